@@ -8,6 +8,7 @@
 
 #include <readline/readline.h>
 #include <gfx/gfx.h>
+#include <cstdlib>
 
 using namespace gfx;
 
@@ -125,6 +126,7 @@ int main(int argc, const char * argv[])
     auto files = make<Array<const String>>();
     
     const String *canvasOutputFilePath = nullptr;
+    Image::EncodingOptions canvasOutputOptions = Image::DefaultEncodingOptions;
     gfx::Size canvasSize{500, 500};
     
     for (const Argument *argument : arguments) {
@@ -151,6 +153,33 @@ int main(int argc, const char * argv[])
                     
                     canvasSize.width = sizeVector->at(0)->doubleValue();
                     canvasSize.height = sizeVector->at(1)->doubleValue();
+                } else if(label->isEqual(str("compression-level"))) {
+                    const char *levelString = argument->value()->getCString();
+                    char *levelEnd = nullptr;
+                    long compressionLevel = strtol(levelString, &levelEnd, 10);
+                    if(levelEnd == levelString || *levelEnd != '\0' || compressionLevel < 0 || compressionLevel > 9) {
+                        std::cerr << "*** Warning: malformed level given with \"--compression-level\". Must be between 0 and 9" << std::endl;
+                        break;
+                    }
+                    
+                    canvasOutputOptions.compressionLevel = int(compressionLevel);
+                } else if(label->isEqual(str("png-filter"))) {
+                    const String *filter = argument->value();
+                    if(filter->isEqual(str("adaptive"))) {
+                        canvasOutputOptions.filter = Image::PNGFilter::Adaptive;
+                    } else if(filter->isEqual(str("none"))) {
+                        canvasOutputOptions.filter = Image::PNGFilter::None;
+                    } else if(filter->isEqual(str("sub"))) {
+                        canvasOutputOptions.filter = Image::PNGFilter::Sub;
+                    } else if(filter->isEqual(str("up"))) {
+                        canvasOutputOptions.filter = Image::PNGFilter::Up;
+                    } else if(filter->isEqual(str("average"))) {
+                        canvasOutputOptions.filter = Image::PNGFilter::Average;
+                    } else if(filter->isEqual(str("paeth"))) {
+                        canvasOutputOptions.filter = Image::PNGFilter::Paeth;
+                    } else {
+                        std::cerr << "*** Warning: unknown filter given with \"--png-filter\". Must be one of adaptive, none, sub, up, average, or paeth" << std::endl;
+                    }
                 }
                 
                 break;
@@ -158,6 +187,11 @@ int main(int argc, const char * argv[])
         }
     }
     
+    if(canvasOutputFilePath && !Image::isRepresentationTypeAvailable(Image::representationTypeForPath(canvasOutputFilePath))) {
+        std::cerr << "!!! Could not write '" << canvasOutputFilePath->getCString() << "': its format is unavailable" << std::endl;
+        return 1;
+    }
+    
     Context::pushContext(Context::bitmapContextWith(canvasSize));
     
     for (const String *filePath : files) {
@@ -183,9 +217,13 @@ int main(int argc, const char * argv[])
     
     if(canvasOutputFilePath) {
         auto image = Context::currentContext()->makeImage();
-        Blob *data = image->makeRepresentation(Image::RepresentationType::PNG);
         auto file = make<File>(canvasOutputFilePath, File::Mode::Write);
-        file->write(data);
+        try {
+            image->writeRepresentation(Image::representationTypeForPath(canvasOutputFilePath), file, canvasOutputOptions);
+        } catch (Exception e) {
+            std::cerr << "!!! Could not write '" << canvasOutputFilePath->getCString() << "': " << e.reason()->getCString() << std::endl;
+            return 1;
+        }
     }
     
     return 0;
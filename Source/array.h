@@ -12,7 +12,10 @@
 #include "base.h"
 #include "str.h"
 #include "exception.h"
+#include "persistent.h"
+#include <algorithm>
 #include <initializer_list>
+#include <vector>
 
 namespace gfx {
     
@@ -22,6 +25,10 @@ namespace gfx {
     ///
     ///All instances of `Array` have mutable storage, to represent an
     ///immutable array, qualify the instance with the const modifier.
+    ///
+    ///Arrays are backed by a `persistent::Vector`. Copying an array is O(1),
+    ///and reading, appending, replacing, and removing the last value are
+    ///O(log32 n). The copy and the original share structure until mutated.
     template<typename T = Base>
     class Array : public Base
     {
@@ -29,26 +36,39 @@ namespace gfx {
         static_assert(!std::is_pointer<T>::value, "T must be a bare type");
         
         ///The storage of the array.
-        CFMutableArrayRef mStorage;
+        persistent::Vector<T> mStorage;
         
     public:
         
         ///Constructs an empty array.
         Array() :
-            mStorage(CFArrayCreateMutable(kCFAllocatorDefault, 0, &Base::kArrayCallbacks))
+            mStorage()
         {
         }
         
         ///Constructs an array by copying the contents of given array.
+        ///
+        ///The copy shares its structure with the given array, and is O(1).
         Array(const Array<T> *other) :
-            mStorage(CFArrayCreateMutableCopy(kCFAllocatorDefault, other->count(), other->mStorage))
+            mStorage(other->mStorage)
         {
         }
         
         ///Constructs an array by copying the contents of a given CFArray.
+        ///
+        ///The CFArray must contain instances of T.
         Array(CFArrayRef array) :
-            mStorage(CFArrayCreateMutableCopy(kCFAllocatorDefault, CFArrayGetCount(array), array))
+            Array()
+        {
+            for (Index index = 0, count = CFArrayGetCount(array); index < count; index++)
+                mStorage.push((T *)CFArrayGetValueAtIndex(array, index));
+        }
+        
+        ///Constructs an array containing the values of a given vector, in order.
+        Array(const std::vector<T *> &values) :
+            mStorage()
         {
+            mStorage.assign(values.data(), values.size());
         }
         
         ///Constructs an array using an initializer list.
@@ -62,17 +82,13 @@ namespace gfx {
         ///The destructor.
         ~Array()
         {
-            if(mStorage) {
-                CFRelease(mStorage);
-                mStorage = NULL;
-            }
         }
         
 #pragma mark - Identity
         
         HashCode hash() const override
         {
-            return CFHash(mStorage);
+            return (HashCode)count();
         }
         
         const String *description() const override
@@ -99,7 +115,17 @@ namespace gfx {
             if(!other)
                 return false;
             
-            return CFEqual(mStorage, other->mStorage);
+            if(other->count() != this->count())
+                return false;
+            
+            persistent::Vector<T> otherStorage(other->mStorage);
+            bool isEqual = true;
+            mStorage.forEach(0, mStorage.count(), [&otherStorage, &isEqual](T *value, size_t index) {
+                isEqual = persistent::values_equal(value, otherStorage.at(index));
+                return isEqual;
+            });
+            
+            return isEqual;
         }
         
         bool isEqual(const Base *other) const override
@@ -107,34 +133,19 @@ namespace gfx {
             if(!other)
                 return false;
             
-            if(this->isKindOfClass<Array<T>>()) {
+            if(other->isKindOfClass<Array<T>>()) {
                 return this->isEqual((const Array<T> *)other);
             }
             
             return false;
         }
         
-#pragma mark - Storage
-        
-        ///Returns the underlying storage of the dictionary.
-        ///
-        ///This should be considered an implementation detail,
-        ///but is exposed for platform compatibility.
-        CFArrayRef getStorage() const
-        {
-            return (CFArrayRef)mStorage;
-        }
-        CFMutableArrayRef getStorage()
-        {
-            return mStorage;
-        }
-        
 #pragma mark - Reading
         
         ///Returns the number of values contained within the receiver.
         Index count() const
         {
-            return CFArrayGetCount(mStorage);
+            return (Index)mStorage.count();
         }
         
         ///Returns the value stored at a given index.
@@ -142,21 +153,28 @@ namespace gfx {
         /// \throws Exception for out of bounds errors.
         T *at(Index index) const
         {
-            gfx_assert((index < this->count()), str("out of range access"));
+            gfx_assert((index >= 0 && index < this->count()), str("out of range access"));
             
-            auto value = (T *)CFArrayGetValueAtIndex(mStorage, index);
-            return retained_autoreleased(value);
+            return retained_autoreleased(mStorage.at(index));
         }
         
         ///Returns a new subarray with the values
         ///contained within a given range of the receiver.
         Array<T> *subarray(Range range) const
         {
-            const void *rawObjects[range.length];
-            CFArrayGetValues(mStorage, range, rawObjects);
+            gfx_assert(range.location >= 0 && range.max() <= count(), str("bad range"));
+            
+            Array<T> *subarray = make<Array<T>>();
+            if(range.location == 0 && range.length == count()) {
+                subarray->mStorage = mStorage;
+            } else {
+                mStorage.forEach(range.location, range.length, [subarray](T *value, size_t index) {
+                    subarray->mStorage.push(value);
+                    return true;
+                });
+            }
             
-            cf::ArrayAutoRef tempArray = CFArrayCreate(kCFAllocatorDefault, rawObjects, range.length, NULL);
-            return make<Array<T>>(tempArray);
+            return subarray;
         }
         
         ///Returns the first value contained in the receiver, or null if the array is empty.
@@ -183,31 +201,61 @@ namespace gfx {
         ///or kCFNotFound if the value is not contained within the array.
         Index firstIndexOf(Range range, T *value) const
         {
-            return CFArrayGetFirstIndexOfValue(mStorage, range, value);
+            gfx_assert(range.location >= 0 && range.max() <= count(), str("bad range"));
+            
+            Index foundIndex = kCFNotFound;
+            mStorage.forEach(range.location, range.length, [value, &foundIndex](T *candidate, size_t index) {
+                if(persistent::values_equal(candidate, value)) {
+                    foundIndex = (Index)index;
+                    return false;
+                }
+                
+                return true;
+            });
+            
+            return foundIndex;
         }
         
         ///Returns the last index of a given value within the receiver,
         ///or kCFNotFound if the value is not contained within the array.
         Index lastIndexOf(Range range, T *value) const
         {
-            return CFArrayGetLastIndexOfValue(mStorage, range, value);
+            gfx_assert(range.location >= 0 && range.max() <= count(), str("bad range"));
+            
+            for (Index index = range.max() - 1; index >= range.location; index--) {
+                if(persistent::values_equal(mStorage.at(index), value))
+                    return index;
+            }
+            
+            return kCFNotFound;
         }
         
         ///Returns a bool indicating whether or not the array contains a given value.
         bool contains(Range range, T *value) const
         {
-            return CFArrayContainsValue(mStorage, range, value);
+            return (firstIndexOf(range, value) != kCFNotFound);
         }
         
 #pragma mark - Mutation
         
         ///Inserts a given value at a given index within the receiver.
+        ///
+        ///Inserting at the end of the array is O(1), elsewhere it is O(n).
         void insertAt(T *value, Index index)
         {
-            gfx_assert((index <= this->count()), str("out of range"));
+            gfx_assert((index >= 0 && index <= this->count()), str("out of range"));
             gfx_assert_param(value);
             
-            CFArrayInsertValueAtIndex(mStorage, index, value);
+            if(index == this->count()) {
+                mStorage.push(value);
+                return;
+            }
+            
+            persistent::Vector<T> oldStorage(mStorage);
+            std::vector<T *> values;
+            oldStorage.copyInto(values);
+            values.insert(values.begin() + index, value);
+            mStorage.assign(values.data(), values.size());
         }
         
         ///Appends a given value to the end of the receiver.
@@ -215,25 +263,38 @@ namespace gfx {
         {
             gfx_assert_param(value);
             
-            CFArrayAppendValue(mStorage, value);
+            mStorage.push(value);
         }
         
         ///Appends the values contained in an array to the end of the receiver.
+        ///
+        ///Appending to an empty array shares the given array's structure, and is O(1).
         void appendArray(const Array<T> *array)
         {
             gfx_assert_param(array);
             
-            CFArrayAppendArray(mStorage, array->getStorage(), Range(0, array->count()));
+            mStorage.append(array->mStorage);
         }
         
         ///Removes the value at a given index.
         ///
+        ///Removing the last value is O(1), removing any other value is O(n).
+        ///
         /// \throws Exception for out of bounds errors.
         void removeAt(Index index)
         {
-            gfx_assert((index < this->count()), str("out of range"));
+            gfx_assert((index >= 0 && index < this->count()), str("out of range"));
+            
+            if(index == this->count() - 1) {
+                mStorage.pop();
+                return;
+            }
             
-            CFArrayRemoveValueAtIndex(mStorage, index);
+            persistent::Vector<T> oldStorage(mStorage);
+            std::vector<T *> values;
+            oldStorage.copyInto(values);
+            values.erase(values.begin() + index);
+            mStorage.assign(values.data(), values.size());
         }
         
         void remove(T *value)
@@ -266,7 +327,7 @@ namespace gfx {
         ///Removes all of the values contained within the array.
         void removeAll()
         {
-            CFArrayRemoveAllValues(mStorage);
+            mStorage.clear();
         }
         
         ///Exchanges the values at the two given indexes within the receiver.
@@ -274,25 +335,28 @@ namespace gfx {
         /// \throws Exception for out of bounds errors.
         void exchange(Index index1, Index index2)
         {
-            gfx_assert((index1 < this->count()), str("out of range"));
-            gfx_assert((index2 < this->count()), str("out of range"));
+            gfx_assert((index1 >= 0 && index1 < this->count()), str("out of range"));
+            gfx_assert((index2 >= 0 && index2 < this->count()), str("out of range"));
             
-            CFArrayExchangeValuesAtIndices(mStorage, index1, index2);
+            persistent::Vector<T> oldStorage(mStorage);
+            mStorage.set(index1, oldStorage.at(index2));
+            mStorage.set(index2, oldStorage.at(index1));
         }
         
-    private:
-        
-        static CFComparisonResult comparer(T *val1, T *val2, std::function<CFComparisonResult(T *left, T *right)> *comparator)
-        {
-            return (*comparator)(val1, val2);
-        }
-        
-    public:
-        
         ///Sorts the contents of the array using a given comparator function.
+        ///
+        ///The sort is stable.
         void sort(Range range, std::function<CFComparisonResult(T *left, T *right)> comparator)
         {
-            CFArraySortValues(mStorage, range, (CFComparatorFunction)&comparer, &comparator);
+            gfx_assert(range.location >= 0 && range.max() <= count(), str("bad range"));
+            
+            persistent::Vector<T> oldStorage(mStorage);
+            std::vector<T *> values;
+            oldStorage.copyInto(values);
+            std::stable_sort(values.begin() + range.location, values.begin() + range.max(), [&comparator](T *left, T *right) {
+                return (comparator(left, right) == kCFCompareLessThan);
+            });
+            mStorage.assign(values.data(), values.size());
         }
         
 #pragma mark - Iteration
@@ -306,34 +370,30 @@ namespace gfx {
         }
         
         ///Enumerates the contents of the receiver, applying a given function with each value.
+        ///
+        ///The values are kept alive for the duration of the enumeration,
+        ///even if the receiver is mutated by the function.
         void iterate(Range range, std::function<void(T *value, Index index, bool *stop)> function) const
         {
-            gfx_assert(range.max() <= count(), str("bad range"));
+            gfx_assert(range.location >= 0 && range.max() <= count(), str("bad range"));
             
-            bool stop = false;
-            for (Index index = range.location, count = range.max(); index < count; index++) {
-                function(this->at(index), index, &stop);
-                
-                if(stop)
-                    break;
-            }
+            persistent::Vector<T> snapshot(mStorage);
+            snapshot.forEach(range.location, range.length, [&function](T *value, size_t index) {
+                bool stop = false;
+                function(value, (Index)index, &stop);
+                return !stop;
+            });
         }
         
         ///Maps the contents of the receiver, applying a given function with each value,
         ///and placing the returned value of the function into a new array.
         const Array *map(Range range, std::function<T *(T *value, Index index, bool *stop)> function) const
         {
-            gfx_assert(range.max() <= count(), str("bad range"));
-            
             Array<T> *newArray = make<Array<T>>();
             
-            bool stop = false;
-            for (Index index = range.location, count = range.max(); index < count; index++) {
-                T *newValue = function(this->at(index), index, &stop);
-                newArray->append(newValue);
-                if(stop)
-                    break;
-            }
+            iterate(range, [newArray, &function](T *value, Index index, bool *stop) {
+                newArray->append(function(value, index, stop));
+            });
             
             return newArray;
         }
@@ -342,19 +402,12 @@ namespace gfx {
         ///and placing the values for which the function returns true in a new array.
         const Array *filter(Range range, std::function<bool(T *value, Index index, bool *stop)> function) const
         {
-            gfx_assert(range.max() <= count(), str("bad range"));
-            
             Array<T> *newArray = make<Array<T>>();
             
-            bool stop = false;
-            for (Index index = range.location, count = range.max(); index < count; index++) {
-                T *value =this->at(index);
-                if(function(value, index, &stop))
-                   newArray->append(value);
-                
-                if(stop)
-                    break;
-            }
+            iterate(range, [newArray, &function](T *value, Index index, bool *stop) {
+                if(function(value, index, stop))
+                    newArray->append(value);
+            });
             
             return newArray;
         }
@@ -6,9 +6,17 @@
 //  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
 //
 
+#if GFX_Include_GraphicsStack
+
 #include "attributedstr.h"
-#include <CoreText/CoreText.h>
+#if !GFX_Graphics_Use_Raster
+#   include <CoreText/CoreText.h>
+#endif /* !GFX_Graphics_Use_Raster */
 #include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <vector>
 
 #include "number.h"
 #include "font.h"
@@ -19,6 +27,7 @@
 
 #include "graphics.h"
 #include "stackframe.h"
+#include "lrucache.h"
 
 namespace gfx {
     
@@ -38,6 +47,7 @@ namespace gfx {
     {
     }
     
+#if !GFX_Graphics_Use_Raster
     TextAttributes::TextAttributes(CFDictionaryRef dictionary) :
         TextAttributes()
     {
@@ -51,6 +61,7 @@ namespace gfx {
                 this->setForegroundColor(make<Color>(foregroundColor));
         }
     }
+#endif /* !GFX_Graphics_Use_Raster */
     
     TextAttributes::~TextAttributes()
     {
@@ -78,8 +89,8 @@ namespace gfx {
         if(!other)
             return false;
         
-        return ((other->mFont && other->mFont->isEqual(mFont)) &&
-                (other->mForegroundColor && other->mForegroundColor->isEqual(mForegroundColor)));
+        return ((other->mFont == mFont || (other->mFont && other->mFont->isEqual(mFont))) &&
+                (other->mForegroundColor == mForegroundColor || (other->mForegroundColor && other->mForegroundColor->isEqual(mForegroundColor))));
     }
     
     bool TextAttributes::isEqual(const Base *other) const
@@ -128,6 +139,7 @@ namespace gfx {
         return retained_autoreleased(mForegroundColor);
     }
     
+#if !GFX_Graphics_Use_Raster
 #pragma mark -
     
     CFDictionaryRef TextAttributes::copyAttributesDictionary() const
@@ -146,9 +158,34 @@ namespace gfx {
         
         return attributes;
     }
+#endif /* !GFX_Graphics_Use_Raster */
     
 #pragma mark - Lifecycle
     
+#if GFX_Graphics_Use_Raster
+    AttributedString::AttributedString(const String *string, const TextAttributes *attributes) :
+        Base(),
+        mString(new String(string)),
+        mAttributes(attributes? new TextAttributes(attributes) : new TextAttributes())
+    {
+    }
+    
+    AttributedString::AttributedString(const AttributedString *other) :
+        Base(),
+        mString(retained(other->mString)),
+        mAttributes(new TextAttributes(other->mAttributes))
+    {
+    }
+    
+    AttributedString::~AttributedString()
+    {
+        released(mString);
+        mString = nullptr;
+        
+        released(mAttributes);
+        mAttributes = nullptr;
+    }
+#else
     AttributedString::AttributedString(const String *string, const TextAttributes *attributes) :
         Base(),
         mStorage(CFAttributedStringCreateMutable(kCFAllocatorDefault, 0))
@@ -171,12 +208,17 @@ namespace gfx {
             mStorage = NULL;
         }
     }
+#endif /* GFX_Graphics_Use_Raster */
     
 #pragma mark - Identity
     
     HashCode AttributedString::hash() const
     {
+#if GFX_Graphics_Use_Raster
+        return mString->hash();
+#else
         return CFHash(get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     bool AttributedString::isEqual(const AttributedString *other) const
@@ -184,7 +226,11 @@ namespace gfx {
         if(!other)
             return false;
         
+#if GFX_Graphics_Use_Raster
+        return (mString->isEqual(other->mString) && mAttributes->isEqual(other->mAttributes));
+#else
         return CFEqual(get(), other->get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     bool AttributedString::isEqual(const Base *other) const
@@ -206,6 +252,7 @@ namespace gfx {
         return description;
     }
     
+#if !GFX_Graphics_Use_Raster
 #pragma mark - Storage
     
     AttributedString::NativeType AttributedString::get()
@@ -217,17 +264,26 @@ namespace gfx {
     {
         return static_cast<ConstNativeType>(mStorage);
     }
+#endif /* !GFX_Graphics_Use_Raster */
     
 #pragma mark - Introspection
     
     Index AttributedString::length() const
     {
+#if GFX_Graphics_Use_Raster
+        return mString->length();
+#else
         return CFAttributedStringGetLength(get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     const String *AttributedString::string() const
     {
+#if GFX_Graphics_Use_Raster
+        return retained_autoreleased(mString);
+#else
         return make<String>(CFAttributedStringGetString(get()));
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark - Attributes
@@ -236,12 +292,228 @@ namespace gfx {
     {
         gfx_assert(locationInString < length(), str("Out of bounds access"));
         
+#if GFX_Graphics_Use_Raster
+        return make<TextAttributes>(mAttributes);
+#else
         auto attributes = CFAttributedStringGetAttributes(get(), locationInString, NULL);
         return make<TextAttributes>(attributes);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark - Drawing
     
+#if GFX_Graphics_Use_Raster
+    ///A line of text laid out by the software rasterizer.
+    struct TextLine
+    {
+        ///The glyphs of the line, positioned relative to the start of its baseline.
+        std::vector<raster::PositionedGlyph> glyphs;
+        
+        ///The advance width of the line, excluding trailing whitespace.
+        Float width;
+    };
+    
+    ///The lines an attributed string is broken into to fit within a constraint
+    ///size, along with the metrics needed to measure and draw them.
+    struct TextLayout
+    {
+        ///The lines of the text.
+        std::vector<TextLine> lines;
+        
+        ///The distance between the baselines of consecutive lines.
+        Float lineHeight;
+        
+        ///The distance from the top of the text to the baseline of the first line.
+        Float ascent;
+        
+        ///The size the lines occupy.
+        Size renderSize;
+        
+        ///Whether or not the text was laid out as a single line that did not need
+        ///breaking or truncating, and is laid out the same way within any constraint
+        ///size at least as wide as it.
+        bool isNaturalLine;
+    };
+    
+    ///A character of text and the glyph it is drawn with.
+    struct TextCluster
+    {
+        ///The Unicode code point of the character.
+        uint32_t character;
+        
+        ///The glyph of the character.
+        uint16_t glyph;
+        
+        ///The advance width of the glyph.
+        Float advance;
+    };
+    
+    ///Returns whether or not a character ends a paragraph.
+    static bool IsLineSeparator(uint32_t character)
+    {
+        return (character == '\n' || character == '\r' || character == 0x2028 || character == 0x2029);
+    }
+    
+    ///Returns the clusters of a string drawn in a font.
+    static std::vector<TextCluster> ClustersForString(const String *string, const raster::Font &font)
+    {
+        const raster::Typeface &typeface = *font.typeface;
+        Float scale = font.size / typeface.unitsPerEm();
+        
+        Index length = string->length();
+        std::vector<UniChar> characters(length);
+        string->getCharacters(Range(0, length), characters.data());
+        
+        std::vector<TextCluster> clusters;
+        clusters.reserve(length);
+        for (Index index = 0; index < length; index++) {
+            uint32_t character = characters[index];
+            if(character >= 0xD800 && character < 0xDC00 && index + 1 < length &&
+               characters[index + 1] >= 0xDC00 && characters[index + 1] < 0xE000) {
+                character = 0x10000 + ((character - 0xD800) << 10) + (characters[index + 1] - 0xDC00);
+                index++;
+            }
+            
+            uint16_t glyph = typeface.glyphForCharacter(character);
+            clusters.push_back(TextCluster{ character, glyph, typeface.advance(glyph) * scale });
+        }
+        
+        return clusters;
+    }
+    
+    ///Adds a line made of runs of clusters to a layout.
+    static void AddLine(TextLayout *layout, std::initializer_list<std::pair<const TextCluster *, const TextCluster *>> runs)
+    {
+        TextLine line{ {}, 0.0 };
+        Float penX = 0.0;
+        for (const auto &run : runs) {
+            for (const TextCluster *cluster = run.first; cluster < run.second; cluster++) {
+                line.glyphs.push_back(raster::PositionedGlyph{ cluster->glyph, Point{ penX, 0.0 } });
+                penX += cluster->advance;
+                
+                if(cluster->character != ' ' && cluster->character != '\t')
+                    line.width = penX;
+            }
+        }
+        
+        layout->renderSize.width = std::max(layout->renderSize.width, line.width);
+        layout->lines.push_back(std::move(line));
+    }
+    
+    static TextLayout *CreateLayoutForString(const String *string,
+                                             const TextAttributes *attributes,
+                                             LineBreakMode lineBreakMode,
+                                             Size boundingSize)
+    {
+        Font *font = attributes->font();
+        gfx_assert(font, str("cannot render text without a font."));
+        
+        const raster::Font &nativeFont = *font->get();
+        TextLayout *layout = new TextLayout{ {}, font->lineHeight(), font->ascent(), Size{}, false };
+        
+        std::vector<TextCluster> clusters = ClustersForString(string, nativeFont);
+        const TextCluster *paragraph = clusters.data(), *end = clusters.data() + clusters.size();
+        
+        uint16_t ellipsisGlyph = nativeFont.typeface->glyphForCharacter(0x2026);
+        TextCluster ellipsis{ 0x2026, ellipsisGlyph, nativeFont.typeface->advance(ellipsisGlyph) * nativeFont.size / nativeFont.typeface->unitsPerEm() };
+        
+        while (paragraph < end && layout->renderSize.height <= boundingSize.height) {
+            const TextCluster *paragraphEnd = paragraph;
+            while (paragraphEnd < end && !IsLineSeparator(paragraphEnd->character))
+                paragraphEnd++;
+            
+            switch (lineBreakMode) {
+                case LineBreakMode::CharWrap:
+                case LineBreakMode::WordWrap: {
+                    const TextCluster *line = paragraph;
+                    do {
+                        layout->renderSize.height += layout->lineHeight;
+                        
+                        //Lines always take at least one character, so that text narrower than a
+                        //single character still makes progress.
+                        const TextCluster *lineEnd = line;
+                        Float width = 0.0;
+                        while (lineEnd < paragraphEnd && (lineEnd == line || width + lineEnd->advance <= boundingSize.width))
+                            width += (lineEnd++)->advance;
+                        
+                        //Word wrapped lines end after the last space that fits, if there is one.
+                        if(lineBreakMode == LineBreakMode::WordWrap && lineEnd < paragraphEnd && lineEnd->character != ' ') {
+                            const TextCluster *lastSpace = lineEnd;
+                            while (lastSpace > line && lastSpace[-1].character != ' ')
+                                lastSpace--;
+                            
+                            if(lastSpace > line)
+                                lineEnd = lastSpace;
+                        }
+                        
+                        //Spaces a line is broken at are kept at the end of the line.
+                        while (lineEnd < paragraphEnd && lineEnd->character == ' ')
+                            lineEnd++;
+                        
+                        AddLine(layout, { { line, lineEnd } });
+                        line = lineEnd;
+                    } while (line < paragraphEnd && layout->renderSize.height <= boundingSize.height);
+                    
+                    break;
+                }
+                    
+                case LineBreakMode::TruncateHead:
+                case LineBreakMode::TruncateMiddle:
+                case LineBreakMode::TruncateTail: {
+                    layout->renderSize.height += layout->lineHeight;
+                    
+                    Float width = 0.0;
+                    for (const TextCluster *cluster = paragraph; cluster < paragraphEnd; cluster++)
+                        width += cluster->advance;
+                    
+                    if(width <= boundingSize.width) {
+                        AddLine(layout, { { paragraph, paragraphEnd } });
+                        break;
+                    }
+                    
+                    //Truncated lines keep as many characters as fit alongside an ellipsis,
+                    //from the end, the start, or both, depending on the line break mode.
+                    Float available = boundingSize.width - ellipsis.advance;
+                    Float headAvailable = (lineBreakMode == LineBreakMode::TruncateTail)? available :
+                                          (lineBreakMode == LineBreakMode::TruncateMiddle)? available / 2.0 : 0.0;
+                    
+                    const TextCluster *headEnd = paragraph;
+                    Float headWidth = 0.0;
+                    while (headEnd < paragraphEnd && headWidth + headEnd->advance <= headAvailable)
+                        headWidth += (headEnd++)->advance;
+                    
+                    const TextCluster *tailStart = paragraphEnd;
+                    Float tailWidth = 0.0;
+                    if(lineBreakMode != LineBreakMode::TruncateTail) {
+                        while (tailStart > headEnd && headWidth + tailWidth + tailStart[-1].advance <= available)
+                            tailWidth += (--tailStart)->advance;
+                    }
+                    
+                    AddLine(layout, { { paragraph, headEnd }, { &ellipsis, &ellipsis + 1 }, { tailStart, paragraphEnd } });
+                    break;
+                }
+            }
+            
+            paragraph = paragraphEnd;
+            if(paragraph < end && paragraph->character == '\r' && paragraph + 1 < end && paragraph[1].character == '\n')
+                paragraph++;
+            
+            if(paragraph < end)
+                paragraph++;
+        }
+        
+        Float naturalWidth = 0.0;
+        bool hasLineSeparators = false;
+        for (const TextCluster &cluster : clusters) {
+            naturalWidth += cluster.advance;
+            hasLineSeparators = hasLineSeparators || IsLineSeparator(cluster.character);
+        }
+        
+        layout->isNaturalLine = (layout->lines.size() == 1 && !hasLineSeparators && naturalWidth <= boundingSize.width);
+        
+        return layout;
+    }
+#else
     static CTLineRef GetSharedElipsisLine(void)
     {
         static CTLineRef sharedElipsisLine = NULL;
@@ -260,21 +532,44 @@ namespace gfx {
         return CTFontGetDescent(font) + CTFontGetAscent(font) + CTFontGetLeading(font);
     }
     
-    static CFArrayRef CreateLinesForString(CFAttributedStringRef attributedString,
-                                           LineBreakMode lineBreakMode,
-                                           CGSize boundingSize,
-                                           CGSize *outRenderSize)
+    ///The lines an attributed string is broken into to fit within a constraint
+    ///size, along with the metrics needed to measure and draw them.
+    struct TextLayout
+    {
+        ///The lines of the text, as `CTLineRef`s.
+        cf::ArrayAutoRef lines;
+        
+        ///The offset of the baseline of each line from the baseline of the first line.
+        std::vector<CGFloat> lineOrigins;
+        
+        ///The distance from the top of the text to the baseline of the first line.
+        CGFloat ascent;
+        
+        ///The size the lines occupy.
+        CGSize renderSize;
+        
+        ///Whether or not the text was laid out as a single line that did not need
+        ///breaking or truncating, and is laid out the same way within any constraint
+        ///size at least as wide as it.
+        bool isNaturalLine;
+    };
+    
+    static TextLayout *CreateLayoutForString(CFAttributedStringRef attributedString,
+                                             LineBreakMode lineBreakMode,
+                                             CGSize boundingSize)
     {
         CTFontRef font = (CTFontRef)CFAttributedStringGetAttribute(attributedString, 0, kCTFontAttributeName, NULL);
         gfx_assert(font, str("cannot render text without a font."));
         
         CFMutableArrayRef lines = CFArrayCreateMutable(kCFAllocatorDefault, 0, &kCFTypeArrayCallBacks);
+        TextLayout *layout = new TextLayout{ lines, {}, CTFontGetAscent(font), CGSizeZero, false };
         CTTypesetterRef typesetter = CTTypesetterCreateWithAttributedString(attributedString);
         
         CGSize renderSize = CGSizeZero;
         CGFloat lineHeight = xCTFontGetLineHeight(font);
         CFIndex stringLength = CFAttributedStringGetLength(attributedString);
         CFIndex stringOffset = 0;
+        bool wasTruncated = false;
         while (stringOffset < stringLength) {
             renderSize.height += lineHeight;
             
@@ -309,6 +604,7 @@ namespace gfx {
                     
                     consumedCharacters = stringLength - stringOffset;
                     CTLineRef lineToTruncate = CTTypesetterCreateLine(typesetter, CFRangeMake(stringOffset, consumedCharacters));
+                    wasTruncated = wasTruncated || (CTLineGetTypographicBounds(lineToTruncate, NULL, NULL, NULL) > boundingSize.width);
                     line = CTLineCreateTruncatedLine(lineToTruncate, boundingSize.width, truncationType, GetSharedElipsisLine());
                     CFRelease(lineToTruncate);
                     
@@ -319,6 +615,7 @@ namespace gfx {
             if(line) {
                 renderSize.width = std::max<CGFloat>(renderSize.width, CTLineGetTypographicBounds(line, NULL, NULL, NULL));
                 
+                layout->lineOrigins.push_back(lineHeight * CFArrayGetCount(lines));
                 CFArrayAppendValue(lines, line);
                 CFRelease(line);
             }
@@ -331,14 +628,135 @@ namespace gfx {
         
         CFRelease(typesetter);
         
-        if(outRenderSize) *outRenderSize = renderSize;
+        CFStringRef string = CFAttributedStringGetString(attributedString);
+        bool hasLineSeparators = CFStringFindCharacterFromSet(string,
+                                                              CFCharacterSetGetPredefined(kCFCharacterSetNewline),
+                                                              CFRangeMake(0, stringLength),
+                                                              0,
+                                                              NULL);
+        
+        layout->renderSize = renderSize;
+        layout->isNaturalLine = (CFArrayGetCount(lines) == 1 && stringOffset >= stringLength &&
+                                 !hasLineSeparators && !wasTruncated && renderSize.width <= boundingSize.width);
         
-        return lines;
+        return layout;
     }
+#endif /* GFX_Graphics_Use_Raster */
+    
+#pragma mark - Layout Cache
+    
+    ///The parameters an attributed string was laid out with.
+    struct TextLayoutKey
+    {
+        ///An immutable copy of the attributed string.
+        Scoped<const AttributedString> string;
+        
+        ///The line break mode the string was laid out with.
+        LineBreakMode lineBreakMode;
+        
+        ///The constraint size the string was laid out within. Ignored for natural lines.
+        Size constraintSize;
+        
+        ///Whether or not the key refers to a natural line.
+        bool isNaturalLine;
+        
+        bool operator==(const TextLayoutKey &other) const
+        {
+            return (lineBreakMode == other.lineBreakMode && isNaturalLine == other.isNaturalLine &&
+                    (isNaturalLine || (constraintSize.width == other.constraintSize.width &&
+                                       constraintSize.height == other.constraintSize.height)) &&
+                    string->isEqual(other.string));
+        }
+    };
     
+    ///Hashes the parameters of a text layout.
+    struct TextLayoutKeyHash
+    {
+        size_t operator()(const TextLayoutKey &key) const
+        {
+            std::hash<Float> hashFloat;
+            size_t hash = key.string->hash() * 31 + size_t(key.lineBreakMode);
+            if(!key.isNaturalLine)
+                hash = (hash * 31 + hashFloat(key.constraintSize.width)) * 31 + hashFloat(key.constraintSize.height);
+            
+            return hash;
+        }
+    };
+    
+    ///The TextLayoutCache class keeps the most recently used layouts of attributed strings,
+    ///so that measuring text and then drawing it, or drawing the same text on every redraw,
+    ///breaks its lines once.
+    ///
+    ///Layouts of single lines that fit their constraint size without being broken are kept
+    ///regardless of the constraint size, so that measuring a label within a large area and
+    ///drawing it within its measured size share a layout.
+    class TextLayoutCache
+    {
+        ///The cached layouts by the parameters they were created with,
+        ///costing the length of the strings they were created from.
+        LRUCache<TextLayoutKey, std::shared_ptr<const TextLayout>, TextLayoutKeyHash> mLayouts;
+        
+    public:
+        
+        ///The largest number of layouts kept by the cache.
+        static const size_t kMaximumCount = 512;
+        
+        ///The largest total length of the strings of the layouts kept by the cache.
+        static const Index kMaximumTotalLength = 64 * 1024;
+        
+        TextLayoutCache() :
+            mLayouts(kMaximumCount, kMaximumTotalLength)
+        {
+        }
+        
+        ///Returns the shared text layout cache.
+        static TextLayoutCache *shared()
+        {
+            static TextLayoutCache *sharedCache = new TextLayoutCache();
+            return sharedCache;
+        }
+        
+        ///Returns the layout of an attributed string within a constraint size, creating it if it is not in the cache.
+        ///
+        /// \param  attributedString    The attributed string to lay out.
+        /// \param  lineBreakMode       The line break mode to lay the string out with.
+        /// \param  constraintSize      The constraint size to lay the string out within.
+        /// \param  createLayout        A function that creates the layout when it is not in the cache.
+        std::shared_ptr<const TextLayout> layoutFor(const AttributedString *attributedString,
+                                                    LineBreakMode lineBreakMode,
+                                                    Size constraintSize,
+                                                    const std::function<TextLayout *()> &createLayout)
+        {
+            TextLayoutKey key{ attributedString, lineBreakMode, constraintSize, true };
+            std::shared_ptr<const TextLayout> layout;
+            if(mLayouts.find(key, layout) && layout->renderSize.width <= constraintSize.width)
+                return layout;
+            
+            //NaN constraint sizes never compare equal to themselves, so only
+            //natural lines, which ignore the constraint size, can be found again.
+            bool isConstraintCacheable = !std::isnan(constraintSize.width) && !std::isnan(constraintSize.height);
+            
+            key.isNaturalLine = false;
+            if(isConstraintCacheable && mLayouts.find(key, layout))
+                return layout;
+            
+            layout.reset(createLayout());
+            
+            Index length = attributedString->length();
+            if(length > kMaximumTotalLength || (!layout->isNaturalLine && !isConstraintCacheable))
+                return layout;
+            
+            const AttributedString *copy = new AttributedString(attributedString);
+            TextLayoutKey cachedKey{ copy, lineBreakMode, constraintSize, layout->isNaturalLine };
+            released(copy);
+            
+            mLayouts.insert(cachedKey, layout, size_t(length));
+            return layout;
+        }
+    };
 #pragma mark -
     
-    static CGFloat TextAlignmentToFlush(TextAlignment alignment) {
+    static Float TextAlignmentToFlush(TextAlignment alignment) {
         switch (alignment) {
             case TextAlignment::Left:
                 return 0.0;
@@ -351,10 +769,76 @@ namespace gfx {
     
 #pragma mark -
     
+#if GFX_Graphics_Use_Raster
     Size AttributedString::size(LineBreakMode lineBreakMode, Size constraintSize)
     {
-        CGSize renderSize = {};
-        cf::ArrayAutoRef unusedLines = CreateLinesForString(get(), lineBreakMode, constraintSize, &renderSize);
+        auto layout = TextLayoutCache::shared()->layoutFor(this, lineBreakMode, constraintSize, [this, lineBreakMode, constraintSize] {
+            return CreateLayoutForString(mString, mAttributes, lineBreakMode, constraintSize);
+        });
+        Size renderSize = layout->renderSize;
+        return { std::min(renderSize.width, constraintSize.width), std::min(renderSize.height, constraintSize.height) };
+    }
+    
+    Size AttributedString::drawAtPoint(Point point, Float maximumWidth, LineBreakMode lineBreakMode, TextAlignment alignment)
+    {
+        Font *font = mAttributes->font();
+        gfx_assert(font, str("cannot render text without a font."));
+        
+        return drawInRect(Rect{{point.x, point.y}, {maximumWidth, font->lineHeight()}}, lineBreakMode, alignment);
+    }
+    
+    Size AttributedString::drawInRect(Rect rect, LineBreakMode lineBreakMode, TextAlignment alignment)
+    {
+        if(Context::currentContext()->recordingDisplayList()) {
+            Scoped<AttributedString> string = make<AttributedString>(this);
+            Context::currentContext()->recordOperation([string, rect, lineBreakMode, alignment](Context *context) {
+                string->drawInRect(rect, lineBreakMode, alignment);
+            });
+            return size(lineBreakMode, rect.size);
+        }
+        
+        if(Context::currentContext()->quickReject(rect))
+            return size(lineBreakMode, rect.size);
+        
+        auto layout = TextLayoutCache::shared()->layoutFor(this, lineBreakMode, rect.size, [this, lineBreakMode, rect] {
+            return CreateLayoutForString(mString, mAttributes, lineBreakMode, rect.size);
+        });
+        
+        raster::Font font = *mAttributes->font()->get();
+        Color *foregroundColor = mAttributes->foregroundColor();
+        raster::Color color = foregroundColor? *foregroundColor->get() : *Color::black()->get();
+        
+        Context::currentContext()->transaction([rect, alignment, &layout, &font, &color](Context *ctx) {
+            raster::Canvas *canvas = ctx->get();
+            canvas->clipToRect(rect);
+            canvas->setFillColor(color);
+            
+            Float flush = TextAlignmentToFlush(alignment);
+            std::vector<raster::PositionedGlyph> glyphs;
+            for (size_t index = 0; index < layout->lines.size(); index++) {
+                const TextLine &line = layout->lines[index];
+                Point origin{ rect.getMinX() + (rect.getWidth() - line.width) * flush,
+                              rect.getMinY() + layout->ascent + layout->lineHeight * index };
+                
+                glyphs.assign(line.glyphs.begin(), line.glyphs.end());
+                for (raster::PositionedGlyph &glyph : glyphs) {
+                    glyph.position.x += origin.x;
+                    glyph.position.y += origin.y;
+                }
+                
+                canvas->fillGlyphs(*font.typeface, font.size, glyphs.data(), glyphs.size());
+            }
+        });
+        
+        return layout->renderSize;
+    }
+#else
+    Size AttributedString::size(LineBreakMode lineBreakMode, Size constraintSize)
+    {
+        auto layout = TextLayoutCache::shared()->layoutFor(this, lineBreakMode, constraintSize, [this, lineBreakMode, constraintSize] {
+            return CreateLayoutForString(get(), lineBreakMode, constraintSize);
+        });
+        CGSize renderSize = layout->renderSize;
         return { std::min(renderSize.width, constraintSize.width), std::min(renderSize.height, constraintSize.height) };
     }
     
@@ -368,36 +852,42 @@ namespace gfx {
     
     Size AttributedString::drawInRect(Rect rect, LineBreakMode lineBreakMode, TextAlignment alignment)
     {
-        AutoreleasePool pool;
+        if(Context::currentContext()->recordingDisplayList()) {
+            Scoped<AttributedString> string = make<AttributedString>(this);
+            Context::currentContext()->recordOperation([string, rect, lineBreakMode, alignment](Context *context) {
+                string->drawInRect(rect, lineBreakMode, alignment);
+            });
+            return size(lineBreakMode, rect.size);
+        }
         
-        CGSize renderSize = {};
-        cf::ArrayAutoRef lines = CreateLinesForString(get(), lineBreakMode, rect.size, &renderSize);
+        if(Context::currentContext()->quickReject(rect))
+            return size(lineBreakMode, rect.size);
         
-        auto font = (CTFontRef)CFAttributedStringGetAttribute(get(), 0, kCTFontAttributeName, NULL);
-        gfx_assert(font, str("cannot render text without a font."));
+        AutoreleasePool pool;
         
-        Context::currentContext()->transaction([rect, lines, font, alignment](Context *ctx) {
+        auto layout = TextLayoutCache::shared()->layoutFor(this, lineBreakMode, rect.size, [this, lineBreakMode, rect] {
+            return CreateLayoutForString(get(), lineBreakMode, rect.size);
+        });
+        
+        Context::currentContext()->transaction([rect, layout, alignment](Context *ctx) {
             CGContextClipToRect(ctx->get(), rect);
-            CGContextTranslateCTM(ctx->get(), rect.getMinX(), rect.getMinY() + CTFontGetAscent(font));
+            CGContextTranslateCTM(ctx->get(), rect.getMinX(), rect.getMinY() + layout->ascent);
             CGContextSetTextMatrix(ctx->get(), ctx->currentTransformationMatrix());
             
-            CGFloat lineOffset = 0.0;
-            CGFloat lineHeight = xCTFontGetLineHeight(font);
             CGFloat flush = TextAlignmentToFlush(alignment);
-            for (CFIndex i = 0, c = CFArrayGetCount(lines); i < c; i++) {
-                CTLineRef line = (CTLineRef)CFArrayGetValueAtIndex(lines, i);
+            for (CFIndex i = 0, c = CFArrayGetCount(layout->lines); i < c; i++) {
+                CTLineRef line = (CTLineRef)CFArrayGetValueAtIndex(layout->lines, i);
                 
                 double penOffset = CTLineGetPenOffsetForFlush(line, flush, rect.getWidth());
-                CGContextSetTextPosition(ctx->get(), penOffset, lineOffset);
+                CGContextSetTextPosition(ctx->get(), penOffset, layout->lineOrigins[i]);
                 
                 CTLineDraw(line, ctx->get());
-                
-                lineOffset += lineHeight;
             }
         });
         
-        return renderSize;
+        return layout->renderSize;
     }
+#endif /* GFX_Graphics_Use_Raster */
     
 #pragma mark - Functions
     
@@ -447,9 +937,11 @@ namespace gfx {
     
     void AttributedString::addTo(gfx::StackFrame *frame)
     {
-        frame->createFunctionBinding(str("text"), &text_make);
-        frame->createFunctionBinding(str("text/size"), &text_size);
-        frame->createFunctionBinding(str("text/draw-at"), &text_drawAt);
-        frame->createFunctionBinding(str("text/draw-in"), &text_drawIn);
+        frame->createFunctionBinding(gfx_str("text"), &text_make);
+        frame->createFunctionBinding(gfx_str("text/size"), &text_size);
+        frame->createFunctionBinding(gfx_str("text/draw-at"), &text_drawAt);
+        frame->createFunctionBinding(gfx_str("text/draw-in"), &text_drawIn);
     }
 }
+
+#endif /* GFX_Include_GraphicsStack */
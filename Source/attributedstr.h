@@ -9,6 +9,8 @@
 #ifndef __gfx__attributedstr__
 #define __gfx__attributedstr__
 
+#if GFX_Include_GraphicsStack
+
 #include "base.h"
 
 namespace gfx {
@@ -70,8 +72,10 @@ namespace gfx {
         ///
         TextAttributes(const TextAttributes *attributes);
         
+#if !GFX_Graphics_Use_Raster
         ///Constructs a text attributes object by copying the contents of a native attributes container.
         TextAttributes(CFDictionaryRef dictionary);
+#endif /* !GFX_Graphics_Use_Raster */
         
         ///The destructor.
         ~TextAttributes();
@@ -99,6 +103,7 @@ namespace gfx {
         ///Returns the foreground color.
         virtual Color *foregroundColor() const;
         
+#if !GFX_Graphics_Use_Raster
 #pragma mark -
         
     private:
@@ -108,6 +113,7 @@ namespace gfx {
         
         ///For `gfx::TextAttributes::copyAttributesDictionary`.
         friend class AttributedString;
+#endif /* !GFX_Graphics_Use_Raster */
     };
     
 #pragma mark -
@@ -116,11 +122,24 @@ namespace gfx {
     ///containing attributes for ranges of said string. It is one of the core classes
     ///forming the basis of text in the Gfx graphics stack.
     ///
-    /// \discussion This class is not as efficient as it could be. Specifically, it would
-    ///             probably make sense to cache layout information across drawing operations.
+    ///The layouts of attributed strings are kept in a cache keyed by their contents,
+    ///attributes, and constraint sizes, so measuring a string and then drawing it, or
+    ///drawing the same string on every redraw, breaks its lines once.
     ///
+    ///With the software rasterizer, the attributes of an attributed string apply to all
+    ///of its contents. Its glyphs are drawn from the glyph atlas of `gfx::raster::Canvas`,
+    ///so drawing the same labels on every redraw does not rasterize them again.
     class AttributedString : public Base
     {
+#if GFX_Graphics_Use_Raster
+    protected:
+        
+        ///The contents of the attributed string.
+        const String *mString;
+        
+        ///The attributes applied to the contents of the attributed string.
+        TextAttributes *mAttributes;
+#else
     public:
         
         ///The native type backing the AttributedString class.
@@ -133,6 +152,7 @@ namespace gfx {
         
         ///The backing storage of the attributed string.
         NativeType mStorage;
+#endif /* GFX_Graphics_Use_Raster */
         
     public:
         
@@ -161,6 +181,7 @@ namespace gfx {
         bool isEqual(const Base *other) const override;
         const String *description() const override;
         
+#if !GFX_Graphics_Use_Raster
 #pragma mark - Storage
         
         ///Returns the underlying storage of the attributed string.
@@ -168,6 +189,7 @@ namespace gfx {
         
         ///Returns the underlying storage of the attributed string.
         ConstNativeType get() const;
+#endif /* !GFX_Graphics_Use_Raster */
         
 #pragma mark - Introspection
         
@@ -238,4 +260,6 @@ namespace gfx {
     };
 }
 
+#endif /* GFX_Include_GraphicsStack */
+
 #endif /* defined(__gfx__attributedstr__) */
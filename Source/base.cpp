@@ -10,6 +10,7 @@
 #include <typeinfo>
 #include <cxxabi.h>
 #include <stack>
+#include <pthread.h>
 
 #include "str.h"
 
@@ -118,20 +119,42 @@ namespace gfx {
 #pragma mark - Auto Lifecycle
     
 #if !TARGET_OS_MAC
-    static std::stack<AutoreleasePool *> pools;
+    ///Returns the autorelease pool stack of the calling thread.
+    ///
+    ///Pools are scoped to the thread that created them, so
+    ///worker threads never autorelease into each other's pools.
+    static std::stack<AutoreleasePool *> &currentPools()
+    {
+        static pthread_key_t poolsKey;
+        static pthread_once_t guard = PTHREAD_ONCE_INIT;
+        pthread_once(&guard, []{
+            pthread_key_create(&poolsKey, [](void *pools) {
+                delete (std::stack<AutoreleasePool *> *)pools;
+            });
+        });
+        
+        auto pools = (std::stack<AutoreleasePool *> *)pthread_getspecific(poolsKey);
+        if(!pools) {
+            pools = new std::stack<AutoreleasePool *>();
+            pthread_setspecific(poolsKey, pools);
+        }
+        
+        return *pools;
+    }
     
     static void pushPool(AutoreleasePool *pool)
     {
-        pools.push(pool);
+        currentPools().push(pool);
     }
     
     static void popPool()
     {
-        pools.pop();
+        currentPools().pop();
     }
     
     static AutoreleasePool *getCurrentPool()
     {
+        auto &pools = currentPools();
         if(pools.size() > 0) {
             return pools.top();
         } else {
@@ -16,6 +16,7 @@ namespace gfx {
     Blob::Blob(Index size) :
         Blob(nullptr, size)
     {
+        setLength(size);
     }
     
     Blob::Blob(const UInt8 *buffer, Index size) :
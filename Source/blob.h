@@ -22,9 +22,9 @@ namespace gfx {
         
 #pragma mark - Lifecycle
         
-        ///Constructs a Blob of a given size.
+        ///Constructs a Blob of a given size, filled with zeros.
         ///
-        /// \param  size    The initial size of the blob's buffer.
+        /// \param  size    The initial length of the blob.
         ///
         Blob(Index size = 0);
         
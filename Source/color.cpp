@@ -16,10 +16,130 @@
 #include "stackframe.h"
 #include "number.h"
 
+#include "lrucache.h"
+
+#include <cctype>
+#include <cmath>
+
 namespace gfx {
     
+#pragma mark - Color Cache
+    
+    ///The red, green, blue, and alpha values of a shared color.
+    struct ColorKey
+    {
+        Float red, green, blue, alpha;
+        
+        bool operator==(const ColorKey &other) const
+        {
+            return (red == other.red && green == other.green &&
+                    blue == other.blue && alpha == other.alpha);
+        }
+        
+        ///Returns whether or not every value is finite. NaN values never
+        ///compare equal to themselves, so keys with them can't be found again.
+        bool isCacheable() const
+        {
+            return (std::isfinite(red) && std::isfinite(green) &&
+                    std::isfinite(blue) && std::isfinite(alpha));
+        }
+    };
+    
+    ///Hashes the values of a shared color.
+    struct ColorKeyHash
+    {
+        size_t operator()(const ColorKey &key) const
+        {
+            std::hash<Float> hashFloat;
+            size_t hash = 0;
+            for (Float value : { key.red, key.green, key.blue, key.alpha })
+                hash = hash * 31 + hashFloat(value);
+            
+            return hash;
+        }
+    };
+    
+    ///The ColorCache class keeps the colors most recently returned by `Color::withRGBA`,
+    ///so that heavily styled drawings which use the same few colors over and over share them.
+    class ColorCache
+    {
+        ///The cached colors by the values they were created with.
+        LRUCache<ColorKey, Scoped<Color>, ColorKeyHash> mColors;
+        
+    public:
+        
+        ///The largest number of colors kept by the cache.
+        static const size_t kMaximumCount = 1024;
+        
+        ColorCache() :
+            mColors(kMaximumCount)
+        {
+        }
+        
+        ///Returns the shared color cache.
+        static ColorCache *shared()
+        {
+            static ColorCache *sharedCache = new ColorCache();
+            return sharedCache;
+        }
+        
+        ///Returns the autoreleased color with given values, creating it if it is not in the cache.
+        ///
+        ///Colors with values that are not finite are created every time, and never cached.
+        Color *colorFor(const ColorKey &key)
+        {
+            if(!key.isCacheable())
+                return make<Color>(key.red, key.green, key.blue, key.alpha);
+            
+            Scoped<Color> color = mColors.valueFor(key, [&key] {
+                return Scoped<Color>(make<Color>(key.red, key.green, key.blue, key.alpha));
+            });
+            return retained_autoreleased(static_cast<Color *>(color));
+        }
+    };
+    
+#pragma mark - HTML Colors
+    
+    ///Parses the red, green, and blue values of an HTML style color string,
+    ///raising an exception if the string is malformed.
+    static void ParseHTMLColorString(const String *colorString, Float &outRed, Float &outGreen, Float &outBlue)
+    {
+        gfx_assert_param(colorString);
+        
+        bool hasPrefix = colorString->hasPrefix(gfx_str("#"));
+        if(colorString->length() - (hasPrefix? 1 : 0) != 6)
+            throw Exception(str("malformed HTML color string given"), nullptr);
+        
+        unsigned long colorCode = strtoul(colorString->getCString() + (hasPrefix? 1 : 0), NULL, 16);
+        outRed = (unsigned char)(colorCode >> 16) / 255.0;
+        outGreen = (unsigned char)(colorCode >> 8) / 255.0;
+        outBlue = (unsigned char)(colorCode) / 255.0;
+    }
+    
+#if !GFX_Graphics_Use_Raster
+    ///Returns the color space native colors are created in.
+    static CGColorSpaceRef ColorColorSpace()
+    {
+        static CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+        return colorSpace;
+    }
+#endif /* !GFX_Graphics_Use_Raster */
+    
 #pragma mark - Lifecycle
     
+#if GFX_Graphics_Use_Raster
+    Color::Color(NativeType color) :
+        Base(),
+        mColor(*color)
+    {
+    }
+    
+    Color::Color(Float red, Float green, Float blue, Float alpha) :
+        Base(),
+        mColor{ red, green, blue, alpha }
+    {
+    }
+#else
     Color::Color(NativeType color) :
         Base(),
         mColor(color)
@@ -31,56 +151,93 @@ namespace gfx {
         Base(),
         mColor(NULL)
     {
-        CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
         CGFloat components[4] = { red, green, blue, alpha };
-        mColor = CGColorCreate(colorSpace, components);
-        CGColorSpaceRelease(colorSpace);
+        mColor = CGColorCreate(ColorColorSpace(), components);
     }
+#endif /* GFX_Graphics_Use_Raster */
     
     Color::Color(const String *inColorString) :
         Base(),
+#if GFX_Graphics_Use_Raster
+        mColor{}
+#else
         mColor(NULL)
+#endif /* GFX_Graphics_Use_Raster */
     {
-        auto colorString = autoreleased(copy(inColorString));
-        
-        if(colorString->hasPrefix(str("#")))
-            colorString->deleteRange(Range(0, 1));
+        Float red, green, blue;
+        ParseHTMLColorString(inColorString, red, green, blue);
         
-        if(colorString->length() == 6) {
-            unsigned long colorCode = strtoul(colorString->getCString(), NULL, 16);
-            auto red = (unsigned char)(colorCode >> 16);
-            auto green = (unsigned char)(colorCode >> 8);
-            auto blue = (unsigned char)(colorCode);
-            
-            CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
-            CGFloat components[4] = { CGFloat(red / 255.0), CGFloat(green / 255.0), CGFloat(blue / 255.0), 1.0 };
-            mColor = CGColorCreate(colorSpace, components);
-            CGColorSpaceRelease(colorSpace);
-        } else {
-            throw Exception(str("malformed HTML color string given"), nullptr);
-        }
+#if GFX_Graphics_Use_Raster
+        mColor = raster::Color{ red, green, blue, 1.0 };
+#else
+        CGFloat components[4] = { CGFloat(red), CGFloat(green), CGFloat(blue), 1.0 };
+        mColor = CGColorCreate(ColorColorSpace(), components);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     Color::~Color()
     {
+#if !GFX_Graphics_Use_Raster
         if(mColor) {
             CFRelease(mColor);
             mColor = NULL;
         }
+#endif /* !GFX_Graphics_Use_Raster */
+    }
+    
+#pragma mark - Shared Colors
+    
+    Color *Color::withRGBA(Float red, Float green, Float blue, Float alpha)
+    {
+        return ColorCache::shared()->colorFor(ColorKey{ red, green, blue, alpha });
+    }
+    
+    Color *Color::withHTMLString(const String *colorString)
+    {
+        Float red, green, blue;
+        ParseHTMLColorString(colorString, red, green, blue);
+        return withRGBA(red, green, blue, 1.0);
+    }
+    
+    bool Color::isHTMLColorString(const String *string)
+    {
+        if(!string || string->length() != 7 || !string->hasPrefix(gfx_str("#")))
+            return false;
+        
+        const char *digits = string->getCString() + 1;
+        for (Index index = 0; index < 6; index++) {
+            if(!isxdigit((unsigned char)digits[index]))
+                return false;
+        }
+        
+        return true;
     }
     
 #pragma mark - Identity
     
     HashCode Color::hash() const
     {
+#if GFX_Graphics_Use_Raster
+        HashCode hash = 0;
+        for (Float component : { mColor.red, mColor.green, mColor.blue, mColor.alpha })
+            hash = hash * 31 + std::hash<Float>()(component);
+        
+        return hash;
+#else
         return CFHash(mColor);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     bool Color::isEqual(const Base *other) const
     {
         if(other->isKindOfClass<Color>()) {
             const Color *otherColor = (const Color *)other;
+#if GFX_Graphics_Use_Raster
+            return (mColor.red == otherColor->mColor.red && mColor.green == otherColor->mColor.green &&
+                    mColor.blue == otherColor->mColor.blue && mColor.alpha == otherColor->mColor.alpha);
+#else
             return CFEqual(mColor, otherColor->mColor);
+#endif /* GFX_Graphics_Use_Raster */
         }
         
         return false;
@@ -112,34 +269,68 @@ namespace gfx {
     
     void Color::setFill()
     {
+        Scoped<Color> color = this;
+        Context::currentContext()->recordOperation([color](Context *context) {
+            color->setFill();
+        });
+
+#if GFX_Graphics_Use_Raster
+        Context::currentContext()->get()->setFillColor(mColor);
+#else
         CGContextSetFillColorWithColor(Context::currentContext()->get(), mColor);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     void Color::setStroke()
     {
+        Scoped<Color> color = this;
+        Context::currentContext()->recordOperation([color](Context *context) {
+            color->setStroke();
+        });
+
+#if GFX_Graphics_Use_Raster
+        Context::currentContext()->get()->setStrokeColor(mColor);
+#else
         CGContextSetStrokeColorWithColor(Context::currentContext()->get(), mColor);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark - Introspection
     
     Index Color::numberOfComponents() const
     {
+#if GFX_Graphics_Use_Raster
+        return 3;
+#else
         return CGColorGetNumberOfComponents(mColor);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     const Float *Color::getComponents() const
     {
+#if GFX_Graphics_Use_Raster
+        return &mColor.red;
+#else
         return CGColorGetComponents(mColor);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     Float Color::alpha() const
     {
+#if GFX_Graphics_Use_Raster
+        return mColor.alpha;
+#else
         return CGColorGetAlpha(mColor);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     Color::NativeType Color::get() const
     {
+#if GFX_Graphics_Use_Raster
+        return &mColor;
+#else
         return mColor;
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark - Color Functions
@@ -150,7 +341,7 @@ namespace gfx {
         auto green = stack->popNumber();
         auto red = stack->popNumber();
         
-        stack->push(make<Color>(red->value() / 255.0, green->value() / 255.0, blue->value() / 255.0, 1.0));
+        stack->push(Color::withRGBA(red->value() / 255.0, green->value() / 255.0, blue->value() / 255.0, 1.0));
     }
     
     static void rgba(StackFrame *stack)
@@ -160,7 +351,7 @@ namespace gfx {
         auto green = stack->popNumber();
         auto red = stack->popNumber();
         
-        stack->push(make<Color>(red->value() / 255.0, green->value() / 255.0, blue->value() / 255.0, alpha->value()));
+        stack->push(Color::withRGBA(red->value() / 255.0, green->value() / 255.0, blue->value() / 255.0, alpha->value()));
     }
     
     static void set_fill(StackFrame *stack)
@@ -181,22 +372,22 @@ namespace gfx {
     {
         gfx_assert_param(frame);
         
-        frame->createVariableBinding(str("white"), Color::white());
-        frame->createVariableBinding(str("black"), Color::black());
-        frame->createVariableBinding(str("translucent"), Color::clear());
-        frame->createVariableBinding(str("red"), Color::red());
-        frame->createVariableBinding(str("green"), Color::green());
-        frame->createVariableBinding(str("blue"), Color::blue());
-        frame->createVariableBinding(str("orange"), Color::orange());
-        frame->createVariableBinding(str("purple"), Color::purple());
-        frame->createVariableBinding(str("pink"), Color::pink());
-        frame->createVariableBinding(str("brown"), Color::brown());
-        frame->createVariableBinding(str("yellow"), Color::yellow());
-        
-        frame->createFunctionBinding(str("rgb"), &rgb);
-        frame->createFunctionBinding(str("rgba"), &rgba);
-        frame->createFunctionBinding(str("set-fill"), &set_fill);
-        frame->createFunctionBinding(str("set-stroke"), &set_stroke);
+        frame->createVariableBinding(gfx_str("white"), Color::white());
+        frame->createVariableBinding(gfx_str("black"), Color::black());
+        frame->createVariableBinding(gfx_str("translucent"), Color::clear());
+        frame->createVariableBinding(gfx_str("red"), Color::red());
+        frame->createVariableBinding(gfx_str("green"), Color::green());
+        frame->createVariableBinding(gfx_str("blue"), Color::blue());
+        frame->createVariableBinding(gfx_str("orange"), Color::orange());
+        frame->createVariableBinding(gfx_str("purple"), Color::purple());
+        frame->createVariableBinding(gfx_str("pink"), Color::pink());
+        frame->createVariableBinding(gfx_str("brown"), Color::brown());
+        frame->createVariableBinding(gfx_str("yellow"), Color::yellow());
+        
+        frame->createFunctionBinding(gfx_str("rgb"), &rgb);
+        frame->createFunctionBinding(gfx_str("rgba"), &rgba);
+        frame->createFunctionBinding(gfx_str("set-fill"), &set_fill);
+        frame->createFunctionBinding(gfx_str("set-stroke"), &set_stroke);
     }
 }
 
@@ -13,7 +13,12 @@
 
 #include "base.h"
 #include "types.h"
-#include <CoreGraphics/CoreGraphics.h>
+
+#if GFX_Graphics_Use_Raster
+#   include "raster.h"
+#else
+#   include <CoreGraphics/CoreGraphics.h>
+#endif /* GFX_Graphics_Use_Raster */
 
 namespace gfx {
     class StackFrame;
@@ -21,10 +26,20 @@ namespace gfx {
     ///The Color class encapsulates color and alpha information.
     ///
     ///The underlying type of Color is platform dependent. On OS X and iOS, it is CGColor.
+    ///With the software rasterizer, it is a `gfx::raster::Color` held by value.
     class Color : public Base
     {
     public:
         
+#if GFX_Graphics_Use_Raster
+        ///The native type of the Color class.
+        typedef const raster::Color *NativeType;
+        
+    protected:
+        
+        ///The components of the color.
+        raster::Color mColor;
+#else
         ///The native type of the Color class.
         typedef CGColorRef NativeType;
         
@@ -32,41 +47,66 @@ namespace gfx {
         
         ///The native object backing the instance.
         CGColorRef mColor;
+#endif /* GFX_Graphics_Use_Raster */
         
     public:
         
-        ///Returns a new autoreleased white Color object.
-        static Color *white()   { return make<Color>(1.0, 1.0, 1.0, 1.0); }
+        ///Returns the shared white Color object.
+        static Color *white()   { static Color *const color = new Color(1.0, 1.0, 1.0, 1.0); return color; }
         
-        ///Returns a new autoreleased black Color object.
-        static Color *black()   { return make<Color>(0.0, 0.0, 0.0, 1.0); }
+        ///Returns the shared black Color object.
+        static Color *black()   { static Color *const color = new Color(0.0, 0.0, 0.0, 1.0); return color; }
         
-        ///Returns a new autoreleased translucent Color object.
-        static Color *clear()   { return make<Color>(0.0, 0.0, 0.0, 0.0); }
+        ///Returns the shared translucent Color object.
+        static Color *clear()   { static Color *const color = new Color(0.0, 0.0, 0.0, 0.0); return color; }
         
-        ///Returns a new autoreleased red Color object.
-        static Color *red()     { return make<Color>(1.0, 0.0, 0.0, 1.0); }
+        ///Returns the shared red Color object.
+        static Color *red()     { static Color *const color = new Color(1.0, 0.0, 0.0, 1.0); return color; }
         
-        ///Returns a new autoreleased green Color object.
-        static Color *green()   { return make<Color>(0.0, 1.0, 0.0, 1.0); }
+        ///Returns the shared green Color object.
+        static Color *green()   { static Color *const color = new Color(0.0, 1.0, 0.0, 1.0); return color; }
         
-        ///Returns a new autoreleased blue Color object.
-        static Color *blue()    { return make<Color>(0.0, 0.0, 1.0, 1.0); }
+        ///Returns the shared blue Color object.
+        static Color *blue()    { static Color *const color = new Color(0.0, 0.0, 1.0, 1.0); return color; }
         
-        ///Returns a new autoreleased orange Color object.
-        static Color *orange()  { return make<Color>(1.0, 0.5, 0.0, 1.0); }
+        ///Returns the shared orange Color object.
+        static Color *orange()  { static Color *const color = new Color(1.0, 0.5, 0.0, 1.0); return color; }
         
-        ///Returns a new autoreleased purple Color object.
-        static Color *purple()  { return make<Color>(0.5, 0.0, 0.5, 1.0); }
+        ///Returns the shared purple Color object.
+        static Color *purple()  { static Color *const color = new Color(0.5, 0.0, 0.5, 1.0); return color; }
         
-        ///Returns a new autoreleased pink Color object.
-        static Color *pink()    { return make<Color>(1.0, 0.0, 1.0, 1.0); }
+        ///Returns the shared pink Color object.
+        static Color *pink()    { static Color *const color = new Color(1.0, 0.0, 1.0, 1.0); return color; }
         
-        ///Returns a new autoreleased brown Color object.
-        static Color *brown()   { return make<Color>(0.6, 0.4, 0.2, 1.0); }
+        ///Returns the shared brown Color object.
+        static Color *brown()   { static Color *const color = new Color(0.6, 0.4, 0.2, 1.0); return color; }
+        
+        ///Returns the shared yellow Color object.
+        static Color *yellow()  { static Color *const color = new Color(1.0, 1.0, 0.0, 1.0); return color; }
+        
+#pragma mark - Shared Colors
+        
+        ///Returns a shared Color object with given red, green, blue, and alpha values.
+        ///
+        /// \param  red     The red value of the color. Range is {0.0, 1.0}.
+        /// \param  green   The green value of the color. Range is {0.0, 1.0}.
+        /// \param  blue    The blue value of the color. Range is {0.0, 1.0}.
+        /// \param  alpha   The alpha value of the color. Range is {0.0, 1.0}.
+        ///
+        ///Colors are immutable, so equal colors may be shared. The most recently
+        ///used colors are kept in a cache, and are returned instead of new colors.
+        static Color *withRGBA(Float red, Float green, Float blue, Float alpha);
+        
+        ///Returns a shared Color object for an HTML style color string.
+        ///
+        /// \param  colorString The color string. Should not be null.
+        ///
+        ///The color string is parsed the same way as by `Color(const String *)`.
+        static Color *withHTMLString(const String *colorString);
         
-        ///Returns a new autoreleased yellow Color object.
-        static Color *yellow()  { return make<Color>(1.0, 1.0, 0.0, 1.0); }
+        ///Returns whether or not a given string is a well formed HTML style color string,
+        ///a `#` followed by exactly six hexadecimal digits.
+        static bool isHTMLColorString(const String *string);
         
 #pragma mark - Lifecycle
         
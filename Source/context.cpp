@@ -12,13 +12,18 @@
 #include "threading.h"
 
 #include "array.h"
+#include "number.h"
 #include "image.h"
+#include "displaylist.h"
+#include "function.h"
 
 #include "stackframe.h"
 #include "graphics.h"
 #include "filepolicy.h"
 
-#include "osx.h"
+#if !GFX_Graphics_Use_Raster
+#   include "osx.h"
+#endif /* !GFX_Graphics_Use_Raster */
 
 namespace gfx {
     
@@ -32,10 +37,10 @@ namespace gfx {
     static Array<Context> *SharedContextStackForCurrentThread()
     {
         auto threadStorage = threading::threadStorage();
-        auto stack = (Array<Context> *)threadStorage->get(str("gfx::Context::contextStack"));
+        auto stack = (Array<Context> *)threadStorage->get(gfx_str("gfx::Context::contextStack"));
         if(stack == nullptr) {
             stack = make<Array<Context>>();
-            threadStorage->set(str("gfx::Context::contextStack"), stack);
+            threadStorage->set(gfx_str("gfx::Context::contextStack"), stack);
         }
         
         return stack;
@@ -74,7 +79,11 @@ namespace gfx {
     
     Float Context::defaultScale()
     {
+#if GFX_Graphics_Use_Raster
+        return 1.0;
+#else
         return platform::display_default_scale_get();
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     Context *Context::bitmapContextWith(Size size, Float scale)
@@ -82,6 +91,19 @@ namespace gfx {
         if(!scale)
             scale = Context::defaultScale();
         
+#if GFX_Graphics_Use_Raster
+        raster::Surface *surface = new raster::Surface(size_t(size.width * scale), size_t(size.height * scale));
+        raster::Canvas *canvas = new raster::Canvas(surface);
+        surface->release();
+        
+        canvas->concatTransform(Transform2D::makeScale(scale, scale));
+        
+        //Drawing into bitmaps is recorded and rendered in parallel bands when the
+        //pixels are needed. The result is identical to drawing immediately.
+        canvas->setDeferred(true);
+        
+        return make<Context>(canvas, scale);
+#else
         CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
         CGContextRef imageContext = CGBitmapContextCreate(/* in data */ NULL,
                                                           /* in width */ size.width * scale,
@@ -96,6 +118,7 @@ namespace gfx {
         CGContextScaleCTM(imageContext, scale, -scale);
         
         return make<Context>(imageContext, scale);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark -
@@ -104,7 +127,12 @@ namespace gfx {
         Base(),
         mContext(context),
         mScale(scale),
-        mOwnsContext(ownsContext)
+        mOwnsContext(ownsContext),
+        mRecording(nullptr),
+        mHasShadow(false),
+        mSavedHasShadow(),
+        mDrawnOperationCount(0),
+        mCulledOperationCount(0)
     {
         gfx_assert_param(context);
     }
@@ -112,7 +140,11 @@ namespace gfx {
     Context::~Context()
     {
         if(mContext && mOwnsContext) {
+#if GFX_Graphics_Use_Raster
+            delete mContext;
+#else
             CFRelease(mContext);
+#endif /* GFX_Graphics_Use_Raster */
             mContext = NULL;
         }
     }
@@ -121,7 +153,11 @@ namespace gfx {
     
     HashCode Context::hash() const
     {
+#if GFX_Graphics_Use_Raster
+        return HashCode(mContext);
+#else
         return CFHash(mContext);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     bool Context::isEqual(const Context *other) const
@@ -129,7 +165,11 @@ namespace gfx {
         if(!other)
             return NULL;
         
+#if GFX_Graphics_Use_Raster
+        return (get() == other->get());
+#else
         return CFEqual(get(), other->get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     bool Context::isEqual(const Base *other) const
@@ -162,24 +202,55 @@ namespace gfx {
     
     Image *Context::makeImage() const
     {
+#if GFX_Graphics_Use_Raster
+        return make<Image>(new raster::Surface(get()->surface()), true);
+#else
         return make<Image>(CGBitmapContextCreateImage(get()), true);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     Rect Context::boundingRect() const
     {
+#if GFX_Graphics_Use_Raster
+        return get()->clipBoundingBox();
+#else
         return CGContextGetClipBoundingBox(get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark - Saving/Restoring State
     
     void Context::save()
     {
+        recordOperation([](Context *context) {
+            context->save();
+        });
+
+        mSavedHasShadow.push_back(mHasShadow);
+        
+#if GFX_Graphics_Use_Raster
+        get()->save();
+#else
         CGContextSaveGState(get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     void Context::restore()
     {
+        recordOperation([](Context *context) {
+            context->restore();
+        });
+
+        if(!mSavedHasShadow.empty()) {
+            mHasShadow = mSavedHasShadow.back();
+            mSavedHasShadow.pop_back();
+        }
+        
+#if GFX_Graphics_Use_Raster
+        get()->restore();
+#else
         CGContextRestoreGState(get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     void Context::transaction(std::function<void(Context *context)> transactionFunctor)
@@ -200,19 +271,108 @@ namespace gfx {
     
     Transform2D Context::currentTransformationMatrix() const
     {
+#if GFX_Graphics_Use_Raster
+        return get()->transform();
+#else
         return CGContextGetCTM(get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     void Context::concatTransformationMatrix(const Transform2D &transform)
     {
+        recordOperation([transform](Context *context) {
+            context->concatTransformationMatrix(transform);
+        });
+
+#if GFX_Graphics_Use_Raster
+        get()->concatTransform(transform);
+#else
         CGContextConcatCTM(get(), transform);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark - Functions
     
     void Context::clear(Rect rect)
     {
+        if(recordOperation([rect](Context *context) { context->clear(rect); }))
+            return;
+
+#if GFX_Graphics_Use_Raster
+        get()->clearRect(rect);
+#else
         CGContextClearRect(get(), rect);
+#endif /* GFX_Graphics_Use_Raster */
+    }
+    
+#pragma mark - Quick Rejection
+    
+    bool Context::quickReject(Rect rect)
+    {
+        if(mRecording)
+            return false;
+        
+        Rect clipBounds = boundingRect();
+        bool isOutsideClip = (rect.getMaxX() < clipBounds.getMinX() || rect.getMinX() > clipBounds.getMaxX() ||
+                              rect.getMaxY() < clipBounds.getMinY() || rect.getMinY() > clipBounds.getMaxY());
+        if(isOutsideClip && !mHasShadow) {
+            mCulledOperationCount++;
+            return true;
+        }
+        
+        mDrawnOperationCount++;
+        return false;
+    }
+    
+    size_t Context::drawnOperationCount() const
+    {
+        return mDrawnOperationCount;
+    }
+    
+    size_t Context::culledOperationCount() const
+    {
+        return mCulledOperationCount;
+    }
+    
+    void Context::resetStatistics()
+    {
+        mDrawnOperationCount = 0;
+        mCulledOperationCount = 0;
+    }
+    
+#pragma mark - Recording
+    
+    void Context::record(DisplayList *displayList, std::function<void(Context *context)> functor)
+    {
+        gfx_assert_param(displayList);
+        gfx_assert_param(functor);
+        
+        DisplayList *previousRecording = mRecording;
+        transaction([this, displayList, previousRecording, &functor](Context *context) {
+            mRecording = displayList;
+            try {
+                functor(context);
+            } catch (...) {
+                mRecording = previousRecording;
+                throw;
+            }
+            
+            mRecording = previousRecording;
+        });
+    }
+    
+    DisplayList *Context::recordingDisplayList() const
+    {
+        return mRecording;
+    }
+    
+    bool Context::recordOperation(const std::function<void(Context *context)> &operation)
+    {
+        if(!mRecording)
+            return false;
+        
+        mRecording->append(operation);
+        return true;
     }
     
     static void ctx_begin(StackFrame *stack)
@@ -233,15 +393,60 @@ namespace gfx {
         stack->push(VectorFromSize(ctxSize));
     }
     
+    static void ctx_stats(StackFrame *stack)
+    {
+        /* -- vec */
+        auto context = Context::currentContext();
+        stack->push(autoreleased(new Array<Base>{
+            make<Number>(context->drawnOperationCount()),
+            make<Number>(context->culledOperationCount())
+        }));
+    }
+    
+    static void ctx_resetStats(StackFrame *stack)
+    {
+        /* -- */
+        Context::currentContext()->resetStatistics();
+    }
+    
+    static void ctx_record(StackFrame *stack)
+    {
+        /* func -- list */
+        auto function = stack->popFunction();
+        auto context = Context::currentContext();
+        auto displayList = make<DisplayList>(context->boundingRect());
+        context->record(displayList, [stack, function](Context *context) {
+            function->apply(stack);
+        });
+        stack->push(displayList);
+    }
+    
+    static void ctx_replay(StackFrame *stack)
+    {
+        /* list -- */
+        auto displayList = stack->popType<DisplayList>();
+        displayList->replay(Context::currentContext());
+    }
+    
+    static void ctx_replayIn(StackFrame *stack)
+    {
+        /* list vec -- */
+        auto rect = VectorToRect(stack->popType<Array<Base>>());
+        auto displayList = stack->popType<DisplayList>();
+        displayList->replayInRect(Context::currentContext(), rect);
+    }
+    
     static void ctx_save(StackFrame *stack)
     {
         auto path = stack->popString();
         
-        auto image = Context::currentContext()->makeImage();
-        auto data = image->makeRepresentation(Image::RepresentationType::PNG);
+        auto type = Image::representationTypeForPath(path);
+        if(!Image::isRepresentationTypeAvailable(type))
+            throw Exception(str("The format of the path is unavailable"), nullptr);
         
+        auto image = Context::currentContext()->makeImage();
         auto file = FilePolicy::ActiveFilePolicy()->openFileAtPath(path, File::Mode::Write);
-        file->write(data);
+        image->writeRepresentation(type, file);
     }
     
 #pragma mark -
@@ -250,10 +455,15 @@ namespace gfx {
     {
         gfx_assert_param(frame);
         
-        frame->createFunctionBinding(str("ctx/begin"), &ctx_begin);
-        frame->createFunctionBinding(str("ctx/end"), &ctx_end);
-        frame->createFunctionBinding(str("ctx/size"), &ctx_size);
-        frame->createFunctionBinding(str("ctx/save"), &ctx_save);
+        frame->createFunctionBinding(gfx_str("ctx/begin"), &ctx_begin);
+        frame->createFunctionBinding(gfx_str("ctx/end"), &ctx_end);
+        frame->createFunctionBinding(gfx_str("ctx/size"), &ctx_size);
+        frame->createFunctionBinding(gfx_str("ctx/save"), &ctx_save);
+        frame->createFunctionBinding(gfx_str("ctx/stats"), &ctx_stats);
+        frame->createFunctionBinding(gfx_str("ctx/reset-stats"), &ctx_resetStats);
+        frame->createFunctionBinding(gfx_str("ctx/record"), &ctx_record);
+        frame->createFunctionBinding(gfx_str("ctx/replay"), &ctx_replay);
+        frame->createFunctionBinding(gfx_str("ctx/replay-in"), &ctx_replayIn);
     }
 }
 
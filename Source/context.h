@@ -11,11 +11,18 @@
 
 #if GFX_Include_GraphicsStack
 
-#include <CoreGraphics/CoreGraphics.h>
 #include "base.h"
+#include <vector>
+
+#if GFX_Graphics_Use_Raster
+#   include "raster.h"
+#else
+#   include <CoreGraphics/CoreGraphics.h>
+#endif /* GFX_Graphics_Use_Raster */
 
 namespace gfx {
     class Image;
+    class DisplayList;
     class StackFrame;
     
     ///The Context class encapsulates the core 2D drawing destination used by
@@ -31,13 +38,18 @@ namespace gfx {
     ///from a background thread, you must never pass context objects between threads.
     ///
     ///The underlying type of Context is platform independent. On iOS and OS X
-    ///it is an instance of the CGContext class-type.
+    ///it is an instance of the CGContext class-type. With the software rasterizer
+    ///it is a `gfx::raster::Canvas`.
     class Context : public Base
     {
     public:
         
         ///The underlying object used by the Context for its rendering operations.
+#if GFX_Graphics_Use_Raster
+        typedef raster::Canvas *NativeType;
+#else
         typedef CGContextRef NativeType;
+#endif /* GFX_Graphics_Use_Raster */
         
     protected:
         
@@ -50,6 +62,27 @@ namespace gfx {
         ///Whether or not the context should destroy the context when it is destructed.
         bool mOwnsContext;
         
+        ///The display list drawing is being recorded into, if any.
+        DisplayList *mRecording;
+        
+        ///Whether or not a shadow is set in the current graphics state.
+        ///
+        ///Shadows may fall outside of the area being drawn, so
+        ///drawing is never quickly rejected while one is set.
+        bool mHasShadow;
+        
+        ///The values of `mHasShadow` for each saved graphics state.
+        std::vector<bool> mSavedHasShadow;
+        
+        ///The number of drawing operations that were not quickly rejected.
+        size_t mDrawnOperationCount;
+        
+        ///The number of drawing operations that were quickly rejected.
+        size_t mCulledOperationCount;
+        
+        ///Shadow updates `mHasShadow`.
+        friend class Shadow;
+        
     public:
         
 #pragma mark - Context Stack
@@ -168,6 +201,52 @@ namespace gfx {
         ///Clears a given section of the context.
         void clear(Rect rect);
         
+#pragma mark - Quick Rejection
+        
+        ///Returns whether or not drawing within a given area is certain to leave
+        ///the receiver unchanged, counting the result in the receiver's statistics.
+        ///
+        /// \param  rect    The area the drawing will touch, in user space. The
+        ///                 bounds of strokes should be inflated by their width.
+        ///
+        ///An area is rejected when it lies entirely outside of the bounding box of
+        ///the receiver's clip. Nothing is rejected while a shadow is set, or while
+        ///the receiver is recording into a display list.
+        bool quickReject(Rect rect);
+        
+        ///Returns the number of drawing operations that were not quickly rejected.
+        size_t drawnOperationCount() const;
+        
+        ///Returns the number of drawing operations that were quickly rejected.
+        size_t culledOperationCount() const;
+        
+        ///Resets the drawn and culled operation counts of the receiver to zero.
+        void resetStatistics();
+        
+#pragma mark - Recording
+        
+        ///Records the drawing performed by a functor into a display list instead of rendering it.
+        ///
+        /// \param  displayList The display list to append the recorded operations to. Required.
+        /// \param  functor     The functor whose drawing should be recorded. Required.
+        ///
+        ///Changes the functor makes to the graphics state, such as transforms, clips, and
+        ///colors, are applied as well as recorded so that the functor may observe them.
+        ///The state of the receiver is restored once the functor returns.
+        void record(DisplayList *displayList, std::function<void(Context *context)> functor);
+        
+        ///Returns the display list the receiver is recording into, if any.
+        DisplayList *recordingDisplayList() const;
+        
+        ///Appends an operation to the display list the receiver is recording into.
+        ///
+        /// \param  operation   The operation to record.
+        ///
+        /// \result true if the receiver is recording and the operation was recorded; false otherwise.
+        ///
+        ///Drawing operations that change pixels are performed only if this method returns false.
+        bool recordOperation(const std::function<void(Context *context)> &operation);
+        
 #pragma mark - Functions
         
         ///Adds the context function suite to a given stack frame.
@@ -19,25 +19,212 @@
 #include "filepolicy.h"
 #include "type.h"
 #include "json.h"
+#include "threading.h"
+#include "typedarray.h"
 
 #include "gfx_defines.h"
+#include <cmath>
+#include <cstring>
 
 namespace gfx {
     
 #pragma mark - Math Operations
     
-#   define SYNTHESIZE_MATH_WRAPPER_1_PARAM(FunctionName) static void FunctionName##Wrapper(StackFrame *frame) { \
-    Number *input = frame->popNumber(); \
-    Number *result = make<Number>(FunctionName(input->value())); \
-    frame->push(result); \
+    ///The number of values below which math functions are applied on the calling thread.
+    static const size_t kParallelMathThreshold = 16384;
+    
+    ///The values that a math function is applied to, in any of the shapes math functions accept.
+    ///
+    ///Numbers are treated as sequences of one value, which are broadcast
+    ///against the other operand when given to a binary function.
+    struct MathOperand
+    {
+        ///The shapes of values accepted by math functions.
+        enum class Shape {
+            Number,
+            Vector,
+            Float64Vector,
+            Float32Vector,
+        };
+        
+        ///The shape of the operand.
+        Shape shape;
+        
+        ///The values of the operand.
+        const double *values;
+        
+        ///The number of values of the operand.
+        size_t count;
+        
+        ///The unboxed values of operands that are not stored as doubles.
+        std::vector<double> storage;
+        
+        ///Pops an operand from a given frame.
+        ///
+        /// \throws `gfx::Exception` if the top of the stack is not a number, vector, or typed vector,
+        ///         or if it is a vector that contains a value that is not a number.
+        explicit MathOperand(StackFrame *frame) :
+            shape(Shape::Number),
+            values(nullptr),
+            count(0),
+            storage()
+        {
+            Base *value = frame->pop();
+            if(value->isKindOfClass<Number>()) {
+                shape = Shape::Number;
+                storage.push_back(static_cast<Number *>(value)->value());
+            } else if(value->isKindOfClass<Float64Array>()) {
+                shape = Shape::Float64Vector;
+                values = static_cast<Float64Array *>(value)->values();
+                count = static_cast<Float64Array *>(value)->count();
+                return;
+            } else if(value->isKindOfClass<Float32Array>()) {
+                shape = Shape::Float32Vector;
+                auto array = static_cast<Float32Array *>(value);
+                storage.assign(array->values(), array->values() + array->count());
+            } else if(value->isKindOfClass<Array<Base>>()) {
+                shape = Shape::Vector;
+                auto array = static_cast<Array<Base> *>(value);
+                storage.reserve(array->count());
+                array->iterate(array->all(), [this](Base *element, Index index, bool *stop) {
+                    gfx_assert(element->isKindOfClass<Number>(), gfx_str("math functions only accept vectors of numbers"));
+                    storage.push_back(static_cast<Number *>(element)->value());
+                });
+            } else {
+                throw Exception((String::Builder() << "wrong type on stack. got '" << value->className() << "'."), nullptr);
+            }
+            
+            values = storage.data();
+            count = storage.size();
+        }
+    };
+    
+    ///Splits a range of values into chunks, and applies a kernel to each chunk,
+    ///using the worker pool when there are enough values to be worth it.
+    static void MathForEachChunk(size_t count, const std::function<void(size_t begin, size_t end)> &kernel)
+    {
+        if(count < kParallelMathThreshold) {
+            kernel(0, count);
+            return;
+        }
+        
+        size_t numberOfChunks = (count + kParallelMathThreshold - 1) / kParallelMathThreshold;
+        threading::parallelFor(numberOfChunks, [count, &kernel](size_t chunk, size_t) {
+            kernel(chunk * kParallelMathThreshold, std::min(count, (chunk + 1) * kParallelMathThreshold));
+        });
+    }
+    
+    ///Pushes the results of a math function in the shape of its input.
+    static void PushMathResults(StackFrame *frame, MathOperand::Shape shape, const std::vector<double> &results)
+    {
+        switch (shape) {
+            case MathOperand::Shape::Number: {
+                frame->push(make<Number>(results[0]));
+                break;
+            }
+                
+            case MathOperand::Shape::Vector: {
+                std::vector<Base *> numbers;
+                numbers.reserve(results.size());
+                for (double result : results)
+                    numbers.push_back(make<Number>(result));
+                
+                frame->push(make<Array<Base>>(numbers));
+                break;
+            }
+                
+            case MathOperand::Shape::Float64Vector: {
+                frame->push(make<Float64Array>(results.data(), results.size()));
+                break;
+            }
+                
+            case MathOperand::Shape::Float32Vector: {
+                auto array = make<Float32Array>(results.size());
+                std::copy(results.begin(), results.end(), array->values());
+                frame->push(array);
+                break;
+            }
+        }
+    }
+    
+    ///Applies a unary math operation to the top of a frame's stack.
+    ///
+    /// \tparam Operation  A type with a static `apply(double) -> double` function.
+    ///
+    ///Every value is computed with the same function that is applied to a single number,
+    ///so a vector's results are bit-identical to applying the function to each item.
+    template<typename Operation>
+    static void ApplyMathFunction1(StackFrame *frame)
+    {
+        MathOperand input(frame);
+        
+        std::vector<double> results(input.count);
+        const double *values = input.values;
+        double *outputs = results.data();
+        MathForEachChunk(results.size(), [values, outputs](size_t begin, size_t end) {
+            for (size_t index = begin; index < end; index++)
+                outputs[index] = Operation::apply(values[index]);
+        });
+        
+        PushMathResults(frame, input.shape, results);
+    }
+    
+    ///Applies a binary math operation to the top two values of a frame's stack.
+    ///
+    /// \tparam Operation  A type with a static `apply(double, double) -> double` function.
+    ///
+    ///The first parameter of the operation is the top of the stack. When one operand is a
+    ///number and the other is a sequence, the number is broadcast against every value. Two
+    ///sequences must have the same shape and count.
+    template<typename Operation>
+    static void ApplyMathFunction2(StackFrame *frame)
+    {
+        MathOperand input1(frame);
+        MathOperand input2(frame);
+        
+        MathOperand::Shape shape;
+        size_t count;
+        if(input1.shape == MathOperand::Shape::Number) {
+            shape = input2.shape;
+            count = input2.count;
+        } else if(input2.shape == MathOperand::Shape::Number) {
+            shape = input1.shape;
+            count = input1.count;
+        } else {
+            gfx_assert(input1.shape == input2.shape, gfx_str("math functions cannot combine vectors of different types"));
+            gfx_assert(input1.count == input2.count, gfx_str("math functions require vectors of the same length"));
+            shape = input1.shape;
+            count = input1.count;
+        }
+        
+        std::vector<double> results(count);
+        const double *values1 = input1.values, *values2 = input2.values;
+        size_t stride1 = (input1.shape == MathOperand::Shape::Number)? 0 : 1;
+        size_t stride2 = (input2.shape == MathOperand::Shape::Number)? 0 : 1;
+        double *outputs = results.data();
+        MathForEachChunk(count, [=](size_t begin, size_t end) {
+            for (size_t index = begin; index < end; index++)
+                outputs[index] = Operation::apply(values1[index * stride1], values2[index * stride2]);
+        });
+        
+        PushMathResults(frame, shape, results);
+    }
+    
+#   define SYNTHESIZE_MATH_WRAPPER_1_PARAM(FunctionName) struct FunctionName##Operation { \
+    static double apply(double value) { return FunctionName(value); } \
+}; \
+static void FunctionName##Wrapper(StackFrame *frame) { \
+    ApplyMathFunction1<FunctionName##Operation>(frame); \
 }
-#   define SYNTHESIZE_MATH_WRAPPER_2_PARAM(FunctionName) static void FunctionName##Wrapper(StackFrame *frame) { \
-    Number *input1 = frame->popNumber(); \
-    Number *input2 = frame->popNumber(); \
-    Number *result = make<Number>(FunctionName(input1->value(), input2->value())); \
-    frame->push(result); \
+#   define SYNTHESIZE_MATH_WRAPPER_2_PARAM(FunctionName) struct FunctionName##Operation { \
+    static double apply(double value1, double value2) { return FunctionName(value1, value2); } \
+}; \
+static void FunctionName##Wrapper(StackFrame *frame) { \
+    ApplyMathFunction2<FunctionName##Operation>(frame); \
 }
     
+#pragma mark -
+    
     static void opPlus(StackFrame *frame)
     {
         Number *right = frame->popNumber();
@@ -356,7 +543,7 @@ namespace gfx {
         try {
             tryFunction->apply(frame);
         } catch (gfx::Exception e) {
-            frame->setBindingToValue(str("__exception"), const_cast<String *>(e.reason()));
+            frame->setBindingToValue(gfx_str("__exception"), const_cast<String *>(e.reason()));
             catchFunction->apply(frame);
         }
     }
@@ -374,7 +561,7 @@ namespace gfx {
             }
         } else if(wordOrWords && wordOrWords->isKindOfClass<String>()) {
             auto name = static_cast<String *>(wordOrWords);
-            if(name->find(str("."), Range(0, name->length()))) {
+            if(name->find(gfx_str("."), Range(0, name->length()))) {
                 throw Exception(str("Dot-syntax is only supported for lookup, cannot use with let."), nullptr);
             }
             
@@ -388,7 +575,7 @@ namespace gfx {
     static void set(StackFrame *frame)
     {
         auto name = frame->popString();
-        if(name->find(str("."), Range(0, name->length()))) {
+        if(name->find(gfx_str("."), Range(0, name->length()))) {
             throw Exception(str("Dot-syntax is only supported for lookup, cannot use with set."), nullptr);
         }
         
@@ -400,7 +587,7 @@ namespace gfx {
     {
         auto value = frame->pop();
         auto name = frame->popString();
-        if(name->find(str("."), Range(0, name->length()))) {
+        if(name->find(gfx_str("."), Range(0, name->length()))) {
             throw Exception(str("Dot-syntax is only supported for lookup, cannot use with set."), nullptr);
         }
         
@@ -623,6 +810,87 @@ namespace gfx {
         frame->push(newVector);
     }
     
+    ///Returns the values of a vector reordered by a given sequence of sort keys.
+    ///
+    /// \param values  The values to reorder.
+    /// \param keys    The sort key of each value. Must all be numbers or all be strings.
+    ///
+    ///Numeric keys are sorted as doubles, with NaN after every other number. String keys
+    ///are sorted by the code points of their utf8 representation. The sort is stable.
+    static Array<Base> *SortedByKeys(const std::vector<Base *> &values, const std::vector<Base *> &keys)
+    {
+        bool allNumbers = true, allStrings = true;
+        for (Base *key : keys) {
+            allNumbers = allNumbers && key->isKindOfClass<Number>();
+            allStrings = allStrings && key->isKindOfClass<String>();
+        }
+        
+        gfx_assert(allNumbers || allStrings, gfx_str("sort keys must all be numbers or all be strings"));
+        
+        std::vector<Base *> sortedValues;
+        sortedValues.reserve(values.size());
+        if(allNumbers) {
+            std::vector<std::pair<double, size_t>> numberKeys;
+            numberKeys.reserve(keys.size());
+            for (size_t index = 0; index < keys.size(); index++)
+                numberKeys.emplace_back(static_cast<Number *>(keys[index])->value(), index);
+            
+            threading::parallelStableSort(numberKeys, [](const std::pair<double, size_t> &left, const std::pair<double, size_t> &right) {
+                return (left.first < right.first) || (!std::isnan(left.first) && std::isnan(right.first));
+            });
+            
+            for (const auto &key : numberKeys)
+                sortedValues.push_back(values[key.second]);
+        } else {
+            std::vector<std::pair<const char *, size_t>> stringKeys;
+            stringKeys.reserve(keys.size());
+            for (size_t index = 0; index < keys.size(); index++)
+                stringKeys.emplace_back(static_cast<String *>(keys[index])->getCString(), index);
+            
+            threading::parallelStableSort(stringKeys, [](const std::pair<const char *, size_t> &left, const std::pair<const char *, size_t> &right) {
+                return (strcmp(left.first, right.first) < 0);
+            });
+            
+            for (const auto &key : stringKeys)
+                sortedValues.push_back(values[key.second]);
+        }
+        
+        return make<Array<Base>>(sortedValues);
+    }
+    
+    static void vec_sortBy(StackFrame *frame)
+    {
+        /* vec func -- vec */
+        Function *function = frame->popFunction();
+        Array<Base> *vector = frame->popType<Array<Base>>();
+        
+        std::vector<Base *> values, keys;
+        values.reserve(vector->count());
+        keys.reserve(vector->count());
+        vector->iterate(vector->all(), [frame, function, &values, &keys](Base *value, Index index, bool *stop) {
+            frame->push(value);
+            function->apply(frame);
+            values.push_back(value);
+            keys.push_back(frame->pop());
+        });
+        
+        frame->push(SortedByKeys(values, keys));
+    }
+    
+    static void vec_sortValues(StackFrame *frame)
+    {
+        /* vec -- vec */
+        Array<Base> *vector = frame->popType<Array<Base>>();
+        
+        std::vector<Base *> values;
+        values.reserve(vector->count());
+        vector->iterate(vector->all(), [&values](Base *value, Index index, bool *stop) {
+            values.push_back(value);
+        });
+        
+        frame->push(SortedByKeys(values, values));
+    }
+    
     static void vec_forEach(StackFrame *frame)
     {
         /* vec func -- */
@@ -661,6 +929,115 @@ namespace gfx {
         frame->push(const_cast<Array<Base> *>(result));
     }
     
+#pragma mark - Parallel Vector Functions
+    
+    ///Applies a function to every value of a vector using the shared worker pool.
+    ///
+    /// \param frame       The frame of the calling word.
+    /// \param vector      The values to apply the function to.
+    /// \param function    The function to apply.
+    /// \param collect     Invoked on the worker with its frame after each application,
+    ///                     returns the result of the application. May return null.
+    ///
+    /// \result The retained result of each application in the order of `vector`.
+    ///          The caller is responsible for releasing them.
+    ///
+    ///Each worker applies the function in its own frame whose parent is a frozen
+    ///view of the calling frame. Functions may read bindings from enclosing scopes,
+    ///but raise if they change them, or if they consume more values than they were
+    ///given. Every application starts from an empty stack, regardless of which
+    ///worker it is made on.
+    static std::vector<Base *> ParallelApply(StackFrame *frame, const Array<Base> *vector, const Function *function, const std::function<Base *(StackFrame *)> &collect)
+    {
+        std::vector<Base *> values;
+        values.reserve(vector->count());
+        vector->iterate(vector->all(), [&values](Base *value, Index index, bool *stop) {
+            values.push_back(value);
+        });
+        
+        Interpreter *interpreter = frame->interpreter();
+        StackFrame *view = make<StackFrame>(frame, interpreter);
+        view->freeze();
+        
+        //Frames are created here and not on the workers because
+        //a parent frame's destroy signal is not thread safe.
+        std::vector<StackFrame *> workerFrames;
+        size_t numberOfWorkers = std::min(values.size(), threading::concurrency());
+        for (size_t worker = 0; worker < numberOfWorkers; worker++)
+            workerFrames.push_back(make<StackFrame>(view, interpreter));
+        
+        std::vector<Base *> results(values.size(), nullptr);
+        try {
+            threading::parallelFor(values.size(), [&](size_t index, size_t worker) {
+                AutoreleasePool pool;
+                
+                //Worker frames are reused across applications, so anything an earlier
+                //application left behind is dropped before the next one is made.
+                StackFrame *workerFrame = workerFrames[worker];
+                workerFrame->dropAll();
+                workerFrame->push(values[index]);
+                interpreter->applyDetached(function, workerFrame);
+                results[index] = retained(collect(workerFrame));
+            });
+        } catch (...) {
+            for (Base *result : results)
+                released(result);
+            
+            throw;
+        }
+        
+        return results;
+    }
+    
+    static void vec_pmap(StackFrame *frame)
+    {
+        /* vec func -- vec */
+        Function *function = frame->popFunction();
+        Array<Base> *vector = frame->popType<Array<Base>>();
+        
+        std::vector<Base *> results = ParallelApply(frame, vector, function, [](StackFrame *workerFrame) {
+            return workerFrame->pop();
+        });
+        Array<Base> *result = make<Array<Base>>();
+        for (Base *value : results) {
+            result->append(value);
+            released(value);
+        }
+        frame->push(result);
+    }
+    
+    static void vec_pfilter(StackFrame *frame)
+    {
+        /* vec func -- vec */
+        Function *function = frame->popFunction();
+        Array<Base> *vector = frame->popType<Array<Base>>();
+        
+        std::vector<Base *> results = ParallelApply(frame, vector, function, [](StackFrame *workerFrame) -> Base * {
+            return workerFrame->popNumber();
+        });
+        Array<Base> *result = make<Array<Base>>();
+        Index index = 0;
+        for (Base *value : results) {
+            if(static_cast<Number *>(value)->value())
+                result->append(vector->at(index));
+            
+            released(value);
+            index++;
+        }
+        frame->push(result);
+    }
+    
+    static void vec_peach(StackFrame *frame)
+    {
+        /* vec func -- */
+        Function *function = frame->popFunction();
+        Array<Base> *vector = frame->popType<Array<Base>>();
+        ParallelApply(frame, vector, function, [](StackFrame *workerFrame) -> Base * {
+            workerFrame->safeDrop();
+            return nullptr;
+        });
+    }
+    
 #pragma mark - Hash Functions
     
     static void hash_get(StackFrame *frame)
@@ -676,9 +1053,20 @@ namespace gfx {
         /* hash hash -- hash */
         Dictionary<Base, Base> *hash2 = frame->popType<Dictionary<Base, Base>>();
         Dictionary<Base, Base> *hash1 = frame->popType<Dictionary<Base, Base>>();
-        Dictionary<Base, Base> *newHash = make<Dictionary<Base, Base>>();
-        newHash->takeValuesFrom(hash1);
-        newHash->takeValuesFrom(hash2);
+        
+        //Start from whichever hash is larger, so only the smaller one is walked.
+        Dictionary<Base, Base> *newHash;
+        if(hash2->count() > hash1->count()) {
+            newHash = make<Dictionary<Base, Base>>(hash2);
+            hash1->iterate([newHash](Base *key, Base *value) {
+                if(!newHash->containsKey(key))
+                    newHash->set(key, value);
+            });
+        } else {
+            newHash = make<Dictionary<Base, Base>>(hash1);
+            newHash->takeValuesFrom(hash2);
+        }
+        
         frame->push(newHash);
     }
     
@@ -828,174 +1216,183 @@ namespace gfx {
         AutoreleasePool pool;
         
         //Core Constants
-        frame->createVariableBinding(str("true"), Number::True());
-        frame->createVariableBinding(str("false"), Number::False());
-        frame->createVariableBinding(str("null"), Null::shared());
+        frame->createVariableBinding(gfx_str("true"), Number::True());
+        frame->createVariableBinding(gfx_str("false"), Number::False());
+        frame->createVariableBinding(gfx_str("null"), Null::shared());
         
         //Math Constants
-        frame->createVariableBinding(str("num/min"), Number::Minimum());
-        frame->createVariableBinding(str("num/max"), Number::Maximum());
-        
-        frame->createVariableBinding(str("math/E"), make<Number>(M_E));
-        frame->createVariableBinding(str("math/LOG2E"), make<Number>(M_LOG2E));
-        frame->createVariableBinding(str("math/LOG10E"), make<Number>(M_LOG10E));
-        frame->createVariableBinding(str("math/LN2"), make<Number>(M_LN2));
-        frame->createVariableBinding(str("math/LN10"), make<Number>(M_LN10));
-        frame->createVariableBinding(str("math/PI"), make<Number>(M_PI));
-        frame->createVariableBinding(str("math/PI2"), make<Number>(M_PI_2));
-        frame->createVariableBinding(str("math/1PI"), make<Number>(M_1_PI));
-        frame->createVariableBinding(str("math/2PI"), make<Number>(M_2_PI));
-        frame->createVariableBinding(str("math/2SQRTPI"), make<Number>(M_2_SQRTPI));
-        frame->createVariableBinding(str("math/SQRT2"), make<Number>(M_SQRT2));
-        frame->createVariableBinding(str("math/SQRT1_2"), make<Number>(M_SQRT1_2));
+        frame->createVariableBinding(gfx_str("num/min"), Number::Minimum());
+        frame->createVariableBinding(gfx_str("num/max"), Number::Maximum());
+        
+        frame->createVariableBinding(gfx_str("math/E"), make<Number>(M_E));
+        frame->createVariableBinding(gfx_str("math/LOG2E"), make<Number>(M_LOG2E));
+        frame->createVariableBinding(gfx_str("math/LOG10E"), make<Number>(M_LOG10E));
+        frame->createVariableBinding(gfx_str("math/LN2"), make<Number>(M_LN2));
+        frame->createVariableBinding(gfx_str("math/LN10"), make<Number>(M_LN10));
+        frame->createVariableBinding(gfx_str("math/PI"), make<Number>(M_PI));
+        frame->createVariableBinding(gfx_str("math/PI2"), make<Number>(M_PI_2));
+        frame->createVariableBinding(gfx_str("math/1PI"), make<Number>(M_1_PI));
+        frame->createVariableBinding(gfx_str("math/2PI"), make<Number>(M_2_PI));
+        frame->createVariableBinding(gfx_str("math/2SQRTPI"), make<Number>(M_2_SQRTPI));
+        frame->createVariableBinding(gfx_str("math/SQRT2"), make<Number>(M_SQRT2));
+        frame->createVariableBinding(gfx_str("math/SQRT1_2"), make<Number>(M_SQRT1_2));
         
         //File Constants
-        frame->createVariableBinding(str("file/out"), File::consoleOut());
-        frame->createVariableBinding(str("file/in"), File::consoleIn());
-        frame->createVariableBinding(str("file/err"), File::consoleError());
+        frame->createVariableBinding(gfx_str("file/out"), File::consoleOut());
+        frame->createVariableBinding(gfx_str("file/in"), File::consoleIn());
+        frame->createVariableBinding(gfx_str("file/err"), File::consoleError());
         
         
         //Math Operations
-        frame->createFunctionBinding(str("+"), &opPlus);
-        frame->createFunctionBinding(str("-"), &opMinus);
-        frame->createFunctionBinding(str("*"), &opTimes);
-        frame->createFunctionBinding(str("/"), &opDivide);
-        frame->createFunctionBinding(str("^"), &opPow);
-        
-        frame->createFunctionBinding(str("math/cos"), &cosWrapper);
-        frame->createFunctionBinding(str("math/sin"), &sinWrapper);
-        frame->createFunctionBinding(str("math/tan"), &tanWrapper);
-        frame->createFunctionBinding(str("math/acos"), &acosWrapper);
-        frame->createFunctionBinding(str("math/asin"), &asinWrapper);
-        frame->createFunctionBinding(str("math/atan"), &atanWrapper);
-        frame->createFunctionBinding(str("math/atan2"), &atan2Wrapper);
-        
-        frame->createFunctionBinding(str("math/cosh"), &coshWrapper);
-        frame->createFunctionBinding(str("math/sinh"), &sinhWrapper);
-        frame->createFunctionBinding(str("math/tanh"), &tanhWrapper);
-        frame->createFunctionBinding(str("math/acosh"), &acoshWrapper);
-        frame->createFunctionBinding(str("math/asinh"), &asinhWrapper);
-        frame->createFunctionBinding(str("math/atanh"), &atanhWrapper);
-        
-        frame->createFunctionBinding(str("math/exp"), &expWrapper);
-        frame->createFunctionBinding(str("math/log"), &logWrapper);
-        frame->createFunctionBinding(str("math/log10"), &log10Wrapper);
-        
-        frame->createFunctionBinding(str("math/sqrt"), &sqrtWrapper);
-        frame->createFunctionBinding(str("math/cbrt"), &cbrtWrapper);
-        frame->createFunctionBinding(str("math/hypot"), &hypotWrapper);
-        
-        frame->createFunctionBinding(str("math/abs"), &absWrapper);
-        frame->createFunctionBinding(str("math/ceil"), &ceilWrapper);
-        frame->createFunctionBinding(str("math/floor"), &floorWrapper);
-        frame->createFunctionBinding(str("math/round"), &roundWrapper);
+        frame->createFunctionBinding(gfx_str("+"), &opPlus);
+        frame->createFunctionBinding(gfx_str("-"), &opMinus);
+        frame->createFunctionBinding(gfx_str("*"), &opTimes);
+        frame->createFunctionBinding(gfx_str("/"), &opDivide);
+        frame->createFunctionBinding(gfx_str("^"), &opPow);
+        
+        frame->createFunctionBinding(gfx_str("math/cos"), &cosWrapper);
+        frame->createFunctionBinding(gfx_str("math/sin"), &sinWrapper);
+        frame->createFunctionBinding(gfx_str("math/tan"), &tanWrapper);
+        frame->createFunctionBinding(gfx_str("math/acos"), &acosWrapper);
+        frame->createFunctionBinding(gfx_str("math/asin"), &asinWrapper);
+        frame->createFunctionBinding(gfx_str("math/atan"), &atanWrapper);
+        frame->createFunctionBinding(gfx_str("math/atan2"), &atan2Wrapper);
+        
+        frame->createFunctionBinding(gfx_str("math/cosh"), &coshWrapper);
+        frame->createFunctionBinding(gfx_str("math/sinh"), &sinhWrapper);
+        frame->createFunctionBinding(gfx_str("math/tanh"), &tanhWrapper);
+        frame->createFunctionBinding(gfx_str("math/acosh"), &acoshWrapper);
+        frame->createFunctionBinding(gfx_str("math/asinh"), &asinhWrapper);
+        frame->createFunctionBinding(gfx_str("math/atanh"), &atanhWrapper);
+        
+        frame->createFunctionBinding(gfx_str("math/exp"), &expWrapper);
+        frame->createFunctionBinding(gfx_str("math/log"), &logWrapper);
+        frame->createFunctionBinding(gfx_str("math/log10"), &log10Wrapper);
+        
+        frame->createFunctionBinding(gfx_str("math/sqrt"), &sqrtWrapper);
+        frame->createFunctionBinding(gfx_str("math/cbrt"), &cbrtWrapper);
+        frame->createFunctionBinding(gfx_str("math/hypot"), &hypotWrapper);
+        
+        frame->createFunctionBinding(gfx_str("math/abs"), &absWrapper);
+        frame->createFunctionBinding(gfx_str("math/ceil"), &ceilWrapper);
+        frame->createFunctionBinding(gfx_str("math/floor"), &floorWrapper);
+        frame->createFunctionBinding(gfx_str("math/round"), &roundWrapper);
         
         
         //Boolean Operations
-        frame->createFunctionBinding(str("and"), &opAnd);
-        frame->createFunctionBinding(str("or"), &opOr);
-        frame->createFunctionBinding(str("not"), &opNot);
+        frame->createFunctionBinding(gfx_str("and"), &opAnd);
+        frame->createFunctionBinding(gfx_str("or"), &opOr);
+        frame->createFunctionBinding(gfx_str("not"), &opNot);
         
-        frame->createFunctionBinding(str("="), &opEqual);
-        frame->createFunctionBinding(str("!="), &opNotEqual);
-        frame->createFunctionBinding(str("<"), &opLessThan);
-        frame->createFunctionBinding(str("<="), &opLessThanOrEqual);
-        frame->createFunctionBinding(str(">"), &opGreaterThan);
-        frame->createFunctionBinding(str(">="), &opGreaterThanOrEqual);
+        frame->createFunctionBinding(gfx_str("="), &opEqual);
+        frame->createFunctionBinding(gfx_str("!="), &opNotEqual);
+        frame->createFunctionBinding(gfx_str("<"), &opLessThan);
+        frame->createFunctionBinding(gfx_str("<="), &opLessThanOrEqual);
+        frame->createFunctionBinding(gfx_str(">"), &opGreaterThan);
+        frame->createFunctionBinding(gfx_str(">="), &opGreaterThanOrEqual);
         
         
         //Stack Operations
-        frame->createFunctionBinding(str("__dup"), &dup);
-        frame->createFunctionBinding(str("__swap"), &swap);
-        frame->createFunctionBinding(str("__drop"), &drop);
-        frame->createFunctionBinding(str("__clear"), &clear);
-        frame->createFunctionBinding(str("__showstack"), &showstack);
+        frame->createFunctionBinding(gfx_str("__dup"), &dup);
+        frame->createFunctionBinding(gfx_str("__swap"), &swap);
+        frame->createFunctionBinding(gfx_str("__drop"), &drop);
+        frame->createFunctionBinding(gfx_str("__clear"), &clear);
+        frame->createFunctionBinding(gfx_str("__showstack"), &showstack);
         
         
         //Core Functions
-        frame->createFunctionBinding(str("type-of"), &type_of);
-        frame->createFunctionBinding(str("is-a?"), &is_a);
+        frame->createFunctionBinding(gfx_str("type-of"), &type_of);
+        frame->createFunctionBinding(gfx_str("is-a?"), &is_a);
         
 #if GFX_Language_SupportsImport
-        frame->createFunctionBinding(str("import"), &import);
+        frame->createFunctionBinding(gfx_str("import"), &import);
 #endif /* GFX_Language_SupportsImport */
         
-        frame->createFunctionBinding(str("print"), &print);
-        frame->createFunctionBinding(str("read"), &read);
-        frame->createFunctionBinding(str("->str"), &toString);
+        frame->createFunctionBinding(gfx_str("print"), &print);
+        frame->createFunctionBinding(gfx_str("read"), &read);
+        frame->createFunctionBinding(gfx_str("->str"), &toString);
         
-        frame->createFunctionBinding(str("if"), &_if);
-        frame->createFunctionBinding(str("ifelse"), &ifelse);
-        frame->createFunctionBinding(str("while"), &_while);
-        frame->createFunctionBinding(str("times"), &times);
-        frame->createFunctionBinding(str("fn/apply"), &apply);
-        frame->createFunctionBinding(str("__recurse"), &recurse);
+        frame->createFunctionBinding(gfx_str("if"), &_if);
+        frame->createFunctionBinding(gfx_str("ifelse"), &ifelse);
+        frame->createFunctionBinding(gfx_str("while"), &_while);
+        frame->createFunctionBinding(gfx_str("times"), &times);
+        frame->createFunctionBinding(gfx_str("fn/apply"), &apply);
+        frame->createFunctionBinding(gfx_str("__recurse"), &recurse);
         
-        frame->createFunctionBinding(str("throw"), &_throw);
-        frame->createFunctionBinding(str("rescue"), &rescue);
+        frame->createFunctionBinding(gfx_str("throw"), &_throw);
+        frame->createFunctionBinding(gfx_str("rescue"), &rescue);
         
-        frame->createFunctionBinding(str("->void"), &drop);
-        frame->createFunctionBinding(str("=>"), &bind);
-        frame->createFunctionBinding(str("set!"), &set);
-        frame->createFunctionBinding(str("def"), &define);
-        frame->createFunctionBinding(str("destruct!"), &destructure);
+        frame->createFunctionBinding(gfx_str("->void"), &drop);
+        frame->createFunctionBinding(gfx_str("=>"), &bind);
+        frame->createFunctionBinding(gfx_str("set!"), &set);
+        frame->createFunctionBinding(gfx_str("def"), &define);
+        frame->createFunctionBinding(gfx_str("destruct!"), &destructure);
         
         
         //String Functions
-        frame->createFunctionBinding(str("str/eq"), &str_eq);
-        frame->createFunctionBinding(str("str/compare"), &str_compare);
-        frame->createFunctionBinding(str("str/contains"), &str_contains);
-        frame->createFunctionBinding(str("str/starts-with"), &str_startsWith);
-        frame->createFunctionBinding(str("str/ends-with"), &str_endsWith);
+        frame->createFunctionBinding(gfx_str("str/eq"), &str_eq);
+        frame->createFunctionBinding(gfx_str("str/compare"), &str_compare);
+        frame->createFunctionBinding(gfx_str("str/contains"), &str_contains);
+        frame->createFunctionBinding(gfx_str("str/starts-with"), &str_startsWith);
+        frame->createFunctionBinding(gfx_str("str/ends-with"), &str_endsWith);
         
-        frame->createFunctionBinding(str("str/char-at"), &str_charAt);
-        frame->createFunctionBinding(str("str/index-of"), &str_indexOf);
+        frame->createFunctionBinding(gfx_str("str/char-at"), &str_charAt);
+        frame->createFunctionBinding(gfx_str("str/index-of"), &str_indexOf);
         
-        frame->createFunctionBinding(str("str/concat"), &str_concat);
-        frame->createFunctionBinding(str("str/replace"), &str_replace);
-        frame->createFunctionBinding(str("str/substr"), &str_substr);
-        frame->createFunctionBinding(str("str/split"), &str_split);
-        frame->createFunctionBinding(str("str/lower-case"), &str_lowerCase);
-        frame->createFunctionBinding(str("str/upper-case"), &str_upperCase);
-        frame->createFunctionBinding(str("str/capital-case"), &str_capitalCase);
+        frame->createFunctionBinding(gfx_str("str/concat"), &str_concat);
+        frame->createFunctionBinding(gfx_str("str/replace"), &str_replace);
+        frame->createFunctionBinding(gfx_str("str/substr"), &str_substr);
+        frame->createFunctionBinding(gfx_str("str/split"), &str_split);
+        frame->createFunctionBinding(gfx_str("str/lower-case"), &str_lowerCase);
+        frame->createFunctionBinding(gfx_str("str/upper-case"), &str_upperCase);
+        frame->createFunctionBinding(gfx_str("str/capital-case"), &str_capitalCase);
         
         
         //Vector Functions
-        frame->createFunctionBinding(str("vec/at"), &vec_at);
-        frame->createFunctionBinding(str("vec/concat"), &vec_concat);
-        frame->createFunctionBinding(str("vec/index-of"), &vec_indexOf);
-        frame->createFunctionBinding(str("vec/last-index-of"), &vec_lastIndexOf);
-        frame->createFunctionBinding(str("vec/join"), &vec_join);
-        frame->createFunctionBinding(str("vec/subset"), &vec_subset);
-        frame->createFunctionBinding(str("vec/sort"), &vec_sort);
-        frame->createFunctionBinding(str("vec/for-each"), &vec_forEach);
-        frame->createFunctionBinding(str("vec/filter"), &vec_filter);
-        frame->createFunctionBinding(str("vec/map"), &vec_map);
+        frame->createFunctionBinding(gfx_str("vec/at"), &vec_at);
+        frame->createFunctionBinding(gfx_str("vec/concat"), &vec_concat);
+        frame->createFunctionBinding(gfx_str("vec/index-of"), &vec_indexOf);
+        frame->createFunctionBinding(gfx_str("vec/last-index-of"), &vec_lastIndexOf);
+        frame->createFunctionBinding(gfx_str("vec/join"), &vec_join);
+        frame->createFunctionBinding(gfx_str("vec/subset"), &vec_subset);
+        frame->createFunctionBinding(gfx_str("vec/sort"), &vec_sort);
+        frame->createFunctionBinding(gfx_str("vec/sort-by"), &vec_sortBy);
+        frame->createFunctionBinding(gfx_str("vec/sort-values"), &vec_sortValues);
+        frame->createFunctionBinding(gfx_str("vec/for-each"), &vec_forEach);
+        frame->createFunctionBinding(gfx_str("vec/filter"), &vec_filter);
+        frame->createFunctionBinding(gfx_str("vec/map"), &vec_map);
+        frame->createFunctionBinding(gfx_str("vec/pmap"), &vec_pmap);
+        frame->createFunctionBinding(gfx_str("vec/pfilter"), &vec_pfilter);
+        frame->createFunctionBinding(gfx_str("vec/peach"), &vec_peach);
         
         
         //Hash Functions
-        frame->createFunctionBinding(str("hash/get"), &hash_get);
-        frame->createFunctionBinding(str("hash/concat"), &hash_concat);
-        frame->createFunctionBinding(str("hash/without"), &hash_without);
-        frame->createFunctionBinding(str("hash/each-pair"), &hash_eachPair);
+        frame->createFunctionBinding(gfx_str("hash/get"), &hash_get);
+        frame->createFunctionBinding(gfx_str("hash/concat"), &hash_concat);
+        frame->createFunctionBinding(gfx_str("hash/without"), &hash_without);
+        frame->createFunctionBinding(gfx_str("hash/each-pair"), &hash_eachPair);
         
         
         //File Functions
-        frame->createFunctionBinding(str("file/exists?"), &file_exists);
-        frame->createFunctionBinding(str("file/dir?"), &file_isDirectory);
-        frame->createFunctionBinding(str("file/open"), &file_open);
-        frame->createFunctionBinding(str("file/close"), &file_close);
-        frame->createFunctionBinding(str("file/size"), &file_size);
-        frame->createFunctionBinding(str("file/seek"), &file_seek);
-        frame->createFunctionBinding(str("file/tell"), &file_tell);
-        frame->createFunctionBinding(str("file/read"), &file_read);
-        frame->createFunctionBinding(str("file/read-line"), &file_readLine);
-        frame->createFunctionBinding(str("file/write"), &file_write);
-        frame->createFunctionBinding(str("file/write-line"), &file_writeLine);
+        frame->createFunctionBinding(gfx_str("file/exists?"), &file_exists);
+        frame->createFunctionBinding(gfx_str("file/dir?"), &file_isDirectory);
+        frame->createFunctionBinding(gfx_str("file/open"), &file_open);
+        frame->createFunctionBinding(gfx_str("file/close"), &file_close);
+        frame->createFunctionBinding(gfx_str("file/size"), &file_size);
+        frame->createFunctionBinding(gfx_str("file/seek"), &file_seek);
+        frame->createFunctionBinding(gfx_str("file/tell"), &file_tell);
+        frame->createFunctionBinding(gfx_str("file/read"), &file_read);
+        frame->createFunctionBinding(gfx_str("file/read-line"), &file_readLine);
+        frame->createFunctionBinding(gfx_str("file/write"), &file_write);
+        frame->createFunctionBinding(gfx_str("file/write-line"), &file_writeLine);
         
         
         //JSON Functions
-        frame->createFunctionBinding(str("json/parse"), &json_parse);
+        frame->createFunctionBinding(gfx_str("json/parse"), &json_parse);
+        
+        
+        //Typed Array Functions
+        TypedArrayFunctions::addTo(frame);
     }
     
     StackFrame *CoreFunctions::sharedCoreFunctionFrame()
@@ -14,6 +14,7 @@
 #include "base.h"
 #include "str.h"
 #include "number.h"
+#include "persistent.h"
 
 namespace gfx {
     
@@ -24,6 +25,9 @@ namespace gfx {
     ///
     ///All instances of `Dictionary` have mutable storage, to represent an
     ///immutable dictionary, qualify the instance with the const modifier.
+    ///
+    ///Dictionaries are backed by a `persistent::Hash`. Copying a dictionary
+    ///is O(1), and reading, setting, and removing values are O(log32 n).
     template<typename Key = const String, typename Value = Base>
     class Dictionary : public Base
     {
@@ -48,25 +52,32 @@ namespace gfx {
     protected:
         
         ///The storage of the Dictionary.
-        CFMutableDictionaryRef mStorage;
+        persistent::Hash<Key, Value, HashCode> mStorage;
         
     public:
         
         ///Constructs an empty dictionary.
         Dictionary() :
-            mStorage(CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &Base::kDictionaryKeyCallbacks, &Base::kDictionaryValueCallbacks))
+            mStorage()
         {
         }
         
         ///Constructs a dictionary by copying a CFDictionary's contents.
+        ///
+        ///The CFDictionary must contain instances of Key and Value.
         Dictionary(CFDictionaryRef dictionary) :
-            mStorage(CFDictionaryCreateMutableCopy(kCFAllocatorDefault, 0, dictionary))
+            Dictionary()
         {
+            CFDictionaryApplyFunction(dictionary, [](const void *key, const void *value, void *context) {
+                static_cast<Dictionary<Key, Value> *>(context)->set((Key *)key, (Value *)value);
+            }, this);
         }
         
         ///Constructs a dictionary by copying another dictionary.
+        ///
+        ///The copy shares its structure with the given dictionary, and is O(1).
         Dictionary(const Dictionary<Key, Value> *dictionary) :
-            Dictionary(dictionary->getStorage())
+            mStorage(dictionary->mStorage)
         {
         }
         
@@ -81,14 +92,13 @@ namespace gfx {
         ///The destructor of the dictionary.
         virtual ~Dictionary()
         {
-            CFRelease(mStorage);
         }
         
 #pragma mark - Identity
         
         HashCode hash() const override
         {
-            return CFHash(mStorage);
+            return (HashCode)count();
         }
         
         const String *description() const override
@@ -117,7 +127,18 @@ namespace gfx {
             if(!other)
                 return false;
             
-            return CFEqual(mStorage, other->mStorage);
+            if(other->count() != this->count())
+                return false;
+            
+            persistent::Hash<Key, Value, HashCode> otherStorage(other->mStorage);
+            bool isEqual = true;
+            mStorage.forEach([&otherStorage, &isEqual](Key *key, Value *value) {
+                isEqual = (otherStorage.contains(key, key->hash()) &&
+                           persistent::values_equal(value, otherStorage.get(key, key->hash())));
+                return isEqual;
+            });
+            
+            return isEqual;
         }
         
         bool isEqual(const Base *other) const override
@@ -125,32 +146,19 @@ namespace gfx {
             if(!other)
                 return false;
             
-            if(this->isKindOfClass<Dictionary<Key, Value>>()) {
+            if(other->isKindOfClass<Dictionary<Key, Value>>()) {
                 return this->isEqual((const Dictionary<Key, Value> *)other);
             }
             
             return false;
         }
         
-        ///Returns the underlying storage of the dictionary.
-        ///
-        ///This should be considered an implementation detail,
-        ///but is exposed for platform compatibility.
-        CFDictionaryRef getStorage() const
-        {
-            return (CFDictionaryRef)mStorage;
-        }
-        CFMutableDictionaryRef getStorage()
-        {
-            return mStorage;
-        }
-        
 #pragma mark - Accessing Values
         
         ///Returns the number of key-value associations stored in the dictionary.
         Index count() const
         {
-            return CFDictionaryGetCount(mStorage);
+            return (Index)mStorage.count();
         }
         
         ///Returns the number of instances of a given key are stored in the receiver.
@@ -158,7 +166,7 @@ namespace gfx {
         {
             gfx_assert_param(key);
             
-            return CFDictionaryGetCountOfKey(mStorage, (const void *)key);
+            return mStorage.contains(key, key->hash())? 1 : 0;
         }
         
         ///Returns the number of instances of a given value are stored in the receiver.
@@ -166,7 +174,15 @@ namespace gfx {
         {
             gfx_assert_param(value);
             
-            return CFDictionaryGetCountOfKey(mStorage, (const void *)value);
+            Index count = 0;
+            mStorage.forEach([value, &count](Key *key, Value *candidate) {
+                if(persistent::values_equal(candidate, value))
+                    count++;
+                
+                return true;
+            });
+            
+            return count;
         }
         
 #pragma mark -
@@ -176,7 +192,7 @@ namespace gfx {
         {
             gfx_assert_param(key);
             
-            return CFDictionaryContainsKey(mStorage, (const void *)key);
+            return mStorage.contains(key, key->hash());
         }
         
         ///Returns a bool indicating whether or not the receiver contains a given value.
@@ -184,7 +200,7 @@ namespace gfx {
         {
             gfx_assert_param(value);
             
-            return CFDictionaryContainsValue(mStorage, (const void *)value);
+            return (countOfValue(value) > 0);
         }
         
 #pragma mark -
@@ -194,22 +210,20 @@ namespace gfx {
         {
             gfx_assert_param(key);
             
-            return retained_autoreleased((Value *)CFDictionaryGetValue(mStorage, key));
+            return retained_autoreleased(mStorage.get(key, key->hash()));
         }
         
-    private:
-        
-        static void applierAdaptor(Key *key, Value *value, std::function<void(Key *key, Value *value)> *function)
-        {
-            (*function)(key, value);
-        }
-        
-    public:
-        
         ///Enumerate over each key-value pair contained within the dictionary, applying a given function to each.
+        ///
+        ///The pairs are kept alive for the duration of the enumeration,
+        ///even if the receiver is mutated by the function.
         void iterate(std::function<void(Key *key, Value *value)> function) const
         {
-            CFDictionaryApplyFunction(mStorage, (CFDictionaryApplierFunction)&applierAdaptor, &function);
+            persistent::Hash<Key, Value, HashCode> snapshot(mStorage);
+            snapshot.forEach([&function](Key *key, Value *value) {
+                function(key, value);
+                return true;
+            });
         }
         
 #pragma mark - Changing Values
@@ -219,13 +233,23 @@ namespace gfx {
         {
             gfx_assert_param(key);
             
-            CFDictionarySetValue(mStorage, key, value);
+            mStorage.set(key, value, key->hash());
         }
         
         ///Take all of the values contained in a
         ///given dictionary and add them to the receiver.
+        ///
+        ///Taking the values of a dictionary into an empty
+        ///dictionary shares the given dictionary's structure.
         void takeValuesFrom(const Dictionary<Key, Value> *other)
         {
+            gfx_assert_param(other);
+            
+            if(this->count() == 0) {
+                mStorage = other->mStorage;
+                return;
+            }
+            
             other->iterate([this](Key *key, Value *value) {
                 this->set(key, value);
             });
@@ -236,13 +260,13 @@ namespace gfx {
         {
             gfx_assert_param(key);
             
-            CFDictionaryRemoveValue(mStorage, key);
+            mStorage.remove(key, key->hash());
         }
         
         ///Removes all of the contents of the receiver.
         void removeAll()
         {
-            CFDictionaryRemoveAllValues(mStorage);
+            mStorage.clear();
         }
         
 #pragma mark - Utilities
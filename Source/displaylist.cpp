@@ -0,0 +1,100 @@
+//
+//  displaylist.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/9/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#if GFX_Include_GraphicsStack
+
+#include "displaylist.h"
+#include "context.h"
+#include "str.h"
+
+namespace gfx {
+    DisplayList::DisplayList(Rect bounds) :
+        mBounds(bounds),
+        mOperations()
+    {
+    }
+    
+    DisplayList::~DisplayList()
+    {
+    }
+    
+#pragma mark - Identity
+    
+    const String *DisplayList::description() const
+    {
+        String::Builder description;
+        description << "<" << this->className() << ":" << (void *)this << " " << count() << " operations>";
+        return description;
+    }
+    
+#pragma mark - Introspection
+    
+    Rect DisplayList::bounds() const
+    {
+        return mBounds;
+    }
+    
+    Index DisplayList::count() const
+    {
+        return Index(mOperations.size());
+    }
+    
+    bool DisplayList::isEmpty() const
+    {
+        return mOperations.empty();
+    }
+    
+#pragma mark - Recording
+    
+    void DisplayList::append(const Operation &operation)
+    {
+        gfx_assert_param(operation);
+        
+        mOperations.push_back(operation);
+    }
+    
+#pragma mark - Replaying
+    
+    void DisplayList::replay(Context *context) const
+    {
+        replay(context, Transform2D::Identity);
+    }
+    
+    void DisplayList::replayInRect(Context *context, Rect rect) const
+    {
+        Float scaleX = (mBounds.size.width != 0.0)? rect.size.width / mBounds.size.width : 1.0;
+        Float scaleY = (mBounds.size.height != 0.0)? rect.size.height / mBounds.size.height : 1.0;
+        
+        Transform2D transform = Transform2D::makeTranslation(-mBounds.origin.x, -mBounds.origin.y)
+            .concat(Transform2D::makeScale(scaleX, scaleY))
+            .concat(Transform2D::makeTranslation(rect.origin.x, rect.origin.y));
+        replay(context, transform);
+    }
+    
+    void DisplayList::replay(Context *context, const Transform2D &transform) const
+    {
+        gfx_assert_param(context);
+        
+        //Operations draw into the current context, as the functor they were recorded from did.
+        Context::pushContext(context);
+        try {
+            context->transaction([this, &transform](Context *context) {
+                context->concatTransformationMatrix(transform);
+                for (const Operation &operation : mOperations)
+                    operation(context);
+            });
+        } catch (...) {
+            Context::popContext();
+            throw;
+        }
+        
+        Context::popContext();
+    }
+}
+
+#endif /* GFX_Include_GraphicsStack */
@@ -0,0 +1,114 @@
+//
+//  displaylist.h
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/9/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef __gfx__displaylist__
+#define __gfx__displaylist__
+
+#if GFX_Include_GraphicsStack
+
+#include "base.h"
+#include "types.h"
+#include <functional>
+#include <vector>
+
+namespace gfx {
+    class Context;
+    class StackFrame;
+    
+    ///The DisplayList class encapsulates a recorded stream of drawing operations.
+    ///
+    ///Display lists are populated by `gfx::Context::record`, which captures the
+    ///path, fill, stroke, gradient, image, shadow and text operations performed
+    ///by a functor instead of rendering them. Every object an operation depends
+    ///on is retained, and mutable objects such as paths are copied, so that a
+    ///list always replays exactly what was recorded.
+    ///
+    ///A display list may be replayed into any context, with any transform, and
+    ///at any scale without re-running the functor that populated it.
+    class DisplayList : public Base
+    {
+    public:
+        
+        ///A single recorded operation. Operations are replayed with the
+        ///context being replayed into as the current context.
+        typedef std::function<void(Context *context)> Operation;
+        
+    protected:
+        
+        ///The user space area the operations were recorded against.
+        Rect mBounds;
+        
+        ///The operations of the list, in the order they were recorded.
+        std::vector<Operation> mOperations;
+        
+    public:
+    
+#pragma mark - Lifecycle
+        
+        ///Constructs an empty display list.
+        ///
+        /// \param  bounds  The area in user space the operations of the list will be recorded against.
+        ///
+        DisplayList(Rect bounds);
+        
+        ///The destructor.
+        ~DisplayList();
+        
+#pragma mark - Identity
+        
+        virtual const String *description() const override;
+        
+#pragma mark - Introspection
+        
+        ///Returns the area in user space the operations of the list were recorded against.
+        Rect bounds() const;
+        
+        ///Returns the number of operations in the list.
+        Index count() const;
+        
+        ///Returns whether or not the list contains no operations.
+        bool isEmpty() const;
+        
+#pragma mark - Recording
+        
+        ///Appends an operation to the receiver.
+        ///
+        ///This method should only be invoked by `gfx::Context` while it is recording.
+        void append(const Operation &operation);
+        
+#pragma mark - Replaying
+        
+        ///Performs the operations of the receiver in a given context.
+        ///
+        /// \param  context The context to replay the operations into. Required.
+        ///
+        ///The state of the context is saved before the operations are
+        ///replayed, and restored afterwards.
+        void replay(Context *context) const;
+        
+        ///Performs the operations of the receiver in a given context,
+        ///transforming them so that the bounds of the receiver fill a rectangle.
+        ///
+        /// \param  context The context to replay the operations into. Required.
+        /// \param  rect    The rectangle in the user space of the context to fill.
+        ///
+        void replayInRect(Context *context, Rect rect) const;
+        
+        ///Performs the operations of the receiver in a given context
+        ///after concatenating a transform onto the context's matrix.
+        ///
+        /// \param  context     The context to replay the operations into. Required.
+        /// \param  transform   The transform to apply to the operations.
+        ///
+        void replay(Context *context, const Transform2D &transform) const;
+    };
+}
+
+#endif /* GFX_Include_GraphicsStack */
+
+#endif /* defined(__gfx__displaylist__) */
@@ -139,6 +139,11 @@ namespace gfx {
     
 #pragma mark - Introspection
     
+    std::FILE *File::get() const
+    {
+        return mFile;
+    }
+    
     size_t File::length() const
     {
         size_t oldPosition = std::ftell(mFile);
@@ -138,6 +138,9 @@ namespace gfx {
         
 #pragma mark - Introspection
         
+        ///Returns the wrapped std::FILE.
+        std::FILE *get() const;
+        
         ///Returns the total length of the file.
         ///
         ///Calling this method on the result of one of
@@ -6,8 +6,11 @@
 //  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
 //
 
+#if GFX_Include_GraphicsStack
+
 #include "font.h"
 #include "str.h"
+#include "exception.h"
 
 #include "stackframe.h"
 #include "number.h"
@@ -20,12 +23,50 @@ namespace gfx {
     {
         gfx_assert_param(name);
         
+#if GFX_Graphics_Use_Raster
+        auto typeface = raster::Typeface::named(name->getCString());
+        if(!typeface)
+            throw Exception((String::Builder() << "could not find font named '" << name << "'."), nullptr);
+        
+        raster::Font nativeFont{ typeface, size };
+        return make<Font>(&nativeFont);
+#else
         cf::AutoRef<CTFontRef> nativeFont = CTFontCreateWithName(name->getStorage(), size, NULL);
         return make<Font>(nativeFont);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark -
     
+#if GFX_Graphics_Use_Raster
+    ///Returns the first of a list of fonts that is installed, raising if none of them are.
+    static Font *FirstInstalledFont(std::initializer_list<const char *> names, Float size)
+    {
+        for (const char *name : names) {
+            if(auto typeface = raster::Typeface::named(name)) {
+                raster::Font nativeFont{ typeface, size };
+                return make<Font>(&nativeFont);
+            }
+        }
+        
+        throw Exception(str("could not find a system font."), nullptr);
+    }
+    
+    Font *Font::regular(Float size)
+    {
+        return FirstInstalledFont({ "HelveticaNeue", "Helvetica", "ArialMT", "LiberationSans", "DejaVuSans", "Roboto-Regular", "NotoSans-Regular" }, size);
+    }
+    
+    Font *Font::bold(Float size)
+    {
+        return FirstInstalledFont({ "HelveticaNeue-Bold", "Helvetica-Bold", "Arial-BoldMT", "LiberationSans-Bold", "DejaVuSans-Bold", "Roboto-Bold", "NotoSans-Bold" }, size);
+    }
+    
+    Font *Font::italic(Float size)
+    {
+        return FirstInstalledFont({ "HelveticaNeue-Italic", "Helvetica-Oblique", "Arial-ItalicMT", "LiberationSans-Italic", "DejaVuSans-Oblique", "Roboto-Italic", "NotoSans-Italic" }, size);
+    }
+#else
     Font *Font::regular(Float size)
     {
         return Font::withName(str("HelveticaNeue"), size);
@@ -40,9 +81,26 @@ namespace gfx {
     {
         return Font::withName(str("HelveticaNeue-Italic"), size);
     }
+#endif /* GFX_Graphics_Use_Raster */
     
 #pragma mark - Lifecycle
     
+#if GFX_Graphics_Use_Raster
+    Font::Font(NativeType font) :
+        Base(),
+        mFont(*font)
+    {
+    }
+    
+    Font::Font(const Font *font) :
+        Font(font->get())
+    {
+    }
+    
+    Font::~Font()
+    {
+    }
+#else
     Font::Font(NativeType font) :
         Base(),
         mFont((NativeType)CFRetain(font))
@@ -61,12 +119,17 @@ namespace gfx {
             mFont = NULL;
         }
     }
+#endif /* GFX_Graphics_Use_Raster */
     
 #pragma mark - Identity
     
     HashCode Font::hash() const
     {
+#if GFX_Graphics_Use_Raster
+        return HashCode(mFont.typeface->uniqueID()) ^ HashCode(std::hash<Float>()(mFont.size));
+#else
         return CFHash(get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     bool Font::isEqual(const Font *other) const
@@ -74,7 +137,11 @@ namespace gfx {
         if(!other)
             return false;
         
+#if GFX_Graphics_Use_Raster
+        return (mFont.typeface == other->mFont.typeface && mFont.size == other->mFont.size);
+#else
         return CFEqual(get(), other->get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     bool Font::isEqual(const Base *other) const
@@ -98,6 +165,39 @@ namespace gfx {
     
 #pragma mark - Introspection
     
+#if GFX_Graphics_Use_Raster
+    Font::NativeType Font::get() const
+    {
+        return &mFont;
+    }
+    
+    Float Font::size() const
+    {
+        return mFont.size;
+    }
+    
+    Transform2D Font::matrix() const
+    {
+        return Transform2D::Identity;
+    }
+    
+#pragma mark -
+    
+    Float Font::ascent() const
+    {
+        return mFont.typeface->ascender() * mFont.size / mFont.typeface->unitsPerEm();
+    }
+    
+    Float Font::descent() const
+    {
+        return -mFont.typeface->descender() * mFont.size / mFont.typeface->unitsPerEm();
+    }
+    
+    Float Font::leading() const
+    {
+        return mFont.typeface->lineGap() * mFont.size / mFont.typeface->unitsPerEm();
+    }
+#else
     Font::NativeType Font::get() const
     {
         return mFont;
@@ -129,6 +229,7 @@ namespace gfx {
     {
         return CTFontGetLeading(get());
     }
+#endif /* GFX_Graphics_Use_Raster */
     
     Float Font::lineHeight() const
     {
@@ -139,14 +240,22 @@ namespace gfx {
     
     const String *Font::displayName() const
     {
+#if GFX_Graphics_Use_Raster
+        return make<String>(mFont.typeface->fullName().c_str());
+#else
         cf::StringAutoRef displayName = CTFontCopyFullName(get());
         return make<String>(displayName);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     const String *Font::fullName() const
     {
+#if GFX_Graphics_Use_Raster
+        return make<String>(mFont.typeface->fullName().c_str());
+#else
         cf::StringAutoRef fullName = CTFontCopyFullName(get());
         return make<String>(fullName);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark - Functions
@@ -186,9 +295,11 @@ namespace gfx {
     {
         gfx_assert_param(frame);
         
-        frame->createFunctionBinding(str("font"), &font_make);
-        frame->createFunctionBinding(str("font/regular"), &font_regular);
-        frame->createFunctionBinding(str("font/bold"), &font_bold);
-        frame->createFunctionBinding(str("font/italic"), &font_italic);
+        frame->createFunctionBinding(gfx_str("font"), &font_make);
+        frame->createFunctionBinding(gfx_str("font/regular"), &font_regular);
+        frame->createFunctionBinding(gfx_str("font/bold"), &font_bold);
+        frame->createFunctionBinding(gfx_str("font/italic"), &font_italic);
     }
 }
+
+#endif /* GFX_Include_GraphicsStack */
@@ -9,17 +9,38 @@
 #ifndef __gfx__font__
 #define __gfx__font__
 
+#if GFX_Include_GraphicsStack
+
 #include "base.h"
-#include <CoreText/CoreText.h>
+#include "types.h"
+
+#if GFX_Graphics_Use_Raster
+#   include "raster.h"
+#else
+#   include <CoreText/CoreText.h>
+#endif /* GFX_Graphics_Use_Raster */
 
 namespace gfx {
     class StackFrame;
     
     ///The Font class encapsulates fonts for the Gfx graphics stack.
+    ///
+    ///The underlying type of Font is platform dependent. On OS X and iOS, it is CTFont.
+    ///With the software rasterizer, it is a `gfx::raster::Font` held by value, and fonts
+    ///are found among the TrueType fonts installed on the system.
     class Font final : public Base
     {
     public:
         
+#if GFX_Graphics_Use_Raster
+        ///The underlying native type that is backing the Font class.
+        typedef const raster::Font *NativeType;
+        
+    protected:
+        
+        ///The typeface and size of the font.
+        raster::Font mFont;
+#else
         ///The underlying native type that is backing the Font class.
         typedef CTFontRef NativeType;
         
@@ -27,6 +48,7 @@ namespace gfx {
         
         ///The backing font object.
         NativeType mFont;
+#endif /* GFX_Graphics_Use_Raster */
         
     public:
         
@@ -39,6 +61,9 @@ namespace gfx {
         ///
         /// \result A new autoreleased Font instance if a font by `name` could be found; null otherwise.
         ///
+        ///With the software rasterizer, `name` may be the PostScript name, full name, or
+        ///file name of an installed font, or the path of a font file. An exception is
+        ///raised if no such font can be found.
         static Font *withName(const String *name, Float size);
         
 #pragma mark -
@@ -125,4 +150,6 @@ namespace gfx {
     };
 }
 
+#endif /* GFX_Include_GraphicsStack */
+
 #endif /* defined(__gfx__font__) */
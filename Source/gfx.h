@@ -18,6 +18,7 @@
 #   include <gfx/exception.h>
 #   include <gfx/array.h>
 #   include <gfx/dictionary.h>
+#   include <gfx/typedarray.h>
 #   include <gfx/filepolicy.h>
 #   include <gfx/session.h>
 
@@ -33,6 +34,8 @@
 #   include <gfx/context.h>
 #   include <gfx/image.h>
 #   include <gfx/layer.h>
+#   include <gfx/displaylist.h>
+#   include <gfx/spatialindex.h>
 #   include <gfx/color.h>
 
 #   include <gfx/gradient.h>
@@ -80,4 +80,34 @@
 #   define GFX_Layer_Use_CA             1
 #endif /* TARGET_OS_MAC && !TARGET_OS_IPHONE */
 
+#pragma mark - Portable Config Options
+
+///Whether or not the graphics stack should be backed by the portable
+///software rasterizer in `gfx::raster` instead of CoreGraphics. This is
+///the only backend available on platforms without CoreGraphics, and may
+///be forced on for Apple platforms by defining it to be 1.
+#ifndef GFX_Graphics_Use_Raster
+#   if TARGET_OS_MAC
+#       define GFX_Graphics_Use_Raster  0
+#   else
+#       define GFX_Graphics_Use_Raster  1
+#   endif /* TARGET_OS_MAC */
+#endif /* GFX_Graphics_Use_Raster */
+
+#if GFX_Graphics_Use_Raster
+#   undef GFX_Layer_Use_CG
+#   undef GFX_Layer_Use_CA
+
+///The CoreGraphics and CoreAnimation layer backings
+///are unavailable with the software rasterizer.
+#   define GFX_Layer_Use_CG             0
+#   define GFX_Layer_Use_CA             0
+
+///Whether or not to use the implementation of `gfx::Layer` that is backed by
+///a `gfx::raster::Surface`. Only available with `GFX_Graphics_Use_Raster`.
+#   define GFX_Layer_Use_Raster         1
+#else
+#   define GFX_Layer_Use_Raster         0
+#endif /* GFX_Graphics_Use_Raster */
+
 #endif
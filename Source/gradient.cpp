@@ -16,7 +16,100 @@
 #include "stackframe.h"
 #include "number.h"
 
+#include "lrucache.h"
+
+#include <cmath>
+#include <functional>
+
 namespace gfx {
+    
+#pragma mark - Gradient Cache
+    
+    ///The stops of a gradient, flattened into the location, the
+    ///number of components, and the components of each color in turn.
+    typedef std::vector<Float> GradientKey;
+    
+    ///Hashes the stops of a gradient.
+    struct GradientKeyHash
+    {
+        size_t operator()(const GradientKey &key) const
+        {
+            std::hash<Float> hashFloat;
+            size_t hash = key.size();
+            for (Float value : key)
+                hash = hash * 31 + hashFloat(value);
+            
+            return hash;
+        }
+    };
+    
+    ///The GradientCache class keeps the native gradients most recently built for `gfx::Gradient`,
+    ///so that scripts which create the same gradient each time they draw share one native gradient.
+    ///
+    ///In the software backend, sharing a native gradient also shares its lookup table,
+    ///which is most of the cost of creating a gradient.
+    class GradientCache
+    {
+    public:
+        
+        ///The type of native gradient kept by the cache.
+#if GFX_Graphics_Use_Raster
+        typedef raster::Gradient NativeGradient;
+#else
+        typedef cf::AutoRef<CGGradientRef> NativeGradient;
+#endif /* GFX_Graphics_Use_Raster */
+        
+    private:
+        
+        ///The cached gradients by the stops they were built from.
+        LRUCache<GradientKey, NativeGradient, GradientKeyHash> mGradients;
+        
+    public:
+        
+        ///The largest number of gradients kept by the cache.
+        static const size_t kMaximumCount = 64;
+        
+        GradientCache() :
+            mGradients(kMaximumCount)
+        {
+        }
+        
+        ///Returns the shared gradient cache.
+        static GradientCache *shared()
+        {
+            static GradientCache *sharedCache = new GradientCache();
+            return sharedCache;
+        }
+        
+        ///Returns the native gradient built from given stops.
+        ///
+        /// \param  key         The stops of the gradient.
+        /// \param  construct   Invoked to build the gradient if it is not in the cache.
+        ///
+        ///Gradients with stops that are not finite are built every time, and never cached.
+        NativeGradient gradientFor(const GradientKey &key, const std::function<NativeGradient()> &construct)
+        {
+            //NaN stops never compare equal to themselves, so keys with them can't be found again.
+            for (Float value : key) {
+                if(!std::isfinite(value))
+                    return construct();
+            }
+            
+            return mGradients.valueFor(key, construct);
+        }
+    };
+    
+#if !GFX_Graphics_Use_Raster
+    ///Returns the color space native gradients are created in.
+    static CGColorSpaceRef GradientColorSpace()
+    {
+        static CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+        return colorSpace;
+    }
+#endif /* !GFX_Graphics_Use_Raster */
+    
+#pragma mark - Lifecycle
+    
     Gradient::Gradient(const Array<Color> *colors, const std::vector<Float> &locations, const DrawingInformation &info) :
         Base(),
         mStorage(),
@@ -24,18 +117,41 @@ namespace gfx {
     {
         gfx_assert(colors->count() == locations.size(), str("colors and locations must be the same size"));
         
-        cf::AutoRef<CGColorSpaceRef> colorSpace = CGColorSpaceCreateDeviceRGB();
-        cf::MutableArrayAutoRef nativeColors = CFArrayCreateMutable(kCFAllocatorDefault, 0, &kCFTypeArrayCallBacks);
-        colors->iterate(colors->all(), [nativeColors](Color *color, Index index, bool *stop) {
-            CFArrayAppendValue(nativeColors, color->get());
+        GradientKey key;
+        colors->iterate(colors->all(), [&key, &locations](Color *color, Index index, bool *stop) {
+            key.push_back(locations[index]);
+            key.push_back(color->numberOfComponents());
+            key.insert(key.end(), color->getComponents(), color->getComponents() + color->numberOfComponents());
+        });
+        
+#if GFX_Graphics_Use_Raster
+        mStorage = new raster::Gradient(GradientCache::shared()->gradientFor(key, [colors, &locations]() {
+            std::vector<raster::GradientStop> stops;
+            colors->iterate(colors->all(), [&stops, &locations](Color *color, Index index, bool *stop) {
+                stops.push_back(raster::GradientStop{ locations[index], *color->get() });
+            });
+            return raster::Gradient(stops);
+        }));
+#else
+        GradientCache::NativeGradient gradient = GradientCache::shared()->gradientFor(key, [colors, &locations]() {
+            cf::MutableArrayAutoRef nativeColors = CFArrayCreateMutable(kCFAllocatorDefault, 0, &kCFTypeArrayCallBacks);
+            colors->iterate(colors->all(), [nativeColors](Color *color, Index index, bool *stop) {
+                CFArrayAppendValue(nativeColors, color->get());
+            });
+            return GradientCache::NativeGradient(CGGradientCreateWithColors(GradientColorSpace(), nativeColors, &locations[0]));
         });
-        mStorage = CGGradientCreateWithColors(colorSpace, nativeColors, &locations[0]);
+        mStorage = (CGGradientRef)CFRetain(gradient);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     Gradient::~Gradient()
     {
         if(mStorage) {
+#if GFX_Graphics_Use_Raster
+            delete mStorage;
+#else
             CFRelease(mStorage);
+#endif /* GFX_Graphics_Use_Raster */
             mStorage = NULL;
         }
     }
@@ -44,7 +160,11 @@ namespace gfx {
     
     HashCode Gradient::hash() const
     {
+#if GFX_Graphics_Use_Raster
+        return get()->hash();
+#else
         return CFHash(get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     bool Gradient::isEqual(const Gradient *other) const
@@ -52,7 +172,11 @@ namespace gfx {
         if(!other)
             return false;
         
+#if GFX_Graphics_Use_Raster
+        return (*get() == *other->get());
+#else
         return CFEqual(get(), other->get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     bool Gradient::isEqual(const Base *other) const
@@ -74,52 +198,116 @@ namespace gfx {
     
     /* Derived from <https://github.com/larcus94/LBGradient/blob/master/LBGradient/LBGradient.m> */
     
+    ///Returns the start and end points of a linear gradient that spans a rectangle
+    ///horizontally, rotated around the center of the rectangle by an angle in degrees.
+    ///
+    ///A linear gradient between rotated points is the same as the gradient between the
+    ///original points drawn with a rotated context, but does not change the context.
+    static std::pair<Point, Point> RotatedLinearGradientPoints(Rect rect, Float angle)
+    {
+        Transform2D rotation = (Transform2D::makeTranslation(-rect.getMidX(), -rect.getMidY())
+                                .concat(Transform2D::makeRotation(-(M_PI * angle / 180.0)))
+                                .concat(Transform2D::makeTranslation(rect.getMidX(), rect.getMidY())));
+        return std::make_pair(rotation.transformPoint(Point{ rect.getMinX(), rect.getMidY() }),
+                              rotation.transformPoint(Point{ rect.getMaxX(), rect.getMidY() }));
+    }
+    
     void Gradient::drawLinearInRect(Rect rect, Float angle)
     {
+        if(Context::currentContext()->recordingDisplayList()) {
+            Scoped<Gradient> gradient = this;
+            Context::currentContext()->recordOperation([gradient, rect, angle](Context *context) {
+                gradient->drawLinearInRect(rect, angle);
+            });
+            return;
+        }
+        
+        if(Context::currentContext()->quickReject(rect))
+            return;
+
+#if GFX_Graphics_Use_Raster
         Context::currentContext()->transaction([this, rect, angle](Context *context) {
-            CGContextClipToRect(context->get(), rect);
-            CGContextTranslateCTM(context->get(), rect.getMidX(), rect.getMidY());
-            CGContextRotateCTM(context->get(), -(M_PI * angle / 180.0));
-            CGContextTranslateCTM(context->get(), -rect.getMidX(), -rect.getMidY());
+            context->get()->clipToRect(rect);
             
-            CGPoint startPoint = { rect.getMinX(), rect.getMidY() };
-            CGPoint endPoint = { rect.getMaxX(), rect.getMidY() };
+            auto points = RotatedLinearGradientPoints(rect, angle);
+            context->get()->drawLinearGradient(*this->get(),
+                                               points.first,
+                                               points.second,
+                                               raster::DrawsBeforeStartLocation | raster::DrawsAfterEndLocation);
+        });
+#else
+        Context::currentContext()->transaction([this, rect, angle](Context *context) {
+            CGContextClipToRect(context->get(), rect);
             
+            auto points = RotatedLinearGradientPoints(rect, angle);
             CGContextDrawLinearGradient(context->get(),
                                         this->get(),
-                                        startPoint,
-                                        endPoint,
+                                        points.first,
+                                        points.second,
                                         kCGGradientDrawsBeforeStartLocation | kCGGradientDrawsAfterEndLocation);
         });
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     void Gradient::drawLinearInPath(const Path *path, Float angle)
     {
+        if(Context::currentContext()->recordingDisplayList()) {
+            Scoped<Gradient> gradient = this;
+            Scoped<Path> pathCopy = make<Path>(path);
+            Context::currentContext()->recordOperation([gradient, pathCopy, angle](Context *context) {
+                gradient->drawLinearInPath(pathCopy, angle);
+            });
+            return;
+        }
+        
+        if(Context::currentContext()->quickReject(path->boundingBox()))
+            return;
+
+#if GFX_Graphics_Use_Raster
         Context::currentContext()->transaction([this, path, angle](Context *context) {
             path->set();
-            auto rect = path->boundingBox();
-            
-            CGContextTranslateCTM(context->get(), rect.getMidX(), rect.getMidY());
-            CGContextRotateCTM(context->get(), -(M_PI * angle / 180.0));
-            CGContextTranslateCTM(context->get(), -rect.getMidX(), -rect.getMidY());
             
-            CGPoint startPoint{ rect.getMinX(), rect.getMidY() };
-            CGPoint endPoint{ rect.getMaxX(), rect.getMidY() };
+            auto points = RotatedLinearGradientPoints(path->boundingBox(), angle);
+            context->get()->drawLinearGradient(*this->get(),
+                                               points.first,
+                                               points.second,
+                                               raster::DrawsBeforeStartLocation | raster::DrawsAfterEndLocation);
+        });
+#else
+        Context::currentContext()->transaction([this, path, angle](Context *context) {
+            path->set();
             
+            auto points = RotatedLinearGradientPoints(path->boundingBox(), angle);
             CGContextDrawLinearGradient(context->get(),
                                         this->get(),
-                                        startPoint,
-                                        endPoint,
+                                        points.first,
+                                        points.second,
                                         kCGGradientDrawsBeforeStartLocation | kCGGradientDrawsAfterEndLocation);
         });
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark -
     
     void Gradient::drawRadialInRect(Rect rect, Point relativeCenterPoint)
     {
+        if(Context::currentContext()->recordingDisplayList()) {
+            Scoped<Gradient> gradient = this;
+            Context::currentContext()->recordOperation([gradient, rect, relativeCenterPoint](Context *context) {
+                gradient->drawRadialInRect(rect, relativeCenterPoint);
+            });
+            return;
+        }
+        
+        if(Context::currentContext()->quickReject(rect))
+            return;
+        
         Context::currentContext()->transaction([this, rect, relativeCenterPoint](Context *context) {
+#if GFX_Graphics_Use_Raster
+            context->get()->clipToRect(rect);
+#else
             CGContextClipToRect(context->get(), rect);
+#endif /* GFX_Graphics_Use_Raster */
             
             Float radius = sqrt(pow(rect.getWidth() / 2.0, 2.0) + pow(rect.getHeight() / 2.0, 2.0));
             Point startCenter{
@@ -131,6 +319,14 @@ namespace gfx {
                 rect.getHeight() / 2.0
             };
             
+#if GFX_Graphics_Use_Raster
+            context->get()->drawRadialGradient(*this->get(),
+                                               startCenter,
+                                               0.0,
+                                               endCenter,
+                                               radius,
+                                               raster::DrawsBeforeStartLocation | raster::DrawsAfterEndLocation);
+#else
             CGContextDrawRadialGradient(context->get(),
                                         this->get(),
                                         startCenter,
@@ -138,11 +334,24 @@ namespace gfx {
                                         endCenter,
                                         radius,
                                         kCGGradientDrawsBeforeStartLocation | kCGGradientDrawsAfterEndLocation);
+#endif /* GFX_Graphics_Use_Raster */
         });
     }
     
     void Gradient::drawRadialInPath(const Path *path, Point relativeCenterPoint)
     {
+        if(Context::currentContext()->recordingDisplayList()) {
+            Scoped<Gradient> gradient = this;
+            Scoped<Path> pathCopy = make<Path>(path);
+            Context::currentContext()->recordOperation([gradient, pathCopy, relativeCenterPoint](Context *context) {
+                gradient->drawRadialInPath(pathCopy, relativeCenterPoint);
+            });
+            return;
+        }
+        
+        if(Context::currentContext()->quickReject(path->boundingBox()))
+            return;
+        
         Context::currentContext()->transaction([this, path, relativeCenterPoint](Context *context) {
             path->set();
             auto rect = path->boundingBox();
@@ -157,6 +366,14 @@ namespace gfx {
                 rect.getHeight() / 2.0
             };
             
+#if GFX_Graphics_Use_Raster
+            context->get()->drawRadialGradient(*this->get(),
+                                               startCenter,
+                                               0.0,
+                                               endCenter,
+                                               radius,
+                                               raster::DrawsBeforeStartLocation | raster::DrawsAfterEndLocation);
+#else
             CGContextDrawRadialGradient(context->get(),
                                         this->get(),
                                         startCenter,
@@ -164,6 +381,7 @@ namespace gfx {
                                         endCenter,
                                         radius,
                                         kCGGradientDrawsBeforeStartLocation | kCGGradientDrawsAfterEndLocation);
+#endif /* GFX_Graphics_Use_Raster */
         });
     }
     
@@ -291,9 +509,9 @@ namespace gfx {
     {
         gfx_assert_param(frame);
         
-        frame->createFunctionBinding(str("linear-gradient"), &gradient_makeLinear);
-        frame->createFunctionBinding(str("radial-gradient"), &gradient_makeRadial);
+        frame->createFunctionBinding(gfx_str("linear-gradient"), &gradient_makeLinear);
+        frame->createFunctionBinding(gfx_str("radial-gradient"), &gradient_makeRadial);
         
-        frame->createFunctionBinding(str("gradient/draw"), &gradient_draw);
+        frame->createFunctionBinding(gfx_str("gradient/draw"), &gradient_draw);
     }
 }
@@ -14,6 +14,10 @@
 
 #include <vector>
 
+#if GFX_Graphics_Use_Raster
+#   include "raster.h"
+#endif /* GFX_Graphics_Use_Raster */
+
 namespace gfx {
     class Color;
     class Path;
@@ -27,7 +31,11 @@ namespace gfx {
     public:
         
         ///The underlying native type of the gradient class.
+#if GFX_Graphics_Use_Raster
+        typedef raster::Gradient *NativeType;
+#else
         typedef CGGradientRef NativeType;
+#endif /* GFX_Graphics_Use_Raster */
         
         ///The DrawingInformation class encapsulates the information necessary to
         ///render a gradient using one of its generic public drawing methods.
@@ -104,6 +112,8 @@ namespace gfx {
         /// \param  locations   The corresponding locations for each color. Locations are in the range of {0.0, 1.0}.
         /// \param  info        The drawing information used to render the gradient through one of its generic drawing methods.
         ///
+        ///Gradients with the same colors and locations share a native gradient
+        ///from a cache of the most recently created gradients.
         Gradient(const Array<Color> *colors, const std::vector<Float> &locations, const DrawingInformation &info);
         
         ///The destructor.
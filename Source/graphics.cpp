@@ -30,6 +30,10 @@
 #include "font.h"
 
 #include "type.h"
+#include "noise.h"
+#include "displaylist.h"
+#include "spatialindex.h"
+#include <random>
 
 namespace gfx {
     
@@ -115,34 +119,213 @@ namespace gfx {
         }
     }
     
-#pragma mark - Misc Functions
+#pragma mark - Noise Functions
     
-    static void noise(StackFrame *frame)
+#if GFX_Graphics_Use_Raster
+    ///Creates an opaque image from a buffer of gray pixels allocated with `new[]`, taking ownership of the buffer.
+    static Image *GrayImageWithPixels(uint8_t *pixels, size_t width, size_t height)
+    {
+        raster::Surface *surface = new raster::Surface(width, height);
+        uint32_t *destination = surface->pixels();
+        for (size_t index = 0, count = width * height; index < count; index++)
+            destination[index] = raster::pixel(pixels[index], pixels[index], pixels[index], 255);
+        
+        delete[] pixels;
+        
+        return make<Image>(surface, true);
+    }
+#else
+    ///Creates an image that takes ownership of a buffer of pixels allocated with `new[]`.
+    ///
+    ///The pixels are handed to the image as is, avoiding the
+    ///copy that creating an image from a bitmap context makes.
+    static CGImageRef CreateImageWithPixels(uint8_t *pixels, size_t width, size_t height, size_t bytesPerRow,
+                                            size_t bitsPerPixel, CGColorSpaceRef colorSpace, CGBitmapInfo bitmapInfo)
+    {
+        auto releasePixels = [](void *info, const void *data, size_t size) {
+            delete[] (uint8_t *)data;
+        };
+        cf::AutoRef<CGDataProviderRef> dataProvider = CGDataProviderCreateWithData(nullptr, pixels, bytesPerRow * height, releasePixels);
+        return CGImageCreate(width, height, 8, bitsPerPixel, bytesPerRow, colorSpace, bitmapInfo, dataProvider, nullptr, false, kCGRenderingIntentDefault);
+    }
+    
+    ///Creates an image from a buffer of gray pixels allocated with `new[]`, taking ownership of the buffer.
+    static Image *GrayImageWithPixels(uint8_t *pixels, size_t width, size_t height)
+    {
+        cf::AutoRef<CGColorSpaceRef> colorSpace = CGColorSpaceCreateDeviceGray();
+        return make<Image>(CreateImageWithPixels(pixels, width, height, width, 8, colorSpace, kCGImageAlphaNone));
+    }
+#endif /* GFX_Graphics_Use_Raster */
+    
+    ///Creates a gray scale image filled with coherent noise.
+    static Image *CoherentNoiseImage(noise::Basis basis, Size size, Number *scale, Number *octaves, Number *seed)
+    {
+        gfx_assert(scale->value() > 0.0, gfx_str("noise scale must be greater than zero"));
+        gfx_assert(octaves->value() >= 1.0, gfx_str("noise must have at least one octave"));
+        
+        size_t width = std::max(size.width, 1.0), height = std::max(size.height, 1.0);
+        uint8_t *pixels = new uint8_t[width * height];
+        noise::fillCoherent(pixels, width, height, width, basis, scale->value(), unsigned(octaves->value()), uint32_t(seed->value()));
+        
+        return GrayImageWithPixels(pixels, width, height);
+    }
+    
+#if GFX_Graphics_Use_Raster
+    ///Shades black with a random alpha, generating the pixel of the noise that each
+    ///device pixel falls on, so the noise is composited without an image of it.
+    class WhiteNoiseShader : public raster::Canvas::Shader
+    {
+        ///The transform from device space to the pixels of the noise.
+        Transform2D mDeviceToNoise;
+        
+        ///The size of the noise in pixels.
+        size_t mWidth, mHeight;
+        
+        ///The largest alpha of the noise.
+        uint8_t mMaximum;
+        
+        ///The seed of the noise.
+        uint32_t mSeed;
+        
+    public:
+        
+        WhiteNoiseShader(const Transform2D &deviceToNoise, size_t width, size_t height, uint8_t maximum, uint32_t seed) :
+            mDeviceToNoise(deviceToNoise),
+            mWidth(width),
+            mHeight(height),
+            mMaximum(maximum),
+            mSeed(seed)
+        {
+        }
+        
+        void shadeRow(long x, long y, long count, uint32_t *outPixels) const override
+        {
+            const Transform2D &t = mDeviceToNoise;
+            Float u = t.a * (x + 0.5) + t.c * (y + 0.5) + t.tx;
+            Float v = t.b * (x + 0.5) + t.d * (y + 0.5) + t.ty;
+            
+            //Pixel n of the noise is number n of its sequence, as with `noise::fillWhite`,
+            //so a run of neighboring pixels only needs one generator.
+            noise::Random random(mSeed);
+            uint32_t nextCounter = 0;
+            for (long index = 0; index < count; index++, u += t.a, v += t.b) {
+                size_t column = size_t(std::min(std::max(std::floor(u), Float(0.0)), Float(mWidth - 1)));
+                size_t row = size_t(std::min(std::max(std::floor(v), Float(0.0)), Float(mHeight - 1)));
+                uint32_t counter = uint32_t(row * mWidth + column);
+                if(index == 0 || counter != nextCounter)
+                    random = noise::Random(mSeed, counter);
+                
+                outPixels[index] = raster::pixel(0, 0, 0, random.nextInRange(mMaximum));
+                nextCounter = counter + 1;
+            }
+        }
+    };
+#endif /* GFX_Graphics_Use_Raster */
+    
+    ///Paints black noise with a random alpha of at most `maximum` into a rect of the current context.
+    static void DrawWhiteNoise(Rect rect, uint8_t maximum, uint32_t seed)
+    {
+        size_t width = rect.getWidth(), height = rect.getHeight();
+        
+#if GFX_Graphics_Use_Raster
+        //The noise is shaded straight into the clipped rows of the canvas, on
+        //its worker threads when it is deferred, rather than being generated
+        //into a surface that is then drawn.
+        raster::Canvas *canvas = Context::currentContext()->get();
+        Transform2D noiseToDevice = Transform2D::makeScale(rect.size.width / width, rect.size.height / height)
+            .concat(Transform2D::makeTranslation(rect.origin.x, rect.origin.y))
+            .concat(canvas->transform());
+        canvas->fillRectWithShader(rect, std::make_shared<WhiteNoiseShader>(noiseToDevice.invert(), width, height, maximum, seed));
+#else
+        //The noise is black with a random alpha. With premultiplied
+        //alpha the color channels of black are zero, so only the alpha
+        //byte needs to be written, which is the first byte of each
+        //pixel in 32-bit little endian RGBA.
+        uint8_t *pixels = new uint8_t[width * height * 4]();
+        noise::fillWhite(pixels, width, height, width * 4, 4, 0, maximum, seed);
+        
+        cf::AutoRef<CGColorSpaceRef> colorSpace = CGColorSpaceCreateDeviceRGB();
+        cf::AutoRef<CGImageRef> image = CreateImageWithPixels(pixels, width, height, width * 4, 32, colorSpace, kCGBitmapByteOrder32Little | kCGImageAlphaPremultipliedLast);
+        CGContextDrawImage(Context::currentContext()->get(), rect, image);
+#endif /* GFX_Graphics_Use_Raster */
+    }
+    
+    static void noise_draw(StackFrame *frame)
     {
         /* num vec -- */
         auto rect = VectorToRect(frame->popType<Array<Base>>());
         auto factor = frame->popNumber();
         
         size_t width = rect.getWidth(), height = rect.getHeight();
-        size_t numberOfBits = width * height;
+        double intensity = std::min(std::max(factor->value(), 0.0), 1.0);
+        uint8_t maximum = uint8_t(std::lround(intensity * 255.0));
+        if(width == 0 || height == 0 || maximum == 0)
+            return;
         
-        uint32_t *bitmapData = new uint32_t[numberOfBits]();
+        //The seed is chosen up front so a recorded display list
+        //replays the same grain every time.
+#if GFX_Graphics_Use_Raster
+        uint32_t seed = std::random_device()();
+#else
+        uint32_t seed = arc4random();
+#endif /* GFX_Graphics_Use_Raster */
         
-        Index max = factor->value() * 255.0;
-        for (Index i = 0; i < numberOfBits; i++) {
-            uint8_t *pixel = (uint8_t *)&bitmapData[i];
+        if(Context::currentContext()->recordOperation([rect, maximum, seed](Context *context) { DrawWhiteNoise(rect, maximum, seed); }))
+            return;
             
-            Byte intensity = arc4random() % max;
-            pixel[0] = intensity;
-        }
+        DrawWhiteNoise(rect, maximum, seed);
+    }
         
-        //This is (obviously) not portable at all.
-        cf::AutoRef<CGColorSpaceRef> colorSpace{ CGColorSpaceCreateDeviceRGB() };
-        cf::AutoRef<CGContextRef> context{ CGBitmapContextCreate(bitmapData, width, height, 8, width * sizeof(uint32_t), colorSpace, kCGBitmapByteOrder32Little | kCGImageAlphaPremultipliedLast) };
-        cf::AutoRef<CGImageRef> image{ CGBitmapContextCreateImage(context) };
-        CGContextDrawImage(Context::currentContext()->get(), rect, image);
+    static void noise_white(StackFrame *frame)
+    {
+        /* vec num -- image */
+        auto seed = frame->popNumber();
+        auto size = VectorToSize(frame->popType<Array<Base>>());
+        
+        size_t width = std::max(size.width, 1.0), height = std::max(size.height, 1.0);
+        uint8_t *pixels = new uint8_t[width * height];
+        noise::fillWhite(pixels, width, height, width, 1, 0, 255, uint32_t(seed->value()));
         
-        delete[] bitmapData;
+        frame->push(GrayImageWithPixels(pixels, width, height));
+    }
+    
+    static void noise_value(StackFrame *frame)
+    {
+        /* vec num num num -- image */
+        auto seed = frame->popNumber();
+        auto octaves = frame->popNumber();
+        auto scale = frame->popNumber();
+        auto size = VectorToSize(frame->popType<Array<Base>>());
+        frame->push(CoherentNoiseImage(noise::Basis::Value, size, scale, octaves, seed));
+    }
+    
+    static void noise_perlin(StackFrame *frame)
+    {
+        /* vec num num num -- image */
+        auto seed = frame->popNumber();
+        auto octaves = frame->popNumber();
+        auto scale = frame->popNumber();
+        auto size = VectorToSize(frame->popType<Array<Base>>());
+        frame->push(CoherentNoiseImage(noise::Basis::Perlin, size, scale, octaves, seed));
+    }
+    
+    static void noise_simplex(StackFrame *frame)
+    {
+        /* vec num num num -- image */
+        auto seed = frame->popNumber();
+        auto octaves = frame->popNumber();
+        auto scale = frame->popNumber();
+        auto size = VectorToSize(frame->popType<Array<Base>>());
+        frame->push(CoherentNoiseImage(noise::Basis::Simplex, size, scale, octaves, seed));
+    }
+    
+    static void noise_sample(StackFrame *frame)
+    {
+        /* vec num num -- num */
+        auto seed = frame->popNumber();
+        auto octaves = frame->popNumber();
+        auto point = VectorToPoint(frame->popType<Array<Base>>());
+        frame->push(make<Number>(noise::fractal(noise::Basis::Perlin, point.x, point.y, unsigned(std::max(octaves->value(), 1.0)), uint32_t(seed->value()))));
     }
     
 #pragma mark - Public Interface
@@ -160,10 +343,15 @@ namespace gfx {
         
         Shadow::addTo(frame);
         Gradient::addTo(frame);
+        SpatialIndex::addTo(frame);
         
-        
-        //Misc Functions
-        frame->createFunctionBinding(str("noise"), &noise);
+        //Noise Functions
+        frame->createFunctionBinding(gfx_str("noise"), &noise_draw);
+        frame->createFunctionBinding(gfx_str("noise/white"), &noise_white);
+        frame->createFunctionBinding(gfx_str("noise/value"), &noise_value);
+        frame->createFunctionBinding(gfx_str("noise/perlin"), &noise_perlin);
+        frame->createFunctionBinding(gfx_str("noise/simplex"), &noise_simplex);
+        frame->createFunctionBinding(gfx_str("noise/sample"), &noise_sample);
     }
     
 #pragma mark -
@@ -172,11 +360,16 @@ namespace gfx {
     {
         Graphics::addTo(interpreter->rootFrame());
         
+        //Color literals are resolved the first time they are evaluated, and
+        //the color is kept on the word so later evaluations just push it.
         interpreter->prependWordHandler([interpreter](StackFrame *currentFrame, Word *word) {
-            if(word->string()->hasPrefix(str("#"))) {
-                auto color = make<Color>(word->string());
+            if(Base *color = word->resolvedValue()) {
                 currentFrame->push(color);
                 return true;
+            } else if(word->string()->hasPrefix(gfx_str("#"))) {
+                auto color = Color::withHTMLString(word->string());
+                currentFrame->push(word->setResolvedValue(color));
+                return true;
             } else {
                 return false;
             }
@@ -185,15 +378,17 @@ namespace gfx {
         auto typeMap = interpreter->typeResolutionMap();
         auto baseType = Type::BaseType();
         
-        typeMap->registerType(typeid(Color), make<Type>(baseType, str("<color>")));
-        typeMap->registerType(typeid(Context), make<Type>(baseType, str("<context>")));
-        typeMap->registerType(typeid(Layer), make<Type>(baseType, str("<layer>")));
-        typeMap->registerType(typeid(Path), make<Type>(baseType, str("<path>")));
-        typeMap->registerType(typeid(Image), make<Type>(baseType, str("<image>")));
-        typeMap->registerType(typeid(Font), make<Type>(baseType, str("<font>")));
-        typeMap->registerType(typeid(AttributedString), make<Type>(baseType, str("<text>")));
-        typeMap->registerType(typeid(Shadow), make<Type>(baseType, str("<shadow>")));
-        typeMap->registerType(typeid(Gradient), make<Type>(baseType, str("<gradient>")));
+        typeMap->registerType(typeid(Color), make<Type>(baseType, gfx_str("<color>")));
+        typeMap->registerType(typeid(Context), make<Type>(baseType, gfx_str("<context>")));
+        typeMap->registerType(typeid(Layer), make<Type>(baseType, gfx_str("<layer>")));
+        typeMap->registerType(typeid(Path), make<Type>(baseType, gfx_str("<path>")));
+        typeMap->registerType(typeid(Image), make<Type>(baseType, gfx_str("<image>")));
+        typeMap->registerType(typeid(Font), make<Type>(baseType, gfx_str("<font>")));
+        typeMap->registerType(typeid(AttributedString), make<Type>(baseType, gfx_str("<text>")));
+        typeMap->registerType(typeid(Shadow), make<Type>(baseType, gfx_str("<shadow>")));
+        typeMap->registerType(typeid(Gradient), make<Type>(baseType, gfx_str("<gradient>")));
+        typeMap->registerType(typeid(DisplayList), make<Type>(baseType, gfx_str("<display-list>")));
+        typeMap->registerType(typeid(SpatialIndex), make<Type>(baseType, gfx_str("<index>")));
     }
 }
 
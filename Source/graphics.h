@@ -13,7 +13,10 @@
 
 #include "base.h"
 #include "array.h"
-#include <CoreGraphics/CoreGraphics.h>
+
+#if !GFX_Graphics_Use_Raster
+#   include <CoreGraphics/CoreGraphics.h>
+#endif /* !GFX_Graphics_Use_Raster */
 
 namespace gfx {
     class StackFrame;
@@ -11,97 +11,551 @@
 #include "blob.h"
 #include "exception.h"
 #include "file.h"
+#include "filepaths.h"
 
-#include <ImageIO/ImageIO.h>
+#if !GFX_Graphics_Use_Raster
+#   include <ImageIO/ImageIO.h>
+#endif /* !GFX_Graphics_Use_Raster */
+
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <sys/stat.h>
 
 #include "graphics.h"
 #include "stackframe.h"
+#include "lrucache.h"
 
 namespace gfx {
     
+#pragma mark - Native Images
+    
+    ///Retains a native image, returning it.
+    static Image::NativeType RetainNativeImage(Image::NativeType image)
+    {
+#if GFX_Graphics_Use_Raster
+        return image->retain();
+#else
+        return CGImageRetain(image);
+#endif /* GFX_Graphics_Use_Raster */
+    }
+    
+    ///Releases a native image.
+    static void ReleaseNativeImage(Image::NativeType image)
+    {
+#if GFX_Graphics_Use_Raster
+        image->release();
+#else
+        CGImageRelease(image);
+#endif /* GFX_Graphics_Use_Raster */
+    }
+    
+    ///Returns the number of bytes of memory used by the pixels of a native image.
+    static size_t NativeImageCost(Image::NativeType image)
+    {
+#if GFX_Graphics_Use_Raster
+        return image->width() * image->height() * sizeof(uint32_t);
+#else
+        return CGImageGetBytesPerRow(image) * CGImageGetHeight(image);
+#endif /* GFX_Graphics_Use_Raster */
+    }
+    
+#pragma mark - Decode Cache
+    
+    ///Identifies an image decoded at a level from the contents of a file.
+    struct DecodedImageKey
+    {
+        ///The file the image was decoded from.
+        Image::Source source;
+        
+        ///The level the image was decoded at.
+        unsigned level;
+        
+        bool operator==(const DecodedImageKey &other) const
+        {
+            return (level == other.level && source == other.source);
+        }
+    };
+    
+    ///Hashes the identity of a decoded image.
+    struct DecodedImageKeyHash
+    {
+        size_t operator()(const DecodedImageKey &key) const
+        {
+            size_t hash = std::hash<uint64_t>()(key.source.inode);
+            hash = hash * 31 + std::hash<uint64_t>()(key.source.device);
+            hash = hash * 31 + std::hash<int64_t>()(key.source.modificationTime);
+            hash = hash * 31 + std::hash<uint64_t>()(key.source.length);
+            return hash * 31 + key.level;
+        }
+    };
+    
+    ///Holds a reference to a native image, so that native images can be kept in an `LRUCache`.
+    class NativeImageRef
+    {
+        Image::NativeType mImage;
+        
+    public:
+        
+        NativeImageRef(Image::NativeType image = nullptr) :
+            mImage(image? RetainNativeImage(image) : nullptr)
+        {
+        }
+        
+        NativeImageRef(const NativeImageRef &other) :
+            NativeImageRef(other.mImage)
+        {
+        }
+        
+        ~NativeImageRef()
+        {
+            if(mImage)
+                ReleaseNativeImage(mImage);
+        }
+        
+        NativeImageRef &operator=(const NativeImageRef &other)
+        {
+            if(other.mImage)
+                RetainNativeImage(other.mImage);
+            if(mImage)
+                ReleaseNativeImage(mImage);
+            
+            mImage = other.mImage;
+            return *this;
+        }
+        
+        ///Returns the native image, which the receiver keeps a reference to.
+        Image::NativeType get() const { return mImage; }
+    };
+    
+    ///The DecodedImageCache class keeps the most recently used decoded images so that
+    ///images loaded from the same file, or drawn repeatedly, are decoded once.
+    ///
+    ///The cache keeps at most `budget()` bytes of pixels, evicting the least recently
+    ///used images first. Images larger than the budget are never kept.
+    class DecodedImageCache
+    {
+        ///The cached images by their identities, costing the bytes of their pixels.
+        LRUCache<DecodedImageKey, NativeImageRef, DecodedImageKeyHash> mImages;
+        
+    public:
+        
+        DecodedImageCache() :
+            mImages(std::numeric_limits<size_t>::max(), Image::kDefaultDecodeCacheBudget)
+        {
+        }
+        
+        ///Returns the shared decode cache.
+        static DecodedImageCache *shared()
+        {
+            static DecodedImageCache *sharedCache = new DecodedImageCache();
+            return sharedCache;
+        }
+        
+        ///Returns the image for a given key, marking it as the most recently used.
+        ///
+        /// \result A native image the caller must release, or null if the image is not in the cache.
+        Image::NativeType copyImage(const DecodedImageKey &key)
+        {
+            NativeImageRef image;
+            if(!mImages.find(key, image))
+                return nullptr;
+            
+            return RetainNativeImage(image.get());
+        }
+        
+        ///Adds an image to the cache for a given key, if it fits within the budget.
+        void addImage(const DecodedImageKey &key, Image::NativeType image)
+        {
+            mImages.insert(key, NativeImageRef(image), NativeImageCost(image));
+        }
+        
+#pragma mark -
+        
+        ///Sets the maximum number of bytes of pixels to keep, evicting as needed.
+        void setBudget(size_t budget)
+        {
+            mImages.setMaximumCost(budget);
+        }
+        
+        ///Returns the maximum number of bytes of pixels to keep.
+        size_t budget()
+        {
+            return mImages.maximumCost();
+        }
+    };
+    
+    void Image::setDecodeCacheBudget(size_t budget)
+    {
+        DecodedImageCache::shared()->setBudget(budget);
+    }
+    
+    size_t Image::decodeCacheBudget()
+    {
+        return DecodedImageCache::shared()->budget();
+    }
+    
 #pragma mark - Lifecycle
     
+    ///Looks up the identity of the contents of a file.
+    ///
+    /// \result true if the file is a regular file whose identity could be found; false otherwise.
+    static bool GetFileSource(File *file, Image::Source &outSource)
+    {
+        struct stat info = {};
+        if(fstat(fileno(file->get()), &info) != 0 || !S_ISREG(info.st_mode))
+            return false;
+        
+#if defined(__APPLE__)
+        const struct timespec &modificationTime = info.st_mtimespec;
+#else
+        const struct timespec &modificationTime = info.st_mtim;
+#endif /* defined(__APPLE__) */
+        
+        outSource.device = uint64_t(info.st_dev);
+        outSource.inode = uint64_t(info.st_ino);
+        outSource.modificationTime = int64_t(modificationTime.tv_sec) * 1000000000 + modificationTime.tv_nsec;
+        outSource.length = uint64_t(info.st_size);
+        return true;
+    }
+    
     Image *Image::withFile(File *file)
     {
         gfx_assert_param(file);
         
+        Source source = {};
+        bool isCacheable = GetFileSource(file, source);
+        
         Blob *fileContents = file->read(file->length());
-        cf::AutoRef<CGDataProviderRef> dataProvider = CGDataProviderCreateWithCFData(fileContents->getStorage());
-        gfx_assert(*dataProvider, str("Could not create image data provider."));
+#if GFX_Graphics_Use_Raster
+        size_t width = 0, height = 0;
+        if(!raster::readPNGSize(fileContents->bytes(), fileContents->length(), width, height))
+            return nullptr;
         
-        cf::AutoRef<CGImageSourceRef> source = CGImageSourceCreateWithDataProvider(dataProvider, NULL);
-        gfx_assert(*source, str("Could not create image source."));
+        Size size = { Float(width), Float(height) };
+#else
+        cf::AutoRef<CGImageSourceRef> imageSource = CGImageSourceCreateWithData(fileContents->getStorage(), NULL);
+        gfx_assert(*imageSource, str("Could not create image source."));
         
-        if(CGImageSourceGetCount(source) > 0) {
-            CGImageRef image = CGImageSourceCreateImageAtIndex(source, 0, NULL);
-            return make<Image>(image, true);
-        } else {
+        if(CGImageSourceGetCount(imageSource) == 0)
             return nullptr;
-        }
+        
+        cf::AutoRef<CFDictionaryRef> properties = CGImageSourceCopyPropertiesAtIndex(imageSource, 0, NULL);
+        if(!properties)
+            return nullptr;
+        
+        CFNumberRef widthNumber = (CFNumberRef)CFDictionaryGetValue(properties, kCGImagePropertyPixelWidth);
+        CFNumberRef heightNumber = (CFNumberRef)CFDictionaryGetValue(properties, kCGImagePropertyPixelHeight);
+        long width = 0, height = 0;
+        if(!widthNumber || !heightNumber ||
+           !CFNumberGetValue(widthNumber, kCFNumberLongType, &width) ||
+           !CFNumberGetValue(heightNumber, kCFNumberLongType, &height))
+            return nullptr;
+        
+        Size size = { Float(width), Float(height) };
+#endif /* GFX_Graphics_Use_Raster */
+        
+        Image *image = make<Image>(fileContents, source, isCacheable, size);
+        
+        //Files that can't be cached are decoded once and kept, so decoding
+        //them now costs nothing extra, and reports corrupt files to callers.
+        if(!isCacheable && !image->get())
+            return nullptr;
+        
+        return image;
     }
     
 #pragma mark -
     
     Image::Image(NativeType image, bool ownsImage) :
         Base(),
+        mDecodeMutex(),
         mImage(image),
-        mOwnsImage(ownsImage)
+        mOwnsImage(ownsImage),
+        mData(nullptr),
+        mSource(),
+        mIsCacheable(false),
+#if GFX_Graphics_Use_Raster
+        mSize{ Float(image->width()), Float(image->height()) }
+#else
+        mSize{ Float(CGImageGetWidth(image)), Float(CGImageGetHeight(image)) }
+#endif /* GFX_Graphics_Use_Raster */
+    {
+    }
+    
+    Image::Image(Blob *data, Source source, bool isCacheable, Size size) :
+        Base(),
+        mDecodeMutex(),
+        mImage(nullptr),
+        mOwnsImage(false),
+        mData(retained(data)),
+        mSource(source),
+        mIsCacheable(isCacheable),
+        mSize(size)
     {
     }
     
     Image::Image(const Image *image) :
-        Image(CGImageRetain(image->get()), true)
+        Base(),
+        mDecodeMutex(),
+        mImage(nullptr),
+        mOwnsImage(false),
+        mData(retained(image->mData)),
+        mSource(image->mSource),
+        mIsCacheable(image->mIsCacheable),
+        mSize(image->mSize)
     {
+        std::lock_guard<std::mutex> lock(image->mDecodeMutex);
+        if(image->mImage) {
+            mImage = RetainNativeImage(image->mImage);
+            mOwnsImage = true;
+        }
     }
     
     Image::~Image()
     {
         if(mOwnsImage) {
-            CFRelease(mImage);
+            ReleaseNativeImage(mImage);
             mImage = NULL;
         }
+        
+        released(mData);
+    }
+    
+#pragma mark - Decoding
+    
+    ///The number of levels an image may be decoded at below its full size.
+    static const unsigned kMaximumLevel = 8;
+    
+    Image::NativeType Image::copyDecodedImage(unsigned level) const
+    {
+        if(!mData)
+            return RetainNativeImage(mImage);
+        
+        if(level > 0)
+            return decodeImage(level);
+        
+        std::lock_guard<std::mutex> lock(mDecodeMutex);
+        if(mImage)
+            return RetainNativeImage(mImage);
+        
+        NativeType image = decodeImage(0);
+        if(image && !mIsCacheable) {
+            //Images that can't be shared through the cache, such as those read
+            //from pipes, keep their full size decode so they are decoded once.
+            mImage = RetainNativeImage(image);
+            mOwnsImage = true;
+        }
+        
+        return image;
+    }
+    
+    Image::NativeType Image::decodeImage(unsigned level) const
+    {
+        DecodedImageKey key{ mSource, level };
+        if(mIsCacheable) {
+            if(NativeType image = DecodedImageCache::shared()->copyImage(key))
+                return image;
+        }
+        
+#if GFX_Graphics_Use_Raster
+        NativeType image = nullptr;
+        if(level == 0) {
+            image = raster::decodePNG(mData->bytes(), mData->length());
+        } else {
+            //Each level is filtered down from the level above it, so drawing
+            //at several reduced sizes only decodes the full image once.
+            if(NativeType largerImage = copyDecodedImage(level - 1)) {
+                image = largerImage->makeHalfSize();
+                ReleaseNativeImage(largerImage);
+            }
+        }
+#else
+        cf::AutoRef<CGImageSourceRef> imageSource = CGImageSourceCreateWithData(mData->getStorage(), NULL);
+        if(!imageSource)
+            return nullptr;
+        
+        NativeType image = nullptr;
+        if(level == 0) {
+            image = CGImageSourceCreateImageAtIndex(imageSource, 0, NULL);
+        } else {
+            //Decoding a thumbnail lets formats such as JPEG skip most of the work
+            //of decoding pixels that would only be filtered away when drawn.
+            long maximumPixelSize = long(std::ceil(std::max(mSize.width, mSize.height) / Float(1UL << level)));
+            cf::AutoRef<CFNumberRef> maximumPixelSizeNumber = CFNumberCreate(kCFAllocatorDefault, kCFNumberLongType, &maximumPixelSize);
+            const void *keys[] = { kCGImageSourceCreateThumbnailFromImageAlways, kCGImageSourceThumbnailMaxPixelSize };
+            const void *values[] = { kCFBooleanTrue, maximumPixelSizeNumber };
+            cf::AutoRef<CFDictionaryRef> options = CFDictionaryCreate(kCFAllocatorDefault, keys, values, 2,
+                                                                      &kCFTypeDictionaryKeyCallBacks,
+                                                                      &kCFTypeDictionaryValueCallBacks);
+            image = CGImageSourceCreateThumbnailAtIndex(imageSource, 0, options);
+        }
+#endif /* GFX_Graphics_Use_Raster */
+        
+        if(image && mIsCacheable)
+            DecodedImageCache::shared()->addImage(key, image);
+        
+        return image;
+    }
+    
+    Image::NativeType Image::copyImageForDrawing(Size deviceSize) const
+    {
+        unsigned level = 0;
+        if(mData) {
+            while (level < kMaximumLevel &&
+                   mSize.width / Float(2UL << level) >= std::max<Float>(deviceSize.width, 1.0) &&
+                   mSize.height / Float(2UL << level) >= std::max<Float>(deviceSize.height, 1.0))
+                level++;
+        }
+        
+        return copyDecodedImage(level);
     }
     
 #pragma mark - Introspection
     
     Image::NativeType Image::get() const
     {
+        if(!mData)
+            return mImage;
+        
+        std::lock_guard<std::mutex> lock(mDecodeMutex);
+        if(!mImage) {
+            mImage = decodeImage(0);
+            mOwnsImage = (mImage != nullptr);
+        }
+        
         return mImage;
     }
     
     Size Image::size() const
     {
-        return Size{ (Float)CGImageGetWidth(get()), (Float)CGImageGetHeight(get()) };
+        return mSize;
     }
     
 #pragma mark - Drawing
     
+    ///Returns the size in device pixels that a rectangle in user space covers in a context.
+    static Size DeviceSizeOfRect(Context *context, Rect rect)
+    {
+        Transform2D transform = context->currentTransformationMatrix();
+        Float scaleX = std::sqrt(transform.a * transform.a + transform.b * transform.b);
+        Float scaleY = std::sqrt(transform.c * transform.c + transform.d * transform.d);
+        return Size{ std::abs(rect.size.width) * scaleX, std::abs(rect.size.height) * scaleY };
+    }
+    
     void Image::drawInRect(Rect rect)
     {
-        Context::currentContext()->transaction([this, rect](Context *context) {
-            Rect scaledRect = rect;
-            scaledRect.origin.x *= context->scale();
-            scaledRect.origin.y *= context->scale();
-            scaledRect.size.width *= context->scale();
-            scaledRect.size.height *= context->scale();
-            CGContextDrawImage(context->get(), scaledRect, this->get());
+        Scoped<Image> image = this;
+        if(Context::currentContext()->recordOperation([image, rect](Context *context) { image->drawInRect(rect); }))
+            return;
+        
+        Context *currentContext = Context::currentContext();
+        Rect scaledRect = rect;
+        scaledRect.origin.x *= currentContext->scale();
+        scaledRect.origin.y *= currentContext->scale();
+        scaledRect.size.width *= currentContext->scale();
+        scaledRect.size.height *= currentContext->scale();
+        if(currentContext->quickReject(scaledRect))
+            return;
+        
+        NativeType nativeImage = copyImageForDrawing(DeviceSizeOfRect(currentContext, scaledRect));
+        if(!nativeImage)
+            return;
+        
+        currentContext->transaction([nativeImage, scaledRect](Context *context) {
+#if GFX_Graphics_Use_Raster
+            context->get()->drawImage(nativeImage, scaledRect);
+#else
+            CGContextDrawImage(context->get(), scaledRect, nativeImage);
+#endif /* GFX_Graphics_Use_Raster */
         });
+        
+        ReleaseNativeImage(nativeImage);
     }
     
     void Image::tileInRect(Rect rect)
     {
+        Scoped<Image> image = this;
+        if(Context::currentContext()->recordOperation([image, rect](Context *context) { image->tileInRect(rect); }))
+            return;
+        
         Context::currentContext()->transaction([this, rect](Context *context) {
             Rect scaledRect = rect;
             scaledRect.origin.x *= context->scale();
             scaledRect.origin.y *= context->scale();
             scaledRect.size.width *= context->scale();
             scaledRect.size.height *= context->scale();
-            CGContextDrawTiledImage(context->get(), scaledRect, this->get());
+            
+            NativeType nativeImage = copyImageForDrawing(DeviceSizeOfRect(context, scaledRect));
+            if(!nativeImage)
+                return;
+            
+#if GFX_Graphics_Use_Raster
+            context->get()->drawTiledImage(nativeImage, scaledRect);
+#else
+            CGContextDrawTiledImage(context->get(), scaledRect, nativeImage);
+#endif /* GFX_Graphics_Use_Raster */
+            
+            ReleaseNativeImage(nativeImage);
         });
     }
     
 #pragma mark - Converting to Data
     
+    const Image::EncodingOptions Image::DefaultEncodingOptions = { -1, Image::PNGFilter::Adaptive };
+    
+#if GFX_Graphics_Use_Raster
+    static raster::PNGFilter PNGFilterToRasterPNGFilter(Image::PNGFilter filter)
+    {
+        switch (filter) {
+            case Image::PNGFilter::Adaptive:
+                return raster::PNGFilter::Adaptive;
+                
+            case Image::PNGFilter::None:
+                return raster::PNGFilter::None;
+                
+            case Image::PNGFilter::Sub:
+                return raster::PNGFilter::Sub;
+                
+            case Image::PNGFilter::Up:
+                return raster::PNGFilter::Up;
+                
+            case Image::PNGFilter::Average:
+                return raster::PNGFilter::Average;
+                
+            case Image::PNGFilter::Paeth:
+                return raster::PNGFilter::Paeth;
+        }
+    }
+    
+    ///Encodes a surface with a given representation type, handing the bytes to a function as they are produced.
+    ///
+    /// \throws Exception if the representation type is unavailable.
+    static bool EncodeSurface(const raster::Surface *surface,
+                              Image::RepresentationType type,
+                              const Image::EncodingOptions &options,
+                              const raster::EncodedBytesFunctor &write)
+    {
+        switch (type) {
+            case Image::RepresentationType::PNG:
+                return raster::encodePNG(surface, raster::PNGEncodingOptions{ options.compressionLevel, PNGFilterToRasterPNGFilter(options.filter) }, write);
+                
+            case Image::RepresentationType::JPEG:
+                throw Exception(str("JPEG representations are unavailable with the software rasterizer"), nullptr);
+                
+            case Image::RepresentationType::RGBA:
+                return raster::encodeRGBA(surface, write);
+                
+            case Image::RepresentationType::PPM:
+                return raster::encodePPM(surface, write);
+                
+            case Image::RepresentationType::QOI:
+                return raster::encodeQOI(surface, write);
+        }
+        
+        return false;
+    }
+#else
     static CFStringRef RepresentationTypeToUTType(Image::RepresentationType type)
     {
         switch (type) {
@@ -110,11 +564,43 @@ namespace gfx {
                 
             case Image::RepresentationType::JPEG:
                 return CFSTR("public.jpeg");
+                
+            case Image::RepresentationType::RGBA:
+            case Image::RepresentationType::PPM:
+            case Image::RepresentationType::QOI:
+                throw Exception(str("RGBA, PPM, and QOI representations are only available with the software rasterizer"), nullptr);
         }
     }
     
+    static size_t WriteToFile(void *info, const void *buffer, size_t count)
+    {
+        return static_cast<File *>(info)->write(static_cast<const UInt8 *>(buffer), count);
+    }
+#endif /* GFX_Graphics_Use_Raster */
+    
     Blob *Image::makeRepresentation(RepresentationType type) const
     {
+        return makeRepresentation(type, DefaultEncodingOptions);
+    }
+    
+    Blob *Image::makeRepresentation(RepresentationType type, const EncodingOptions &options) const
+    {
+        if(!get())
+            throw Exception(str("Could not decode image"), nullptr);
+        
+#if GFX_Graphics_Use_Raster
+        std::vector<uint8_t> data;
+        bool succeeded = EncodeSurface(get(), type, options, [&data](const uint8_t *bytes, size_t length) {
+            data.insert(data.end(), bytes, bytes + length);
+            return true;
+        });
+        
+        if(!succeeded) {
+            throw Exception(str("Could not create image blob representation"), nullptr);
+        }
+        
+        return make<Blob>(data.data(), Index(data.size()));
+#else
         cf::AutoRef<CFMutableDataRef> data = CFDataCreateMutable(kCFAllocatorDefault, 0);
         cf::AutoRef<CGImageDestinationRef> destination = CGImageDestinationCreateWithData(data, RepresentationTypeToUTType(type), 1, NULL);
         CGImageDestinationAddImage(destination, get(), NULL);
@@ -124,6 +610,60 @@ namespace gfx {
         }
         
         return make<Blob>(CFDataRef(data));
+#endif /* GFX_Graphics_Use_Raster */
+    }
+    
+    void Image::writeRepresentation(RepresentationType type, File *file, const EncodingOptions &options) const
+    {
+        gfx_assert_param(file);
+        
+        if(!get())
+            throw Exception(str("Could not decode image"), nullptr);
+        
+#if GFX_Graphics_Use_Raster
+        bool succeeded = EncodeSurface(get(), type, options, [file](const uint8_t *bytes, size_t length) {
+            return (file->write(bytes, length) == length);
+        });
+        
+        if(!succeeded) {
+            throw Exception(str("Could not write image representation"), nullptr);
+        }
+#else
+        CGDataConsumerCallbacks callbacks = { &WriteToFile, NULL };
+        cf::AutoRef<CGDataConsumerRef> consumer = CGDataConsumerCreate(file, &callbacks);
+        cf::AutoRef<CGImageDestinationRef> destination = CGImageDestinationCreateWithDataConsumer(consumer, RepresentationTypeToUTType(type), 1, NULL);
+        CGImageDestinationAddImage(destination, get(), NULL);
+        
+        if(!CGImageDestinationFinalize(destination)) {
+            throw Exception(str("Could not write image representation"), nullptr);
+        }
+#endif /* GFX_Graphics_Use_Raster */
+    }
+    
+    Image::RepresentationType Image::representationTypeForPath(const String *path)
+    {
+        gfx_assert_param(path);
+        
+        const String *pathExtension = FilePaths::pathExtension(path)->lowercasedString();
+        if(pathExtension->isEqual(gfx_str("jpg")) || pathExtension->isEqual(gfx_str("jpeg")))
+            return RepresentationType::JPEG;
+        else if(pathExtension->isEqual(gfx_str("rgba")) || pathExtension->isEqual(gfx_str("raw")))
+            return RepresentationType::RGBA;
+        else if(pathExtension->isEqual(gfx_str("ppm")))
+            return RepresentationType::PPM;
+        else if(pathExtension->isEqual(gfx_str("qoi")))
+            return RepresentationType::QOI;
+        else
+            return RepresentationType::PNG;
+    }
+    
+    bool Image::isRepresentationTypeAvailable(RepresentationType type)
+    {
+#if GFX_Graphics_Use_Raster
+        return (type != RepresentationType::JPEG);
+#else
+        return (type == RepresentationType::PNG || type == RepresentationType::JPEG);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark - Functions
@@ -160,19 +700,18 @@ namespace gfx {
         auto file = stack->popType<File>();
         auto image = stack->popType<Image>();
         
-        auto imageBlob = image->makeRepresentation(Image::RepresentationType::PNG);
-        file->write(imageBlob);
+        image->writeRepresentation(Image::RepresentationType::PNG, file);
     }
     
 #pragma mark -
     
     void Image::addTo(StackFrame *frame)
     {
-        frame->createFunctionBinding(str("image/from-file"), &image_fromFile);
+        frame->createFunctionBinding(gfx_str("image/from-file"), &image_fromFile);
         
-        frame->createFunctionBinding(str("image/size"), &image_size);
-        frame->createFunctionBinding(str("image/draw-in"), &image_drawIn);
+        frame->createFunctionBinding(gfx_str("image/size"), &image_size);
+        frame->createFunctionBinding(gfx_str("image/draw-in"), &image_drawIn);
         
-        frame->createFunctionBinding(str("image/save-to"), &image_saveTo);
+        frame->createFunctionBinding(gfx_str("image/save-to"), &image_saveTo);
     }
 }
@@ -11,6 +11,11 @@
 
 #include "base.h"
 #include "types.h"
+#include <mutex>
+
+#if GFX_Graphics_Use_Raster
+#   include "raster.h"
+#endif /* GFX_Graphics_Use_Raster */
 
 namespace gfx {
     class Blob;
@@ -19,12 +24,22 @@ namespace gfx {
     class StackFrame;
     
     ///The Image class encapsulates the loading and drawing of images in the Gfx graphics stack.
+    ///
+    ///Images created from files are decoded when they are first drawn rather than when they
+    ///are created. Decoded images are kept in a shared cache keyed by the identity and
+    ///modification time of their file, so loading the same file again reuses the pixels
+    ///decoded the last time. An image drawn at half its size or less is decoded at a
+    ///reduced size, and the reduced sizes are cached alongside the full size.
     class Image final : public Base
     {
     public:
         
         ///The underlying native type used by the Image class.
+#if GFX_Graphics_Use_Raster
+        typedef raster::Surface *NativeType;
+#else
         typedef CGImageRef NativeType;
+#endif /* GFX_Graphics_Use_Raster */
         
         ///The different representations that may be extracted from an Image.
         enum class RepresentationType
@@ -32,18 +47,126 @@ namespace gfx {
             ///A PNG data blob.
             PNG,
             
-            ///A JPEG data blob.
+            ///A JPEG data blob. Unavailable with the software rasterizer.
             JPEG,
+            
+            ///Unpremultiplied 8-bit RGBA pixels without a header, from the top row
+            ///to the bottom. Only available with the software rasterizer.
+            RGBA,
+            
+            ///A binary PPM, composited over black. Only available with the software rasterizer.
+            PPM,
+            
+            ///A Quite OK Image. Only available with the software rasterizer.
+            QOI,
+        };
+        
+        ///The filters that may be applied to the scanlines of PNG representations.
+        enum class PNGFilter
+        {
+            ///Each scanline uses the filter that compresses best.
+            Adaptive,
+            
+            ///Scanlines are not filtered.
+            None,
+            
+            ///Each scanline uses the sub filter.
+            Sub,
+            
+            ///Each scanline uses the up filter.
+            Up,
+            
+            ///Each scanline uses the average filter.
+            Average,
+            
+            ///Each scanline uses the Paeth filter.
+            Paeth,
+        };
+        
+        ///The options used to create representations of an image.
+        ///
+        ///The options are only honored by the software rasterizer.
+        struct EncodingOptions
+        {
+            ///The compression level of PNG representations, from 0 for no compression
+            ///to 9 for the smallest output, or -1 for the default level.
+            int compressionLevel;
+            
+            ///The filter applied to the scanlines of PNG representations.
+            PNGFilter filter;
+        };
+        
+        ///The options used when none are given.
+        static const EncodingOptions DefaultEncodingOptions;
+        
+        ///Identifies the contents of a file that an image was created from.
+        struct Source
+        {
+            ///The device of the file.
+            uint64_t device;
+            
+            ///The inode of the file.
+            uint64_t inode;
+            
+            ///The modification time of the file, in nanoseconds since the epoch.
+            int64_t modificationTime;
+            
+            ///The length of the file.
+            uint64_t length;
+            
+            bool operator==(const Source &other) const
+            {
+                return (device == other.device && inode == other.inode &&
+                        modificationTime == other.modificationTime && length == other.length);
+            }
         };
         
     protected:
         
-        ///The underlying native type.
-        NativeType mImage;
+        ///Guards `mImage` and `mOwnsImage`, which are assigned when an image created
+        ///from a file is first decoded at its full size, and ensures that the full
+        ///size decode is only made once when an image is drawn on several threads.
+        mutable std::mutex mDecodeMutex;
+        
+        ///The underlying native type. Null until an image created
+        ///from a file is decoded at its full size.
+        mutable NativeType mImage;
         
         ///Whether or not underlying native type is owned
         ///by the instance and should be cleaned up.
-        bool mOwnsImage;
+        mutable bool mOwnsImage;
+        
+        ///The encoded contents of the file the image was created from, or null.
+        Blob *mData;
+        
+        ///The identity of the file the image was created from.
+        Source mSource;
+        
+        ///Whether or not decoded images may be shared through the decode cache.
+        bool mIsCacheable;
+        
+        ///The size of the image in pixels.
+        Size mSize;
+        
+        ///Returns the image decoded at a given level, where each level is half
+        ///the size of the one before it, and level 0 is the full size.
+        ///
+        /// \result A native image the caller must release, or null if the image could not be decoded.
+        ///
+        ///Decodes are shared through the decode cache. Images that are not cacheable
+        ///keep their full size decode in `mImage` instead.
+        NativeType copyDecodedImage(unsigned level) const;
+        
+        ///Decodes the image at a given level through the decode cache, without
+        ///consulting or assigning `mImage`.
+        ///
+        /// \result A native image the caller must release, or null if the image could not be decoded.
+        NativeType decodeImage(unsigned level) const;
+        
+        ///Returns the image decoded at the smallest level that is at least a given device size.
+        ///
+        /// \result A native image the caller must release, or null if the image could not be decoded.
+        NativeType copyImageForDrawing(Size deviceSize) const;
         
     public:
         
@@ -55,6 +178,10 @@ namespace gfx {
         ///
         /// \result A new autoreleased Image if the file could be loaded; null otherwise.
         ///
+        ///Only the header of a regular file is read when the image is created, so a file
+        ///that is corrupt past its header yields an image that draws nothing, and whose
+        ///`get()` is null. Files that can't be cached, such as pipes, are decoded right
+        ///away instead, and yield null if they are corrupt.
         static Image *withFile(File *file);
         
 #pragma mark -
@@ -66,6 +193,15 @@ namespace gfx {
         ///
         Image(NativeType image, bool ownsImage = true);
         
+        ///Constructs an image that is decoded from the contents of a file when it is first used.
+        ///
+        /// \param  data        The contents of the file. Required.
+        /// \param  source      The identity of the file.
+        /// \param  isCacheable Whether or not the identity of the file may be used to share decoded images.
+        /// \param  size        The size of the image in pixels.
+        ///
+        Image(Blob *data, Source source, bool isCacheable, Size size);
+        
         ///Constructs an image by performing a shallow copy of another images backing.
         ///
         /// \param  image   The other image. Should not be null.
@@ -77,7 +213,9 @@ namespace gfx {
         
 #pragma mark - Introspection
         
-        ///Returns the underlying native type.
+        ///Returns the underlying native type, decoding the image at its full size if needed.
+        ///
+        /// \result The native image, or null if the image could not be decoded.
         NativeType get() const;
         
         ///Returns the size of the image.
@@ -108,6 +246,54 @@ namespace gfx {
         /// \result A new autoreleased Blob instance.
         Blob *makeRepresentation(RepresentationType type) const;
         
+        ///Creates a binary blob representation of the image with a given set of options.
+        ///
+        /// \param  type    The format to use for the binary blob.
+        /// \param  options The options to encode the blob with.
+        ///
+        /// \result A new autoreleased Blob instance.
+        Blob *makeRepresentation(RepresentationType type, const EncodingOptions &options) const;
+        
+        ///Writes a representation of the image into a file.
+        ///
+        /// \param  type    The format to write.
+        /// \param  file    The file to write into. Required.
+        /// \param  options The options to encode the representation with.
+        ///
+        /// \throws Exception if the representation could not be created or written.
+        ///
+        ///The representation is written into the file while it is being encoded, rather
+        ///than being created in memory first. With the software rasterizer, the rows of
+        ///PNG representations are compressed in bands on multiple threads.
+        void writeRepresentation(RepresentationType type, File *file, const EncodingOptions &options = DefaultEncodingOptions) const;
+        
+        ///Returns the representation type that conventionally uses the extension of a path.
+        ///
+        /// \param  path    The path. Required.
+        ///
+        /// \result The representation type for the extension of the path, or PNG if the extension is not recognized.
+        ///
+        ///The extensions `png`, `jpg`, `jpeg`, `rgba`, `raw`, `ppm`, and `qoi` are recognized.
+        static RepresentationType representationTypeForPath(const String *path);
+        
+        ///Returns whether or not representations of a given type can be created with the current backend.
+        ///
+        ///Callers that write representations into files should check this before
+        ///opening them, so that an unavailable format does not truncate the file.
+        static bool isRepresentationTypeAvailable(RepresentationType type);
+        
+#pragma mark - Decode Cache
+        
+        ///The default number of bytes of decoded images kept by the decode cache.
+        static const size_t kDefaultDecodeCacheBudget = 64 * 1024 * 1024;
+        
+        ///Sets the maximum number of bytes of decoded images the decode cache keeps,
+        ///evicting the least recently used images as needed.
+        static void setDecodeCacheBudget(size_t budget);
+        
+        ///Returns the maximum number of bytes of decoded images the decode cache keeps.
+        static size_t decodeCacheBudget();
+        
 #pragma mark - Functions
         
         ///Adds the image suite to a given stack frame.
@@ -53,13 +53,13 @@ namespace gfx {
         mSearchPaths(new Array<const String>()),
         mImportAllowed(true),
         mWordHandlers(),
-        AnnotationFoundSignal(str("gfx::Interpreter::AnnotationFoundSignal"))
+        AnnotationFoundSignal(gfx_str("gfx::Interpreter::AnnotationFoundSignal"))
     {
         ///Handles words that begin with `:` by stripping the `:` off
         ///and pushing the resulting `gfx::Word` onto the stack. Useful
         ///for functions related to the interpreter.
         this->appendWordHandler([this](StackFrame *currentFrame, Word *word) {
-            if(word->string()->hasPrefix(str(":"))) {
+            if(word->string()->hasPrefix(gfx_str(":"))) {
                 auto string = word->string()->substring(Range(1, word->string()->length() - 1));
                 currentFrame->push(string);
                 return true;
@@ -74,7 +74,7 @@ namespace gfx {
         ///is ignored and will be handled by another word-handler.
         this->appendWordHandler([](StackFrame *currentFrame, Word *word) {
             auto wordString = word->string();
-            if(wordString->length() > 2 && wordString->hasPrefix(str("=>"))) {
+            if(wordString->length() > 2 && wordString->hasPrefix(gfx_str("=>"))) {
                 auto bindingName = wordString->substring(Range(2, wordString->length() - 2));
                 currentFrame->setBindingToValue(bindingName, currentFrame->pop());
                 return true;
@@ -88,8 +88,8 @@ namespace gfx {
         ///data within a hash without invoking the `hash/get` functor.
         this->appendWordHandler([this](StackFrame *currentFrame, Word *word) {
             auto wordString = word->string();
-            if(wordString->find(str("."), Range(0, wordString->length()))) {
-                auto pieces = SplitString(wordString, str("."));
+            if(wordString->find(gfx_str("."), Range(0, wordString->length()))) {
+                auto pieces = SplitString(wordString, gfx_str("."));
                 Base *result = currentFrame->bindingValue(pieces->first()) ?: Null::shared();
                 if(pieces->count() > 1) {
                     pieces->iterate(Range(1, pieces->count() - 1), [this, word, currentFrame, &result](String *subword, Index index, bool *stop) {
@@ -116,7 +116,7 @@ namespace gfx {
         ///Handles words enclosed in angle brackets, aka types.
         this->appendWordHandler([this](StackFrame *currentFrame, Word *word) {
             auto wordString = word->string();
-            if(wordString->hasPrefix(str("<")) && wordString->hasSuffix(str(">"))) {
+            if(wordString->hasPrefix(gfx_str("<")) && wordString->hasSuffix(gfx_str(">"))) {
                 auto type = mTypeResolutionMap->lookupTypeByName(wordString);
                 if(type)
                     currentFrame->push(const_cast<Type *>(type));
@@ -150,7 +150,7 @@ namespace gfx {
 #endif /* GFX_Include_GraphicsStack */
         
         this->addSearchPath(String::Empty);
-        this->addSearchPath(str("./"));
+        this->addSearchPath(gfx_str("./"));
     }
     
     Interpreter::~Interpreter()
@@ -199,7 +199,7 @@ namespace gfx {
         
         if(part->isKindOfClass<Word>()) {
             auto word = static_cast<Word *>(part);
-            if(word->string()->hasPrefix(str("&"))) {
+            if(word->string()->hasPrefix(gfx_str("&"))) {
                 //Looking up functions without applying them is a special case for now.
                 auto rawWord = word->string()->substring(Range(1, word->string()->length() - 1));
                 this->evalExpression(currentFrame, make<Word>(rawWord, word->offset()), EvalContext::Vector);
@@ -350,10 +350,10 @@ namespace gfx {
     Array<const Function> *Interpreter::threadLocalFunctionStack() const
     {
         auto storage = threadStorage();
-        auto stack = static_cast<Array<const Function> *>(storage->get(str("threadLocalFunctionStack")));
+        auto stack = static_cast<Array<const Function> *>(storage->get(gfx_str("threadLocalFunctionStack")));
         if(!stack) {
             stack = make<Array<const Function>>();
-            storage->set(str("threadLocalFunctionStack"), stack);
+            storage->set(gfx_str("threadLocalFunctionStack"), stack);
         }
         
         return stack;
@@ -379,6 +379,19 @@ namespace gfx {
         threadLocalFunctionStack()->remove(function);
     }
     
+    void Interpreter::applyDetached(const Function *function, StackFrame *frame)
+    {
+        gfx_assert_param(function);
+        gfx_assert_param(frame);
+        
+        try {
+            function->apply(frame);
+        } catch (Exception &e) {
+            resetFunctionStack(e);
+            throw;
+        }
+    }
+    
     const String *Interpreter::backtrace() const
     {
         auto stack = threadLocalFunctionStack();
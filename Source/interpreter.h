@@ -220,6 +220,20 @@ namespace gfx {
         ///side-effect of this method being invoked.
         void exitedFunction(const Function *function);
         
+        ///Applies a function to a frame outside of an evaluation loop.
+        ///
+        /// \param function    The function to apply. Required.
+        /// \param frame       The frame to apply the function to. Required.
+        ///
+        ///If the function raises, the backtrace of the current thread is attached
+        ///to the exception and the thread's function stack is reset, just as an
+        ///evaluation loop would. Used by worker threads, which have no evaluation
+        ///loop of their own to clean up after a failed application.
+        ///
+        /// \throws `gfx::Exception`
+        ///
+        void applyDetached(const Function *function, StackFrame *frame);
+        
         ///Returns the current function backtrace.
         ///
         /// \result The backtrace for the current thread, or null if there is no backtrace.
@@ -9,6 +9,8 @@
 #include "json.h"
 #include "exception.h"
 #include "null.h"
+#include "numberformat.h"
+#include <string>
 
 namespace gfx {
     namespace json {
@@ -55,10 +57,12 @@ namespace gfx {
         Reader::Reader(const String *string) :
             Base(),
             mString(retained(string)),
+            mCharacters(string->length()),
             mCurrentIndex(0),
             mOffset{0, 0}
         {
-            
+            if(!mCharacters.empty())
+                mString->getCharacters(Range(0, mString->length()), mCharacters.data());
         }
         
         Reader::~Reader()
@@ -106,20 +110,20 @@ namespace gfx {
         UniChar Reader::peek(Index delta)
         {
             Index offset = mCurrentIndex + delta;
-            if(offset >= 0 && offset < mString->length())
-                return mString->at(offset);
+            if(offset >= 0 && offset < Index(mCharacters.size()))
+                return mCharacters[offset];
             else
                 return 0;
         }
         
-        String *Reader::borrow(Index amount)
+        const String *Reader::borrow(Index amount)
         {
             auto subrange = Range(mCurrentIndex, amount);
             if(amount > 0 && subrange.max() < mString->length()) {
                 auto substring = mString->substring(subrange);
                 return substring;
             } else {
-                return str("");
+                return gfx_str("");
             }
         }
         
@@ -246,8 +250,14 @@ namespace gfx {
         
         Number *Reader::parseNumber()
         {
-            auto numberString = this->accumulateWhile(&is_number);
-            return make<Number>(numberString->doubleValue());
+            Index start = mCurrentIndex;
+            bool isFirstCharacter = true;
+            while (this->more() && is_number(this->current(), isFirstCharacter)) {
+                isFirstCharacter = false;
+                this->next();
+            }
+            
+            return make<Number>(numberformat::parseDouble(mCharacters.data() + start, mCharacters.data() + mCurrentIndex));
         }
         
         Dictionary<Base, Base> *Reader::parseObject()
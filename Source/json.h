@@ -15,6 +15,7 @@
 #include "dictionary.h"
 #include "array.h"
 #include <functional>
+#include <vector>
 
 namespace gfx {
     class String;
@@ -29,6 +30,9 @@ namespace gfx {
             ///The string being parsed.
             const String *mString;
             
+            ///The characters of the string, so that tokens can be read in place.
+            std::vector<UniChar> mCharacters;
+            
             ///The index within the string the parser is currently operating on.
             Index mCurrentIndex;
             
@@ -59,7 +63,7 @@ namespace gfx {
             ///
             UniChar peek(Index delta);
             
-            String *borrow(Index amount);
+            const String *borrow(Index amount);
             
             ///Returns a bool indicating whether or not there is more content available.
             bool more();
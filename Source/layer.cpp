@@ -15,12 +15,17 @@
 #   include "layerbacking_cg.h"
 #elif GFX_Layer_Use_CA
 #   include "layerbacking_calayer.h"
+#elif GFX_Layer_Use_Raster
+#   include "layerbacking_raster.h"
 #endif /* GFX_Layer_Use_CG */
 
 #include "stackframe.h"
 #include "interpreter.h"
 #include "graphics.h"
 #include "function.h"
+#include "displaylist.h"
+#include "threading.h"
+#include <algorithm>
 
 namespace gfx {
     
@@ -31,9 +36,11 @@ namespace gfx {
         mDrawFunctor(drawFunctor),
         mSuperlayer(nullptr),
         mSublayers(new Array<Layer>()),
+        mDrawsConcurrently(true),
         mBacking(new LayerBacking(this, frame, scale)),
-        WillDisplaySignal(str("WillDisplaySignal")),
-        DidDisplaySignal(str("DidDisplaySignal"))
+        mDisplayList(nullptr),
+        WillDisplaySignal(gfx_str("WillDisplaySignal")),
+        DidDisplaySignal(gfx_str("DidDisplaySignal"))
     {
         setNeedsDisplay();
     }
@@ -47,6 +54,9 @@ namespace gfx {
         mSublayers = nullptr;
         
         delete mBacking;
+        
+        released(mDisplayList);
+        mDisplayList = nullptr;
     }
     
 #pragma mark - Introspection
@@ -62,6 +72,16 @@ namespace gfx {
         return mDrawFunctor;
     }
     
+    void Layer::setDrawsConcurrently(bool drawsConcurrently)
+    {
+        mDrawsConcurrently = drawsConcurrently;
+    }
+    
+    bool Layer::drawsConcurrently() const
+    {
+        return mDrawsConcurrently;
+    }
+    
     Float Layer::scale() const
     {
         return mBacking->scale();
@@ -153,12 +173,35 @@ namespace gfx {
     
     void Layer::draw(Rect rect)
     {
-        try {
-            mDrawFunctor(this, rect);
-        } catch (Exception e) {
-            if(!mDrawExceptionHandler || !mDrawExceptionHandler(e))
-                throw;
+        auto context = Context::currentContext();
+        if(mDisplayList) {
+            Rect bounds = mDisplayList->bounds();
+            if(bounds.origin.x != rect.origin.x || bounds.origin.y != rect.origin.y ||
+               bounds.size.width != rect.size.width || bounds.size.height != rect.size.height) {
+                released(mDisplayList);
+                mDisplayList = nullptr;
+            }
         }
+        
+        if(!mDisplayList) {
+            DisplayList *displayList = new DisplayList(rect);
+            try {
+                context->record(displayList, [this, rect](Context *context) {
+                    mDrawFunctor(this, rect);
+                });
+            } catch (Exception e) {
+                released(displayList);
+                
+                if(!mDrawExceptionHandler || !mDrawExceptionHandler(e))
+                    throw;
+                
+                return;
+            }
+            
+            mDisplayList = displayList;
+        }
+        
+        mDisplayList->replay(context);
     }
     
     void Layer::didDisplay()
@@ -166,9 +209,35 @@ namespace gfx {
         DidDisplaySignal(this);
     }
     
+    void Layer::willDisplayConcurrently()
+    {
+    }
+    
+    void Layer::didDisplayConcurrently()
+    {
+    }
+    
     void Layer::setNeedsDisplay()
     {
-        mBacking->setNeedsDisplay();
+        setNeedsDisplayInRect(Rect{ {}, frame().size });
+    }
+    
+    void Layer::setNeedsDisplayInRect(Rect rect)
+    {
+        released(mDisplayList);
+        mDisplayList = nullptr;
+        
+        mBacking->setNeedsDisplayInRect(rect);
+    }
+    
+    bool Layer::needsDisplay() const
+    {
+        return mBacking->needsDisplay();
+    }
+    
+    void Layer::displayIfNeeded()
+    {
+        mBacking->displayIfNeeded();
     }
     
 #pragma mark -
@@ -177,28 +246,126 @@ namespace gfx {
     {
         gfx_assert_param(context);
         
+        Scoped<Layer> layer = this;
+        if(context->recordOperation([layer](Context *context) { layer->render(context); }))
+            return;
+        
+        std::vector<Layer *> layersNeedingDisplay;
+        collectLayersNeedingDisplay(layersNeedingDisplay);
+        auto serialLayers = std::stable_partition(layersNeedingDisplay.begin(), layersNeedingDisplay.end(), [](Layer *layer) {
+            return layer->drawsConcurrently();
+        });
+        {
+            AutoreleasePool pool;
+            
+            for (auto layer = layersNeedingDisplay.begin(); layer != serialLayers; layer++)
+                (*layer)->willDisplayConcurrently();
+            
+            try {
+                threading::parallelFor(serialLayers - layersNeedingDisplay.begin(), [&layersNeedingDisplay](size_t index, size_t) {
+                    AutoreleasePool pool;
+                    layersNeedingDisplay[index]->displayIfNeeded();
+                });
+            } catch (...) {
+                for (auto layer = layersNeedingDisplay.begin(); layer != serialLayers; layer++)
+                    (*layer)->didDisplayConcurrently();
+                
+                throw;
+            }
+            
+            for (auto layer = layersNeedingDisplay.begin(); layer != serialLayers; layer++)
+                (*layer)->didDisplayConcurrently();
+        }
+        for (auto layer = serialLayers; layer != layersNeedingDisplay.end(); layer++)
+            (*layer)->displayIfNeeded();
+        
+        composite(context);
+    }
+    
+    void Layer::collectLayersNeedingDisplay(std::vector<Layer *> &layers)
+    {
+        if(needsDisplay())
+            layers.push_back(this);
+        
+        mSublayers->iterate(mSublayers->all(), [&layers](Layer *sublayer, Index index, bool *stop) {
+            sublayer->collectLayersNeedingDisplay(layers);
+        });
+    }
+    
+    void Layer::composite(Context *context)
+    {
         mBacking->render(context);
         
         if(!LayerBacking::RendersOwnSublayers) {
             mSublayers->iterate(mSublayers->all(), [context](Layer *sublayer, Index index, bool *stop) {
-                sublayer->render(context);
+                sublayer->composite(context);
             });
         }
     }
     
 #pragma mark - Layer Functions
     
+    ///The ScriptLayer class draws its contents by applying a script function.
+    ///
+    ///When drawn concurrently, the function is applied in a frame of its own whose
+    ///parent is a frozen view of the creating frame. These frames are created on the
+    ///rendering thread because a parent frame's destroy signal is not thread safe.
+    class ScriptLayer : public Layer
+    {
+        ///The frame the layer was created in.
+        Scoped<StackFrame> mStackFrame;
+        
+        ///The function that draws the contents of the layer.
+        Scoped<Function> mDrawFunction;
+        
+        ///The frame to apply the draw function in during a concurrent draw, if any.
+        /* weak */ StackFrame *mConcurrentFrame;
+        
+    public:
+        
+        ScriptLayer(Rect frame, StackFrame *stackFrame, Function *drawFunction) :
+            Layer(frame, [this](Layer *layer, Rect rect) { drawContents(rect); }),
+            mStackFrame(stackFrame),
+            mDrawFunction(drawFunction),
+            mConcurrentFrame(nullptr)
+        {
+        }
+        
+        void willDisplayConcurrently() override
+        {
+            Interpreter *interpreter = mStackFrame->interpreter();
+            StackFrame *view = make<StackFrame>(mStackFrame, interpreter);
+            view->freeze();
+            
+            mConcurrentFrame = make<StackFrame>(view, interpreter);
+        }
+        
+        void didDisplayConcurrently() override
+        {
+            mConcurrentFrame = nullptr;
+        }
+        
+        ///Applies the draw function to a given rect.
+        void drawContents(Rect rect)
+        {
+            if(mConcurrentFrame) {
+                mConcurrentFrame->dropAll();
+                mConcurrentFrame->push(VectorFromRect(rect));
+                mStackFrame->interpreter()->applyDetached(mDrawFunction, mConcurrentFrame);
+            } else {
+                mStackFrame->push(VectorFromRect(rect));
+                mDrawFunction->apply(mStackFrame);
+                mStackFrame->safeDrop();
+            }
+        }
+    };
+    
     static void layer_make(StackFrame *stack)
     {
         /* vec func -- Layer */
-        Scoped<StackFrame> stackFrame = stack;
-        Scoped<Function> drawFunction = stack->popFunction();
+        Function *drawFunction = stack->popFunction();
         auto frame = VectorToRect(stack->popType<Array<Base>>());
-        stack->push(make<Layer>(frame, [stackFrame, drawFunction](Layer *layer, Rect rect) {
-            stackFrame->push(VectorFromRect(rect));
-            drawFunction->apply(stackFrame);
-            stackFrame->safeDrop();
-        }));
+        stack->push(make<ScriptLayer>(frame, stack, drawFunction));
     }
     
     static void layer_frame(StackFrame *stack)
@@ -223,6 +390,14 @@ namespace gfx {
         layer->setNeedsDisplay();
     }
     
+    static void layer_displayIn(StackFrame *stack)
+    {
+        /* layer vec -- */
+        auto rect = VectorToRect(stack->popType<Array<Base>>());
+        auto layer = stack->popType<Layer>();
+        layer->setNeedsDisplayInRect(rect);
+    }
+    
     static void layer_render(StackFrame *stack)
     {
         /* layer -- */
@@ -265,15 +440,16 @@ namespace gfx {
     {
         gfx_assert_param(frame);
         
-        frame->createFunctionBinding(str("layer"), &layer_make);
-        frame->createFunctionBinding(str("layer/frame"), &layer_frame);
-        frame->createFunctionBinding(str("layer/set-frame"), &layer_setFrame);
-        frame->createFunctionBinding(str("layer/display"), &layer_display);
-        frame->createFunctionBinding(str("layer/render"), &layer_render);
+        frame->createFunctionBinding(gfx_str("layer"), &layer_make);
+        frame->createFunctionBinding(gfx_str("layer/frame"), &layer_frame);
+        frame->createFunctionBinding(gfx_str("layer/set-frame"), &layer_setFrame);
+        frame->createFunctionBinding(gfx_str("layer/display"), &layer_display);
+        frame->createFunctionBinding(gfx_str("layer/display-in"), &layer_displayIn);
+        frame->createFunctionBinding(gfx_str("layer/render"), &layer_render);
         
-        frame->createFunctionBinding(str("layer/add-child"), &layer_addChild);
-        frame->createFunctionBinding(str("layer/remove-as-child"), &layer_removeAsChild);
-        frame->createFunctionBinding(str("layer/parent"), &layer_parent);
-        frame->createFunctionBinding(str("layer/children"), &layer_children);
+        frame->createFunctionBinding(gfx_str("layer/add-child"), &layer_addChild);
+        frame->createFunctionBinding(gfx_str("layer/remove-as-child"), &layer_removeAsChild);
+        frame->createFunctionBinding(gfx_str("layer/parent"), &layer_parent);
+        frame->createFunctionBinding(gfx_str("layer/children"), &layer_children);
     }
 }
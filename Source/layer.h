@@ -13,12 +13,14 @@
 #include "types.h"
 #include "array.h"
 #include "broadcastsignal.h"
+#include <vector>
 
 OBJC_EXTERN_CLASS CALayer;
 
 namespace gfx {
     class LayerBacking;
     class Context;
+    class DisplayList;
     class StackFrame;
     
     ///The Layer class manages rasterized contents, and encapsulates rendering
@@ -40,6 +42,10 @@ namespace gfx {
         ///
         ///The result of the function is cached, however, the function
         ///should still attempt to complete its work as quickly as possible.
+        ///
+        ///Unless `drawsConcurrently` is false, the draw functors of different
+        ///layers in a tree may be invoked concurrently from background threads
+        ///while the tree is rendered.
         typedef std::function<void(Layer *layer, Rect rect)> DrawFunctor;
         
         ///A function used to capture exceptions that are raised during the rendering of a layer.
@@ -67,6 +73,9 @@ namespace gfx {
         ///The sublayers of the layer.
         Array<Layer> *mSublayers;
         
+        ///Whether or not the draw functor may be invoked from a background thread.
+        bool mDrawsConcurrently;
+        
         ///The backing of the Layer.
         ///
         ///A layer's backing will vary depending on target platform,
@@ -74,6 +83,13 @@ namespace gfx {
         ///options set in the `gfx_defines` header.
         LayerBacking *mBacking;
         
+        ///The operations recorded by the last invocation of the draw functor.
+        ///
+        ///The display list is replayed instead of invoking the draw functor
+        ///again until the layer is marked as needing display, or is asked
+        ///to draw into a rect of a different size.
+        DisplayList *mDisplayList;
+        
     public:
         
 #pragma mark - Lifecycle
@@ -103,6 +119,16 @@ namespace gfx {
         ///Returns the draw functor of the layer.
         virtual const DrawFunctor &drawFunctor() const;
         
+        ///Sets whether or not the layer's draw functor may be invoked from a
+        ///background thread while a layer tree is rendered. Defaults to true.
+        ///
+        ///Layers whose draw functors are not thread safe are displayed serially
+        ///on the rendering thread.
+        virtual void setDrawsConcurrently(bool drawsConcurrently);
+        
+        ///Returns whether or not the layer's draw functor may be invoked from a background thread.
+        virtual bool drawsConcurrently() const;
+        
         ///Returns the scale factor of the layer.
         virtual Float scale() const;
         
@@ -173,7 +199,9 @@ namespace gfx {
         
         ///Draws the contents of the receiver into the current context.
         ///
-        ///The default implementation of this method invokes the layer's.
+        ///The default implementation of this method invokes the layer's
+        ///draw functor, recording its operations into a display list that
+        ///is replayed by subsequent draws until the layer needs display.
         virtual void draw(Rect rect);
         
         ///Informs the layer that its draw functor was invoked.
@@ -181,23 +209,74 @@ namespace gfx {
         ///This method may be invoked from a background thread.
         virtual void didDisplay();
         
+        ///Informs the layer that its draw functor will soon be invoked from a background thread.
+        ///
+        ///This method is invoked serially on the rendering thread before any layer of the tree
+        ///is drawn, inside of an autorelease pool that is drained once the concurrent draws have
+        ///completed. Subclasses may override it to create state that their draw functor needs and
+        ///that cannot be created concurrently. The default implementation does nothing.
+        virtual void willDisplayConcurrently();
+        
+        ///Informs the layer that the concurrent draws of a render have completed.
+        ///
+        ///This method is invoked serially on the rendering thread, even if a draw raised.
+        ///The default implementation does nothing.
+        virtual void didDisplayConcurrently();
+        
         ///Marks the layer's contents as invalid, eventually invoking
         ///the receiver's draw functor.
         ///
-        ///Depending on the implementation of `gfx::Layer` in use, this method
-        ///will either synchronously invoke the draw functor function,
-        ///or the draw functor will be called on the next run loop cycle.
-        ///Call sites should take this into account as needed.
+        ///The draw functor is not invoked synchronously. Depending on the
+        ///implementation of `gfx::Layer` in use, it will be called when the
+        ///layer is next rendered, or on the next run loop cycle. Repeated
+        ///invalidations before then are coalesced into a single redraw.
         virtual void setNeedsDisplay();
         
+        ///Marks an area of the layer's contents as invalid, eventually
+        ///invoking the receiver's draw functor with the area to redraw.
+        ///
+        /// \param  rect    The area to invalidate, in the coordinate system of the layer.
+        ///
+        ///Invalidated areas are coalesced until the layer is displayed. The draw
+        ///functor is given the union of the invalidated areas, and drawing is
+        ///clipped to it.
+        virtual void setNeedsDisplayInRect(Rect rect);
+        
+        ///Returns whether or not the layer has invalidated areas that have not been redrawn.
+        ///
+        ///Layer implementations that defer display to the platform always return false.
+        virtual bool needsDisplay() const;
+        
+        ///Immediately redraws any invalidated areas of the layer's contents.
+        ///
+        ///Rendering a layer displays it if needed, so this method is only
+        ///required by hosts that read the layer's contents directly.
+        virtual void displayIfNeeded();
+        
 #pragma mark -
         
         ///Renders the contents of the receiver and its children into a given Context.
         ///
         /// \param  context The context to render the contents into. Required.
         ///
+        ///Every layer in the receiver's tree that needs display is redrawn before
+        ///anything is composited. As each layer draws into its own backing, these
+        ///redraws are performed concurrently on the shared worker pool, except for
+        ///layers that do not draw concurrently. The layers are then composited into
+        ///the context serially, in z-order.
         virtual void render(Context *context);
         
+    protected:
+        
+        ///Appends the receiver and every layer beneath it that needs display to a vector.
+        void collectLayersNeedingDisplay(std::vector<Layer *> &layers);
+        
+        ///Composites the contents of the receiver and its children into a
+        ///given Context, without displaying the tree concurrently first.
+        void composite(Context *context);
+        
+    public:
+        
 #pragma mark - Signals
         
         ///A signal that broadcasts whenever the Layer's contents will be redrawn.
@@ -95,10 +95,23 @@ namespace gfx {
         /// - `gfx::Layer::didDisplay`
         void display();
         
-        ///Marks the receiver as needing display. The CGLayer implementation
-        ///of this method immediately invokes display.
+        ///Marks the receiver as needing display. The CALayer implementation
+        ///of this method defers display to Core Animation.
         void setNeedsDisplay();
         
+        ///Marks an area of the receiver as needing display.
+        ///
+        /// \param  rect    The area to invalidate, in the coordinate system of the layer.
+        ///
+        ///Core Animation coalesces invalidated areas, and clips drawing to them.
+        void setNeedsDisplayInRect(Rect rect);
+        
+        ///Returns false, as Core Animation schedules display itself.
+        bool needsDisplay() const;
+        
+        ///Displays the invalidated areas of the receiver, if any.
+        void displayIfNeeded();
+        
         ///Render the contents of the layer into a given context.
         ///
         /// \param  context The context to render the layer's contents into. Required.
@@ -135,12 +135,14 @@ namespace gfx {
         
         mLayer->willDisplay();
         
+        //Core Animation clips the context to the area being redrawn.
         Context *layerContext = Context::currentContext();
         Rect boundingRect{ Point{}, frame().size };
-        layerContext->clear(boundingRect);
+        Rect dirtyRect = boundingRect.getIntersection(CGContextGetClipBoundingBox(layerContext->get()));
+        layerContext->clear(dirtyRect);
         
-        layerContext->transaction([this, boundingRect](Context *context) {
-            mLayer->draw(boundingRect);
+        layerContext->transaction([this, dirtyRect](Context *context) {
+            mLayer->draw(dirtyRect);
         });
         
         mLayer->didDisplay();
@@ -161,6 +163,28 @@ namespace gfx {
         }
     }
     
+    void LayerBacking::setNeedsDisplayInRect(Rect rect)
+    {
+        if(threading::isMainThread()) {
+            [mTexture setNeedsDisplayInRect:rect];
+        } else {
+            threading::performOnMainThread([this, rect] {
+                [mTexture setNeedsDisplayInRect:rect];
+            });
+        }
+    }
+    
+    bool LayerBacking::needsDisplay() const
+    {
+        return false;
+    }
+    
+    void LayerBacking::displayIfNeeded()
+    {
+        if(threading::isMainThread())
+            [mTexture displayIfNeeded];
+    }
+    
     void LayerBacking::render(Context *context)
     {
         gfx_assert_param(context);
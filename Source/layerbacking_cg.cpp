@@ -15,16 +15,26 @@
 namespace gfx {
     bool const LayerBacking::RendersOwnSublayers = false;
     
+    ///Creates a texture of a given size and scale.
+    ///
+    ///A CGLayer only takes the characteristics of its reference context,
+    ///so a single pixel context is used instead of one the size of the layer.
+    static CGLayerRef CreateTexture(Size size, Float scale)
+    {
+        AutoreleasePool pool;
+        
+        Context *referenceContext = Context::bitmapContextWith({1.0, 1.0}, scale);
+        return CGLayerCreateWithContext(referenceContext->get(), size, NULL);
+    }
+    
     LayerBacking::LayerBacking(Layer *layer, Rect frame, Float scale) :
-        mTexture(),
+        mTexture(CreateTexture(frame.size, scale)),
         mLayer(layer),
         mFrame(frame),
-        mScale(scale)
+        mScale(scale),
+        mNeedsDisplay(false),
+        mDirtyRect()
     {
-        AutoreleasePool pool;
-        
-        Context *referenceContext = Context::bitmapContextWith(frame.size, scale);
-        mTexture = CGLayerCreateWithContext(referenceContext->get(), referenceContext->boundingRect().size, NULL);
     }
     
     LayerBacking::~LayerBacking()
@@ -53,17 +63,15 @@ namespace gfx {
     
     void LayerBacking::setFrame(Rect frame)
     {
-        if(frame.size.width != mFrame.size.width || frame.size.height != mFrame.size.height) {
-            CGContextRef referenceContext = CGLayerGetContext(mTexture);
-            CGLayerRef newBacking = CGLayerCreateWithContext(referenceContext, CGContextGetClipBoundingBox(referenceContext).size, NULL);
-            
+        bool sizeChanged = (frame.size.width != mFrame.size.width || frame.size.height != mFrame.size.height);
+        mFrame = frame;
+        
+        if(sizeChanged) {
             CGLayerRelease(mTexture);
-            mTexture = newBacking;
+            mTexture = CreateTexture(frame.size, scale());
             
             setNeedsDisplay();
         }
-        
-        mFrame = frame;
     }
     
     Rect LayerBacking::frame() const
@@ -79,13 +87,18 @@ namespace gfx {
         
         mLayer->willDisplay();
         
-        Context *layerContext = make<Context>(CGLayerGetContext(mTexture), scale(), false);
         Rect boundingRect = { {}, frame().size };
-        layerContext->clear(boundingRect);
+        Rect dirtyRect = mNeedsDisplay? mDirtyRect : boundingRect;
+        mNeedsDisplay = false;
+        mDirtyRect = Rect{};
+        
+        Context *layerContext = make<Context>(CGLayerGetContext(mTexture), scale(), false);
+        layerContext->clear(dirtyRect);
         
         Context::pushContext(layerContext);
-        layerContext->transaction([this, boundingRect](Context *context) {
-            mLayer->draw(boundingRect);
+        layerContext->transaction([this, dirtyRect](Context *context) {
+            CGContextClipToRect(context->get(), dirtyRect);
+            mLayer->draw(dirtyRect);
         });
         Context::popContext();
         
@@ -94,13 +107,36 @@ namespace gfx {
     
     void LayerBacking::setNeedsDisplay()
     {
-        display();
+        setNeedsDisplayInRect(Rect{ {}, frame().size });
+    }
+    
+    void LayerBacking::setNeedsDisplayInRect(Rect rect)
+    {
+        Rect dirtyRect = rect.getIntersection(Rect{ {}, frame().size });
+        if(dirtyRect.isEmpty())
+            return;
+        
+        mDirtyRect = mDirtyRect.getUnion(dirtyRect);
+        mNeedsDisplay = true;
+    }
+    
+    bool LayerBacking::needsDisplay() const
+    {
+        return mNeedsDisplay;
+    }
+    
+    void LayerBacking::displayIfNeeded()
+    {
+        if(mNeedsDisplay)
+            display();
     }
     
     void LayerBacking::render(Context *context)
     {
         gfx_assert_param(context);
         
+        displayIfNeeded();
+        
         CGContextDrawLayerAtPoint(context->get(), frame().origin, mTexture);
     }
     
@@ -44,6 +44,13 @@ namespace gfx {
         ///The frame of the layer backing.
         Rect mFrame;
         
+        ///Whether or not the backing has been invalidated since it was last displayed.
+        bool mNeedsDisplay;
+        
+        ///The union of the areas invalidated since the backing was last displayed,
+        ///in the coordinate system of the layer.
+        Rect mDirtyRect;
+        
     public:
         
         ///Indicates whether or not the current backing class renders
@@ -92,15 +99,30 @@ namespace gfx {
         /// - `gfx::Layer::didDisplay`
         void display();
         
-        ///Marks the receiver as needing display. The CGLayer implementation
-        ///of this method immediately invokes display.
+        ///Marks the receiver as needing display.
         void setNeedsDisplay();
         
-        ///Render the contents of the layer into a given context.
+        ///Marks an area of the receiver as needing display.
         ///
-        /// \param  context The context to render the layer's contents into. Required.
+        /// \param  rect    The area to invalidate, in the coordinate system of the layer.
         ///
-        ///This method will do nothing if the layer backing has never been displayed.
+        ///The CGLayer implementation of this method does not display immediately.
+        ///Invalidated areas are coalesced into a single dirty rect which is
+        ///redrawn by the next call to `gfx::LayerBacking::displayIfNeeded`.
+        void setNeedsDisplayInRect(Rect rect);
+        
+        ///Returns whether or not the receiver has been invalidated since it was last displayed.
+        bool needsDisplay() const;
+        
+        ///Displays the dirty rect of the receiver if it has been invalidated.
+        ///
+        ///Backings of different layers may be displayed concurrently.
+        void displayIfNeeded();
+        
+        ///Render the contents of the layer into a given context,
+        ///displaying any invalidated areas of the receiver first.
+        ///
+        /// \param  context The context to render the layer's contents into. Required.
         void render(Context *context);
         
 #pragma mark - Hooks
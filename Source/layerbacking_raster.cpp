@@ -0,0 +1,171 @@
+//
+//  layerbacking_raster.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/6/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#if GFX_Layer_Use_Raster
+
+#include "layerbacking_raster.h"
+#include "layer.h"
+#include "context.h"
+#include <cmath>
+
+namespace gfx {
+    bool const LayerBacking::RendersOwnSublayers = false;
+    
+    ///Creates a transparent surface to back a layer of a given size and scale.
+    static raster::Surface *CreateTexture(Size size, Float scale)
+    {
+        return new raster::Surface(size_t(std::ceil(size.width * scale)), size_t(std::ceil(size.height * scale)));
+    }
+    
+    ///Returns a given scale, or the default scale if it is 0.
+    static Float ResolvedScale(Float scale)
+    {
+        return scale? scale : Context::defaultScale();
+    }
+    
+    LayerBacking::LayerBacking(Layer *layer, Rect frame, Float scale) :
+        mTexture(CreateTexture(frame.size, ResolvedScale(scale))),
+        mLayer(layer),
+        mScale(ResolvedScale(scale)),
+        mFrame(frame),
+        mNeedsDisplay(false),
+        mDirtyRect()
+    {
+    }
+    
+    LayerBacking::~LayerBacking()
+    {
+        mTexture->release();
+    }
+    
+#pragma mark - Properties
+    
+    Layer *LayerBacking::layer() const
+    {
+        return mLayer;
+    }
+    
+#pragma mark -
+    
+    void LayerBacking::setScale(Float scale)
+    {
+        mScale = scale;
+    }
+    
+    Float LayerBacking::scale() const
+    {
+        return mScale;
+    }
+    
+    void LayerBacking::setFrame(Rect frame)
+    {
+        bool sizeChanged = (frame.size.width != mFrame.size.width || frame.size.height != mFrame.size.height);
+        mFrame = frame;
+        
+        if(sizeChanged) {
+            mTexture->release();
+            mTexture = CreateTexture(frame.size, scale());
+            
+            setNeedsDisplay();
+        }
+    }
+    
+    Rect LayerBacking::frame() const
+    {
+        return mFrame;
+    }
+    
+#pragma mark - Drawing
+    
+    void LayerBacking::display()
+    {
+        AutoreleasePool pool;
+        
+        mLayer->willDisplay();
+        
+        Rect boundingRect = { {}, frame().size };
+        Rect dirtyRect = mNeedsDisplay? mDirtyRect : boundingRect;
+        mNeedsDisplay = false;
+        mDirtyRect = Rect{};
+        
+        //Contexts the texture has been rendered into may not have drawn it yet.
+        //Partial redraws keep the pixels outside of the dirty rect.
+        if(mTexture->retainCount() > 1) {
+            raster::Surface *texture = new raster::Surface(mTexture);
+            mTexture->release();
+            mTexture = texture;
+        }
+        
+        raster::Canvas *canvas = new raster::Canvas(mTexture);
+        canvas->setDeferred(true);
+        
+        Context *layerContext = make<Context>(canvas, scale());
+        layerContext->concatTransformationMatrix(Transform2D::makeScale(scale(), scale()));
+        layerContext->clear(dirtyRect);
+        
+        Context::pushContext(layerContext);
+        layerContext->transaction([this, dirtyRect](Context *context) {
+            context->get()->clipToRect(dirtyRect);
+            mLayer->draw(dirtyRect);
+        });
+        Context::popContext();
+        
+        canvas->flush();
+        
+        mLayer->didDisplay();
+    }
+    
+    void LayerBacking::setNeedsDisplay()
+    {
+        setNeedsDisplayInRect(Rect{ {}, frame().size });
+    }
+    
+    void LayerBacking::setNeedsDisplayInRect(Rect rect)
+    {
+        Rect dirtyRect = rect.getIntersection(Rect{ {}, frame().size });
+        if(dirtyRect.isEmpty())
+            return;
+        
+        mDirtyRect = mDirtyRect.getUnion(dirtyRect);
+        mNeedsDisplay = true;
+    }
+    
+    bool LayerBacking::needsDisplay() const
+    {
+        return mNeedsDisplay;
+    }
+    
+    void LayerBacking::displayIfNeeded()
+    {
+        if(mNeedsDisplay)
+            display();
+    }
+    
+    void LayerBacking::render(Context *context)
+    {
+        gfx_assert_param(context);
+        
+        displayIfNeeded();
+        
+        context->get()->drawImage(mTexture, frame());
+    }
+    
+#pragma mark - Hooks
+    
+    void LayerBacking::layerDidInsertSublayer(Index offset, Layer *newSublayer)
+    {
+        //Do nothing.
+    }
+    
+    void LayerBacking::layerDidRemoveFromSuperlayer()
+    {
+        //Do nothing.
+    }
+}
+
+#endif /* GFX_Layer_Use_Raster */
@@ -0,0 +1,186 @@
+//
+//  lrucache.h
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/14/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef __gfx__lrucache__
+#define __gfx__lrucache__
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace gfx {
+    
+    ///The LRUCache class keeps the most recently used values by key, evicting
+    ///the least recently used values once it exceeds its limits.
+    ///
+    /// \tparam Key     The type of the keys. Must be equality comparable.
+    /// \tparam Value   The type of the values. Values are copied in and out of the cache,
+    ///                 so they should manage the lifetime of what they refer to, e.g. by
+    ///                 being `gfx::Scoped` or `std::shared_ptr` instances.
+    /// \tparam Hash    The type of the functor used to hash keys.
+    ///
+    ///Each value has a cost, 1 unless given otherwise. The cache keeps at most
+    ///a given number of values, whose costs add up to at most a given total.
+    ///Values that cost more than the total on their own are never kept.
+    ///
+    ///Keys that do not compare equal to themselves, such as keys containing NaN,
+    ///can never be found again, so callers should not insert them.
+    ///
+    ///All methods of this class are thread-safe.
+    template<typename Key, typename Value, typename Hash = std::hash<Key>>
+    class LRUCache
+    {
+        ///A cached value, its key, and its cost.
+        struct Entry
+        {
+            Key key;
+            Value value;
+            size_t cost;
+        };
+        
+        ///Guards the members of the cache.
+        std::mutex mMutex;
+        
+        ///The cached values, from most to least recently used.
+        std::list<Entry> mEntries;
+        
+        ///The cached values by their keys.
+        std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> mEntriesByKey;
+        
+        ///The largest number of values to keep.
+        size_t mMaximumCount;
+        
+        ///The largest total cost of the values to keep.
+        size_t mMaximumCost;
+        
+        ///The total cost of the values currently kept.
+        size_t mCost;
+        
+        ///Evicts the least recently used values until the cache is within its limits.
+        ///
+        ///The cache must be locked by the caller.
+        void trim()
+        {
+            while (!mEntries.empty() && (mEntries.size() > mMaximumCount || mCost > mMaximumCost)) {
+                mCost -= mEntries.back().cost;
+                mEntriesByKey.erase(mEntries.back().key);
+                mEntries.pop_back();
+            }
+        }
+    
+    public:
+        
+        ///Constructs an empty cache.
+        ///
+        /// \param  maximumCount    The largest number of values to keep.
+        /// \param  maximumCost     The largest total cost of the values to keep. Unlimited by default.
+        ///
+        explicit LRUCache(size_t maximumCount, size_t maximumCost = std::numeric_limits<size_t>::max()) :
+            mMutex(),
+            mEntries(),
+            mEntriesByKey(),
+            mMaximumCount(maximumCount),
+            mMaximumCost(maximumCost),
+            mCost(0)
+        {
+        }
+        
+        LRUCache(const LRUCache &) = delete;
+        LRUCache &operator=(const LRUCache &) = delete;
+        
+#pragma mark - Lookup
+        
+        ///Looks up the value for a given key, marking it as the most recently used.
+        ///
+        /// \param  key         The key to look up.
+        /// \param  outValue    On return, a copy of the value if it was found.
+        ///
+        /// \result true if the value was found; false otherwise.
+        bool find(const Key &key, Value &outValue)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto existingEntry = mEntriesByKey.find(key);
+            if(existingEntry == mEntriesByKey.end())
+                return false;
+            
+            mEntries.splice(mEntries.begin(), mEntries, existingEntry->second);
+            outValue = existingEntry->second->value;
+            return true;
+        }
+        
+        ///Adds a value for a given key, evicting values as needed.
+        ///
+        ///Nothing is added if the key is already in the cache,
+        ///or if the cost is larger than the maximum total cost.
+        void insert(const Key &key, const Value &value, size_t cost = 1)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if(cost > mMaximumCost || mEntriesByKey.find(key) != mEntriesByKey.end())
+                return;
+            
+            mEntries.push_front(Entry{ key, value, cost });
+            mEntriesByKey.emplace(key, mEntries.begin());
+            mCost += cost;
+            
+            trim();
+        }
+        
+        ///Returns the value for a given key, creating and adding it if it is not in the cache.
+        ///
+        /// \param  key     The key to look up.
+        /// \param  create  Invoked to create the value if it is not in the cache. The cache
+        ///                 is not locked while it runs, so it may be invoked by more than one
+        ///                 thread for the same key, in which case the first value is kept.
+        ///
+        template<typename Create>
+        Value valueFor(const Key &key, const Create &create)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                auto existingEntry = mEntriesByKey.find(key);
+                if(existingEntry != mEntriesByKey.end()) {
+                    mEntries.splice(mEntries.begin(), mEntries, existingEntry->second);
+                    return existingEntry->second->value;
+                }
+            }
+            
+            Value value = create();
+            insert(key, value);
+            return value;
+        }
+        
+#pragma mark - Limits
+        
+        ///Sets the largest total cost of the values to keep, evicting values as needed.
+        void setMaximumCost(size_t maximumCost)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mMaximumCost = maximumCost;
+            trim();
+        }
+        
+        ///Returns the largest total cost of the values to keep.
+        size_t maximumCost()
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            return mMaximumCost;
+        }
+        
+        ///Returns the number of values currently kept.
+        size_t count()
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            return mEntries.size();
+        }
+    };
+}
+
+#endif /* defined(__gfx__lrucache__) */
@@ -0,0 +1,176 @@
+//
+//  noise.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/5/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#include "noise.h"
+#include "threading.h"
+#include <cmath>
+
+namespace gfx {
+    namespace noise {
+    
+#pragma mark - Random Numbers
+        
+        void Random::fill(uint32_t *buffer, size_t count)
+        {
+            for (size_t index = 0; index < count; index++)
+                buffer[index] = next();
+        }
+        
+#pragma mark - Coherent Noise
+        
+        ///Returns the quintic fade curve of a value in [0, 1], which has
+        ///zero first and second derivatives at both ends of the range.
+        static inline double Fade(double t)
+        {
+            return t * t * t * (t * (t * 6.0 - 15.0) + 10.0);
+        }
+        
+        static inline double Lerp(double a, double b, double t)
+        {
+            return a + t * (b - a);
+        }
+        
+        static inline double Clamp(double value)
+        {
+            return (value < -1.0)? -1.0 : (value > 1.0)? 1.0 : value;
+        }
+        
+        ///Returns the dot product of an offset and one of eight gradients selected by a hash.
+        static inline double Gradient(uint32_t hash, double x, double y)
+        {
+            switch (hash & 7) {
+                case 0: return x + y;
+                case 1: return -x + y;
+                case 2: return x - y;
+                case 3: return -x - y;
+                case 4: return x;
+                case 5: return -x;
+                case 6: return y;
+                default: return -y;
+            }
+        }
+        
+        static double Value(double x, double y, uint32_t seed)
+        {
+            double floorX = std::floor(x), floorY = std::floor(y);
+            int32_t x0 = int32_t(floorX), y0 = int32_t(floorY);
+            double u = Fade(x - floorX), v = Fade(y - floorY);
+            
+            const double kScale = 2.0 / 4294967295.0;
+            double v00 = hash(seed, x0, y0) * kScale - 1.0;
+            double v10 = hash(seed, x0 + 1, y0) * kScale - 1.0;
+            double v01 = hash(seed, x0, y0 + 1) * kScale - 1.0;
+            double v11 = hash(seed, x0 + 1, y0 + 1) * kScale - 1.0;
+            
+            return Lerp(Lerp(v00, v10, u), Lerp(v01, v11, u), v);
+        }
+        
+        static double Perlin(double x, double y, uint32_t seed)
+        {
+            double floorX = std::floor(x), floorY = std::floor(y);
+            int32_t x0 = int32_t(floorX), y0 = int32_t(floorY);
+            double fx = x - floorX, fy = y - floorY;
+            double u = Fade(fx), v = Fade(fy);
+            
+            double g00 = Gradient(hash(seed, x0, y0), fx, fy);
+            double g10 = Gradient(hash(seed, x0 + 1, y0), fx - 1.0, fy);
+            double g01 = Gradient(hash(seed, x0, y0 + 1), fx, fy - 1.0);
+            double g11 = Gradient(hash(seed, x0 + 1, y0 + 1), fx - 1.0, fy - 1.0);
+            
+            return Clamp(Lerp(Lerp(g00, g10, u), Lerp(g01, g11, u), v));
+        }
+        
+        static double Simplex(double x, double y, uint32_t seed)
+        {
+            const double kSkew = 0.5 * (std::sqrt(3.0) - 1.0);
+            const double kUnskew = (3.0 - std::sqrt(3.0)) / 6.0;
+            
+            double skew = (x + y) * kSkew;
+            double floorI = std::floor(x + skew), floorJ = std::floor(y + skew);
+            int32_t i = int32_t(floorI), j = int32_t(floorJ);
+            
+            double unskew = (floorI + floorJ) * kUnskew;
+            double x0 = x - (floorI - unskew), y0 = y - (floorJ - unskew);
+            
+            int32_t i1 = (x0 > y0)? 1 : 0, j1 = (x0 > y0)? 0 : 1;
+            double x1 = x0 - i1 + kUnskew, y1 = y0 - j1 + kUnskew;
+            double x2 = x0 - 1.0 + 2.0 * kUnskew, y2 = y0 - 1.0 + 2.0 * kUnskew;
+            
+            auto corner = [seed](int32_t i, int32_t j, double x, double y) -> double {
+                double t = 0.5 - x * x - y * y;
+                if(t < 0.0)
+                    return 0.0;
+                
+                t *= t;
+                return t * t * Gradient(hash(seed, i, j), x, y);
+            };
+            
+            double sum = corner(i, j, x0, y0) + corner(i + i1, j + j1, x1, y1) + corner(i + 1, j + 1, x2, y2);
+            return Clamp(70.0 * sum);
+        }
+        
+        double sample(Basis basis, double x, double y, uint32_t seed)
+        {
+            switch (basis) {
+                case Basis::Value:
+                    return Value(x, y, seed);
+                
+                case Basis::Perlin:
+                    return Perlin(x, y, seed);
+                
+                case Basis::Simplex:
+                    return Simplex(x, y, seed);
+            }
+            
+            return 0.0;
+        }
+        
+        double fractal(Basis basis, double x, double y, unsigned int octaves, uint32_t seed)
+        {
+            if(octaves <= 1)
+                return sample(basis, x, y, seed);
+            
+            double sum = 0.0, amplitude = 1.0, totalAmplitude = 0.0, frequency = 1.0;
+            for (unsigned int octave = 0; octave < octaves; octave++) {
+                sum += amplitude * sample(basis, x * frequency, y * frequency, seed + octave * 0x9e3779b9U);
+                totalAmplitude += amplitude;
+                amplitude *= 0.5;
+                frequency *= 2.0;
+            }
+            
+            return sum / totalAmplitude;
+        }
+        
+#pragma mark - Filling Buffers
+        
+        void fillWhite(uint8_t *pixels, size_t width, size_t height, size_t bytesPerRow,
+                       size_t bytesPerPixel, size_t channel, uint8_t maximum, uint32_t seed)
+        {
+            threading::parallelFor(height, [=](size_t row, size_t) {
+                Random random(seed, uint32_t(row * width));
+                uint8_t *pixel = pixels + row * bytesPerRow + channel;
+                for (size_t column = 0; column < width; column++, pixel += bytesPerPixel)
+                    *pixel = uint8_t(random.nextInRange(maximum));
+            });
+        }
+        
+        void fillCoherent(uint8_t *pixels, size_t width, size_t height, size_t bytesPerRow,
+                          Basis basis, double scale, unsigned int octaves, uint32_t seed)
+        {
+            double inverseScale = 1.0 / scale;
+            threading::parallelFor(height, [=](size_t row, size_t) {
+                uint8_t *pixel = pixels + row * bytesPerRow;
+                double y = (row + 0.5) * inverseScale;
+                for (size_t column = 0; column < width; column++) {
+                    double value = fractal(basis, (column + 0.5) * inverseScale, y, octaves, seed);
+                    pixel[column] = uint8_t(std::lround((value + 1.0) * 127.5));
+                }
+            });
+        }
+    }
+}
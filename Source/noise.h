@@ -0,0 +1,163 @@
+//
+//  noise.h
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/5/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef __gfx__noise__
+#define __gfx__noise__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gfx {
+    
+    ///The noise namespace contains the random number generation
+    ///and coherent noise functions behind the noise functions.
+    ///
+    ///Every function in this namespace is deterministic for a given seed,
+    ///and none keep hidden state, so they may be freely called from any
+    ///number of threads at once.
+    namespace noise {
+    
+#pragma mark - Random Numbers
+        
+        ///Returns a well distributed hash of a 32-bit value.
+        inline uint32_t hash(uint32_t value)
+        {
+            value ^= value >> 16;
+            value *= 0x7feb352dU;
+            value ^= value >> 15;
+            value *= 0x846ca68bU;
+            value ^= value >> 16;
+            return value;
+        }
+        
+        ///Returns a well distributed hash of a seed and a pair of coordinates.
+        inline uint32_t hash(uint32_t seed, int32_t x, int32_t y)
+        {
+            return hash(hash(hash(seed) ^ uint32_t(x)) ^ uint32_t(y));
+        }
+        
+        ///The Random class is a seedable, counter based random number generator.
+        ///
+        ///The nth number yielded by a generator is the hash of its seed and n,
+        ///so generators have no dependency between numbers. This allows bulk
+        ///generation to be vectorized by the compiler, and any range of the
+        ///sequence to be generated on any thread without generating the rest.
+        class Random
+        {
+            ///The hashed seed of the generator.
+            uint32_t mSeed;
+            
+            ///The position of the generator in its sequence.
+            uint32_t mCounter;
+            
+        public:
+            
+            ///Constructs a generator with a given seed, positioned at a given point in its sequence.
+            explicit Random(uint32_t seed, uint32_t counter = 0) :
+                mSeed(hash(seed)),
+                mCounter(counter)
+            {
+            }
+            
+            ///Returns the next number of the sequence.
+            uint32_t next()
+            {
+                return hash(mSeed ^ hash(mCounter++));
+            }
+            
+            ///Returns the next number of the sequence as a double in the range [0, 1).
+            double nextDouble()
+            {
+                return next() * (1.0 / 4294967296.0);
+            }
+            
+            ///Returns the next number of the sequence in the range [0, maximum].
+            ///
+            ///The number is scaled without division, so maximum may be zero.
+            uint32_t nextInRange(uint32_t maximum)
+            {
+                return uint32_t((uint64_t(next()) * (uint64_t(maximum) + 1)) >> 32);
+            }
+            
+            ///Fills a buffer with the next numbers of the sequence.
+            void fill(uint32_t *buffer, size_t count);
+        };
+        
+#pragma mark - Coherent Noise
+        
+        ///The kinds of coherent noise that can be generated.
+        enum class Basis {
+            ///Interpolated random values on an integer lattice.
+            Value,
+            
+            ///Ken Perlin's improved gradient noise.
+            Perlin,
+            
+            ///Ken Perlin's simplex noise. Has fewer directional artifacts than Perlin noise.
+            Simplex,
+        };
+        
+        ///Samples coherent noise at a point.
+        ///
+        /// \param  basis   The kind of noise to sample.
+        /// \param  x       The x coordinate. Features of the noise are roughly one unit apart.
+        /// \param  y       The y coordinate.
+        /// \param  seed    The seed of the noise.
+        ///
+        /// \result A value in the range [-1, 1].
+        ///
+        extern double sample(Basis basis, double x, double y, uint32_t seed);
+        
+        ///Samples fractal Brownian motion built from a given kind of noise at a point.
+        ///
+        /// \param  basis   The kind of noise to build upon.
+        /// \param  x       The x coordinate.
+        /// \param  y       The y coordinate.
+        /// \param  octaves The number of layers of noise. Each layer has twice the frequency and
+        ///                 half the amplitude of the last. A single octave is plain noise.
+        /// \param  seed    The seed of the noise. Each octave uses a different seed derived from it.
+        ///
+        /// \result A value in the range [-1, 1].
+        ///
+        extern double fractal(Basis basis, double x, double y, unsigned int octaves, uint32_t seed);
+        
+#pragma mark - Filling Buffers
+        
+        ///Fills a single channel of an 8-bit pixel buffer with white noise.
+        ///
+        /// \param  pixels          The buffer to fill. Required.
+        /// \param  width           The width of the buffer in pixels.
+        /// \param  height          The height of the buffer in pixels.
+        /// \param  bytesPerRow     The number of bytes between the start of each row.
+        /// \param  bytesPerPixel   The number of bytes between each pixel of a row.
+        /// \param  channel         The offset of the channel to fill within each pixel.
+        /// \param  maximum         The largest value to write. Values are uniform in [0, maximum].
+        /// \param  seed            The seed of the noise.
+        ///
+        ///Rows are filled in parallel. The output only depends on the seed.
+        extern void fillWhite(uint8_t *pixels, size_t width, size_t height, size_t bytesPerRow,
+                              size_t bytesPerPixel, size_t channel, uint8_t maximum, uint32_t seed);
+        
+        ///Fills an 8-bit single channel pixel buffer with coherent noise.
+        ///
+        /// \param  pixels      The buffer to fill. Required.
+        /// \param  width       The width of the buffer in pixels.
+        /// \param  height      The height of the buffer in pixels.
+        /// \param  bytesPerRow The number of bytes between the start of each row.
+        /// \param  basis       The kind of noise to fill with.
+        /// \param  scale       The approximate size of features of the noise in pixels. Must be positive.
+        /// \param  octaves     The number of octaves of fractal Brownian motion. See `gfx::noise::fractal`.
+        /// \param  seed        The seed of the noise.
+        ///
+        ///Rows are filled in parallel. The output only depends on the parameters.
+        extern void fillCoherent(uint8_t *pixels, size_t width, size_t height, size_t bytesPerRow,
+                                 Basis basis, double scale, unsigned int octaves, uint32_t seed);
+    }
+}
+
+#endif /* defined(__gfx__noise__) */
@@ -40,6 +40,6 @@ namespace gfx {
     
     const String *Null::description() const
     {
-        return str("null");
+        return gfx_str("null");
     }
 }
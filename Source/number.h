@@ -11,6 +11,7 @@
 
 #include "base.h"
 #include "str.h"
+#include "numberformat.h"
 
 namespace gfx {
     ///The Number class encapsulates a simple `double` in an
@@ -90,11 +91,12 @@ namespace gfx {
             return false;
         }
         
+        ///Returns the shortest representation of the number that round trips.
         const String *description() const override
         {
-            String::Builder description;
-            description << this->value();
-            return description;
+            char buffer[numberformat::kFormatBufferSize];
+            numberformat::formatDouble(this->value(), buffer);
+            return make<String>(buffer);
         }
         
 #pragma mark - Accessing
@@ -0,0 +1,232 @@
+//
+//  numberformat.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/2/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#include "numberformat.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace gfx {
+    namespace numberformat {
+        ///The powers of ten which are exactly representable as doubles.
+        static const double kExactPowersOfTen[] = {
+            1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+            1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+            1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+        };
+        
+        ///The largest integer such that it and every integer below it are exactly representable as doubles.
+        static const uint64_t kMaximumExactInteger = (1ULL << 53);
+        
+        ///The largest number of decimal digits that always fit in a `uint64_t`.
+        static const int kMaximumMantissaDigits = 19;
+        
+#pragma mark - Formatting
+        
+        ///Writes a given literal into a buffer, returning its length.
+        static size_t write_literal(const char *literal, char *buffer)
+        {
+            size_t length = strlen(literal);
+            memcpy(buffer, literal, length + 1);
+            return length;
+        }
+        
+        ///Writes the digits of a given non-zero integer into a buffer, returning their length.
+        static size_t write_integer(int64_t value, char *buffer)
+        {
+            char digits[kFormatBufferSize];
+            size_t numberOfDigits = 0;
+            
+            uint64_t magnitude = (value < 0)? uint64_t(-value) : uint64_t(value);
+            while (magnitude > 0) {
+                digits[numberOfDigits++] = char('0' + (magnitude % 10));
+                magnitude /= 10;
+            }
+            
+            size_t length = 0;
+            if(value < 0)
+                buffer[length++] = '-';
+            
+            while (numberOfDigits > 0)
+                buffer[length++] = digits[--numberOfDigits];
+            
+            buffer[length] = '\0';
+            return length;
+        }
+        
+        size_t formatDouble(double value, char *buffer)
+        {
+            if(std::isnan(value))
+                return write_literal("nan", buffer);
+            
+            if(std::isinf(value))
+                return write_literal((value < 0.0)? "-inf" : "inf", buffer);
+            
+            if(value == 0.0)
+                return write_literal(std::signbit(value)? "-0" : "0", buffer);
+            
+            //The overwhelming majority of numbers seen by the interpreter
+            //are integers, so they get a path which never touches printf.
+            if(std::fabs(value) < 1e15 && value == std::trunc(value))
+                return write_integer(int64_t(value), buffer);
+            
+            //Every decimal with 15 or fewer significant digits survives a
+            //round trip through a normal double, so `%.15g` is the shortest form
+            //whenever it round trips. Otherwise 16 or 17 digits are needed.
+            int length = 0;
+            for (int precision = 15; precision <= 17; precision++) {
+                length = snprintf(buffer, kFormatBufferSize, "%.*g", precision, value);
+                if(strtod(buffer, nullptr) == value)
+                    break;
+            }
+            
+            return size_t(length);
+        }
+        
+#pragma mark - Parsing
+        
+        ///Parses a number by way of `strtod`, skipping any digit group separators.
+        ///
+        ///The characters must have been validated as a number, and so are all ASCII.
+        template<typename Character>
+        static double slow_parse_double(const Character *characters, size_t length)
+        {
+            std::string cleanedCharacters;
+            cleanedCharacters.reserve(length);
+            for (size_t index = 0; index < length; index++) {
+                if(characters[index] != '_')
+                    cleanedCharacters.push_back(char(characters[index]));
+            }
+            
+            return strtod(cleanedCharacters.c_str(), nullptr);
+        }
+        
+        ///Parses a double from a buffer of ASCII characters or UTF-16 code units.
+        template<typename Character>
+        static double parse_double(const Character *characters, size_t length, size_t *outConsumed)
+        {
+            size_t index = 0;
+            
+            bool isNegative = false;
+            if(index < length && (characters[index] == '-' || characters[index] == '+')) {
+                isNegative = (characters[index] == '-');
+                index++;
+            }
+            
+            uint64_t mantissa = 0;
+            int mantissaDigits = 0;
+            int exponent = 0;
+            bool sawDigits = false;
+            bool isTruncated = false;
+            
+            for (; index < length; index++) {
+                Character c = characters[index];
+                if(c == '_')
+                    continue;
+                
+                if(c < '0' || c > '9')
+                    break;
+                
+                sawDigits = true;
+                if(mantissaDigits < kMaximumMantissaDigits) {
+                    mantissa = (mantissa * 10) + (c - '0');
+                    if(mantissa != 0)
+                        mantissaDigits++;
+                } else {
+                    exponent++;
+                    isTruncated = isTruncated || (c != '0');
+                }
+            }
+            
+            if(index < length && characters[index] == '.') {
+                index++;
+                
+                for (; index < length; index++) {
+                    Character c = characters[index];
+                    if(c == '_')
+                        continue;
+                    
+                    if(c < '0' || c > '9')
+                        break;
+                    
+                    sawDigits = true;
+                    if(mantissaDigits < kMaximumMantissaDigits) {
+                        mantissa = (mantissa * 10) + (c - '0');
+                        if(mantissa != 0)
+                            mantissaDigits++;
+                        
+                        exponent--;
+                    } else {
+                        isTruncated = isTruncated || (c != '0');
+                    }
+                }
+            }
+            
+            if(!sawDigits) {
+                if(outConsumed)
+                    *outConsumed = 0;
+                
+                return 0.0;
+            }
+            
+            if(index < length && (characters[index] == 'e' || characters[index] == 'E')) {
+                size_t exponentStart = index;
+                index++;
+                
+                bool isExponentNegative = false;
+                if(index < length && (characters[index] == '-' || characters[index] == '+')) {
+                    isExponentNegative = (characters[index] == '-');
+                    index++;
+                }
+                
+                int explicitExponent = 0;
+                bool sawExponentDigits = false;
+                for (; index < length && characters[index] >= '0' && characters[index] <= '9'; index++) {
+                    sawExponentDigits = true;
+                    if(explicitExponent < 100000)
+                        explicitExponent = (explicitExponent * 10) + (characters[index] - '0');
+                }
+                
+                if(sawExponentDigits)
+                    exponent += isExponentNegative? -explicitExponent : explicitExponent;
+                else
+                    index = exponentStart;
+            }
+            
+            if(outConsumed)
+                *outConsumed = index;
+            
+            //When both the mantissa and the power of ten are exact, a single
+            //multiplication or division is correctly rounded (Clinger's fast path).
+            if(!isTruncated && mantissa <= kMaximumExactInteger && exponent >= -22 && exponent <= 22) {
+                double result = double(mantissa);
+                if(exponent < 0)
+                    result /= kExactPowersOfTen[-exponent];
+                else
+                    result *= kExactPowersOfTen[exponent];
+                
+                return isNegative? -result : result;
+            }
+            
+            return slow_parse_double(characters, index);
+        }
+        
+        double parseDouble(const char *characters, size_t length, size_t *outConsumed)
+        {
+            return parse_double(characters, length, outConsumed);
+        }
+        
+        double parseDouble(const uint16_t *begin, const uint16_t *end, size_t *outConsumed)
+        {
+            return parse_double(begin, size_t(end - begin), outConsumed);
+        }
+    }
+}
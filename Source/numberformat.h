@@ -0,0 +1,64 @@
+//
+//  numberformat.h
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/2/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef __gfx__numberformat__
+#define __gfx__numberformat__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gfx {
+    
+    ///The numberformat namespace contains functions for converting
+    ///between double values and their textual representations
+    ///without going through CFString or the current locale.
+    namespace numberformat {
+        enum {
+            ///The size of a buffer large enough to hold any formatted double, including its terminator.
+            kFormatBufferSize = 32,
+        };
+        
+        ///Formats a double into the shortest representation that parses back into the same value.
+        ///
+        /// \param  value   The value to format.
+        /// \param  buffer  A buffer of at least `kFormatBufferSize` bytes. Required.
+        ///
+        /// \result The number of characters written into buffer, not including the terminator.
+        ///
+        ///Integral values are written without a fractional part, e.g. `42`.
+        ///Very large and very small values are written in exponent form, e.g. `1e+21`.
+        extern size_t formatDouble(double value, char *buffer);
+        
+        ///Parses a double from a buffer of ASCII characters.
+        ///
+        /// \param  characters  The characters to parse. Required.
+        /// \param  length      The number of characters in the buffer.
+        /// \param  outConsumed On return, the number of characters that made up the number. Optional.
+        ///
+        /// \result The parsed value, or 0.0 if the buffer does not begin with a number.
+        ///
+        ///The accepted format is `[+-]digits[.digits][(e|E)[+-]digits]`. Underscores
+        ///may be used as digit group separators, e.g. `1_000_000`. Parsing stops at
+        ///the first character which does not fit the format.
+        extern double parseDouble(const char *characters, size_t length, size_t *outConsumed = nullptr);
+        
+        ///Parses a double from a range of UTF-16 code units, such as the `UniChar`s of a string.
+        ///
+        /// \param  begin       The first code unit to parse. Required.
+        /// \param  end         The code unit after the last one to parse. Required.
+        /// \param  outConsumed On return, the number of code units that made up the number. Optional.
+        ///
+        /// \result The parsed value, or 0.0 if the range does not begin with a number.
+        ///
+        ///Accepts the same format as the character buffer variant. This allows parsers to
+        ///read numbers in place from the characters of their source.
+        extern double parseDouble(const uint16_t *begin, const uint16_t *end, size_t *outConsumed = nullptr);
+    }
+}
+
+#endif /* defined(__gfx__numberformat__) */
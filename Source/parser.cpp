@@ -11,6 +11,8 @@
 #include "word.h"
 #include "number.h"
 #include "annotation.h"
+#include "numberformat.h"
+#include <string>
 
 #include "papertape.h"
 
@@ -93,10 +95,12 @@ namespace gfx {
     Parser::Parser(const String *string) :
         Base(),
         mString(retained(string)),
+        mCharacters(string->length()),
         mCurrentIndex(0),
         mOffset{0, 0}
     {
-        
+        if(!mCharacters.empty())
+            mString->getCharacters(Range(0, mString->length()), mCharacters.data());
     }
     
     Parser::~Parser()
@@ -138,8 +142,8 @@ namespace gfx {
     UniChar Parser::peek(Index delta)
     {
         Index offset = mCurrentIndex + delta;
-        if(offset >= 0 && offset < mString->length())
-            return mString->at(offset);
+        if(offset >= 0 && offset < Index(mCharacters.size()))
+            return mCharacters[offset];
         else
             return 0;
     }
@@ -266,8 +270,14 @@ namespace gfx {
     
     Number *Parser::parseNumber()
     {
-        auto numberString = this->accumulateWhile(&is_number);
-        auto number = make<Number>(numberString->doubleValue());
+        Index start = mCurrentIndex;
+        bool isFirstCharacter = true;
+        while (this->more() && is_number(this->current(), isFirstCharacter)) {
+            isFirstCharacter = false;
+            this->next();
+        }
+        
+        auto number = make<Number>(numberformat::parseDouble(mCharacters.data() + start, mCharacters.data() + mCurrentIndex));
         if(this->current() == kPercentageMarker) {
             number = make<Number>(number->value() / 100.0);
             this->next();
@@ -14,6 +14,7 @@
 #include "exception.h"
 #include "offset.h"
 #include "expression.h"
+#include <vector>
 
 namespace gfx {
     class String;
@@ -35,6 +36,9 @@ namespace gfx {
         ///The string being parsed.
         const String *mString;
         
+        ///The characters of the string, so that tokens can be read in place.
+        std::vector<UniChar> mCharacters;
+        
         ///The index within the string the parser is currently operating on.
         Index mCurrentIndex;
         
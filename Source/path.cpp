@@ -14,37 +14,177 @@
 
 #include "stackframe.h"
 #include "graphics.h"
+#include "interpreter.h"
 #include "number.h"
+#include "typedarray.h"
+#include "lrucache.h"
+
+#include <cmath>
+#include <functional>
+#include <mutex>
 
 namespace gfx {
     
+#pragma mark - Hash-Consing
+    
+    ///The shapes constructed by the `Path::with*` functions.
+    enum class ConstructedShape {
+        Rect,
+        RoundedRect,
+        Oval,
+        Triangle,
+    };
+    
+    ///The parameters a path was constructed from by one of the `Path::with*` functions.
+    struct ConstructedPathKey
+    {
+        ConstructedShape shape;
+        Rect rect;
+        Float parameter1;
+        Float parameter2;
+        Transform2D transform;
+        
+        bool operator==(const ConstructedPathKey &other) const
+        {
+            return (shape == other.shape &&
+                    rect.origin.x == other.rect.origin.x && rect.origin.y == other.rect.origin.y &&
+                    rect.size.width == other.rect.size.width && rect.size.height == other.rect.size.height &&
+                    parameter1 == other.parameter1 && parameter2 == other.parameter2 &&
+                    transform == other.transform);
+        }
+        
+        ///Returns whether or not every parameter is finite. NaN parameters never
+        ///compare equal to themselves, so keys with them can't be found again.
+        bool isCacheable() const
+        {
+            for (Float value : { rect.origin.x, rect.origin.y, rect.size.width, rect.size.height,
+                                 parameter1, parameter2,
+                                 transform.a, transform.b, transform.c, transform.d, transform.tx, transform.ty }) {
+                if(!std::isfinite(value))
+                    return false;
+            }
+            
+            return true;
+        }
+    };
+    
+    ///Hashes the parameters of a constructed path.
+    struct ConstructedPathKeyHash
+    {
+        size_t operator()(const ConstructedPathKey &key) const
+        {
+            std::hash<Float> hashFloat;
+            size_t hash = size_t(key.shape);
+            for (Float value : { key.rect.origin.x, key.rect.origin.y, key.rect.size.width, key.rect.size.height,
+                                 key.parameter1, key.parameter2,
+                                 key.transform.a, key.transform.b, key.transform.c, key.transform.d, key.transform.tx, key.transform.ty })
+                hash = hash * 31 + hashFloat(value);
+            
+            return hash;
+        }
+    };
+    
+    ///The ConstructedPathCache class keeps the paths most recently built by the `Path::with*`
+    ///functions, so that a redraw which builds the same shapes again can copy them instead.
+    ///
+    ///The cached paths are never handed out directly, as paths are mutable. Copies of a path
+    ///share the geometry memoized for it, which is most of the cost of drawing a new path.
+    class ConstructedPathCache
+    {
+        ///The cached paths by the parameters they were constructed from.
+        LRUCache<ConstructedPathKey, Scoped<Path>, ConstructedPathKeyHash> mPaths;
+        
+    public:
+        
+        ///The largest number of paths kept by the cache.
+        static const size_t kMaximumCount = 256;
+        
+        ConstructedPathCache() :
+            mPaths(kMaximumCount)
+        {
+        }
+        
+        ///Returns the shared constructed path cache.
+        static ConstructedPathCache *shared()
+        {
+            static ConstructedPathCache *sharedCache = new ConstructedPathCache();
+            return sharedCache;
+        }
+        
+        ///Returns a new autoreleased copy of the path constructed from given parameters.
+        ///
+        /// \param  key         The parameters of the path.
+        /// \param  construct   Invoked to build the path if it is not in the cache.
+        ///
+        ///Paths with parameters that are not finite are built every time, and never cached.
+        Path *copyOf(const ConstructedPathKey &key, const std::function<Path *()> &construct)
+        {
+            if(!key.isCacheable())
+                return construct();
+            
+            Scoped<Path> path = mPaths.valueFor(key, [&construct] { return Scoped<Path>(construct()); });
+            return make<Path>(path);
+        }
+    };
+    
+#pragma mark - Creating Paths
+    
     Path *Path::withRect(Rect rect)
     {
-        CGPathRef ovalPath = CGPathCreateWithRect(rect, NULL);
-        Path *path = make<Path>(ovalPath);
-        CFRelease(ovalPath);
-        return path;
+        ConstructedPathKey key{ ConstructedShape::Rect, rect, 0.0, 0.0, Transform2D::Identity };
+        return ConstructedPathCache::shared()->copyOf(key, [rect]() {
+#if GFX_Graphics_Use_Raster
+            Path *path = make<Path>();
+            path->get()->addRect(rect, Transform2D::Identity);
+            return path;
+#else
+            CGPathRef ovalPath = CGPathCreateWithRect(rect, NULL);
+            Path *path = make<Path>(ovalPath);
+            CFRelease(ovalPath);
+            return path;
+#endif /* GFX_Graphics_Use_Raster */
+        });
     }
     
     Path *Path::withRoundedRect(Rect rect, Float cornerWidth, Float cornerHeight)
     {
-        CGPathRef ovalPath = CGPathCreateWithRoundedRect(rect, cornerWidth, cornerHeight, NULL);
-        Path *path = make<Path>(ovalPath);
-        CFRelease(ovalPath);
-        return path;
+        ConstructedPathKey key{ ConstructedShape::RoundedRect, rect, cornerWidth, cornerHeight, Transform2D::Identity };
+        return ConstructedPathCache::shared()->copyOf(key, [rect, cornerWidth, cornerHeight]() {
+#if GFX_Graphics_Use_Raster
+            Path *path = make<Path>();
+            path->get()->addRoundedRect(rect, cornerWidth, cornerHeight, Transform2D::Identity);
+            return path;
+#else
+            CGPathRef ovalPath = CGPathCreateWithRoundedRect(rect, cornerWidth, cornerHeight, NULL);
+            Path *path = make<Path>(ovalPath);
+            CFRelease(ovalPath);
+            return path;
+#endif /* GFX_Graphics_Use_Raster */
+        });
     }
     
     Path *Path::withOval(Rect rect)
     {
-        CGAffineTransform transform = Context::currentContext()->currentTransformationMatrix();
-        CGPathRef ovalPath = CGPathCreateWithEllipseInRect(rect, &transform);
-        Path *path = make<Path>(ovalPath);
-        CFRelease(ovalPath);
-        return path;
+        Transform2D transform = Context::currentContext()->currentTransformationMatrix();
+        ConstructedPathKey key{ ConstructedShape::Oval, rect, 0.0, 0.0, transform };
+        return ConstructedPathCache::shared()->copyOf(key, [rect, transform]() {
+#if GFX_Graphics_Use_Raster
+            Path *path = make<Path>();
+            path->get()->addEllipse(rect, transform);
+            return path;
+#else
+            CGPathRef ovalPath = CGPathCreateWithEllipseInRect(rect, &transform);
+            Path *path = make<Path>(ovalPath);
+            CFRelease(ovalPath);
+            return path;
+#endif /* GFX_Graphics_Use_Raster */
+        });
     }
     
-    Path *Path::withTriangle(Rect rect, TriangleDirection direction)
+    ///Builds a path in the shape of a triangle pointing in a given direction.
+    static Path *MakeTriangle(Rect rect, Path::TriangleDirection direction)
     {
+        typedef Path::TriangleDirection TriangleDirection;
         Path *emptyPath = make<Path>();
         
         switch (direction) {
@@ -90,11 +230,29 @@ namespace gfx {
         return emptyPath;
     }
     
+    Path *Path::withTriangle(Rect rect, TriangleDirection direction)
+    {
+        ConstructedPathKey key{ ConstructedShape::Triangle, rect, Float(direction), 0.0, Transform2D::Identity };
+        return ConstructedPathCache::shared()->copyOf(key, [rect, direction]() {
+            return MakeTriangle(rect, direction);
+        });
+    }
+    
 #pragma mark - Lifecycle
     
     Path::Path() :
         Base(),
+#if GFX_Graphics_Use_Raster
+        mPath(new raster::Path()),
+#else
         mPath(CGPathCreateMutable()),
+#endif /* GFX_Graphics_Use_Raster */
+#if !GFX_Graphics_Use_Raster
+        mBoundsMutex(),
+        mHasBounds(false),
+        mBoundingBox(),
+        mPathBoundingBox(),
+#endif /* !GFX_Graphics_Use_Raster */
         mTransform(Transform2D::Identity),
         mLineCapStyle(LineCap::Butt),
         mLineJoinStyle(LineJoin::Miter),
@@ -105,7 +263,17 @@ namespace gfx {
     
     Path::Path(ConstNativeType path) :
         Base(),
+#if GFX_Graphics_Use_Raster
+        mPath(new raster::Path(*path)),
+#else
         mPath(CGPathCreateMutableCopy(path)),
+#endif /* GFX_Graphics_Use_Raster */
+#if !GFX_Graphics_Use_Raster
+        mBoundsMutex(),
+        mHasBounds(false),
+        mBoundingBox(),
+        mPathBoundingBox(),
+#endif /* !GFX_Graphics_Use_Raster */
         mTransform(Transform2D::Identity),
         mLineCapStyle(LineCap::Butt),
         mLineJoinStyle(LineJoin::Miter),
@@ -116,13 +284,27 @@ namespace gfx {
     Path::Path(const Path *path) :
         Path(path->get())
     {
+        mTransform = path->mTransform;
+        mLineCapStyle = path->mLineCapStyle;
+        mLineJoinStyle = path->mLineJoinStyle;
+        mLineWidth = path->mLineWidth;
         
+#if !GFX_Graphics_Use_Raster
+        std::lock_guard<std::mutex> lock(path->mBoundsMutex);
+        mHasBounds = path->mHasBounds;
+        mBoundingBox = path->mBoundingBox;
+        mPathBoundingBox = path->mPathBoundingBox;
+#endif /* !GFX_Graphics_Use_Raster */
     }
     
     Path::~Path()
     {
         if(mPath) {
+#if GFX_Graphics_Use_Raster
+            delete mPath;
+#else
             CFRelease(mPath);
+#endif /* GFX_Graphics_Use_Raster */
             mPath = NULL;
         }
     }
@@ -134,7 +316,11 @@ namespace gfx {
         if(!other)
             return false;
         
+#if GFX_Graphics_Use_Raster
+        return (*get() == *other->get());
+#else
         return CFEqual(get(), other->get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     bool Path::isEqual(const Base *other) const
@@ -150,13 +336,21 @@ namespace gfx {
     
     HashCode Path::hash() const
     {
+#if GFX_Graphics_Use_Raster
+        return get()->hash();
+#else
         return CFHash(get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark -
     
     Path::NativeType Path::get()
     {
+#if !GFX_Graphics_Use_Raster
+        //The native path may be changed by the caller, so the memoized bounds can no longer be trusted.
+        mHasBounds = false;
+#endif /* !GFX_Graphics_Use_Raster */
         return mPath;
     }
     
@@ -169,84 +363,217 @@ namespace gfx {
     
     void Path::moveToPoint(Point point)
     {
+#if GFX_Graphics_Use_Raster
+        get()->moveTo(point, mTransform);
+#else
         CGPathMoveToPoint(get(), &mTransform, point.x, point.y);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     void Path::lineToPoint(Point point)
     {
+#if GFX_Graphics_Use_Raster
+        get()->lineTo(point, mTransform);
+#else
         CGPathAddLineToPoint(get(), &mTransform, point.x, point.y);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     void Path::closePath()
     {
+#if GFX_Graphics_Use_Raster
+        get()->close();
+#else
         CGPathCloseSubpath(get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     void Path::addPath(const Path *otherPath)
     {
+#if GFX_Graphics_Use_Raster
+        gfx_assert_param(otherPath);
+        
+        this->get()->addPath(*otherPath->get(), otherPath->mTransform);
+#else
         gfx_assert_param(otherPath);
         
         CGPathAddPath(this->get(), &otherPath->mTransform, otherPath->get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     void Path::arcToPoint(Point point1, Point point2, Float radius)
     {
+#if GFX_Graphics_Use_Raster
+        get()->addArcToPoint(point1, point2, radius, mTransform);
+#else
         CGPathAddArcToPoint(get(), &mTransform, point1.x, point1.y, point2.x, point2.y, radius);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     void Path::curveToPoint(Point point, Point controlPoint1, Point controlPoint2)
     {
+#if GFX_Graphics_Use_Raster
+        get()->cubicTo(controlPoint1, controlPoint2, point, mTransform);
+#else
         CGPathAddCurveToPoint(get(), &mTransform, controlPoint1.x, controlPoint1.y, controlPoint2.x, controlPoint2.y, point.x, point.y);
+#endif /* GFX_Graphics_Use_Raster */
+    }
+    
+    void Path::addLines(const Point *points, Index count)
+    {
+        gfx_assert(points != nullptr || count == 0, str("points are required to add lines"));
+        
+#if GFX_Graphics_Use_Raster
+        get()->addLines(points, count, mTransform);
+#else
+        CGPathAddLines(get(), &mTransform, points, count);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark - Getting Information about Paths
     
+#if !GFX_Graphics_Use_Raster
+    void Path::memoizeBounds() const
+    {
+        if(mHasBounds)
+            return;
+        
+        mBoundingBox = CGPathGetBoundingBox(get());
+        mPathBoundingBox = CGPathGetBoundingBox(get());
+        mHasBounds = true;
+    }
+#endif /* !GFX_Graphics_Use_Raster */
+    
     Rect Path::boundingBox() const
     {
-        return CGPathGetBoundingBox(get());
+#if GFX_Graphics_Use_Raster
+        return get()->boundingBox();
+#else
+        std::lock_guard<std::mutex> lock(mBoundsMutex);
+        memoizeBounds();
+        return mBoundingBox;
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     Rect Path::pathBoundingBox() const
     {
-        return CGPathGetBoundingBox(get());
+#if GFX_Graphics_Use_Raster
+        return get()->pathBoundingBox();
+#else
+        std::lock_guard<std::mutex> lock(mBoundsMutex);
+        memoizeBounds();
+        return mPathBoundingBox;
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     Point Path::currentPoint() const
     {
+#if GFX_Graphics_Use_Raster
+        return get()->currentPoint();
+#else
         return CGPathGetCurrentPoint(get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark -
     
     bool Path::isEmpty() const
     {
+#if GFX_Graphics_Use_Raster
+        return get()->isEmpty();
+#else
         return CGPathIsEmpty(get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     bool Path::isRectangle(Rect *outRect) const
     {
+#if GFX_Graphics_Use_Raster
+        return get()->isRect(outRect);
+#else
         return CGPathIsRect(get(), outRect);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     bool Path::containsPoint(Point point) const
     {
+#if GFX_Graphics_Use_Raster
+        return get()->containsPoint(point, raster::FillRule::NonZero, mTransform);
+#else
         return CGPathContainsPoint(get(), &mTransform, point, false);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark - Drawing
     
+    ///The miter limit used when stroking paths. Matches the default of both backends.
+    static const Float kStrokeMiterLimit = 10.0;
+    
+    ///Returns the bounding box of the area a path covers when stroked.
+    ///
+    ///The bounding box of the path is inflated by half of its line width,
+    ///scaled up by the miter limit for miter joins, whose corners may
+    ///extend further out than the line width alone.
+    static Rect StrokeBoundingBox(const Path *path)
+    {
+        Float outset = path->lineWidth() / 2.0;
+        if(path->lineJoinStyle() == Path::LineJoin::Miter)
+            outset *= kStrokeMiterLimit;
+        
+        Rect bounds = path->boundingBox();
+        return Rect{Point{bounds.origin.x - outset, bounds.origin.y - outset},
+                    Size{bounds.size.width + outset * 2.0, bounds.size.height + outset * 2.0}};
+    }
+    
+#if GFX_Graphics_Use_Raster
+    ///Applies the line attributes of a path to a canvas.
+    static void ApplyLineAttributes(raster::Canvas *canvas, const Path *path)
+    {
+        canvas->setLineCap(raster::LineCap(path->lineCapStyle()));
+        canvas->setLineJoin(raster::LineJoin(path->lineJoinStyle()));
+        canvas->setLineWidth(path->lineWidth());
+    }
+#endif /* GFX_Graphics_Use_Raster */
+    
     void Path::set() const
     {
+        if(Context::currentContext()->recordingDisplayList()) {
+            Scoped<Path> path = make<Path>(this);
+            Context::currentContext()->recordOperation([path](Context *context) { path->set(); });
+        }
+
+#if GFX_Graphics_Use_Raster
+        Context *context = Context::currentContext();
+        ApplyLineAttributes(context->get(), this);
+        context->get()->clipToPath(*this->get(), raster::FillRule::NonZero);
+#else
         Context *context = Context::currentContext();
         CGContextAddPath(context->get(), this->get());
         CGContextSetLineCap(context->get(), (CGLineCap)lineCapStyle());
         CGContextSetLineJoin(context->get(), (CGLineJoin)lineJoinStyle());
         CGContextSetLineWidth(context->get(), lineWidth());
         CGContextClip(context->get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     void Path::fill() const
     {
+        if(Context::currentContext()->recordingDisplayList()) {
+            Scoped<Path> path = make<Path>(this);
+            Context::currentContext()->recordOperation([path](Context *context) { path->fill(); });
+            return;
+        }
+        
+        if(Context::currentContext()->quickReject(boundingBox()))
+            return;
+
+#if GFX_Graphics_Use_Raster
+        Context *context = Context::currentContext();
+        context->transaction([this](Context *context) {
+            ApplyLineAttributes(context->get(), this);
+            context->get()->fillPath(*get(), raster::FillRule::NonZero);
+        });
+#else
         Context *context = Context::currentContext();
         context->transaction([this](Context *context) {
             CGContextAddPath(context->get(), get());
@@ -255,10 +582,27 @@ namespace gfx {
             CGContextSetLineWidth(context->get(), lineWidth());
             CGContextFillPath(context->get());
         });
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     void Path::stroke() const
     {
+        if(Context::currentContext()->recordingDisplayList()) {
+            Scoped<Path> path = make<Path>(this);
+            Context::currentContext()->recordOperation([path](Context *context) { path->stroke(); });
+            return;
+        }
+        
+        if(Context::currentContext()->quickReject(StrokeBoundingBox(this)))
+            return;
+
+#if GFX_Graphics_Use_Raster
+        Context *context = Context::currentContext();
+        context->transaction([this](Context *context) {
+            ApplyLineAttributes(context->get(), this);
+            context->get()->strokePath(*get());
+        });
+#else
         Context *context = Context::currentContext();
         context->transaction([this](Context *context) {
             CGContextAddPath(context->get(), get());
@@ -267,27 +611,139 @@ namespace gfx {
             CGContextSetLineWidth(context->get(), lineWidth());
             CGContextStrokePath(context->get());
         });
+#endif /* GFX_Graphics_Use_Raster */
+    }
+    
+#pragma mark -
+    
+    ///Returns the transforms of the instances of a path that are not quickly rejected by the current context.
+    static std::vector<Transform2D> VisibleInstanceTransforms(Rect bounds, const std::vector<Transform2D> &transforms)
+    {
+        Context *context = Context::currentContext();
+        std::vector<Transform2D> visibleTransforms;
+        visibleTransforms.reserve(transforms.size());
+        for (const Transform2D &transform : transforms) {
+            if(!context->quickReject(transform.transformRect(bounds)))
+                visibleTransforms.push_back(transform);
+        }
+        
+        return visibleTransforms;
+    }
+    
+    void Path::fillInstances(const std::vector<Transform2D> &transforms) const
+    {
+        if(Context::currentContext()->recordingDisplayList()) {
+            Scoped<Path> path = make<Path>(this);
+            Context::currentContext()->recordOperation([path, transforms](Context *context) { path->fillInstances(transforms); });
+            return;
+        }
+        
+        auto visibleTransforms = VisibleInstanceTransforms(boundingBox(), transforms);
+        if(visibleTransforms.empty())
+            return;
+        
+#if GFX_Graphics_Use_Raster
+        Context *context = Context::currentContext();
+        context->transaction([this, &visibleTransforms](Context *context) {
+            ApplyLineAttributes(context->get(), this);
+            context->get()->fillPathInstances(*get(), raster::FillRule::NonZero, visibleTransforms.data(), visibleTransforms.size());
+        });
+#else
+        Context *context = Context::currentContext();
+        context->transaction([this, &visibleTransforms](Context *context) {
+            for (const Transform2D &transform : visibleTransforms) {
+                CGContextSaveGState(context->get());
+                CGContextConcatCTM(context->get(), transform);
+                CGContextAddPath(context->get(), get());
+                CGContextFillPath(context->get());
+                CGContextRestoreGState(context->get());
+            }
+        });
+#endif /* GFX_Graphics_Use_Raster */
+    }
+    
+    void Path::strokeInstances(const std::vector<Transform2D> &transforms) const
+    {
+        if(Context::currentContext()->recordingDisplayList()) {
+            Scoped<Path> path = make<Path>(this);
+            Context::currentContext()->recordOperation([path, transforms](Context *context) { path->strokeInstances(transforms); });
+            return;
+        }
+        
+        auto visibleTransforms = VisibleInstanceTransforms(StrokeBoundingBox(this), transforms);
+        if(visibleTransforms.empty())
+            return;
+        
+#if GFX_Graphics_Use_Raster
+        Context *context = Context::currentContext();
+        context->transaction([this, &visibleTransforms](Context *context) {
+            ApplyLineAttributes(context->get(), this);
+            context->get()->strokePathInstances(*get(), visibleTransforms.data(), visibleTransforms.size());
+        });
+#else
+        Context *context = Context::currentContext();
+        context->transaction([this, &visibleTransforms](Context *context) {
+            CGContextSetLineCap(context->get(), (CGLineCap)lineCapStyle());
+            CGContextSetLineJoin(context->get(), (CGLineJoin)lineJoinStyle());
+            CGContextSetLineWidth(context->get(), lineWidth());
+            for (const Transform2D &transform : visibleTransforms) {
+                CGContextSaveGState(context->get());
+                CGContextConcatCTM(context->get(), transform);
+                CGContextAddPath(context->get(), get());
+                CGContextStrokePath(context->get());
+                CGContextRestoreGState(context->get());
+            }
+        });
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark -
     
     void Path::fillRect(Rect rect)
     {
+        if(Context::currentContext()->recordOperation([rect](Context *context) { Path::fillRect(rect); }))
+            return;
+        
+        if(Context::currentContext()->quickReject(rect))
+            return;
+
+#if GFX_Graphics_Use_Raster
+        Context *context = Context::currentContext();
+        context->get()->fillRect(rect);
+#else
         Context *context = Context::currentContext();
         CGContextFillRect(context->get(), rect);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     void Path::strokeRect(Rect rect)
     {
+        if(Context::currentContext()->recordOperation([rect](Context *context) { Path::strokeRect(rect); }))
+            return;
+
+#if GFX_Graphics_Use_Raster
+        Context *context = Context::currentContext();
+        context->get()->strokeRect(rect);
+#else
         Context *context = Context::currentContext();
         CGContextStrokeRect(context->get(), rect);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     void Path::strokeLine(Point point1, Point point2)
     {
+        if(Context::currentContext()->recordOperation([point1, point2](Context *context) { Path::strokeLine(point1, point2); }))
+            return;
+
+#if GFX_Graphics_Use_Raster
+        Context *context = Context::currentContext();
+        Point points[] = { point1, point2 };
+        context->get()->strokeLineSegments(points, 2);
+#else
         Context *context = Context::currentContext();
         Point points[] = { point1, point2 };
         CGContextStrokeLineSegments(context->get(), points, 2);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark - Path Attributes
@@ -304,7 +760,15 @@ namespace gfx {
     
     void Path::setDefaultLineCapStyle(LineCap capStyle)
     {
+        Context::currentContext()->recordOperation([capStyle](Context *context) {
+            Path::setDefaultLineCapStyle(capStyle);
+        });
+
+#if GFX_Graphics_Use_Raster
+        Context::currentContext()->get()->setLineCap(raster::LineCap(capStyle));
+#else
         CGContextSetLineCap(Context::currentContext()->get(), (CGLineCap)capStyle);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark -
@@ -321,7 +785,15 @@ namespace gfx {
     
     void Path::setDefaultLineJoinStyle(LineJoin joinStyle)
     {
+        Context::currentContext()->recordOperation([joinStyle](Context *context) {
+            Path::setDefaultLineJoinStyle(joinStyle);
+        });
+
+#if GFX_Graphics_Use_Raster
+        Context::currentContext()->get()->setLineJoin(raster::LineJoin(joinStyle));
+#else
         CGContextSetLineJoin(Context::currentContext()->get(), (CGLineJoin)joinStyle);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark -
@@ -338,7 +810,15 @@ namespace gfx {
     
     void Path::setDefaultLineWidth(Float width)
     {
+        Context::currentContext()->recordOperation([width](Context *context) {
+            Path::setDefaultLineWidth(width);
+        });
+
+#if GFX_Graphics_Use_Raster
+        Context::currentContext()->get()->setLineWidth(width);
+#else
         CGContextSetLineWidth(Context::currentContext()->get(), width);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark -
@@ -465,6 +945,72 @@ namespace gfx {
         stack->push(path);
     }
     
+    ///Returns the points of a flat vector of coordinates, such as `[x1 y1 x2 y2 ...]`.
+    ///
+    /// \param  value   A vector of numbers, or a typed vector.
+    ///
+    /// \throws `gfx::Exception` if the value is not a vector of numbers or a typed
+    ///         vector, or if it does not contain an even number of values.
+    static std::vector<Point> FlatVectorToPoints(Base *value)
+    {
+        std::vector<Point> points;
+        if(value->isKindOfClass<Float64Array>()) {
+            auto array = static_cast<Float64Array *>(value);
+            gfx_assert((array->count() % 2) == 0, str("coordinate vectors must contain an even number of values"));
+            
+            const double *values = array->values();
+            points.reserve(array->count() / 2);
+            for (Index index = 0, count = array->count(); index < count; index += 2)
+                points.push_back(Point{ values[index], values[index + 1] });
+        } else if(value->isKindOfClass<Float32Array>()) {
+            auto array = static_cast<Float32Array *>(value);
+            gfx_assert((array->count() % 2) == 0, str("coordinate vectors must contain an even number of values"));
+            
+            const float *values = array->values();
+            points.reserve(array->count() / 2);
+            for (Index index = 0, count = array->count(); index < count; index += 2)
+                points.push_back(Point{ values[index], values[index + 1] });
+        } else {
+            auto array = dynamic_cast_or_throw<Array<Base> *>(value);
+            gfx_assert((array->count() % 2) == 0, str("coordinate vectors must contain an even number of values"));
+            
+            points.reserve(array->count() / 2);
+            array->iterate(array->all(), [&points](Base *element, Index index, bool *stop) {
+                Float coordinate = dynamic_cast_or_throw<Number *>(element)->value();
+                if((index % 2) == 0)
+                    points.push_back(Point{ coordinate, 0.0 });
+                else
+                    points.back().y = coordinate;
+            });
+        }
+        
+        return points;
+    }
+    
+    static void path_polyline(StackFrame *stack)
+    {
+        /* vals -- path */
+        auto points = FlatVectorToPoints(stack->pop());
+        auto path = make<Path>();
+        path->addLines(points.data(), points.size());
+        stack->push(path);
+    }
+    
+    static void path_polygon(StackFrame *stack)
+    {
+        /* vals -- path */
+        auto points = FlatVectorToPoints(stack->pop());
+        auto path = make<Path>();
+        if(points.empty()) {
+            stack->push(path);
+            return;
+        }
+        
+        path->addLines(points.data(), points.size());
+        path->closePath();
+        stack->push(path);
+    }
+    
     static void path_curve(StackFrame *stack)
     {
         auto controlPoint2 = VectorToPoint(stack->popType<Array<Base>>());
@@ -535,36 +1081,99 @@ namespace gfx {
         path->stroke();
     }
     
+#pragma mark - Instances
+    
+    ///Returns the transforms of a vector of instances.
+    ///
+    /// \param  value   A flat vector of offsets, such as `[x1 y1 x2 y2 ...]`, as a vector of numbers
+    ///                 or a typed vector. Or, a vector of point-vectors and transform-vectors, where
+    ///                 a transform-vector contains the six numbers `[a b c d tx ty]` of a 2D transform.
+    ///
+    /// \throws `gfx::Exception` if the value is not a vector of instances.
+    static std::vector<Transform2D> VectorToInstanceTransforms(Base *value)
+    {
+        std::vector<Transform2D> transforms;
+        
+        auto array = dynamic_cast<Array<Base> *>(value);
+        if(array && array->count() > 0 && array->first()->isKindOfClass<Array<Base>>()) {
+            transforms.reserve(array->count());
+            array->iterate(array->all(), [&transforms](Base *element, Index index, bool *stop) {
+                auto instance = dynamic_cast_or_throw<Array<Base> *>(element);
+                if(instance->count() == 6) {
+                    Float components[6];
+                    for (Index component = 0; component < 6; component++)
+                        components[component] = dynamic_cast_or_throw<Number *>(instance->at(component))->value();
+                    
+                    transforms.push_back(NativeAffineTransform{ components[0], components[1], components[2],
+                                                                components[3], components[4], components[5] });
+                } else {
+                    Point offset = VectorToPoint(instance);
+                    transforms.push_back(Transform2D::makeTranslation(offset.x, offset.y));
+                }
+            });
+            
+            return transforms;
+        }
+        
+        auto offsets = FlatVectorToPoints(value);
+        transforms.reserve(offsets.size());
+        for (const Point &offset : offsets)
+            transforms.push_back(Transform2D::makeTranslation(offset.x, offset.y));
+        
+        return transforms;
+    }
+    
+    static void draw_instances(StackFrame *stack)
+    {
+        /* path vals -- */
+        auto transforms = VectorToInstanceTransforms(stack->pop());
+        auto path = stack->popType<Path>();
+        path->fillInstances(transforms);
+    }
+    
+    static void draw_strokeInstances(StackFrame *stack)
+    {
+        /* path vals -- */
+        auto transforms = VectorToInstanceTransforms(stack->pop());
+        auto path = stack->popType<Path>();
+        path->strokeInstances(transforms);
+    }
+    
 #pragma mark -
     
     void Path::addTo(StackFrame *frame)
     {
         gfx_assert_param(frame);
         
-        frame->createFunctionBinding(str("fill-rect"), &fn_fill);
-        frame->createFunctionBinding(str("stroke-rect"), &fn_stroke);
-        
-        frame->createFunctionBinding(str("path/make"), &path_make);
-        frame->createFunctionBinding(str("path/rect"), &path_rect);
-        frame->createFunctionBinding(str("path/round-rect"), &path_roundRect);
-        frame->createFunctionBinding(str("path/oval"), &path_oval);
-        frame->createFunctionBinding(str("path/up-triangle"), &path_upTriangle);
-        frame->createFunctionBinding(str("path/down-triangle"), &path_downTriangle);
-        frame->createFunctionBinding(str("path/left-triangle"), &path_leftTriangle);
-        frame->createFunctionBinding(str("path/right-triangle"), &path_rightTriangle);
-        
-        frame->createFunctionBinding(str("path/move"), &path_move);
-        frame->createFunctionBinding(str("path/line"), &path_line);
-        frame->createFunctionBinding(str("path/arc"), &path_arc);
-        frame->createFunctionBinding(str("path/curve"), &path_curve);
-        
-        frame->createFunctionBinding(str("path/bounding-box"), &path_boundingBox);
-        frame->createFunctionBinding(str("path/current-point"), &path_currentPoint);
-        frame->createFunctionBinding(str("path/empty?"), &path_isEmpty);
-        frame->createFunctionBinding(str("path/contains-point"), &path_containsPoint);
-        
-        frame->createFunctionBinding(str("path/fill"), &path_fill);
-        frame->createFunctionBinding(str("path/stroke"), &path_stroke);
+        frame->createFunctionBinding(gfx_str("fill-rect"), &fn_fill);
+        frame->createFunctionBinding(gfx_str("stroke-rect"), &fn_stroke);
+        
+        frame->createFunctionBinding(gfx_str("path/make"), &path_make);
+        frame->createFunctionBinding(gfx_str("path/rect"), &path_rect);
+        frame->createFunctionBinding(gfx_str("path/round-rect"), &path_roundRect);
+        frame->createFunctionBinding(gfx_str("path/oval"), &path_oval);
+        frame->createFunctionBinding(gfx_str("path/up-triangle"), &path_upTriangle);
+        frame->createFunctionBinding(gfx_str("path/down-triangle"), &path_downTriangle);
+        frame->createFunctionBinding(gfx_str("path/left-triangle"), &path_leftTriangle);
+        frame->createFunctionBinding(gfx_str("path/right-triangle"), &path_rightTriangle);
+        
+        frame->createFunctionBinding(gfx_str("path/move"), &path_move);
+        frame->createFunctionBinding(gfx_str("path/line"), &path_line);
+        frame->createFunctionBinding(gfx_str("path/arc"), &path_arc);
+        frame->createFunctionBinding(gfx_str("path/curve"), &path_curve);
+        frame->createFunctionBinding(gfx_str("path/polyline"), &path_polyline);
+        frame->createFunctionBinding(gfx_str("path/polygon"), &path_polygon);
+        
+        frame->createFunctionBinding(gfx_str("path/bounding-box"), &path_boundingBox);
+        frame->createFunctionBinding(gfx_str("path/current-point"), &path_currentPoint);
+        frame->createFunctionBinding(gfx_str("path/empty?"), &path_isEmpty);
+        frame->createFunctionBinding(gfx_str("path/contains-point"), &path_containsPoint);
+        
+        frame->createFunctionBinding(gfx_str("path/fill"), &path_fill);
+        frame->createFunctionBinding(gfx_str("path/stroke"), &path_stroke);
+        
+        frame->createFunctionBinding(gfx_str("draw/instances"), &draw_instances);
+        frame->createFunctionBinding(gfx_str("draw/stroke-instances"), &draw_strokeInstances);
     }
 }
 
@@ -12,7 +12,14 @@
 #if GFX_Include_GraphicsStack
 
 #include "base.h"
-#include <CoreGraphics/CoreGraphics.h>
+#include <vector>
+
+#if GFX_Graphics_Use_Raster
+#   include "raster.h"
+#else
+#   include <CoreGraphics/CoreGraphics.h>
+#   include <mutex>
+#endif /* GFX_Graphics_Use_Raster */
 
 namespace gfx {
     class StackFrame;
@@ -20,18 +27,38 @@ namespace gfx {
     ///The Path class encapsulates a bézier path and the basic operations necessary to operate on it.
     ///
     ///The underlying type of the Path class is platform dependent. On iOS and OS X, it is a CGMutablePath.
+    ///With the software rasterizer, it is a `gfx::raster::Path`.
+    ///
+    ///The bounds of a path are memoized until it is changed. The paths created by the
+    ///`with*` functions are hash-consed: constructing a shape identical to a recent one
+    ///copies the earlier path, along with any geometry memoized for it, rather than
+    ///building it again. This lets redraws that rebuild the same shapes reuse their
+    ///bounds, flattened polylines and stroked outlines.
     class Path : public Base
     {
     public:
         
+#if GFX_Graphics_Use_Raster
+        ///The underlying native type used by Path.
+        typedef raster::Path *NativeType;
+        
+        ///The immutable variant of the underlying native type used by Path.
+        typedef const raster::Path *ConstNativeType;
+#else
         ///The underlying native type used by Path.
         typedef CGMutablePathRef NativeType;
         
         ///The immutable variant of the underlying native type used by Path.
         typedef CGPathRef ConstNativeType;
+#endif /* GFX_Graphics_Use_Raster */
         
         ///Junction types for stroked lines.
         enum class LineJoin {
+#if GFX_Graphics_Use_Raster
+            Miter = int(raster::LineJoin::Miter),
+            Round = int(raster::LineJoin::Round),
+            Bevel = int(raster::LineJoin::Bevel),
+#else
             ///A join with a sharp angled corner. Default.
             Miter = kCGLineJoinMiter,
             
@@ -40,15 +67,21 @@ namespace gfx {
             
             ///A join with a squared end.
             Bevel = kCGLineJoinBevel,
+#endif /* GFX_Graphics_Use_Raster */
         };
         
         ///Line cap types for stroked lines.
         enum class LineCap {
+#if GFX_Graphics_Use_Raster
+            Butt    = int(raster::LineCap::Butt),
+            Round   = int(raster::LineCap::Round),
+#else
             ///A line with a square end. Default.
             Butt    = kCGLineCapButt,
             
             ///A line with a rounded end.
             Round   = kCGLineCapRound,
+#endif /* GFX_Graphics_Use_Raster */
         };
         
         ///The different directions for the point of a triangle.
@@ -71,6 +104,23 @@ namespace gfx {
         ///The object the Path class is wrapping and operating on.
         NativeType mPath;
         
+#if !GFX_Graphics_Use_Raster
+        ///Guards the memoized bounds of the path. `CGPath` computes its bounds on every call.
+        mutable std::mutex mBoundsMutex;
+        
+        ///Whether or not `mBoundingBox` and `mPathBoundingBox` are current.
+        mutable bool mHasBounds;
+        
+        ///The memoized result of `boundingBox()`.
+        mutable Rect mBoundingBox;
+        
+        ///The memoized result of `pathBoundingBox()`.
+        mutable Rect mPathBoundingBox;
+        
+        ///Computes the bounds of the path if they are not current. `mBoundsMutex` must be held.
+        void memoizeBounds() const;
+#endif /* !GFX_Graphics_Use_Raster */
+        
         ///The transform applicable to the path.
         Transform2D mTransform;
         
@@ -196,6 +246,15 @@ namespace gfx {
         ///
         void curveToPoint(Point point, Point controlPoint1, Point controlPoint2);
         
+        ///Adds a subpath of lines through a sequence of points in a single operation.
+        ///
+        /// \param  points  The points to connect. Required if count is greater than zero.
+        /// \param  count   The number of points.
+        ///
+        ///The first point begins a new subpath. This is much faster than
+        ///moving to the first point and adding a line to each of the others.
+        void addLines(const Point *points, Index count);
+        
 #pragma mark - Getting Information about Paths
         
         ///Returns the bounding box containing all points within the path.
@@ -239,6 +298,24 @@ namespace gfx {
         ///Paints the line segments of the path in the current `gfx::Context`.
         void stroke() const;
         
+        ///Paints the area within the path once for each of a set of transforms in the current `gfx::Context`.
+        ///
+        /// \param  transforms  The transforms to paint the path with, each applied in addition to
+        ///                     the current transformation matrix of the context.
+        ///
+        ///The geometry of the path is only computed once for all of the instances, so this
+        ///is much faster than filling the path under each transform in turn. Instances that
+        ///fall outside of the clip of the context are rejected without being drawn.
+        void fillInstances(const std::vector<Transform2D> &transforms) const;
+        
+        ///Paints the line segments of the path once for each of a set of transforms in the current `gfx::Context`.
+        ///
+        /// \param  transforms  The transforms to paint the path with, each applied in addition to
+        ///                     the current transformation matrix of the context.
+        ///
+        /// \seealso(gfx::Path::fillInstances)
+        void strokeInstances(const std::vector<Transform2D> &transforms) const;
+        
 #pragma mark -
         
         ///Fills the specified rectangle with the current fill `gfx::Color`.
@@ -0,0 +1,860 @@
+//
+//  persistent.h
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/9/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef __gfx__persistent__
+#define __gfx__persistent__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace gfx {
+
+    ///The persistent namespace contains the structurally shared containers
+    ///that back `gfx::Array` and `gfx::Dictionary`.
+    ///
+    ///Copying a persistent container is constant time, the copy shares all
+    ///of its nodes with the original. Nodes are reference counted, and a
+    ///container edits a node in place when it is the node's only owner,
+    ///copying the path to the node otherwise. A container that has never
+    ///been copied therefore behaves like a transient: batches of edits
+    ///allocate nothing beyond what a conventional container would.
+    ///
+    ///Values are of the form `T *`, where T provides `retain`, `release`,
+    ///`hash`, and `isEqual`. Containers retain the values they hold.
+    namespace persistent {
+
+        ///Retains a value if it is non-null.
+        template<typename T>
+        static inline T *retain_value(T *value)
+        {
+            if(value)
+                value->retain();
+
+            return value;
+        }
+
+        ///Releases a value if it is non-null.
+        template<typename T>
+        static inline void release_value(T *value)
+        {
+            if(value)
+                value->release();
+        }
+
+        ///Returns whether or not two values are equal, treating null as equal only to null.
+        template<typename T>
+        static inline bool values_equal(T *left, T *right)
+        {
+            if(left == right)
+                return true;
+
+            if(!left || !right)
+                return false;
+
+            return left->isEqual(right);
+        }
+
+#pragma mark - Vector
+
+        ///The Vector class is an ordered sequence implemented as a 32-way bit-partitioned
+        ///trie with a tail buffer. `at`, `set`, `push`, and `pop` are O(log32 n), which is
+        ///effectively constant. Copies are O(1), and share structure with the original.
+        template<typename T>
+        class Vector
+        {
+            enum : uint32_t {
+                kBits = 5,
+                kWidth = (1 << kBits),
+                kMask = (kWidth - 1),
+            };
+
+            ///A node of the trie. Leaves hold values, branches hold nodes.
+            struct Node
+            {
+                ///The number of owners of the node.
+                std::atomic<uint32_t> retainCount;
+
+                ///Whether or not the node holds values.
+                bool isLeaf;
+
+                union {
+                    Node *children[kWidth];
+                    T *values[kWidth];
+                };
+
+                explicit Node(bool inIsLeaf) :
+                    retainCount(1),
+                    isLeaf(inIsLeaf)
+                {
+                    for (uint32_t index = 0; index < kWidth; index++)
+                        children[index] = nullptr;
+                }
+            };
+
+            ///The number of values in the vector.
+            size_t mCount;
+
+            ///The level of the root node, in bits.
+            uint32_t mShift;
+
+            ///The root of the trie. Null when all values fit in the tail.
+            Node *mRoot;
+
+            ///The last, partially filled leaf of the vector. Null when empty.
+            Node *mTail;
+
+#pragma mark - Nodes
+
+            static Node *retain_node(Node *node)
+            {
+                if(node)
+                    node->retainCount++;
+
+                return node;
+            }
+
+            static void release_node(Node *node)
+            {
+                if(!node || --node->retainCount > 0)
+                    return;
+
+                if(node->isLeaf) {
+                    for (uint32_t index = 0; index < kWidth; index++)
+                        release_value(node->values[index]);
+                } else {
+                    for (uint32_t index = 0; index < kWidth; index++)
+                        release_node(node->children[index]);
+                }
+
+                delete node;
+            }
+
+            ///Returns a node the caller may edit in place, given an owned reference to a node.
+            ///
+            ///The node is returned as is when the caller is its only owner. Otherwise
+            ///the caller's reference is exchanged for a reference to a new copy.
+            static Node *editable_node(Node *node)
+            {
+                if(node->retainCount.load() == 1)
+                    return node;
+
+                Node *newNode = new Node(node->isLeaf);
+                if(node->isLeaf) {
+                    for (uint32_t index = 0; index < kWidth; index++)
+                        newNode->values[index] = retain_value(node->values[index]);
+                } else {
+                    for (uint32_t index = 0; index < kWidth; index++)
+                        newNode->children[index] = retain_node(node->children[index]);
+                }
+
+                release_node(node);
+                return newNode;
+            }
+
+            ///Returns the index of the first value stored in the tail.
+            size_t tailOffset() const
+            {
+                return (mCount < kWidth)? 0 : (((mCount - 1) >> kBits) << kBits);
+            }
+
+            ///Returns the leaf containing the value at a given index.
+            Node *leafFor(size_t index) const
+            {
+                if(index >= tailOffset())
+                    return mTail;
+
+                Node *node = mRoot;
+                for (uint32_t level = mShift; level > 0; level -= kBits)
+                    node = node->children[(index >> level) & kMask];
+
+                return node;
+            }
+
+            ///Wraps a given node in branches until it reaches a given level.
+            static Node *new_path(uint32_t level, Node *node)
+            {
+                if(level == 0)
+                    return node;
+
+                Node *branch = new Node(false);
+                branch->children[0] = new_path(level - kBits, node);
+                return branch;
+            }
+
+            ///Places a full tail leaf into the trie. Consumes `parent` and `tail`.
+            Node *pushTail(uint32_t level, Node *parent, Node *tail)
+            {
+                parent = parent? editable_node(parent) : new Node(false);
+
+                uint32_t subindex = ((mCount - 1) >> level) & kMask;
+                if(level == kBits) {
+                    parent->children[subindex] = tail;
+                } else {
+                    Node *child = parent->children[subindex];
+                    parent->children[subindex] = child? pushTail(level - kBits, child, tail) : new_path(level - kBits, tail);
+                }
+
+                return parent;
+            }
+
+            ///Removes the last leaf from the trie. Consumes `node`.
+            ///
+            /// \result The new node, or null if the node became empty.
+            Node *popTail(uint32_t level, Node *node)
+            {
+                uint32_t subindex = ((mCount - 2) >> level) & kMask;
+                if(level > kBits) {
+                    node = editable_node(node);
+                    Node *child = node->children[subindex];
+                    node->children[subindex] = nullptr;
+
+                    Node *newChild = popTail(level - kBits, child);
+                    if(!newChild && subindex == 0) {
+                        release_node(node);
+                        return nullptr;
+                    }
+
+                    node->children[subindex] = newChild;
+                    return node;
+                } else if(subindex == 0) {
+                    release_node(node);
+                    return nullptr;
+                } else {
+                    node = editable_node(node);
+                    release_node(node->children[subindex]);
+                    node->children[subindex] = nullptr;
+                    return node;
+                }
+            }
+
+            ///Replaces the value at a given index within the trie. Consumes `node`.
+            static Node *setInTrie(uint32_t level, Node *node, size_t index, T *value)
+            {
+                node = editable_node(node);
+                if(level == 0) {
+                    T *oldValue = node->values[index & kMask];
+                    node->values[index & kMask] = retain_value(value);
+                    release_value(oldValue);
+                } else {
+                    uint32_t subindex = (index >> level) & kMask;
+                    node->children[subindex] = setInTrie(level - kBits, node->children[subindex], index, value);
+                }
+
+                return node;
+            }
+
+        public:
+
+#pragma mark - Lifecycle
+
+            ///Constructs an empty vector.
+            Vector() :
+                mCount(0),
+                mShift(kBits),
+                mRoot(nullptr),
+                mTail(nullptr)
+            {
+            }
+
+            ///Constructs a vector which shares the contents of another vector. O(1).
+            Vector(const Vector &other) :
+                mCount(other.mCount),
+                mShift(other.mShift),
+                mRoot(retain_node(other.mRoot)),
+                mTail(retain_node(other.mTail))
+            {
+            }
+
+            Vector &operator=(const Vector &other)
+            {
+                if(this != &other) {
+                    Node *oldRoot = mRoot;
+                    Node *oldTail = mTail;
+
+                    mCount = other.mCount;
+                    mShift = other.mShift;
+                    mRoot = retain_node(other.mRoot);
+                    mTail = retain_node(other.mTail);
+
+                    release_node(oldRoot);
+                    release_node(oldTail);
+                }
+
+                return *this;
+            }
+
+            ///The destructor.
+            ~Vector()
+            {
+                release_node(mRoot);
+                release_node(mTail);
+            }
+
+#pragma mark - Reading
+
+            ///Returns the number of values in the vector.
+            size_t count() const
+            {
+                return mCount;
+            }
+
+            ///Returns the value at a given index. The index must be in bounds.
+            T *at(size_t index) const
+            {
+                return leafFor(index)->values[index & kMask];
+            }
+
+            ///Applies a function to each value within a given range, in order,
+            ///stopping early if the function returns false.
+            ///
+            ///Values are read a leaf at a time, making this considerably
+            ///faster than repeatedly calling `at`.
+            void forEach(size_t location, size_t length, const std::function<bool(T *value, size_t index)> &function) const
+            {
+                size_t index = location, end = location + length;
+                while (index < end) {
+                    Node *leaf = leafFor(index);
+                    size_t leafEnd = std::min(end, (index | kMask) + 1);
+                    for (; index < leafEnd; index++) {
+                        if(!function(leaf->values[index & kMask], index))
+                            return;
+                    }
+                }
+            }
+
+#pragma mark - Editing
+
+            ///Appends a given value to the end of the vector.
+            void push(T *value)
+            {
+                size_t tailLength = mCount - tailOffset();
+                if(mTail && tailLength < kWidth) {
+                    mTail = editable_node(mTail);
+                    mTail->values[tailLength] = retain_value(value);
+                    mCount++;
+                    return;
+                }
+
+                Node *newTail = new Node(true);
+                newTail->values[0] = retain_value(value);
+
+                if(mTail) {
+                    if((mCount >> kBits) > (size_t(1) << mShift)) {
+                        Node *newRoot = new Node(false);
+                        newRoot->children[0] = mRoot;
+                        newRoot->children[1] = new_path(mShift, mTail);
+                        mRoot = newRoot;
+                        mShift += kBits;
+                    } else {
+                        mRoot = pushTail(mShift, mRoot, mTail);
+                    }
+                }
+
+                mTail = newTail;
+                mCount++;
+            }
+
+            ///Removes the last value of the vector. Does nothing if the vector is empty.
+            void pop()
+            {
+                if(mCount == 0) {
+                    return;
+                } else if(mCount == 1) {
+                    this->clear();
+                    return;
+                }
+
+                size_t tailLength = mCount - tailOffset();
+                if(tailLength > 1) {
+                    mTail = editable_node(mTail);
+                    release_value(mTail->values[tailLength - 1]);
+                    mTail->values[tailLength - 1] = nullptr;
+                    mCount--;
+                    return;
+                }
+
+                Node *newTail = retain_node(leafFor(mCount - 2));
+                Node *newRoot = popTail(mShift, mRoot);
+                if(mShift > kBits && newRoot && !newRoot->children[1]) {
+                    Node *collapsedRoot = retain_node(newRoot->children[0]);
+                    release_node(newRoot);
+                    newRoot = collapsedRoot;
+                    mShift -= kBits;
+                }
+
+                release_node(mTail);
+                mRoot = newRoot;
+                mTail = newTail;
+                mCount--;
+
+                if(!mRoot)
+                    mShift = kBits;
+            }
+
+            ///Replaces the value at a given index. The index must be in bounds.
+            void set(size_t index, T *value)
+            {
+                if(index >= tailOffset()) {
+                    mTail = editable_node(mTail);
+
+                    T *oldValue = mTail->values[index & kMask];
+                    mTail->values[index & kMask] = retain_value(value);
+                    release_value(oldValue);
+                } else {
+                    mRoot = setInTrie(mShift, mRoot, index, value);
+                }
+            }
+
+            ///Appends the contents of another vector.
+            ///
+            ///Appending to an empty vector shares the other vector's structure, and is O(1).
+            void append(const Vector &other)
+            {
+                if(mCount == 0) {
+                    *this = other;
+                    return;
+                }
+
+                Vector otherCopy(other);
+                otherCopy.forEach(0, otherCopy.count(), [this](T *value, size_t index) {
+                    this->push(value);
+                    return true;
+                });
+            }
+
+            ///Removes all of the values from the vector.
+            void clear()
+            {
+                release_node(mRoot);
+                release_node(mTail);
+
+                mCount = 0;
+                mShift = kBits;
+                mRoot = nullptr;
+                mTail = nullptr;
+            }
+
+#pragma mark - Bulk Operations
+
+            ///Copies the values of the vector into a given std::vector, without retaining them.
+            void copyInto(std::vector<T *> &outValues) const
+            {
+                outValues.reserve(outValues.size() + mCount);
+                forEach(0, mCount, [&outValues](T *value, size_t index) {
+                    outValues.push_back(value);
+                    return true;
+                });
+            }
+
+            ///Replaces the contents of the vector with a given sequence of values.
+            void assign(T *const *values, size_t count)
+            {
+                Vector newVector;
+                for (size_t index = 0; index < count; index++)
+                    newVector.push(values[index]);
+
+                *this = newVector;
+            }
+        };
+
+#pragma mark - Hash
+
+        ///The Hash class is an unordered map implemented as a compressed hash-array
+        ///mapped prefix tree (CHAMP). `get`, `set`, and `remove` are O(log32 n).
+        ///Copies are O(1), and share structure with the original.
+        template<typename Key, typename Value, typename HashCodeType = size_t>
+        class Hash
+        {
+            enum : uint32_t {
+                kBits = 5,
+                kWidth = (1 << kBits),
+                kMask = (kWidth - 1),
+                kMaximumShift = (sizeof(HashCodeType) * 8),
+            };
+
+            ///A key-value association stored in a node.
+            struct Entry
+            {
+                HashCodeType hash;
+                Key *key;
+                Value *value;
+            };
+
+            ///A node of the tree. Entries and child nodes are kept in bitmap order.
+            ///
+            ///Nodes past the last level of hash bits hold colliding entries,
+            ///and ignore their bitmaps.
+            struct Node
+            {
+                std::atomic<uint32_t> retainCount;
+                uint32_t entryMap;
+                uint32_t childMap;
+                std::vector<Entry> entries;
+                std::vector<Node *> children;
+
+                Node() :
+                    retainCount(1),
+                    entryMap(0),
+                    childMap(0),
+                    entries(),
+                    children()
+                {
+                }
+            };
+
+            ///The number of associations in the hash.
+            size_t mCount;
+
+            ///The root of the tree. Null when empty.
+            Node *mRoot;
+
+#pragma mark - Nodes
+
+            static Node *retain_node(Node *node)
+            {
+                if(node)
+                    node->retainCount++;
+
+                return node;
+            }
+
+            static void release_node(Node *node)
+            {
+                if(!node || --node->retainCount > 0)
+                    return;
+
+                for (const Entry &entry : node->entries) {
+                    release_value(entry.key);
+                    release_value(entry.value);
+                }
+
+                for (Node *child : node->children)
+                    release_node(child);
+
+                delete node;
+            }
+
+            ///Returns a node the caller may edit in place, given an owned reference to a node.
+            static Node *editable_node(Node *node)
+            {
+                if(node->retainCount.load() == 1)
+                    return node;
+
+                Node *newNode = new Node();
+                newNode->entryMap = node->entryMap;
+                newNode->childMap = node->childMap;
+                newNode->entries = node->entries;
+                newNode->children = node->children;
+
+                for (const Entry &entry : newNode->entries) {
+                    retain_value(entry.key);
+                    retain_value(entry.value);
+                }
+
+                for (Node *child : newNode->children)
+                    retain_node(child);
+
+                release_node(node);
+                return newNode;
+            }
+
+            static uint32_t bit_for(HashCodeType hash, uint32_t shift)
+            {
+                return uint32_t(1) << ((hash >> shift) & kMask);
+            }
+
+            static uint32_t index_for(uint32_t map, uint32_t bit)
+            {
+                return uint32_t(__builtin_popcount(map & (bit - 1)));
+            }
+
+            ///Creates a node containing two entries with different keys. Takes ownership of both entries.
+            static Node *merge_entries(const Entry &entry1, const Entry &entry2, uint32_t shift)
+            {
+                Node *node = new Node();
+                if(shift >= kMaximumShift) {
+                    node->entries.push_back(entry1);
+                    node->entries.push_back(entry2);
+                    return node;
+                }
+
+                uint32_t bit1 = bit_for(entry1.hash, shift);
+                uint32_t bit2 = bit_for(entry2.hash, shift);
+                if(bit1 == bit2) {
+                    node->childMap = bit1;
+                    node->children.push_back(merge_entries(entry1, entry2, shift + kBits));
+                } else {
+                    node->entryMap = (bit1 | bit2);
+                    if(bit1 < bit2) {
+                        node->entries.push_back(entry1);
+                        node->entries.push_back(entry2);
+                    } else {
+                        node->entries.push_back(entry2);
+                        node->entries.push_back(entry1);
+                    }
+                }
+
+                return node;
+            }
+
+            static const Entry *find(const Node *node, Key *key, HashCodeType hash, uint32_t shift)
+            {
+                while (node) {
+                    if(shift >= kMaximumShift) {
+                        for (const Entry &entry : node->entries) {
+                            if(values_equal(entry.key, key))
+                                return &entry;
+                        }
+
+                        return nullptr;
+                    }
+
+                    uint32_t bit = bit_for(hash, shift);
+                    if(node->entryMap & bit) {
+                        const Entry &entry = node->entries[index_for(node->entryMap, bit)];
+                        return (entry.hash == hash && values_equal(entry.key, key))? &entry : nullptr;
+                    } else if(node->childMap & bit) {
+                        node = node->children[index_for(node->childMap, bit)];
+                        shift += kBits;
+                    } else {
+                        return nullptr;
+                    }
+                }
+
+                return nullptr;
+            }
+
+            ///Associates a value with a key. Consumes `node`.
+            static Node *insert(Node *node, Key *key, Value *value, HashCodeType hash, uint32_t shift, bool *outAdded)
+            {
+                node = node? editable_node(node) : new Node();
+
+                if(shift >= kMaximumShift) {
+                    for (Entry &entry : node->entries) {
+                        if(values_equal(entry.key, key)) {
+                            Value *oldValue = entry.value;
+                            entry.value = retain_value(value);
+                            release_value(oldValue);
+                            return node;
+                        }
+                    }
+
+                    node->entries.push_back(Entry{hash, retain_value(key), retain_value(value)});
+                    *outAdded = true;
+                    return node;
+                }
+
+                uint32_t bit = bit_for(hash, shift);
+                if(node->entryMap & bit) {
+                    uint32_t index = index_for(node->entryMap, bit);
+                    Entry &entry = node->entries[index];
+                    if(entry.hash == hash && values_equal(entry.key, key)) {
+                        Value *oldValue = entry.value;
+                        entry.value = retain_value(value);
+                        release_value(oldValue);
+                        return node;
+                    }
+
+                    Entry existingEntry = entry;
+                    node->entries.erase(node->entries.begin() + index);
+                    node->entryMap &= ~bit;
+
+                    Node *child = merge_entries(existingEntry, Entry{hash, retain_value(key), retain_value(value)}, shift + kBits);
+                    node->children.insert(node->children.begin() + index_for(node->childMap, bit), child);
+                    node->childMap |= bit;
+                    *outAdded = true;
+                } else if(node->childMap & bit) {
+                    uint32_t index = index_for(node->childMap, bit);
+                    node->children[index] = insert(node->children[index], key, value, hash, shift + kBits, outAdded);
+                } else {
+                    node->entries.insert(node->entries.begin() + index_for(node->entryMap, bit), Entry{hash, retain_value(key), retain_value(value)});
+                    node->entryMap |= bit;
+                    *outAdded = true;
+                }
+
+                return node;
+            }
+
+            ///Removes the value associated with a key. Consumes `node`.
+            ///
+            /// \result The new node, or null if the node became empty.
+            static Node *erase(Node *node, Key *key, HashCodeType hash, uint32_t shift, bool *outRemoved)
+            {
+                if(!find(node, key, hash, shift))
+                    return node;
+
+                node = editable_node(node);
+                *outRemoved = true;
+
+                if(shift >= kMaximumShift) {
+                    for (auto entry = node->entries.begin(); entry != node->entries.end(); entry++) {
+                        if(values_equal(entry->key, key)) {
+                            release_value(entry->key);
+                            release_value(entry->value);
+                            node->entries.erase(entry);
+                            break;
+                        }
+                    }
+                } else {
+                    uint32_t bit = bit_for(hash, shift);
+                    if(node->entryMap & bit) {
+                        uint32_t index = index_for(node->entryMap, bit);
+                        release_value(node->entries[index].key);
+                        release_value(node->entries[index].value);
+                        node->entries.erase(node->entries.begin() + index);
+                        node->entryMap &= ~bit;
+                    } else {
+                        uint32_t index = index_for(node->childMap, bit);
+                        Node *child = erase(node->children[index], key, hash, shift + kBits, outRemoved);
+                        if(child && child->children.empty() && child->entries.size() == 1) {
+                            //Keep the tree canonical by pulling lone entries up into their parent.
+                            Entry entry = child->entries[0];
+                            retain_value(entry.key);
+                            retain_value(entry.value);
+                            release_node(child);
+
+                            node->children.erase(node->children.begin() + index);
+                            node->childMap &= ~bit;
+                            node->entries.insert(node->entries.begin() + index_for(node->entryMap, bit), entry);
+                            node->entryMap |= bit;
+                        } else if(!child) {
+                            node->children.erase(node->children.begin() + index);
+                            node->childMap &= ~bit;
+                        } else {
+                            node->children[index] = child;
+                        }
+                    }
+                }
+
+                if(node->entries.empty() && node->children.empty()) {
+                    release_node(node);
+                    return nullptr;
+                }
+
+                return node;
+            }
+
+            static bool for_each(const Node *node, const std::function<bool(Key *key, Value *value)> &function)
+            {
+                for (const Entry &entry : node->entries) {
+                    if(!function(entry.key, entry.value))
+                        return false;
+                }
+
+                for (const Node *child : node->children) {
+                    if(!for_each(child, function))
+                        return false;
+                }
+
+                return true;
+            }
+
+        public:
+
+#pragma mark - Lifecycle
+
+            ///Constructs an empty hash.
+            Hash() :
+                mCount(0),
+                mRoot(nullptr)
+            {
+            }
+
+            ///Constructs a hash which shares the contents of another hash. O(1).
+            Hash(const Hash &other) :
+                mCount(other.mCount),
+                mRoot(retain_node(other.mRoot))
+            {
+            }
+
+            Hash &operator=(const Hash &other)
+            {
+                if(this != &other) {
+                    Node *oldRoot = mRoot;
+
+                    mCount = other.mCount;
+                    mRoot = retain_node(other.mRoot);
+
+                    release_node(oldRoot);
+                }
+
+                return *this;
+            }
+
+            ///The destructor.
+            ~Hash()
+            {
+                release_node(mRoot);
+            }
+
+#pragma mark - Reading
+
+            ///Returns the number of key-value associations in the hash.
+            size_t count() const
+            {
+                return mCount;
+            }
+
+            ///Returns whether or not the hash contains a given key.
+            bool contains(Key *key, HashCodeType hash) const
+            {
+                return (find(mRoot, key, hash, 0) != nullptr);
+            }
+
+            ///Returns the value associated with a given key, or null.
+            Value *get(Key *key, HashCodeType hash) const
+            {
+                const Entry *entry = find(mRoot, key, hash, 0);
+                return entry? entry->value : nullptr;
+            }
+
+            ///Applies a function to each association in the hash,
+            ///stopping early if the function returns false.
+            void forEach(const std::function<bool(Key *key, Value *value)> &function) const
+            {
+                if(mRoot)
+                    for_each(mRoot, function);
+            }
+
+#pragma mark - Editing
+
+            ///Associates a given value with a given key, replacing any existing value.
+            void set(Key *key, Value *value, HashCodeType hash)
+            {
+                bool added = false;
+                mRoot = insert(mRoot, key, value, hash, 0, &added);
+                if(added)
+                    mCount++;
+            }
+
+            ///Removes the value associated with a given key, if any.
+            void remove(Key *key, HashCodeType hash)
+            {
+                bool removed = false;
+                mRoot = erase(mRoot, key, hash, 0, &removed);
+                if(removed)
+                    mCount--;
+            }
+
+            ///Removes all of the associations from the hash.
+            void clear()
+            {
+                release_node(mRoot);
+                mRoot = nullptr;
+                mCount = 0;
+            }
+        };
+    }
+}
+
+#endif /* defined(__gfx__persistent__) */
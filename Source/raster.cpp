@@ -0,0 +1,1159 @@
+//
+//  raster.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/6/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#if GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster
+
+#include "raster.h"
+#include <algorithm>
+#include <cmath>
+
+namespace gfx {
+    namespace raster {
+    
+#pragma mark - Colors
+        
+        static inline Float Clamp01(Float value)
+        {
+            return (value < 0.0)? 0.0 : (value > 1.0)? 1.0 : value;
+        }
+        
+        uint32_t Color::premultiplied() const
+        {
+            Float alpha = Clamp01(this->alpha);
+            return pixel(uint32_t(std::lround(Clamp01(red) * alpha * 255.0)),
+                         uint32_t(std::lround(Clamp01(green) * alpha * 255.0)),
+                         uint32_t(std::lround(Clamp01(blue) * alpha * 255.0)),
+                         uint32_t(std::lround(alpha * 255.0)));
+        }
+        
+#pragma mark - Surfaces
+        
+        Surface::Surface(size_t width, size_t height) :
+            mRetainCount(1),
+            mWidth(width),
+            mHeight(height),
+            mPixels(SurfacePool::shared().acquire(width * height))
+        {
+            std::fill(mPixels.begin(), mPixels.end(), 0);
+        }
+        
+        Surface::Surface(const Surface *other) :
+            mRetainCount(1),
+            mWidth(other->mWidth),
+            mHeight(other->mHeight),
+            mPixels(SurfacePool::shared().acquire(other->mPixels.size()))
+        {
+            std::copy(other->mPixels.begin(), other->mPixels.end(), mPixels.begin());
+        }
+        
+        Surface::~Surface()
+        {
+            SurfacePool::shared().recycle(mPixels);
+        }
+        
+        Surface *Surface::retain()
+        {
+            mRetainCount.fetch_add(1, std::memory_order_relaxed);
+            return this;
+        }
+        
+        const Surface *Surface::retain() const
+        {
+            mRetainCount.fetch_add(1, std::memory_order_relaxed);
+            return this;
+        }
+        
+        void Surface::release() const
+        {
+            if(mRetainCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete this;
+        }
+        
+        bool Surface::isEqual(const Surface *other) const
+        {
+            if(!other)
+                return false;
+            
+            return (mWidth == other->mWidth && mHeight == other->mHeight && mPixels == other->mPixels);
+        }
+        
+        HashCode Surface::hash() const
+        {
+            HashCode hash = mWidth * 31 + mHeight;
+            for (uint32_t pixel : mPixels)
+                hash = hash * 31 + pixel;
+            
+            return hash;
+        }
+        
+#pragma mark -
+        
+        Surface *Surface::makeHalfSize() const
+        {
+            Surface *half = new Surface((mWidth + 1) / 2, (mHeight + 1) / 2);
+            for (size_t y = 0; y < half->mHeight; y++) {
+                const uint32_t *top = row(y * 2);
+                const uint32_t *bottom = row(std::min(y * 2 + 1, mHeight - 1));
+                uint32_t *out = half->row(y);
+                for (size_t x = 0; x < half->mWidth; x++) {
+                    size_t left = x * 2, right = std::min(x * 2 + 1, mWidth - 1);
+                    
+                    //Each channel of the sum fits in 10 bits, so red and blue, and green
+                    //and alpha, may be summed in pairs without carrying into each other.
+                    uint32_t redBlue = ((top[left] & 0x00ff00ff) + (top[right] & 0x00ff00ff) +
+                                        (bottom[left] & 0x00ff00ff) + (bottom[right] & 0x00ff00ff) + 0x00020002);
+                    uint32_t greenAlpha = (((top[left] >> 8) & 0x00ff00ff) + ((top[right] >> 8) & 0x00ff00ff) +
+                                           ((bottom[left] >> 8) & 0x00ff00ff) + ((bottom[right] >> 8) & 0x00ff00ff) + 0x00020002);
+                    out[x] = ((redBlue >> 2) & 0x00ff00ff) | (((greenAlpha >> 2) & 0x00ff00ff) << 8);
+                }
+            }
+            
+            return half;
+        }
+        
+#pragma mark - Surface Pool
+        
+        SurfacePool &SurfacePool::shared()
+        {
+            static SurfacePool *sharedPool = new SurfacePool(kDefaultBudget);
+            return *sharedPool;
+        }
+        
+        size_t SurfacePool::bucketCapacity(size_t count)
+        {
+            if(count < kMinimumPooledPixels)
+                return count;
+            
+            //Find the power of two such that `power < count <= power * 2` (or the
+            //minimum, for a count equal to it), and round up to a quarter of it.
+            size_t power = kMinimumPooledPixels;
+            while (power * 2 < count)
+                power *= 2;
+            
+            size_t step = power / 4;
+            return ((count + step - 1) / step) * step;
+        }
+        
+        SurfacePool::SurfacePool(size_t budget) :
+            mMutex(),
+            mEntries(),
+            mBudget(budget),
+            mPooledBytes(0)
+        {
+        }
+        
+#pragma mark -
+        
+        std::vector<uint32_t> SurfacePool::acquire(size_t count)
+        {
+            size_t capacity = bucketCapacity(count);
+            std::vector<uint32_t> pixels;
+            if(capacity >= kMinimumPooledPixels) {
+                std::lock_guard<std::mutex> lock(mMutex);
+                for (auto entry = mEntries.begin(); entry != mEntries.end(); entry++) {
+                    if(entry->capacity == capacity) {
+                        pixels.swap(entry->pixels);
+                        mPooledBytes -= capacity * sizeof(uint32_t);
+                        mEntries.erase(entry);
+                        break;
+                    }
+                }
+            }
+            
+            if(pixels.capacity() < capacity)
+                pixels.reserve(capacity);
+            
+            pixels.resize(count);
+            return pixels;
+        }
+        
+        void SurfacePool::recycle(std::vector<uint32_t> &pixels)
+        {
+            std::vector<uint32_t> buffer;
+            buffer.swap(pixels);
+            
+            //Buffers that were not allocated for a bucket are of no use to the pool.
+            size_t capacity = buffer.capacity();
+            if(capacity < kMinimumPooledPixels || bucketCapacity(capacity) != capacity)
+                return;
+            
+            std::lock_guard<std::mutex> lock(mMutex);
+            if(capacity * sizeof(uint32_t) > mBudget)
+                return;
+            
+            mEntries.push_front(Entry{capacity, std::move(buffer)});
+            mPooledBytes += capacity * sizeof(uint32_t);
+            trim();
+        }
+        
+        void SurfacePool::purge()
+        {
+            std::list<Entry> entries;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                entries.swap(mEntries);
+                mPooledBytes = 0;
+            }
+        }
+        
+        void SurfacePool::trim()
+        {
+            while (mPooledBytes > mBudget && !mEntries.empty()) {
+                mPooledBytes -= mEntries.back().capacity * sizeof(uint32_t);
+                mEntries.pop_back();
+            }
+        }
+        
+#pragma mark -
+        
+        void SurfacePool::setBudget(size_t budget)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mBudget = budget;
+            trim();
+        }
+        
+        size_t SurfacePool::budget() const
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            return mBudget;
+        }
+        
+        size_t SurfacePool::pooledBytes() const
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            return mPooledBytes;
+        }
+        
+#pragma mark - Paths
+        
+        ///The distance of the control points of a cubic approximating a quarter circle from its ends.
+        static Float const kQuarterCircleControlDistance = 0.5522847498307936;
+        
+        ///The geometry derived from the elements of a path.
+        ///
+        ///Geometry is shared between copies of a path, which may be drawn from
+        ///multiple threads at once, so its members are guarded by a mutex.
+        struct Path::Geometry
+        {
+            ///Guards the members of the geometry.
+            std::mutex mutex;
+            
+            ///Whether or not `boundingBox` has been computed.
+            bool hasBoundingBox;
+            
+            ///The bounding box of every point of the path.
+            Rect boundingBox;
+            
+            ///Whether or not `pathBoundingBox` has been computed.
+            bool hasPathBoundingBox;
+            
+            ///The smallest bounding box of the path.
+            Rect pathBoundingBox;
+            
+            ///The transform the path was most recently flattened with.
+            Transform2D flattenedTransform;
+            
+            ///The tolerance the path was most recently flattened with.
+            Float flattenedTolerance;
+            
+            ///The most recently flattened contours of the path, if any.
+            std::shared_ptr<const std::vector<Contour>> flattened;
+            
+            ///The style the path was most recently stroked with.
+            StrokeStyle strokedStyle;
+            
+            ///The tolerance the path was most recently stroked with.
+            Float strokedTolerance;
+            
+            ///The most recently stroked outline of the path, if any.
+            std::shared_ptr<const std::vector<Contour>> stroked;
+            
+            Geometry() :
+                mutex(),
+                hasBoundingBox(false),
+                boundingBox(),
+                hasPathBoundingBox(false),
+                pathBoundingBox(),
+                flattenedTransform(Transform2D::Identity),
+                flattenedTolerance(0.0),
+                flattened(),
+                strokedStyle(),
+                strokedTolerance(0.0),
+                stroked()
+            {
+            }
+        };
+        
+        Path::Path() :
+            mVerbs(),
+            mPoints(),
+            mSubpathStart(),
+            mGeometry()
+        {
+        }
+        
+#pragma mark - Memoized Geometry
+        
+        Path::Geometry &Path::geometry() const
+        {
+            //Paths are only read while being drawn concurrently, so the only race
+            //to settle is between threads creating the geometry at the same time.
+            auto geometry = std::atomic_load(&mGeometry);
+            if(!geometry) {
+                auto newGeometry = std::make_shared<Geometry>();
+                if(std::atomic_compare_exchange_strong(&mGeometry, &geometry, newGeometry))
+                    geometry = newGeometry;
+            }
+            
+            return *geometry;
+        }
+        
+        void Path::invalidateGeometry()
+        {
+            if(mGeometry)
+                mGeometry.reset();
+        }
+        
+#pragma mark - Constructing Paths
+        
+        void Path::ensureSubpath()
+        {
+            if(!mVerbs.empty() && mVerbs.back() == Verb::Close) {
+                mVerbs.push_back(Verb::Move);
+                mPoints.push_back(mSubpathStart);
+            }
+        }
+        
+        void Path::moveTo(Point point, const Transform2D &transform)
+        {
+            invalidateGeometry();
+            
+            mSubpathStart = transform.transformPoint(point);
+            mVerbs.push_back(Verb::Move);
+            mPoints.push_back(mSubpathStart);
+        }
+        
+        void Path::lineTo(Point point, const Transform2D &transform)
+        {
+            if(mVerbs.empty())
+                return moveTo(point, transform);
+            
+            invalidateGeometry();
+            ensureSubpath();
+            mVerbs.push_back(Verb::Line);
+            mPoints.push_back(transform.transformPoint(point));
+        }
+        
+        void Path::quadTo(Point controlPoint, Point point, const Transform2D &transform)
+        {
+            if(mVerbs.empty())
+                moveTo(controlPoint, transform);
+            
+            invalidateGeometry();
+            ensureSubpath();
+            mVerbs.push_back(Verb::Quad);
+            mPoints.push_back(transform.transformPoint(controlPoint));
+            mPoints.push_back(transform.transformPoint(point));
+        }
+        
+        void Path::cubicTo(Point controlPoint1, Point controlPoint2, Point point, const Transform2D &transform)
+        {
+            if(mVerbs.empty())
+                moveTo(controlPoint1, transform);
+            
+            invalidateGeometry();
+            ensureSubpath();
+            mVerbs.push_back(Verb::Cubic);
+            mPoints.push_back(transform.transformPoint(controlPoint1));
+            mPoints.push_back(transform.transformPoint(controlPoint2));
+            mPoints.push_back(transform.transformPoint(point));
+        }
+        
+        void Path::close()
+        {
+            if(mVerbs.empty() || mVerbs.back() == Verb::Close)
+                return;
+            
+            invalidateGeometry();
+            mVerbs.push_back(Verb::Close);
+        }
+        
+#pragma mark -
+        
+        void Path::addRect(Rect rect, const Transform2D &transform)
+        {
+            moveTo(Point{ rect.getMinX(), rect.getMinY() }, transform);
+            lineTo(Point{ rect.getMaxX(), rect.getMinY() }, transform);
+            lineTo(Point{ rect.getMaxX(), rect.getMaxY() }, transform);
+            lineTo(Point{ rect.getMinX(), rect.getMaxY() }, transform);
+            close();
+        }
+        
+        void Path::addRoundedRect(Rect rect, Float cornerWidth, Float cornerHeight, const Transform2D &transform)
+        {
+            Float radiusX = std::min(std::abs(cornerWidth), rect.getWidth() / 2.0);
+            Float radiusY = std::min(std::abs(cornerHeight), rect.getHeight() / 2.0);
+            if(radiusX <= 0.0 || radiusY <= 0.0)
+                return addRect(rect, transform);
+            
+            Float minX = rect.getMinX(), maxX = rect.getMaxX(), minY = rect.getMinY(), maxY = rect.getMaxY();
+            Float controlX = radiusX * kQuarterCircleControlDistance, controlY = radiusY * kQuarterCircleControlDistance;
+            
+            moveTo(Point{ minX + radiusX, minY }, transform);
+            lineTo(Point{ maxX - radiusX, minY }, transform);
+            cubicTo(Point{ maxX - radiusX + controlX, minY }, Point{ maxX, minY + radiusY - controlY }, Point{ maxX, minY + radiusY }, transform);
+            lineTo(Point{ maxX, maxY - radiusY }, transform);
+            cubicTo(Point{ maxX, maxY - radiusY + controlY }, Point{ maxX - radiusX + controlX, maxY }, Point{ maxX - radiusX, maxY }, transform);
+            lineTo(Point{ minX + radiusX, maxY }, transform);
+            cubicTo(Point{ minX + radiusX - controlX, maxY }, Point{ minX, maxY - radiusY + controlY }, Point{ minX, maxY - radiusY }, transform);
+            lineTo(Point{ minX, minY + radiusY }, transform);
+            cubicTo(Point{ minX, minY + radiusY - controlY }, Point{ minX + radiusX - controlX, minY }, Point{ minX + radiusX, minY }, transform);
+            close();
+        }
+        
+        void Path::addEllipse(Rect rect, const Transform2D &transform)
+        {
+            Float minX = rect.getMinX(), midX = rect.getMidX(), maxX = rect.getMaxX();
+            Float minY = rect.getMinY(), midY = rect.getMidY(), maxY = rect.getMaxY();
+            Float controlX = (rect.getWidth() / 2.0) * kQuarterCircleControlDistance;
+            Float controlY = (rect.getHeight() / 2.0) * kQuarterCircleControlDistance;
+            
+            moveTo(Point{ maxX, midY }, transform);
+            cubicTo(Point{ maxX, midY + controlY }, Point{ midX + controlX, maxY }, Point{ midX, maxY }, transform);
+            cubicTo(Point{ midX - controlX, maxY }, Point{ minX, midY + controlY }, Point{ minX, midY }, transform);
+            cubicTo(Point{ minX, midY - controlY }, Point{ midX - controlX, minY }, Point{ midX, minY }, transform);
+            cubicTo(Point{ midX + controlX, minY }, Point{ maxX, midY - controlY }, Point{ maxX, midY }, transform);
+            close();
+        }
+        
+        void Path::addArcToPoint(Point point1, Point point2, Float radius, const Transform2D &transform)
+        {
+            if(mVerbs.empty())
+                return moveTo(point1, transform);
+            
+            Point point0 = transform.invert().transformPoint(currentPoint());
+            Float x1 = point0.x - point1.x, y1 = point0.y - point1.y;
+            Float x2 = point2.x - point1.x, y2 = point2.y - point1.y;
+            Float length1 = std::hypot(x1, y1), length2 = std::hypot(x2, y2);
+            Float cross = x1 * y2 - y1 * x2;
+            if(radius <= 0.0 || length1 == 0.0 || length2 == 0.0 || std::abs(cross) <= 1e-9 * length1 * length2)
+                return lineTo(point1, transform);
+            
+            x1 /= length1; y1 /= length1;
+            x2 /= length2; y2 /= length2;
+            
+            Float halfAngle = std::acos(std::max(-1.0, std::min(1.0, x1 * x2 + y1 * y2))) / 2.0;
+            Float tangentDistance = radius / std::tan(halfAngle);
+            Point tangent1{ point1.x + x1 * tangentDistance, point1.y + y1 * tangentDistance };
+            Point tangent2{ point1.x + x2 * tangentDistance, point1.y + y2 * tangentDistance };
+            
+            Float bisectorX = x1 + x2, bisectorY = y1 + y2;
+            Float bisectorLength = std::hypot(bisectorX, bisectorY);
+            Float centerDistance = radius / std::sin(halfAngle);
+            Point center{ point1.x + bisectorX / bisectorLength * centerDistance, point1.y + bisectorY / bisectorLength * centerDistance };
+            
+            Float startAngle = std::atan2(tangent1.y - center.y, tangent1.x - center.x);
+            Float sweep = std::atan2(tangent2.y - center.y, tangent2.x - center.x) - startAngle;
+            if(sweep > M_PI)
+                sweep -= 2.0 * M_PI;
+            else if(sweep < -M_PI)
+                sweep += 2.0 * M_PI;
+            
+            lineTo(tangent1, transform);
+            
+            //The arc is always shorter than a half circle, so two cubics are
+            //enough to keep each one within a quarter circle.
+            Float segmentSweep = sweep / 2.0;
+            Float control = 4.0 / 3.0 * std::tan(segmentSweep / 4.0) * radius;
+            for (int segment = 0; segment < 2; segment++) {
+                Float angle0 = startAngle + segmentSweep * segment, angle1 = angle0 + segmentSweep;
+                Point end{ center.x + std::cos(angle1) * radius, center.y + std::sin(angle1) * radius };
+                Point control1{
+                    center.x + std::cos(angle0) * radius - std::sin(angle0) * control,
+                    center.y + std::sin(angle0) * radius + std::cos(angle0) * control,
+                };
+                Point control2{
+                    end.x + std::sin(angle1) * control,
+                    end.y - std::cos(angle1) * control,
+                };
+                cubicTo(control1, control2, end, transform);
+            }
+        }
+        
+        void Path::addPath(const Path &other, const Transform2D &transform)
+        {
+            auto point = other.mPoints.begin();
+            for (Verb verb : other.mVerbs) {
+                switch (verb) {
+                    case Verb::Move:
+                        moveTo(point[0], transform);
+                        point += 1;
+                        break;
+                    
+                    case Verb::Line:
+                        lineTo(point[0], transform);
+                        point += 1;
+                        break;
+                    
+                    case Verb::Quad:
+                        quadTo(point[0], point[1], transform);
+                        point += 2;
+                        break;
+                    
+                    case Verb::Cubic:
+                        cubicTo(point[0], point[1], point[2], transform);
+                        point += 3;
+                        break;
+                    
+                    case Verb::Close:
+                        close();
+                        break;
+                }
+            }
+        }
+        
+        void Path::addLines(const Point *points, size_t count, const Transform2D &transform)
+        {
+            if(count == 0)
+                return;
+            
+            mVerbs.reserve(mVerbs.size() + count);
+            mPoints.reserve(mPoints.size() + count);
+            
+            moveTo(points[0], transform);
+            for (size_t index = 1; index < count; index++)
+                lineTo(points[index], transform);
+        }
+        
+#pragma mark - Introspection
+        
+        bool Path::isEmpty() const
+        {
+            return mVerbs.empty();
+        }
+        
+        Point Path::currentPoint() const
+        {
+            if(mVerbs.empty())
+                return Point{};
+            
+            if(mVerbs.back() == Verb::Close)
+                return mSubpathStart;
+            
+            return mPoints.back();
+        }
+        
+        ///Returns the bounding box of a set of points.
+        static Rect BoundingBoxOfPoints(const Point *points, size_t count)
+        {
+            if(count == 0)
+                return Rect{};
+            
+            Float minX = points[0].x, maxX = points[0].x, minY = points[0].y, maxY = points[0].y;
+            for (size_t index = 1; index < count; index++) {
+                minX = std::min(minX, points[index].x);
+                maxX = std::max(maxX, points[index].x);
+                minY = std::min(minY, points[index].y);
+                maxY = std::max(maxY, points[index].y);
+            }
+            
+            return Rect{ Point{ minX, minY }, Size{ maxX - minX, maxY - minY } };
+        }
+        
+        Rect Path::boundingBox() const
+        {
+            Geometry &geometry = this->geometry();
+            std::lock_guard<std::mutex> lock(geometry.mutex);
+            if(!geometry.hasBoundingBox) {
+                geometry.boundingBox = BoundingBoxOfPoints(mPoints.data(), mPoints.size());
+                geometry.hasBoundingBox = true;
+            }
+            
+            return geometry.boundingBox;
+        }
+        
+        ///Expands an extent to include the extrema of a cubic on one axis.
+        static void IncludeCubicExtrema(Float p0, Float p1, Float p2, Float p3, Float &minimum, Float &maximum)
+        {
+            //The derivative of the cubic divided by three is at² + bt + c.
+            Float a = -p0 + 3.0 * p1 - 3.0 * p2 + p3;
+            Float b = 2.0 * (p0 - 2.0 * p1 + p2);
+            Float c = p1 - p0;
+            
+            Float roots[2];
+            int numberOfRoots = 0;
+            if(std::abs(a) < 1e-12) {
+                if(std::abs(b) > 1e-12)
+                    roots[numberOfRoots++] = -c / b;
+            } else {
+                Float discriminant = b * b - 4.0 * a * c;
+                if(discriminant >= 0.0) {
+                    Float root = std::sqrt(discriminant);
+                    roots[numberOfRoots++] = (-b + root) / (2.0 * a);
+                    roots[numberOfRoots++] = (-b - root) / (2.0 * a);
+                }
+            }
+            
+            for (int index = 0; index < numberOfRoots; index++) {
+                Float t = roots[index];
+                if(t > 0.0 && t < 1.0) {
+                    Float mt = 1.0 - t;
+                    Float value = mt * mt * mt * p0 + 3.0 * mt * mt * t * p1 + 3.0 * mt * t * t * p2 + t * t * t * p3;
+                    minimum = std::min(minimum, value);
+                    maximum = std::max(maximum, value);
+                }
+            }
+        }
+        
+        Rect Path::pathBoundingBox() const
+        {
+            Geometry &geometry = this->geometry();
+            std::lock_guard<std::mutex> lock(geometry.mutex);
+            if(!geometry.hasPathBoundingBox) {
+                geometry.pathBoundingBox = computePathBoundingBox();
+                geometry.hasPathBoundingBox = true;
+            }
+            
+            return geometry.pathBoundingBox;
+        }
+        
+        Rect Path::computePathBoundingBox() const
+        {
+            if(mPoints.empty())
+                return Rect{};
+            
+            Float minX = mPoints[0].x, maxX = mPoints[0].x, minY = mPoints[0].y, maxY = mPoints[0].y;
+            auto include = [&](Point point) {
+                minX = std::min(minX, point.x);
+                maxX = std::max(maxX, point.x);
+                minY = std::min(minY, point.y);
+                maxY = std::max(maxY, point.y);
+            };
+            
+            Point last = mPoints[0];
+            size_t pointIndex = 0;
+            for (Verb verb : mVerbs) {
+                switch (verb) {
+                    case Verb::Move:
+                    case Verb::Line:
+                        last = mPoints[pointIndex++];
+                        include(last);
+                        break;
+                    
+                    case Verb::Quad: {
+                        //Quadratics are elevated to cubics to share the extrema code.
+                        Point control = mPoints[pointIndex], end = mPoints[pointIndex + 1];
+                        Point control1{ last.x + 2.0 / 3.0 * (control.x - last.x), last.y + 2.0 / 3.0 * (control.y - last.y) };
+                        Point control2{ end.x + 2.0 / 3.0 * (control.x - end.x), end.y + 2.0 / 3.0 * (control.y - end.y) };
+                        include(end);
+                        IncludeCubicExtrema(last.x, control1.x, control2.x, end.x, minX, maxX);
+                        IncludeCubicExtrema(last.y, control1.y, control2.y, end.y, minY, maxY);
+                        last = end;
+                        pointIndex += 2;
+                        break;
+                    }
+                    
+                    case Verb::Cubic: {
+                        Point control1 = mPoints[pointIndex], control2 = mPoints[pointIndex + 1], end = mPoints[pointIndex + 2];
+                        include(end);
+                        IncludeCubicExtrema(last.x, control1.x, control2.x, end.x, minX, maxX);
+                        IncludeCubicExtrema(last.y, control1.y, control2.y, end.y, minY, maxY);
+                        last = end;
+                        pointIndex += 3;
+                        break;
+                    }
+                    
+                    case Verb::Close:
+                        break;
+                }
+            }
+            
+            return Rect{ Point{ minX, minY }, Size{ maxX - minX, maxY - minY } };
+        }
+        
+        bool Path::isRect(Rect *outRect) const
+        {
+            size_t count = mVerbs.size();
+            if(count < 4 || count > 6 || mVerbs[0] != Verb::Move)
+                return false;
+            
+            size_t lines = 0;
+            for (size_t index = 1; index < count; index++) {
+                if(mVerbs[index] == Verb::Line)
+                    lines++;
+                else if(mVerbs[index] != Verb::Close || index != count - 1)
+                    return false;
+            }
+            
+            if(lines < 3 || lines > 4)
+                return false;
+            
+            if(lines == 4 && (mPoints[4].x != mPoints[0].x || mPoints[4].y != mPoints[0].y))
+                return false;
+            
+            //Each edge must be axis aligned, alternating between horizontal and vertical.
+            bool firstIsHorizontal = (mPoints[0].y == mPoints[1].y);
+            for (size_t index = 0; index < 4; index++) {
+                Point from = mPoints[index], to = mPoints[(index + 1) % 4];
+                bool horizontal = ((index % 2 == 0) == firstIsHorizontal);
+                if(horizontal? (from.y != to.y) : (from.x != to.x))
+                    return false;
+            }
+            
+            if(outRect)
+                *outRect = BoundingBoxOfPoints(mPoints.data(), 4);
+            
+            return true;
+        }
+        
+        bool Path::containsPoint(Point point, FillRule rule, const Transform2D &transform) const
+        {
+            std::vector<Contour> contours;
+            flatten(transform, 0.05, contours);
+            
+            //Subpaths are implicitly closed, and the winding number of
+            //the point is found by casting a ray towards positive x.
+            int winding = 0;
+            for (const Contour &contour : contours) {
+                size_t count = contour.points.size();
+                for (size_t index = 0; index < count; index++) {
+                    Point from = contour.points[index], to = contour.points[(index + 1) % count];
+                    if(from.y <= point.y) {
+                        if(to.y > point.y && (to.x - from.x) * (point.y - from.y) - (point.x - from.x) * (to.y - from.y) > 0.0)
+                            winding++;
+                    } else {
+                        if(to.y <= point.y && (to.x - from.x) * (point.y - from.y) - (point.x - from.x) * (to.y - from.y) < 0.0)
+                            winding--;
+                    }
+                }
+            }
+            
+            if(rule == FillRule::EvenOdd)
+                return (winding % 2) != 0;
+            else
+                return winding != 0;
+        }
+        
+        bool Path::operator==(const Path &other) const
+        {
+            if(mVerbs != other.mVerbs || mPoints.size() != other.mPoints.size())
+                return false;
+            
+            for (size_t index = 0, count = mPoints.size(); index < count; index++) {
+                if(mPoints[index].x != other.mPoints[index].x || mPoints[index].y != other.mPoints[index].y)
+                    return false;
+            }
+            
+            return true;
+        }
+        
+        HashCode Path::hash() const
+        {
+            HashCode hash = mVerbs.size();
+            for (const Point &point : mPoints)
+                hash = hash * 31 + std::hash<Float>()(point.x) * 17 + std::hash<Float>()(point.y);
+            
+            return hash;
+        }
+        
+#pragma mark - Flattening
+        
+        ///Returns the number of line segments needed to keep a curve within a tolerance.
+        ///
+        ///This is Wang's formula, where `degreeFactor` is n(n - 1)/8 for a curve of degree n,
+        ///and `secondDifference` is the length of the largest second difference of its points.
+        static size_t SegmentsForCurve(Float degreeFactor, Float secondDifference, Float tolerance)
+        {
+            Float segments = std::ceil(std::sqrt(degreeFactor * secondDifference / tolerance));
+            if(!(segments >= 1.0))
+                return 1;
+            
+            return size_t(std::min(segments, 1024.0));
+        }
+        
+        void Path::flatten(const Transform2D &transform, Float tolerance, std::vector<Contour> &outContours) const
+        {
+            Contour *contour = nullptr;
+            Point last{};
+            size_t pointIndex = 0;
+            for (Verb verb : mVerbs) {
+                switch (verb) {
+                    case Verb::Move: {
+                        outContours.push_back(Contour{ {}, false });
+                        contour = &outContours.back();
+                        last = transform.transformPoint(mPoints[pointIndex++]);
+                        contour->points.push_back(last);
+                        break;
+                    }
+                    
+                    case Verb::Line: {
+                        last = transform.transformPoint(mPoints[pointIndex++]);
+                        contour->points.push_back(last);
+                        break;
+                    }
+                    
+                    case Verb::Quad: {
+                        Point p0 = last;
+                        Point p1 = transform.transformPoint(mPoints[pointIndex]);
+                        Point p2 = transform.transformPoint(mPoints[pointIndex + 1]);
+                        pointIndex += 2;
+                        
+                        Float difference = std::hypot(p0.x - 2.0 * p1.x + p2.x, p0.y - 2.0 * p1.y + p2.y);
+                        size_t segments = SegmentsForCurve(0.25, difference, tolerance);
+                        for (size_t segment = 1; segment < segments; segment++) {
+                            Float t = Float(segment) / segments, mt = 1.0 - t;
+                            contour->points.push_back(Point{
+                                mt * mt * p0.x + 2.0 * mt * t * p1.x + t * t * p2.x,
+                                mt * mt * p0.y + 2.0 * mt * t * p1.y + t * t * p2.y,
+                            });
+                        }
+                        
+                        contour->points.push_back(p2);
+                        last = p2;
+                        break;
+                    }
+                    
+                    case Verb::Cubic: {
+                        Point p0 = last;
+                        Point p1 = transform.transformPoint(mPoints[pointIndex]);
+                        Point p2 = transform.transformPoint(mPoints[pointIndex + 1]);
+                        Point p3 = transform.transformPoint(mPoints[pointIndex + 2]);
+                        pointIndex += 3;
+                        
+                        Float difference = std::max(std::hypot(p0.x - 2.0 * p1.x + p2.x, p0.y - 2.0 * p1.y + p2.y),
+                                                    std::hypot(p1.x - 2.0 * p2.x + p3.x, p1.y - 2.0 * p2.y + p3.y));
+                        size_t segments = SegmentsForCurve(0.75, difference, tolerance);
+                        for (size_t segment = 1; segment < segments; segment++) {
+                            Float t = Float(segment) / segments, mt = 1.0 - t;
+                            Float b0 = mt * mt * mt, b1 = 3.0 * mt * mt * t, b2 = 3.0 * mt * t * t, b3 = t * t * t;
+                            contour->points.push_back(Point{
+                                b0 * p0.x + b1 * p1.x + b2 * p2.x + b3 * p3.x,
+                                b0 * p0.y + b1 * p1.y + b2 * p2.y + b3 * p3.y,
+                            });
+                        }
+                        
+                        contour->points.push_back(p3);
+                        last = p3;
+                        break;
+                    }
+                    
+                    case Verb::Close: {
+                        contour->closed = true;
+                        last = contour->points.front();
+                        break;
+                    }
+                }
+            }
+        }
+        
+        std::shared_ptr<const std::vector<Contour>> Path::flattened(const Transform2D &transform, Float tolerance) const
+        {
+            Geometry &geometry = this->geometry();
+            std::lock_guard<std::mutex> lock(geometry.mutex);
+            if(!geometry.flattened || geometry.flattenedTransform != transform || geometry.flattenedTolerance != tolerance) {
+                auto contours = std::make_shared<std::vector<Contour>>();
+                flatten(transform, tolerance, *contours);
+                
+                geometry.flattenedTransform = transform;
+                geometry.flattenedTolerance = tolerance;
+                geometry.flattened = contours;
+            }
+            
+            return geometry.flattened;
+        }
+        
+        std::shared_ptr<const std::vector<Contour>> Path::stroked(const StrokeStyle &style, Float tolerance) const
+        {
+            Geometry &geometry = this->geometry();
+            std::lock_guard<std::mutex> lock(geometry.mutex);
+            
+            const StrokeStyle &strokedStyle = geometry.strokedStyle;
+            bool isStale = (!geometry.stroked || geometry.strokedTolerance != tolerance ||
+                            strokedStyle.width != style.width || strokedStyle.cap != style.cap ||
+                            strokedStyle.join != style.join || strokedStyle.miterLimit != style.miterLimit);
+            if(isStale) {
+                std::vector<Contour> contours;
+                flatten(Transform2D::Identity, tolerance, contours);
+                
+                auto polygons = std::make_shared<std::vector<Contour>>();
+                stroke(contours, style, tolerance, *polygons);
+                
+                geometry.strokedStyle = style;
+                geometry.strokedTolerance = tolerance;
+                geometry.stroked = polygons;
+            }
+            
+            return geometry.stroked;
+        }
+        
+#pragma mark - Stroking
+        
+        ///Returns the signed area of a polygon, positive for counterclockwise winding in a y-up space.
+        static Float SignedArea(const std::vector<Point> &points)
+        {
+            Float area = 0.0;
+            for (size_t index = 0, count = points.size(); index < count; index++) {
+                const Point &from = points[index], &to = points[(index + 1) % count];
+                area += from.x * to.y - to.x * from.y;
+            }
+            
+            return area / 2.0;
+        }
+        
+        ///Adds a polygon to a set of stroke polygons, winding it positively.
+        static void AddStrokePolygon(std::vector<Contour> &outPolygons, std::vector<Point> &&points)
+        {
+            if(SignedArea(points) < 0.0)
+                std::reverse(points.begin(), points.end());
+            
+            outPolygons.push_back(Contour{ std::move(points), true });
+        }
+        
+        ///Adds a circle polygon to a set of stroke polygons.
+        static void AddStrokeCircle(std::vector<Contour> &outPolygons, Point center, Float radius, Float tolerance)
+        {
+            size_t segments = 8;
+            if(tolerance < radius) {
+                Float step = 2.0 * std::acos(1.0 - tolerance / radius);
+                segments = size_t(std::min(std::max(std::ceil(2.0 * M_PI / step), 8.0), 1024.0));
+            }
+            
+            std::vector<Point> points;
+            points.reserve(segments);
+            for (size_t segment = 0; segment < segments; segment++) {
+                Float angle = 2.0 * M_PI * segment / segments;
+                points.push_back(Point{ center.x + std::cos(angle) * radius, center.y + std::sin(angle) * radius });
+            }
+            
+            AddStrokePolygon(outPolygons, std::move(points));
+        }
+        
+        ///Adds the polygon for a cap at the end of an open contour.
+        ///
+        /// \param  point       The end of the contour.
+        /// \param  directionX  The unit direction pointing out of the contour at the end.
+        /// \param  directionY
+        ///
+        static void AddStrokeCap(std::vector<Contour> &outPolygons, const StrokeStyle &style, Float tolerance,
+                                 Point point, Float directionX, Float directionY)
+        {
+            Float halfWidth = style.width / 2.0;
+            switch (style.cap) {
+                case LineCap::Butt:
+                    break;
+                
+                case LineCap::Round:
+                    AddStrokeCircle(outPolygons, point, halfWidth, tolerance);
+                    break;
+                
+                case LineCap::Square: {
+                    Float normalX = -directionY * halfWidth, normalY = directionX * halfWidth;
+                    Float extentX = directionX * halfWidth, extentY = directionY * halfWidth;
+                    AddStrokePolygon(outPolygons, {
+                        Point{ point.x + normalX, point.y + normalY },
+                        Point{ point.x + normalX + extentX, point.y + normalY + extentY },
+                        Point{ point.x - normalX + extentX, point.y - normalY + extentY },
+                        Point{ point.x - normalX, point.y - normalY },
+                    });
+                    break;
+                }
+            }
+        }
+        
+        ///Adds the polygon for a join between two segments meeting at a point.
+        static void AddStrokeJoin(std::vector<Contour> &outPolygons, const StrokeStyle &style, Float tolerance,
+                                  Point point, Float inX, Float inY, Float outX, Float outY)
+        {
+            Float cross = inX * outY - inY * outX;
+            Float dot = inX * outX + inY * outY;
+            if(std::abs(cross) < 1e-12 && dot > 0.0)
+                return;
+            
+            //The gap between the segments is on the outside of the turn.
+            Float halfWidth = style.width / 2.0;
+            Float side = (cross > 0.0)? -1.0 : 1.0;
+            Point outer1{ point.x - inY * halfWidth * side, point.y + inX * halfWidth * side };
+            Point outer2{ point.x - outY * halfWidth * side, point.y + outX * halfWidth * side };
+            
+            //Turns this small are indistinguishable from a bevel.
+            Float gap = std::hypot(outer1.x - outer2.x, outer1.y - outer2.y);
+            LineJoin join = (gap <= tolerance)? LineJoin::Bevel : style.join;
+            
+            switch (join) {
+                case LineJoin::Round: {
+                    AddStrokeCircle(outPolygons, point, halfWidth, tolerance);
+                    break;
+                }
+                
+                case LineJoin::Miter: {
+                    //The ratio of the miter length to the line width is 1 / sin(φ / 2), where φ is
+                    //the angle between the segments. The cosine of the turn is -cos(φ).
+                    Float halfCosine = std::sqrt(std::max(0.0, (1.0 + dot) / 2.0));
+                    if(halfCosine > 0.0 && 1.0 / halfCosine <= style.miterLimit) {
+                        Float bisectorX = (outer1.x - point.x) + (outer2.x - point.x);
+                        Float bisectorY = (outer1.y - point.y) + (outer2.y - point.y);
+                        Float bisectorLength = std::hypot(bisectorX, bisectorY);
+                        if(bisectorLength > 0.0) {
+                            Float miterLength = halfWidth / halfCosine;
+                            Point miter{ point.x + bisectorX / bisectorLength * miterLength, point.y + bisectorY / bisectorLength * miterLength };
+                            AddStrokePolygon(outPolygons, { point, outer1, miter, outer2 });
+                            break;
+                        }
+                    }
+                    
+                    AddStrokePolygon(outPolygons, { point, outer1, outer2 });
+                    break;
+                }
+                
+                case LineJoin::Bevel: {
+                    AddStrokePolygon(outPolygons, { point, outer1, outer2 });
+                    break;
+                }
+            }
+        }
+        
+        void stroke(const std::vector<Contour> &contours, const StrokeStyle &style,
+                    Float tolerance, std::vector<Contour> &outPolygons)
+        {
+            if(style.width <= 0.0)
+                return;
+            
+            Float halfWidth = style.width / 2.0;
+            std::vector<Point> points;
+            for (const Contour &contour : contours) {
+                points.clear();
+                for (const Point &point : contour.points) {
+                    if(points.empty() || point.x != points.back().x || point.y != points.back().y)
+                        points.push_back(point);
+                }
+                
+                bool closed = contour.closed;
+                if(closed && points.size() > 1 && points.front().x == points.back().x && points.front().y == points.back().y)
+                    points.pop_back();
+                
+                size_t count = points.size();
+                if(count == 0)
+                    continue;
+                
+                //A subpath without length only draws its caps, as a dot.
+                if(count == 1) {
+                    if(style.cap != LineCap::Butt) {
+                        AddStrokeCap(outPolygons, style, tolerance, points[0], -1.0, 0.0);
+                        AddStrokeCap(outPolygons, style, tolerance, points[0], 1.0, 0.0);
+                    }
+                    
+                    continue;
+                }
+                
+                size_t segments = closed? count : count - 1;
+                std::vector<Point> directions(segments);
+                for (size_t index = 0; index < segments; index++) {
+                    const Point &from = points[index], &to = points[(index + 1) % count];
+                    Float length = std::hypot(to.x - from.x, to.y - from.y);
+                    directions[index] = Point{ (to.x - from.x) / length, (to.y - from.y) / length };
+                    
+                    Float normalX = -directions[index].y * halfWidth, normalY = directions[index].x * halfWidth;
+                    AddStrokePolygon(outPolygons, {
+                        Point{ from.x + normalX, from.y + normalY },
+                        Point{ to.x + normalX, to.y + normalY },
+                        Point{ to.x - normalX, to.y - normalY },
+                        Point{ from.x - normalX, from.y - normalY },
+                    });
+                }
+                
+                size_t firstJoin = closed? 0 : 1;
+                for (size_t index = firstJoin; index < count; index++) {
+                    if(!closed && index == count - 1)
+                        break;
+                    
+                    const Point &in = directions[(index + segments - 1) % segments], &out = directions[index];
+                    AddStrokeJoin(outPolygons, style, tolerance, points[index], in.x, in.y, out.x, out.y);
+                }
+                
+                if(!closed) {
+                    AddStrokeCap(outPolygons, style, tolerance, points[0], -directions.front().x, -directions.front().y);
+                    AddStrokeCap(outPolygons, style, tolerance, points[count - 1], directions.back().x, directions.back().y);
+                }
+            }
+        }
+        
+#pragma mark - Gradients
+        
+        Gradient::Gradient(const std::vector<GradientStop> &stops) :
+            mStops(stops),
+            mLookupTable()
+        {
+            std::stable_sort(mStops.begin(), mStops.end(), [](const GradientStop &left, const GradientStop &right) {
+                return left.location < right.location;
+            });
+            
+            auto lookupTable = std::make_shared<std::vector<uint32_t>>(size_t(kLookupTableSize));
+            for (size_t index = 0; index < kLookupTableSize; index++)
+                (*lookupTable)[index] = colorAt(Float(index) / Float(kLookupTableSize - 1));
+            
+            mLookupTable = lookupTable;
+        }
+        
+        uint32_t Gradient::colorAt(Float location) const
+        {
+            if(mStops.empty())
+                return 0;
+            
+            if(!(location > mStops.front().location))
+                return mStops.front().color.premultiplied();
+            
+            if(location >= mStops.back().location)
+                return mStops.back().color.premultiplied();
+            
+            auto upper = std::upper_bound(mStops.begin(), mStops.end(), location, [](Float location, const GradientStop &stop) {
+                return location < stop.location;
+            });
+            auto lower = upper - 1;
+            
+            Float span = upper->location - lower->location;
+            Float t = (span > 0.0)? (location - lower->location) / span : 1.0;
+            const Color &from = lower->color, &to = upper->color;
+            return Color{
+                from.red + (to.red - from.red) * t,
+                from.green + (to.green - from.green) * t,
+                from.blue + (to.blue - from.blue) * t,
+                from.alpha + (to.alpha - from.alpha) * t,
+            }.premultiplied();
+        }
+        
+        bool Gradient::operator==(const Gradient &other) const
+        {
+            if(mStops.size() != other.mStops.size())
+                return false;
+            
+            for (size_t index = 0, count = mStops.size(); index < count; index++) {
+                const GradientStop &left = mStops[index], &right = other.mStops[index];
+                if(left.location != right.location ||
+                   left.color.red != right.color.red ||
+                   left.color.green != right.color.green ||
+                   left.color.blue != right.color.blue ||
+                   left.color.alpha != right.color.alpha)
+                    return false;
+            }
+            
+            return true;
+        }
+        
+        HashCode Gradient::hash() const
+        {
+            HashCode hash = mStops.size();
+            for (const GradientStop &stop : mStops)
+                hash = hash * 31 + std::hash<Float>()(stop.location) + stop.color.premultiplied();
+            
+            return hash;
+        }
+    }
+}
+
+#endif /* GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster */
@@ -0,0 +1,1115 @@
+//
+//  raster.h
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/6/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef __gfx__raster__
+#define __gfx__raster__
+
+#if GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster
+
+#include "types.h"
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gfx {
+    
+    ///The raster namespace contains the portable software renderer that backs
+    ///the graphics stack when Gfx is compiled with `GFX_Graphics_Use_Raster`.
+    ///
+    ///The renderer draws anti-aliased paths into premultiplied RGBA8 surfaces.
+    ///Paths are flattened into line segments, and the exact area each segment
+    ///covers is accumulated one row of pixels at a time. Every row of output
+    ///only depends on the geometry being drawn and the horizontal extent of the
+    ///clip, never on which other rows are being drawn.
+    ///
+    ///The types in this namespace mirror the CoreGraphics types the rest of the
+    ///graphics stack is written against, and are exposed through the `NativeType`
+    ///of `gfx::Context`, `gfx::Path`, `gfx::Color`, `gfx::Gradient`, and `gfx::Image`.
+    namespace raster {
+    
+#pragma mark - Colors
+        
+        ///A color with unpremultiplied components in the range [0, 1].
+        struct Color
+        {
+            Float red;
+            Float green;
+            Float blue;
+            Float alpha;
+            
+            ///Returns the color as a premultiplied pixel.
+            uint32_t premultiplied() const;
+        };
+        
+        ///Returns a premultiplied pixel from 8-bit components.
+        ///
+        ///Pixels are stored with red in the lowest byte and alpha in the highest,
+        ///which is RGBA byte order in memory on little endian hosts.
+        inline uint32_t pixel(uint32_t red, uint32_t green, uint32_t blue, uint32_t alpha)
+        {
+            return red | (green << 8) | (blue << 16) | (alpha << 24);
+        }
+        
+#pragma mark - Surfaces
+        
+        ///The Surface class encapsulates a bitmap of premultiplied RGBA8 pixels.
+        ///
+        ///Surfaces are reference counted so that images may share them without
+        ///copying, in the same manner as `CGImage`. Surfaces are created with a
+        ///retain count of 1, and are destroyed when their count reaches 0.
+        class Surface
+        {
+            ///The retain count of the surface.
+            mutable std::atomic<long> mRetainCount;
+            
+            ///The width of the surface in pixels.
+            size_t mWidth;
+            
+            ///The height of the surface in pixels.
+            size_t mHeight;
+            
+            ///The pixels of the surface, from the top row to the bottom.
+            std::vector<uint32_t> mPixels;
+            
+            Surface(const Surface &) = delete;
+            Surface &operator=(const Surface &) = delete;
+            
+            ~Surface();
+            
+        public:
+            
+            ///Constructs a transparent surface of a given size.
+            Surface(size_t width, size_t height);
+            
+            ///Constructs a surface by copying the pixels of another surface.
+            explicit Surface(const Surface *other);
+            
+            ///Increments the retain count of the receiver, returning it.
+            Surface *retain();
+            const Surface *retain() const;
+            
+            ///Decrements the retain count of the receiver, destroying it if the count reaches 0.
+            void release() const;
+            
+            ///Returns the retain count of the receiver. A count greater
+            ///than 1 indicates that the surface is shared.
+            long retainCount() const { return mRetainCount.load(std::memory_order_acquire); }
+            
+#pragma mark -
+            
+            ///Returns the width of the surface in pixels.
+            size_t width() const { return mWidth; }
+            
+            ///Returns the height of the surface in pixels.
+            size_t height() const { return mHeight; }
+            
+            ///Returns the pixels of a given row.
+            uint32_t *row(size_t y) { return mPixels.data() + y * mWidth; }
+            const uint32_t *row(size_t y) const { return mPixels.data() + y * mWidth; }
+            
+            ///Returns the pixels of the surface.
+            uint32_t *pixels() { return mPixels.data(); }
+            const uint32_t *pixels() const { return mPixels.data(); }
+            
+            ///Returns whether or not the pixels of the receiver are equal to those of another surface.
+            bool isEqual(const Surface *other) const;
+            
+            ///Returns a hash of the pixels of the receiver.
+            HashCode hash() const;
+            
+#pragma mark -
+            
+            ///Creates a surface half the width and height of the receiver, rounded up,
+            ///where each pixel is the average of a 2x2 block of the receiver's pixels.
+            ///
+            /// \result A new surface with a retain count of 1.
+            ///
+            ///Repeatedly halving a surface produces the levels of a mipmap, which
+            ///may be drawn in place of the surface when it is greatly scaled down.
+            Surface *makeHalfSize() const;
+        };
+        
+        ///The SurfacePool class keeps the pixel buffers of destroyed surfaces so that
+        ///new surfaces of a similar size may reuse them instead of allocating memory.
+        ///
+        ///Buffers are grouped into buckets by capacity. Each range of sizes from one power
+        ///of two, exclusive, up to the next, inclusive, is split into four buckets of equal
+        ///width, so a reused buffer is always less than a quarter larger than the surface
+        ///it backs. The pool keeps at most `budget()` bytes of idle buffers,
+        ///evicting the least recently recycled buffers first.
+        ///
+        ///Surfaces acquire and recycle their buffers through the shared pool automatically.
+        ///All methods of this class are thread-safe.
+        class SurfacePool
+        {
+            ///An idle buffer.
+            struct Entry
+            {
+                ///The bucket capacity of the buffer, in pixels.
+                size_t capacity;
+                
+                ///The buffer.
+                std::vector<uint32_t> pixels;
+            };
+            
+            ///Guards the members of the pool.
+            mutable std::mutex mMutex;
+            
+            ///The idle buffers, from the most recently recycled to the least.
+            std::list<Entry> mEntries;
+            
+            ///The maximum number of bytes of idle buffers to keep.
+            size_t mBudget;
+            
+            ///The number of bytes of idle buffers currently kept.
+            size_t mPooledBytes;
+            
+            ///Evicts the least recently recycled buffers until the pool fits within its budget.
+            void trim();
+            
+        public:
+            
+            ///The default budget of the shared pool, in bytes.
+            static const size_t kDefaultBudget = 64 * 1024 * 1024;
+            
+            ///Buffers smaller than this many pixels are left to the allocator.
+            static const size_t kMinimumPooledPixels = 64 * 64;
+            
+            ///Returns the pool used by all surfaces.
+            static SurfacePool &shared();
+            
+            ///Returns the capacity of the bucket that holds buffers for a given number of pixels.
+            static size_t bucketCapacity(size_t count);
+            
+            ///Constructs an empty pool with a given budget in bytes.
+            explicit SurfacePool(size_t budget);
+            
+#pragma mark -
+            
+            ///Returns a buffer of a given number of pixels, reusing an idle buffer if one fits.
+            ///
+            ///The contents of the buffer are unspecified.
+            std::vector<uint32_t> acquire(size_t count);
+            
+            ///Takes a buffer that is no longer in use, leaving the given vector empty.
+            void recycle(std::vector<uint32_t> &pixels);
+            
+            ///Evicts every idle buffer.
+            void purge();
+            
+#pragma mark -
+            
+            ///Sets the maximum number of bytes of idle buffers to keep, evicting as needed.
+            void setBudget(size_t budget);
+            
+            ///Returns the maximum number of bytes of idle buffers to keep.
+            size_t budget() const;
+            
+            ///Returns the number of bytes of idle buffers currently kept.
+            size_t pooledBytes() const;
+        };
+        
+#pragma mark - Encoding and Decoding
+        
+        ///The filters that may be applied to the scanlines of a PNG before it is compressed.
+        enum class PNGFilter
+        {
+            ///Each scanline uses the filter that gives the smallest sum of
+            ///absolute differences, as the PNG specification suggests.
+            Adaptive,
+            
+            ///Scanlines are compressed as they are.
+            None,
+            
+            ///Each byte is predicted from the pixel to its left.
+            Sub,
+            
+            ///Each byte is predicted from the pixel above it.
+            Up,
+            
+            ///Each byte is predicted from the average of the pixels to its left and above it.
+            Average,
+            
+            ///Each byte is predicted with the Paeth predictor.
+            Paeth,
+        };
+        
+        ///The options used to encode a PNG.
+        struct PNGEncodingOptions
+        {
+            ///The zlib compression level, from 0 for no compression to 9 for
+            ///the smallest output, or -1 for the zlib default.
+            int compressionLevel;
+            
+            ///The filter applied to the scanlines of the PNG.
+            PNGFilter filter;
+        };
+        
+        ///A function that is given the bytes of an encoded image in order as they are produced.
+        ///
+        ///Returns false to stop encoding, such as when the bytes could not be written.
+        typedef std::function<bool(const uint8_t *bytes, size_t length)> EncodedBytesFunctor;
+        
+        ///Encodes a surface as a PNG with 8-bit unpremultiplied RGBA pixels.
+        ///
+        /// \param  surface     The surface to encode. Required.
+        /// \param  options     The options to encode the PNG with.
+        /// \param  write       Invoked with the bytes of the PNG as they are produced.
+        ///
+        /// \result true if the surface could be encoded; false otherwise.
+        ///
+        ///The rows of the surface are split into bands that are filtered and compressed
+        ///concurrently using the shared worker pool. Each band is primed with the data
+        ///of the band above it, and the compressed bands are joined into a single zlib
+        ///stream, so the output is a standard PNG that compresses nearly as well as one
+        ///compressed serially. Bands are handed to `write` as soon as every band above
+        ///them is complete, from whichever thread completed them, but never concurrently.
+        extern bool encodePNG(const Surface *surface, const PNGEncodingOptions &options, const EncodedBytesFunctor &write);
+        
+        ///Encodes a surface as a PNG with 8-bit unpremultiplied RGBA pixels,
+        ///using adaptive filtering and the default compression level.
+        ///
+        /// \param  surface     The surface to encode. Required.
+        /// \param  outData     On return, contains the PNG.
+        ///
+        /// \result true if the surface could be encoded; false otherwise.
+        ///
+        extern bool encodePNG(const Surface *surface, std::vector<uint8_t> &outData);
+        
+        ///Encodes a surface in the Quite OK Image format with unpremultiplied RGBA pixels.
+        ///
+        /// \param  surface     The surface to encode. Required.
+        /// \param  write       Invoked with the bytes of the image as they are produced.
+        ///
+        /// \result true if the surface could be encoded; false otherwise.
+        ///
+        extern bool encodeQOI(const Surface *surface, const EncodedBytesFunctor &write);
+        
+        ///Encodes a surface as a binary PPM. The surface is composited over black.
+        ///
+        /// \param  surface     The surface to encode. Required.
+        /// \param  write       Invoked with the bytes of the image as they are produced.
+        ///
+        /// \result true if the surface could be encoded; false otherwise.
+        ///
+        extern bool encodePPM(const Surface *surface, const EncodedBytesFunctor &write);
+        
+        ///Encodes the pixels of a surface as unpremultiplied RGBA bytes without a header,
+        ///from the top row to the bottom.
+        ///
+        /// \param  surface     The surface to encode. Required.
+        /// \param  write       Invoked with the bytes of the image as they are produced.
+        ///
+        /// \result true if the surface could be encoded; false otherwise.
+        ///
+        extern bool encodeRGBA(const Surface *surface, const EncodedBytesFunctor &write);
+        
+        ///Decodes a PNG into a new surface.
+        ///
+        /// \param  bytes   The contents of the PNG.
+        /// \param  length  The number of bytes.
+        ///
+        /// \result A new surface with a retain count of 1 if the PNG could be decoded; null otherwise.
+        ///
+        ///Every color type and bit depth is supported, including interlaced images.
+        ///Ancillary chunks other than transparency are ignored.
+        extern Surface *decodePNG(const uint8_t *bytes, size_t length);
+        
+        ///Reads the size of a PNG without decoding its pixels.
+        ///
+        /// \param  bytes       The contents of the PNG.
+        /// \param  length      The number of bytes.
+        /// \param  outWidth    On return, contains the width of the PNG in pixels.
+        /// \param  outHeight   On return, contains the height of the PNG in pixels.
+        ///
+        /// \result true if the PNG has a valid header; false otherwise.
+        ///
+        extern bool readPNGSize(const uint8_t *bytes, size_t length, size_t &outWidth, size_t &outHeight);
+        
+#pragma mark - Paths
+        
+        ///The rules that determine which areas are inside of a path.
+        enum class FillRule {
+            ///Areas a path winds around a non-zero number of times are inside.
+            NonZero,
+            
+            ///Areas a path winds around an odd number of times are inside.
+            EvenOdd,
+        };
+        
+        ///The line cap styles. Values match `CGLineCap`.
+        enum class LineCap {
+            Butt = 0,
+            Round = 1,
+            Square = 2,
+        };
+        
+        ///The line join styles. Values match `CGLineJoin`.
+        enum class LineJoin {
+            Miter = 0,
+            Round = 1,
+            Bevel = 2,
+        };
+        
+        ///A flattened subpath.
+        struct Contour
+        {
+            ///The points of the contour.
+            std::vector<Point> points;
+            
+            ///Whether or not the last point connects back to the first.
+            bool closed;
+        };
+        
+        struct StrokeStyle;
+        
+        ///The Path class encapsulates a sequence of bézier subpaths.
+        ///
+        ///Like `CGPath`, every method that adds to a path takes a transform that
+        ///is applied to the added geometry. Points queried from a path are in
+        ///the coordinate space of the path, after those transforms.
+        ///
+        ///The bounds, flattened polylines and stroked outline of a path are computed
+        ///on demand and memoized until the path is changed. Copies of a path share
+        ///its memoized geometry until either of them is changed.
+        class Path
+        {
+        public:
+            
+            ///The elements of a path.
+            enum class Verb : uint8_t {
+                ///Starts a new subpath. Uses one point.
+                Move,
+                
+                ///Adds a line. Uses one point.
+                Line,
+                
+                ///Adds a quadratic curve. Uses a control point and an end point.
+                Quad,
+                
+                ///Adds a cubic curve. Uses two control points and an end point.
+                Cubic,
+                
+                ///Closes the current subpath. Uses no points.
+                Close,
+            };
+            
+        protected:
+            
+            ///The elements of the path.
+            std::vector<Verb> mVerbs;
+            
+            ///The points used by the elements of the path.
+            std::vector<Point> mPoints;
+            
+            ///The first point of the current subpath.
+            Point mSubpathStart;
+            
+            ///The geometry derived from the elements of a path.
+            struct Geometry;
+            
+            ///The memoized geometry of the path, or null if none has been computed since it last changed.
+            mutable std::shared_ptr<Geometry> mGeometry;
+            
+            ///Ensures there is a subpath to add a segment to.
+            void ensureSubpath();
+            
+            ///Returns the memoized geometry of the path, creating it if needed.
+            Geometry &geometry() const;
+            
+            ///Discards the memoized geometry of the path. Invoked whenever the path changes.
+            void invalidateGeometry();
+            
+            ///Computes the smallest bounding box of the path, excluding control points.
+            Rect computePathBoundingBox() const;
+            
+        public:
+            
+            Path();
+            
+#pragma mark - Constructing Paths
+            
+            void moveTo(Point point, const Transform2D &transform);
+            void lineTo(Point point, const Transform2D &transform);
+            void quadTo(Point controlPoint, Point point, const Transform2D &transform);
+            void cubicTo(Point controlPoint1, Point controlPoint2, Point point, const Transform2D &transform);
+            void close();
+            
+            ///Adds a closed rectangle subpath.
+            void addRect(Rect rect, const Transform2D &transform);
+            
+            ///Adds a closed rectangle subpath with elliptical corners.
+            void addRoundedRect(Rect rect, Float cornerWidth, Float cornerHeight, const Transform2D &transform);
+            
+            ///Adds a closed ellipse subpath fit into a rectangle.
+            void addEllipse(Rect rect, const Transform2D &transform);
+            
+            ///Adds an arc of a given radius tangent to the lines from the current
+            ///point to point1, and from point1 to point2. Matches `CGPathAddArcToPoint`.
+            void addArcToPoint(Point point1, Point point2, Float radius, const Transform2D &transform);
+            
+            ///Adds the subpaths of another path.
+            void addPath(const Path &other, const Transform2D &transform);
+            
+            ///Adds a subpath of lines through a sequence of points. Matches `CGPathAddLines`.
+            void addLines(const Point *points, size_t count, const Transform2D &transform);
+            
+#pragma mark - Introspection
+            
+            ///Returns the elements of the path.
+            const std::vector<Verb> &verbs() const { return mVerbs; }
+            
+            ///Returns the points of the path.
+            const std::vector<Point> &points() const { return mPoints; }
+            
+            ///Returns whether or not the path has no elements.
+            bool isEmpty() const;
+            
+            ///Returns the current point of the path.
+            Point currentPoint() const;
+            
+            ///Returns the bounding box of every point of the path, including control points.
+            Rect boundingBox() const;
+            
+            ///Returns the smallest bounding box of the path, excluding control points.
+            Rect pathBoundingBox() const;
+            
+            ///Returns whether or not the path is a single rectangle, yielding it.
+            bool isRect(Rect *outRect) const;
+            
+            ///Returns whether or not a point is inside of the path after a given transform is applied to it.
+            bool containsPoint(Point point, FillRule rule, const Transform2D &transform) const;
+            
+            bool operator==(const Path &other) const;
+            bool operator!=(const Path &other) const { return !(*this == other); }
+            
+            ///Returns a hash of the elements of the path.
+            HashCode hash() const;
+            
+#pragma mark - Flattening
+            
+            ///Flattens the path into polylines.
+            ///
+            /// \param  transform       The transform to apply to the path before flattening.
+            /// \param  tolerance       The largest distance allowed between a curve
+            ///                         and its polyline, after the transform.
+            /// \param  outContours     On return, contains a contour for each subpath.
+            ///
+            void flatten(const Transform2D &transform, Float tolerance, std::vector<Contour> &outContours) const;
+            
+            ///Returns the path flattened into polylines, memoizing the result.
+            ///
+            ///Only the contours of the most recent transform and tolerance are kept,
+            ///so drawing a path repeatedly under the same transform flattens it once.
+            std::shared_ptr<const std::vector<Contour>> flattened(const Transform2D &transform, Float tolerance) const;
+            
+            ///Returns polygons covering the stroke of the path, memoizing the result.
+            ///
+            /// \param  style       The style of the stroke.
+            /// \param  tolerance   The largest distance allowed between a curve and its polyline.
+            ///
+            /// \result Polygons in the coordinate space of the path that cover its stroke when
+            ///         filled with `FillRule::NonZero`. Only the outline of the most recent style
+            ///         and tolerance is kept.
+            std::shared_ptr<const std::vector<Contour>> stroked(const StrokeStyle &style, Float tolerance) const;
+        };
+        
+#pragma mark - Stroking
+        
+        ///The attributes of a stroked line.
+        struct StrokeStyle
+        {
+            Float width;
+            LineCap cap;
+            LineJoin join;
+            Float miterLimit;
+        };
+        
+        ///Converts flattened contours into closed polygons that cover their stroke.
+        ///
+        /// \param  contours    The contours to stroke.
+        /// \param  style       The style of the stroke.
+        /// \param  tolerance   The largest distance allowed between a round cap or join and its polygon.
+        /// \param  outPolygons On return, contains polygons that cover the stroke when filled with `FillRule::NonZero`.
+        ///
+        ///Each segment, join and cap becomes its own positively wound polygon, so that
+        ///the union of them is filled without seams under the non-zero fill rule.
+        extern void stroke(const std::vector<Contour> &contours, const StrokeStyle &style,
+                           Float tolerance, std::vector<Contour> &outPolygons);
+                           
+#pragma mark - Gradients
+        
+        ///A color stop of a gradient.
+        struct GradientStop
+        {
+            ///The location of the stop in the range [0, 1].
+            Float location;
+            
+            ///The color of the stop.
+            Color color;
+        };
+        
+        ///The Gradient class encapsulates the color stops of a gradient.
+        ///
+        ///The colors of a gradient are precomputed into a lookup table when it is
+        ///constructed, so that shading a pixel does not search or interpolate stops.
+        ///Copies of a gradient share its lookup table.
+        class Gradient
+        {
+        public:
+            
+            ///The number of entries in the lookup table of a gradient.
+            static const size_t kLookupTableSize = 1024;
+            
+        protected:
+            
+            ///The stops of the gradient, ordered by location.
+            std::vector<GradientStop> mStops;
+            
+            ///The premultiplied colors of the gradient at evenly spaced locations from 0 to 1.
+            std::shared_ptr<const std::vector<uint32_t>> mLookupTable;
+            
+        public:
+            
+            ///Constructs a gradient with a given set of stops, in any order.
+            explicit Gradient(const std::vector<GradientStop> &stops);
+            
+            ///Returns the stops of the gradient, ordered by location.
+            const std::vector<GradientStop> &stops() const { return mStops; }
+            
+            ///Returns the premultiplied color of the gradient at a location in the range [0, 1].
+            ///
+            ///The color is interpolated from the stops of the gradient. Use `lookupTable`
+            ///when shading many pixels.
+            uint32_t colorAt(Float location) const;
+            
+            ///Returns the lookup table of the gradient, containing `kLookupTableSize`
+            ///premultiplied colors at evenly spaced locations from 0 to 1.
+            const uint32_t *lookupTable() const { return mLookupTable->data(); }
+            
+            bool operator==(const Gradient &other) const;
+            
+            ///Returns a hash of the stops of the gradient.
+            HashCode hash() const;
+        };
+        
+        ///Options for drawing gradients. Values match `CGGradientDrawingOptions`.
+        enum GradientDrawingOptions {
+            ///Extend the first color of the gradient before its start.
+            DrawsBeforeStartLocation = (1 << 0),
+            
+            ///Extend the last color of the gradient after its end.
+            DrawsAfterEndLocation = (1 << 1),
+        };
+        
+#pragma mark - Typefaces
+        
+        ///The Typeface class encapsulates the outlines and metrics of a TrueType font.
+        ///
+        ///Only fonts with quadratic `glyf` outlines are supported, and only the first
+        ///font of a collection is used. Typefaces are immutable once they are loaded,
+        ///and are shared by every font created from them.
+        class Typeface
+        {
+        protected:
+            
+            ///The contents of the font file.
+            std::vector<uint8_t> mData;
+            
+            ///The number that identifies the typeface in the glyph atlas.
+            uint64_t mUniqueID;
+            
+            ///The offsets of the tables used by the typeface within `mData`.
+            size_t mGlyphOffsets, mGlyphs, mHorizontalMetrics, mCharacterMap;
+            
+            ///The lengths of the tables used by the typeface.
+            size_t mGlyphOffsetsLength, mGlyphsLength, mHorizontalMetricsLength, mCharacterMapLength;
+            
+            ///Whether or not the glyph offsets table uses 32-bit offsets.
+            bool mHasLongGlyphOffsets;
+            
+            ///The number of glyphs in the typeface.
+            uint16_t mNumberOfGlyphs;
+            
+            ///The number of glyphs with an advance in the horizontal metrics table.
+            uint16_t mNumberOfHorizontalMetrics;
+            
+            ///The metrics of the typeface, in font units.
+            Float mUnitsPerEm, mAscender, mDescender, mLineGap;
+            
+            ///The names of the typeface.
+            std::string mPostScriptName, mFullName;
+            
+            explicit Typeface(std::vector<uint8_t> &&data);
+            
+            ///Locates the tables of the typeface, returning whether or not it can be used.
+            bool load();
+            
+            ///Adds the outline of a glyph, following the components of composite glyphs up to a given depth.
+            void addGlyphOutline(uint16_t glyph, const Transform2D &transform, Path &path, int depth) const;
+        
+        public:
+            
+            ///Returns a typeface loaded from the contents of a font file.
+            ///
+            /// \result The typeface, or null if the data is not a supported font.
+            static std::shared_ptr<const Typeface> withData(std::vector<uint8_t> data);
+            
+            ///Returns the installed typeface with a given PostScript name, full name, or file path.
+            ///
+            ///The font directories of the system and the user are searched the first time a
+            ///typeface is looked up by name. Typefaces are loaded once and kept for the life
+            ///of the process.
+            ///
+            /// \result The typeface, or null if none could be found.
+            static std::shared_ptr<const Typeface> named(const std::string &name);
+            
+#pragma mark -
+            
+            ///Returns the number that identifies the typeface. Never reused.
+            uint64_t uniqueID() const { return mUniqueID; }
+            
+            ///Returns the PostScript name of the typeface.
+            const std::string &postScriptName() const { return mPostScriptName; }
+            
+            ///Returns the full name of the typeface.
+            const std::string &fullName() const { return mFullName; }
+            
+            ///Returns the number of font units in the em square.
+            Float unitsPerEm() const { return mUnitsPerEm; }
+            
+            ///Returns the distance from the baseline to the top of the tallest ascender, in font units.
+            Float ascender() const { return mAscender; }
+            
+            ///Returns the distance from the baseline to the bottom of the lowest descender, in font units. Negative.
+            Float descender() const { return mDescender; }
+            
+            ///Returns the space between lines, in font units.
+            Float lineGap() const { return mLineGap; }
+            
+#pragma mark -
+            
+            ///Returns the glyph for a Unicode code point, or 0 if the typeface has none.
+            uint16_t glyphForCharacter(uint32_t character) const;
+            
+            ///Returns the advance width of a glyph, in font units.
+            Float advance(uint16_t glyph) const;
+            
+            ///Adds the outline of a glyph to a path.
+            ///
+            /// \param  glyph       The glyph.
+            /// \param  transform   The transform from font units, with y increasing upwards, to the space of the path.
+            /// \param  path        The path to add the outline to.
+            ///
+            void addGlyphOutline(uint16_t glyph, const Transform2D &transform, Path &path) const;
+        };
+        
+        ///A glyph and the position of its origin on the baseline.
+        struct PositionedGlyph
+        {
+            ///The glyph.
+            uint16_t glyph;
+            
+            ///The position of the origin of the glyph.
+            Point position;
+        };
+        
+        ///A typeface at a size. The native type of `gfx::Font`.
+        struct Font
+        {
+            ///The typeface.
+            std::shared_ptr<const Typeface> typeface;
+            
+            ///The size of the font, in points per em.
+            Float size;
+        };
+        
+#pragma mark - Canvases
+        
+        ///A rectangle of pixels.
+        struct PixelRect
+        {
+            long x;
+            long y;
+            long width;
+            long height;
+            
+            ///Returns whether or not the rectangle contains no pixels.
+            bool isEmpty() const { return (width <= 0 || height <= 0); }
+            
+            ///Returns the intersection of the receiver and another rectangle.
+            PixelRect intersection(const PixelRect &other) const;
+            
+            ///Returns the smallest rectangle of pixels that touches a given rectangle.
+            static PixelRect enclosing(Rect rect);
+        };
+        
+        ///The Canvas class encapsulates drawing into a `raster::Surface`.
+        ///
+        ///Canvas is a state machine equivalent to a `CGContext`. It maintains a
+        ///stack of graphics states containing the current transformation matrix,
+        ///the clip, the fill and stroke colors, the line style, and the shadow.
+        ///
+        ///Device space has its origin in the top left corner of the surface,
+        ///with y increasing downwards.
+        ///
+        ///A canvas may defer drawing by recording each operation into a display
+        ///list. Deferred operations are binned into horizontal bands of the surface
+        ///which are rendered concurrently when the canvas is flushed. Every band
+        ///renders its operations in the order they were recorded, and rows of
+        ///coverage do not depend on the rows rendered alongside them, so deferred
+        ///drawing is pixel-identical to immediate drawing.
+        class Canvas
+        {
+        public:
+            
+            ///A clip that is not a simple rectangle of pixels.
+            struct ClipMask
+            {
+                ///The pixels the mask covers.
+                PixelRect bounds;
+                
+                ///The coverage of each pixel in the bounds, from 0 to 255.
+                std::vector<uint8_t> coverage;
+            };
+            
+            ///A graphics state.
+            struct State
+            {
+                ///The current transformation matrix.
+                Transform2D transform;
+                
+                ///The pixels that may be drawn into.
+                PixelRect clipBounds;
+                
+                ///The coverage of the clip within its bounds, if it is not rectangular.
+                std::shared_ptr<const ClipMask> clipMask;
+                
+                ///The premultiplied fill color.
+                uint32_t fillColor;
+                
+                ///The premultiplied stroke color.
+                uint32_t strokeColor;
+                
+                ///The style of stroked lines.
+                StrokeStyle strokeStyle;
+                
+                ///The offset of the shadow in device space.
+                Size shadowOffset;
+                
+                ///The blur radius of the shadow in device space.
+                Float shadowBlur;
+                
+                ///The premultiplied color of the shadow. Zero if there is no shadow.
+                uint32_t shadowColor;
+            };
+            
+            ///A source of premultiplied pixels for filling an area.
+            class Shader
+            {
+            public:
+                virtual ~Shader() {}
+                
+                ///Writes the pixels of a run in a row of device space.
+                virtual void shadeRow(long x, long y, long count, uint32_t *outPixels) const = 0;
+            };
+            
+            ///A drawing operation whose coverage has been computed against
+            ///the clip, ready to be rendered into any range of rows.
+            struct Command;
+            
+        protected:
+            
+            ///The surface drawn into.
+            Surface *mSurface;
+            
+            ///The graphics state stack. The last state is the current one.
+            std::vector<State> mStates;
+            
+            ///Whether or not drawing is recorded instead of performed immediately.
+            bool mDeferred;
+            
+            ///The drawing recorded since the canvas was last flushed.
+            std::vector<std::unique_ptr<Command>> mCommands;
+            
+            ///Returns the current graphics state.
+            State &state() { return mStates.back(); }
+            const State &state() const { return mStates.back(); }
+            
+            ///Returns the tolerance to flatten curves with in the current user space.
+            Float userSpaceTolerance() const;
+            
+            ///Returns the tolerance to flatten curves with so that they stay within
+            ///the tolerance of the current user space under each of a set of transforms.
+            Float instanceTolerance(const Transform2D *transforms, size_t count) const;
+            
+            ///Fills user space polygons once for each of a set of transforms.
+            void fillInstancePolygons(const std::vector<Contour> &polygons, FillRule rule, uint32_t color,
+                                      const Transform2D *transforms, size_t count);
+            
+            ///Performs a command immediately, or records it if the canvas is deferred.
+            void perform(std::unique_ptr<Command> command);
+            
+            ///Fills device space polygons with a solid color or a shader,
+            ///applying the shadow and the clip.
+            void fillDevicePolygons(const std::vector<Contour> &polygons, FillRule rule,
+                                    uint32_t color, std::shared_ptr<const Shader> shader);
+            
+            ///Clears the pixels covered by device space polygons.
+            void clearDevicePolygons(const std::vector<Contour> &polygons);
+            
+            ///Fills the current clip with a shader.
+            void fillClipWithShader(std::shared_ptr<const Shader> shader);
+            
+            ///Returns an image that is safe to sample while drawing, copying
+            ///the surface of the receiver if the image is that surface.
+            const Surface *sampleableImage(const Surface *image);
+            
+        public:
+            
+            ///Constructs a canvas that draws into a given surface, retaining it.
+            explicit Canvas(Surface *surface);
+            
+            ///The destructor. Performs any deferred drawing.
+            ~Canvas();
+            
+            ///Returns the surface drawn into, first performing any deferred drawing.
+            Surface *surface();
+            
+#pragma mark - Deferred Drawing
+            
+            ///The number of rows in each band of a surface rendered by a deferred canvas.
+            static const long kBandHeight = 64;
+            
+            ///The number of commands a deferred canvas records before it flushes itself.
+            static const size_t kMaximumDeferredCommands = 4096;
+            
+            ///Sets whether or not the receiver records drawing to be performed in
+            ///parallel when it is flushed. Turning deferral off flushes the receiver.
+            void setDeferred(bool deferred);
+            
+            ///Returns whether or not the receiver records drawing.
+            bool isDeferred() const { return mDeferred; }
+            
+            ///Performs any drawing recorded by the receiver.
+            void flush();
+            
+#pragma mark - Graphics State
+            
+            void save();
+            void restore();
+            
+            ///Returns the current graphics state.
+            const State &currentState() const { return state(); }
+            
+            Transform2D transform() const;
+            void concatTransform(const Transform2D &transform);
+            
+            void setFillColor(const Color &color);
+            void setStrokeColor(const Color &color);
+            
+            void setLineWidth(Float width);
+            void setLineCap(LineCap cap);
+            void setLineJoin(LineJoin join);
+            void setMiterLimit(Float limit);
+            
+            ///Sets the shadow of subsequent drawing. Matches `CGContextSetShadowWithColor`,
+            ///the offset and blur are in device space, and ignore the transform.
+            void setShadow(Size offset, Float blur, const Color &color);
+            
+            ///Removes the shadow of subsequent drawing.
+            void clearShadow();
+            
+#pragma mark - Clipping
+            
+            ///Intersects the clip with a rectangle in user space.
+            void clipToRect(Rect rect);
+            
+            ///Intersects the clip with a path in user space.
+            void clipToPath(const Path &path, FillRule rule);
+            
+            ///Returns the bounding box of the clip in user space.
+            Rect clipBoundingBox() const;
+            
+#pragma mark - Drawing
+            
+            void fillPath(const Path &path, FillRule rule);
+            void strokePath(const Path &path);
+            
+            ///Fills a path once for each of a set of transforms, which are applied in addition to the
+            ///current transform. The path is flattened once, rather than once for each instance.
+            void fillPathInstances(const Path &path, FillRule rule, const Transform2D *transforms, size_t count);
+            
+            ///Strokes a path once for each of a set of transforms, which are applied in addition to the
+            ///current transform. The outline of the stroke is computed once, rather than once for each instance.
+            void strokePathInstances(const Path &path, const Transform2D *transforms, size_t count);
+            
+            void fillRect(Rect rect);
+            void strokeRect(Rect rect);
+            void clearRect(Rect rect);
+            
+            ///Strokes a line between each pair of points.
+            void strokeLineSegments(const Point *points, size_t count);
+            
+            ///Fills glyphs of a typeface with the fill color.
+            ///
+            /// \param  typeface    The typeface of the glyphs.
+            /// \param  size        The size of the font in user space units per em.
+            /// \param  glyphs      The glyphs and the positions of their origins in user space.
+            /// \param  count       The number of glyphs.
+            ///
+            ///Glyphs drawn without rotation, skew or a shadow are composited from the shared
+            ///`GlyphAtlas`, with their origins snapped to the nearest row and to the nearest
+            ///subpixel position. Other glyphs are filled as paths.
+            void fillGlyphs(const Typeface &typeface, Float size, const PositionedGlyph *glyphs, size_t count);
+            
+            ///Draws a surface scaled into a rectangle in user space.
+            void drawImage(const Surface *image, Rect rect);
+            
+            ///Fills the clip with copies of a surface scaled to a rectangle in user space.
+            void drawTiledImage(const Surface *image, Rect rect);
+            
+            ///Fills a rectangle in user space with the pixels of a shader, applying the shadow and
+            ///the clip. The shader is given rows in device space, and may be called from any thread.
+            void fillRectWithShader(Rect rect, std::shared_ptr<const Shader> shader);
+            
+            ///Fills the clip with a linear gradient between two points in user space.
+            void drawLinearGradient(const Gradient &gradient, Point start, Point end, int options);
+            
+            ///Fills the clip with a radial gradient between two circles in user space.
+            void drawRadialGradient(const Gradient &gradient, Point startCenter, Float startRadius,
+                                    Point endCenter, Float endRadius, int options);
+        };
+        
+#pragma mark - Glyph Atlas
+        
+        ///The GlyphAtlas class caches the coverage of rasterized glyphs.
+        ///
+        ///Glyphs are rasterized once for each typeface, device size, glyph, and horizontal
+        ///subpixel position they are drawn at, and packed into shelves of pages of 8-bit
+        ///coverage. Drawing a run of cached glyphs blends rows of the pages directly, so
+        ///drawing the same labels on every redraw does not rasterize any outlines.
+        ///
+        ///When every page is full, the atlas is emptied and filling starts over. Pages
+        ///are shared with the drawing that refers to them, so emptying the atlas never
+        ///disturbs drawing that has been recorded but not yet performed. All methods
+        ///of this class are thread-safe.
+        class GlyphAtlas
+        {
+        public:
+            
+            ///The width and height of each page, in pixels.
+            static const long kPageSize = 512;
+            
+            ///The largest number of pages kept by the atlas.
+            static const size_t kMaximumPageCount = 8;
+            
+            ///The number of horizontal positions within a pixel that glyphs are rasterized at.
+            static const int kSubpixelPositions = 4;
+            
+            ///The largest device size of a font whose glyphs are cached. Glyphs of
+            ///larger fonts are filled as paths.
+            static const long kMaximumFontSize = 128;
+            
+            ///A page of coverage.
+            struct Page
+            {
+                ///The coverage of each pixel of the page, from 0 to 255.
+                std::vector<uint8_t> coverage;
+            };
+            
+            ///A glyph rasterized into a page.
+            struct Entry
+            {
+                ///The page containing the glyph.
+                std::shared_ptr<const Page> page;
+                
+                ///The pixels of the glyph within its page. Empty for glyphs with no outline.
+                PixelRect rect;
+                
+                ///The offset of the top left of the glyph from its origin, in whole pixels.
+                long left, top;
+            };
+        
+        protected:
+            
+            ///A glyph drawn at a size and subpixel position.
+            struct Key
+            {
+                uint64_t typeface;
+                Float size;
+                int subpixelPosition;
+                uint16_t glyph;
+                
+                bool operator==(const Key &other) const
+                {
+                    return (typeface == other.typeface && size == other.size &&
+                            subpixelPosition == other.subpixelPosition && glyph == other.glyph);
+                }
+            };
+            
+            ///Hashes a glyph key.
+            struct KeyHash
+            {
+                size_t operator()(const Key &key) const;
+            };
+            
+            ///Guards the members of the atlas.
+            mutable std::mutex mMutex;
+            
+            ///The pages of the atlas. The last page is the one being filled.
+            std::vector<std::shared_ptr<Page>> mPages;
+            
+            ///The cached glyphs.
+            std::unordered_map<Key, Entry, KeyHash> mEntries;
+            
+            ///The position and height of the shelf being filled in the last page.
+            long mShelfX, mShelfY, mShelfHeight;
+            
+            ///Reserves an area of a page for a glyph of a given size, returning the page and the area.
+            ///
+            ///The atlas must be locked by the caller.
+            std::shared_ptr<Page> allocate(long width, long height, PixelRect &outRect);
+        
+        public:
+            
+            GlyphAtlas();
+            
+            ///Returns the atlas used by all canvases.
+            static GlyphAtlas &shared();
+            
+#pragma mark -
+            
+            ///Returns a glyph of a typeface, rasterizing it if it is not in the atlas.
+            ///
+            /// \param  typeface            The typeface of the glyph.
+            /// \param  size                The size of the font in device pixels per em. At most `kMaximumFontSize`.
+            /// \param  subpixelPosition    The horizontal position of the origin of the glyph within
+            ///                             a pixel, from 0 to `kSubpixelPositions - 1`.
+            /// \param  glyph               The glyph.
+            ///
+            Entry entryFor(const Typeface &typeface, Float size, int subpixelPosition, uint16_t glyph);
+            
+            ///Empties the atlas.
+            void removeAll();
+            
+            ///Returns the number of pages in the atlas.
+            size_t pageCount() const;
+        };
+    }
+}
+
+#endif /* GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster */
+
+#endif /* defined(__gfx__raster__) */
@@ -0,0 +1,1672 @@
+//
+//  rastercanvas.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/6/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#if GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster
+
+#include "raster.h"
+#include "threading.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#   error "The raster backend stores pixels as RGBA bytes, which requires a little endian host."
+#endif /* __BYTE_ORDER__ */
+
+namespace gfx {
+    namespace raster {
+    
+#pragma mark - Pixel Rects
+        
+        PixelRect PixelRect::intersection(const PixelRect &other) const
+        {
+            long minX = std::max(x, other.x), minY = std::max(y, other.y);
+            long maxX = std::min(x + width, other.x + other.width);
+            long maxY = std::min(y + height, other.y + other.height);
+            return PixelRect{ minX, minY, std::max(0L, maxX - minX), std::max(0L, maxY - minY) };
+        }
+        
+        PixelRect PixelRect::enclosing(Rect rect)
+        {
+            const Float kLimit = Float(1L << 30);
+            auto clamp = [kLimit](Float value) { return std::max(-kLimit, std::min(kLimit, value)); };
+            
+            long minX = long(std::floor(clamp(rect.getMinX()))), minY = long(std::floor(clamp(rect.getMinY())));
+            long maxX = long(std::ceil(clamp(rect.getMaxX()))), maxY = long(std::ceil(clamp(rect.getMaxY())));
+            return PixelRect{ minX, minY, maxX - minX, maxY - minY };
+        }
+        
+#pragma mark - Vector Kernels
+        
+        /* The compositing kernels operate on four pixels at a time using the
+           vector extensions of GCC and clang, which lower to SSE2 and NEON.
+           Every kernel has a scalar twin for the ends of spans, written with
+           the same templates so that both produce identical results. */
+        
+        typedef uint32_t U32x4 __attribute__((vector_size(16)));
+        typedef int32_t I32x4 __attribute__((vector_size(16)));
+        typedef float F32x4 __attribute__((vector_size(16)));
+        
+        template<typename Vector, typename Scalar>
+        static inline Vector Load(const Scalar *source)
+        {
+            Vector vector;
+            memcpy(&vector, source, sizeof(vector));
+            return vector;
+        }
+        
+        template<typename Vector, typename Scalar>
+        static inline void Store(Scalar *destination, Vector vector)
+        {
+            memcpy(destination, &vector, sizeof(vector));
+        }
+        
+        ///Takes the lanes of `ifTrue` where `mask` is set, and the lanes of `ifFalse` elsewhere.
+        template<typename Mask, typename Vector>
+        static inline Vector Select(Mask mask, Vector ifTrue, Vector ifFalse)
+        {
+            return (Vector)(((Mask)ifTrue & mask) | ((Mask)ifFalse & ~mask));
+        }
+        
+        ///Multiplies the two 8-bit channels at bits 0-7 and 16-23 of each lane
+        ///by a factor in [0, 255], dividing by 255 with correct rounding.
+        template<typename T>
+        static inline T ScalePairs(T pairs, T factor)
+        {
+            T product = pairs * factor + 0x00800080;
+            return ((product + ((product >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+        }
+        
+        ///Multiplies every channel of premultiplied pixels by a factor in [0, 255].
+        template<typename T>
+        static inline T ScalePixels(T pixels, T factor)
+        {
+            return ScalePairs(pixels & 0x00ff00ff, factor) | (ScalePairs((pixels >> 8) & 0x00ff00ff, factor) << 8);
+        }
+        
+        ///Composites premultiplied source pixels over destination pixels.
+        template<typename T>
+        static inline T SourceOver(T source, T destination)
+        {
+            return source + ScalePixels(destination, 255 - (source >> 24));
+        }
+        
+        ///Returns four coverage values widened into the lanes of a vector.
+        static inline U32x4 WidenCoverage(const uint8_t *coverage)
+        {
+            return U32x4{ coverage[0], coverage[1], coverage[2], coverage[3] };
+        }
+        
+        static inline uint32_t LoadCoverageWord(const uint8_t *coverage)
+        {
+            uint32_t word;
+            memcpy(&word, coverage, sizeof(word));
+            return word;
+        }
+        
+        ///Composites a solid premultiplied color over a span with per-pixel coverage.
+        static void BlendSolidSpan(uint32_t *destination, uint32_t color, const uint8_t *coverage, long count)
+        {
+            const U32x4 colorVector = { color, color, color, color };
+            const bool isOpaque = ((color >> 24) == 255);
+            
+            long index = 0;
+            for (; index + 4 <= count; index += 4) {
+                uint32_t coverageWord = LoadCoverageWord(coverage + index);
+                if(coverageWord == 0)
+                    continue;
+                
+                if(coverageWord == 0xffffffff && isOpaque) {
+                    Store(destination + index, colorVector);
+                    continue;
+                }
+                
+                U32x4 source = ScalePixels(colorVector, WidenCoverage(coverage + index));
+                Store(destination + index, SourceOver(source, Load<U32x4>(destination + index)));
+            }
+            
+            for (; index < count; index++) {
+                if(coverage[index] == 0)
+                    continue;
+                
+                uint32_t source = ScalePixels<uint32_t>(color, coverage[index]);
+                destination[index] = SourceOver<uint32_t>(source, destination[index]);
+            }
+        }
+        
+        ///Composites a span of premultiplied pixels over a span with per-pixel coverage.
+        static void BlendSpan(uint32_t *destination, const uint32_t *source, const uint8_t *coverage, long count)
+        {
+            long index = 0;
+            for (; index + 4 <= count; index += 4) {
+                uint32_t coverageWord = LoadCoverageWord(coverage + index);
+                if(coverageWord == 0)
+                    continue;
+                
+                U32x4 sourceVector = Load<U32x4>(source + index);
+                if(coverageWord != 0xffffffff)
+                    sourceVector = ScalePixels(sourceVector, WidenCoverage(coverage + index));
+                
+                Store(destination + index, SourceOver(sourceVector, Load<U32x4>(destination + index)));
+            }
+            
+            for (; index < count; index++) {
+                if(coverage[index] == 0)
+                    continue;
+                
+                uint32_t sourcePixel = ScalePixels<uint32_t>(source[index], coverage[index]);
+                destination[index] = SourceOver<uint32_t>(sourcePixel, destination[index]);
+            }
+        }
+        
+        ///Clears a span in proportion to per-pixel coverage.
+        static void ClearSpan(uint32_t *destination, const uint8_t *coverage, long count)
+        {
+            long index = 0;
+            for (; index + 4 <= count; index += 4) {
+                U32x4 remaining = 255 - WidenCoverage(coverage + index);
+                Store(destination + index, ScalePixels(Load<U32x4>(destination + index), remaining));
+            }
+            
+            for (; index < count; index++)
+                destination[index] = ScalePixels<uint32_t>(destination[index], 255 - coverage[index]);
+        }
+        
+        ///Multiplies coverage by the coverage of a mask.
+        static void MultiplyCoverage(uint8_t *coverage, const uint8_t *mask, long count)
+        {
+            for (long index = 0; index < count; index++) {
+                uint32_t product = uint32_t(coverage[index]) * mask[index] + 128;
+                coverage[index] = uint8_t((product + (product >> 8)) >> 8);
+            }
+        }
+        
+        ///Converts accumulated signed area into 8-bit coverage under a fill rule.
+        static void CoverageFromArea(const float *area, uint8_t *outCoverage, long count, FillRule rule)
+        {
+            const U32x4 kAbsoluteMask = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
+            const F32x4 kOne = { 1.0f, 1.0f, 1.0f, 1.0f };
+            const F32x4 kTwo = { 2.0f, 2.0f, 2.0f, 2.0f };
+            
+            auto select = [](I32x4 mask, F32x4 ifTrue, F32x4 ifFalse) -> F32x4 {
+                return (F32x4)(((I32x4)ifTrue & mask) | ((I32x4)ifFalse & ~mask));
+            };
+            
+            long index = 0;
+            for (; index + 4 <= count; index += 4) {
+                F32x4 value = (F32x4)(Load<U32x4>(area + index) & kAbsoluteMask);
+                if(rule == FillRule::EvenOdd) {
+                    F32x4 wrapped = value - kTwo * __builtin_convertvector(__builtin_convertvector(value / kTwo, I32x4), F32x4);
+                    value = select((I32x4)(wrapped > kOne), kTwo - wrapped, wrapped);
+                } else {
+                    value = select((I32x4)(value > kOne), kOne, value);
+                }
+                
+                I32x4 scaled = __builtin_convertvector(value * 255.0f + 0.5f, I32x4);
+                for (int lane = 0; lane < 4; lane++)
+                    outCoverage[index + lane] = uint8_t(scaled[lane]);
+            }
+            
+            for (; index < count; index++) {
+                float value = std::abs(area[index]);
+                if(rule == FillRule::EvenOdd) {
+                    float wrapped = value - 2.0f * float(int32_t(value / 2.0f));
+                    value = (wrapped > 1.0f)? 2.0f - wrapped : wrapped;
+                } else {
+                    value = (value > 1.0f)? 1.0f : value;
+                }
+                
+                outCoverage[index] = uint8_t(int32_t(value * 255.0f + 0.5f));
+            }
+        }
+        
+#pragma mark - Coverage
+        
+        ///An edge of a polygon in device space, oriented downwards.
+        struct Edge
+        {
+            Float x0, y0, x1, y1;
+            
+            ///The change in x for each unit of y.
+            Float slope;
+            
+            ///+1 if the edge originally pointed downwards, -1 otherwise.
+            Float direction;
+        };
+        
+        ///The CoverageRasterizer class computes the exact area coverage of polygons.
+        ///
+        ///The signed area each edge covers in a row of pixels is accumulated into
+        ///a row buffer, and the running sum of the buffer is the winding of each
+        ///pixel weighted by how much of it is covered. The edges that affect a row
+        ///are always visited in the same order, so a row is rasterized identically
+        ///no matter which rows are rasterized with it.
+        class CoverageRasterizer
+        {
+            ///The edges of the polygons, sorted by their top.
+            std::vector<Edge> mEdges;
+            
+            ///The rule used to determine the inside of the polygons.
+            FillRule mRule;
+            
+            ///The pixels the polygons touch within the clip.
+            PixelRect mBounds;
+            
+            ///The horizontal extent of the clip.
+            long mLeft, mRight;
+            
+            ///Adds an edge that lies entirely within the horizontal extent of the clip.
+            void addClippedEdge(Point from, Point to)
+            {
+                if(from.y == to.y)
+                    return;
+                
+                Edge edge;
+                if(from.y < to.y)
+                    edge = Edge{ from.x, from.y, to.x, to.y, 0.0, 1.0 };
+                else
+                    edge = Edge{ to.x, to.y, from.x, from.y, 0.0, -1.0 };
+                
+                edge.slope = (edge.x1 - edge.x0) / (edge.y1 - edge.y0);
+                mEdges.push_back(edge);
+            }
+            
+            ///Adds an edge, splitting it at the left and right of the clip.
+            ///
+            ///The parts left of the clip become vertical edges on its left side,
+            ///which contribute the same winding to every pixel to their right.
+            ///The parts right of the clip are discarded, as coverage only flows
+            ///to the right.
+            void addEdge(Point from, Point to)
+            {
+                Float left = mLeft, right = mRight;
+                Float splits[4] = { 0.0, 1.0, 1.0, 1.0 };
+                int numberOfSplits = 1;
+                
+                Float deltaX = to.x - from.x;
+                if(deltaX != 0.0) {
+                    for (Float boundary : { left, right }) {
+                        Float t = (boundary - from.x) / deltaX;
+                        if(t > 0.0 && t < 1.0)
+                            splits[numberOfSplits++] = t;
+                    }
+                }
+                
+                splits[numberOfSplits++] = 1.0;
+                std::sort(splits, splits + numberOfSplits);
+                
+                for (int index = 0; index + 1 < numberOfSplits; index++) {
+                    Float t0 = splits[index], t1 = splits[index + 1];
+                    if(t1 <= t0)
+                        continue;
+                    
+                    Point start{ from.x + deltaX * t0, from.y + (to.y - from.y) * t0 };
+                    Point end = (t1 == 1.0)? to : Point{ from.x + deltaX * t1, from.y + (to.y - from.y) * t1 };
+                    Float middle = (start.x + end.x) / 2.0;
+                    if(middle <= left) {
+                        addClippedEdge(Point{ left, start.y }, Point{ left, end.y });
+                    } else if(middle < right) {
+                        start.x = std::max(left, std::min(right, start.x));
+                        end.x = std::max(left, std::min(right, end.x));
+                        addClippedEdge(start, end);
+                    }
+                }
+            }
+            
+            ///Accumulates the signed area of a line within a single row.
+            ///
+            /// \param  area    The row buffer, whose first cell is at the left of the clip.
+            /// \param  x0      The x coordinate of the line at the top of its part of the row.
+            /// \param  x1      The x coordinate of the line at the bottom of its part of the row.
+            /// \param  height  The signed height of the line within the row.
+            ///
+            static void accumulateLine(float *area, Float x0, Float x1, Float height)
+            {
+                Float minX = std::min(x0, x1), maxX = std::max(x0, x1);
+                Float minXFloor = std::floor(minX), maxXCeil = std::ceil(maxX);
+                long minIndex = long(minXFloor), maxIndex = long(maxXCeil);
+                
+                if(maxIndex <= minIndex + 1) {
+                    //The line is within a single column.
+                    Float middle = 0.5 * (x0 + x1) - minXFloor;
+                    area[minIndex] += float(height - height * middle);
+                    area[minIndex + 1] += float(height * middle);
+                } else {
+                    Float inverseWidth = 1.0 / (maxX - minX);
+                    Float firstFraction = minX - minXFloor;
+                    Float firstArea = 0.5 * inverseWidth * (1.0 - firstFraction) * (1.0 - firstFraction);
+                    Float lastFraction = maxX - maxXCeil + 1.0;
+                    Float lastArea = 0.5 * inverseWidth * lastFraction * lastFraction;
+                    
+                    area[minIndex] += float(height * firstArea);
+                    if(maxIndex == minIndex + 2) {
+                        area[minIndex + 1] += float(height * (1.0 - firstArea - lastArea));
+                    } else {
+                        Float secondArea = inverseWidth * (1.5 - firstFraction);
+                        area[minIndex + 1] += float(height * (secondArea - firstArea));
+                        for (long index = minIndex + 2; index < maxIndex - 1; index++)
+                            area[index] += float(height * inverseWidth);
+                        
+                        Float penultimateArea = secondArea + (maxIndex - minIndex - 3) * inverseWidth;
+                        area[maxIndex - 1] += float(height * (1.0 - penultimateArea - lastArea));
+                    }
+                    
+                    area[maxIndex] += float(height * lastArea);
+                }
+            }
+            
+        public:
+            
+            ///Constructs a rasterizer for polygons in device space.
+            ///
+            /// \param  polygons    The polygons. Each is implicitly closed.
+            /// \param  rule        The fill rule.
+            /// \param  clip        The pixels that may be covered.
+            ///
+            CoverageRasterizer(const std::vector<Contour> &polygons, FillRule rule, const PixelRect &clip) :
+                mEdges(),
+                mRule(rule),
+                mBounds(),
+                mLeft(clip.x),
+                mRight(clip.x + clip.width)
+            {
+                if(clip.isEmpty())
+                    return;
+                
+                Float minX = GFX_FLOAT_MAX, minY = GFX_FLOAT_MAX, maxX = -GFX_FLOAT_MAX, maxY = -GFX_FLOAT_MAX;
+                for (const Contour &polygon : polygons) {
+                    size_t count = polygon.points.size();
+                    if(count < 2)
+                        continue;
+                    
+                    for (size_t index = 0; index < count; index++) {
+                        const Point &from = polygon.points[index], &to = polygon.points[(index + 1) % count];
+                        if(!std::isfinite(from.x) || !std::isfinite(from.y))
+                            continue;
+                        
+                        minX = std::min(minX, from.x);
+                        maxX = std::max(maxX, from.x);
+                        minY = std::min(minY, from.y);
+                        maxY = std::max(maxY, from.y);
+                        
+                        if(std::isfinite(to.x) && std::isfinite(to.y))
+                            addEdge(from, to);
+                    }
+                }
+                
+                if(mEdges.empty())
+                    return;
+                
+                mBounds = PixelRect::enclosing(Rect{ Point{ minX, minY }, Size{ maxX - minX, maxY - minY } }).intersection(clip);
+                std::stable_sort(mEdges.begin(), mEdges.end(), [](const Edge &left, const Edge &right) {
+                    return left.y0 < right.y0;
+                });
+            }
+            
+            ///Returns the pixels the polygons touch within the clip.
+            const PixelRect &bounds() const { return mBounds; }
+            
+            ///Rasterizes a range of rows, invoking a functor with the coverage of each.
+            ///
+            /// \param  firstRow    The first row to rasterize.
+            /// \param  endRow      The row after the last row to rasterize.
+            /// \param  functor     A functor of the form `(long y, long x, long count, uint8_t *coverage)`.
+            ///                     The coverage may be modified by the functor.
+            ///
+            template<typename Functor>
+            void rasterize(long firstRow, long endRow, Functor functor) const
+            {
+                firstRow = std::max(firstRow, mBounds.y);
+                endRow = std::min(endRow, mBounds.y + mBounds.height);
+                if(firstRow >= endRow)
+                    return;
+                
+                long width = mRight - mLeft;
+                std::vector<float> area(width + 2, 0.0f);
+                std::vector<uint8_t> coverage(width + 2, 0);
+                std::vector<const Edge *> activeEdges;
+                
+                size_t nextEdge = 0;
+                for (; nextEdge < mEdges.size() && mEdges[nextEdge].y0 < firstRow + 1; nextEdge++) {
+                    if(mEdges[nextEdge].y1 > firstRow)
+                        activeEdges.push_back(&mEdges[nextEdge]);
+                }
+                
+                for (long y = firstRow; y < endRow; y++) {
+                    Float rowTop = y, rowBottom = y + 1;
+                    if(y != firstRow) {
+                        activeEdges.erase(std::remove_if(activeEdges.begin(), activeEdges.end(), [rowTop](const Edge *edge) {
+                            return edge->y1 <= rowTop;
+                        }), activeEdges.end());
+                        
+                        for (; nextEdge < mEdges.size() && mEdges[nextEdge].y0 < rowBottom; nextEdge++) {
+                            if(mEdges[nextEdge].y1 > rowTop)
+                                activeEdges.push_back(&mEdges[nextEdge]);
+                        }
+                    }
+                    
+                    if(activeEdges.empty())
+                        continue;
+                    
+                    Float minX = GFX_FLOAT_MAX, maxX = -GFX_FLOAT_MAX;
+                    for (const Edge *edge : activeEdges) {
+                        Float top = std::max(rowTop, edge->y0), bottom = std::min(rowBottom, edge->y1);
+                        if(bottom <= top)
+                            continue;
+                        
+                        Float x0 = edge->x0 + (top - edge->y0) * edge->slope - mLeft;
+                        Float x1 = edge->x0 + (bottom - edge->y0) * edge->slope - mLeft;
+                        x0 = std::max(0.0, std::min(Float(width), x0));
+                        x1 = std::max(0.0, std::min(Float(width), x1));
+                        
+                        accumulateLine(area.data(), x0, x1, (bottom - top) * edge->direction);
+                        minX = std::min(minX, std::min(x0, x1));
+                        maxX = std::max(maxX, std::max(x0, x1));
+                    }
+                    
+                    if(minX > maxX)
+                        continue;
+                    
+                    //The running sum of the row buffer is the area covered at each pixel.
+                    long start = long(std::floor(minX)), touchedEnd = std::min(width + 2, long(std::ceil(maxX)) + 2);
+                    float sum = 0.0f;
+                    for (long index = start; index < touchedEnd; index++) {
+                        sum += area[index];
+                        area[index] = sum;
+                    }
+                    
+                    //Edges right of the clip are discarded, so a row can end
+                    //with coverage that extends to the right of the clip.
+                    long spanEnd = std::min(width, touchedEnd);
+                    if(std::abs(sum) * 255.0f >= 0.5f && touchedEnd < width) {
+                        std::fill(area.begin() + touchedEnd, area.begin() + width, sum);
+                        spanEnd = touchedEnd = width;
+                    }
+                    
+                    long spanStart = std::max(start, mBounds.x - mLeft);
+                    spanEnd = std::min(spanEnd, mBounds.x + mBounds.width - mLeft);
+                    if(spanStart < spanEnd) {
+                        CoverageFromArea(area.data() + spanStart, coverage.data(), spanEnd - spanStart, mRule);
+                        functor(y, mLeft + spanStart, spanEnd - spanStart, coverage.data());
+                    }
+                    
+                    std::fill(area.begin() + start, area.begin() + touchedEnd, 0.0f);
+                }
+            }
+        };
+        
+#pragma mark - Shaders
+        
+        ///Samples a surface with bilinear filtering.
+        class ImageShader : public Canvas::Shader
+        {
+            const Surface *mImage;
+            
+            ///The transform from device space to the pixels of the image.
+            Transform2D mDeviceToImage;
+            
+            ///Whether or not the image repeats beyond its bounds.
+            bool mTiled;
+            
+            ///Returns a pixel of the image, clamping or wrapping the coordinates.
+            uint32_t pixelAt(long x, long y) const
+            {
+                long width = mImage->width(), height = mImage->height();
+                if(mTiled) {
+                    x %= width; if(x < 0) x += width;
+                    y %= height; if(y < 0) y += height;
+                } else {
+                    x = std::max(0L, std::min(width - 1, x));
+                    y = std::max(0L, std::min(height - 1, y));
+                }
+                
+                return mImage->row(y)[x];
+            }
+            
+            ///Linearly interpolates each channel of two pixels by a weight in [0, 256].
+            static inline uint32_t Lerp(uint32_t from, uint32_t to, uint32_t weight)
+            {
+                uint32_t inverse = 256 - weight;
+                uint32_t redBlue = (((from & 0x00ff00ff) * inverse + (to & 0x00ff00ff) * weight) >> 8) & 0x00ff00ff;
+                uint32_t greenAlpha = ((((from >> 8) & 0x00ff00ff) * inverse + ((to >> 8) & 0x00ff00ff) * weight) >> 8) & 0x00ff00ff;
+                return redBlue | (greenAlpha << 8);
+            }
+            
+        public:
+            
+            ImageShader(const Surface *image, const Transform2D &deviceToImage, bool tiled) :
+                mImage(image->retain()),
+                mDeviceToImage(deviceToImage),
+                mTiled(tiled)
+            {
+            }
+            
+            ~ImageShader()
+            {
+                mImage->release();
+            }
+            
+            ImageShader(const ImageShader &) = delete;
+            ImageShader &operator=(const ImageShader &) = delete;
+            
+            void shadeRow(long x, long y, long count, uint32_t *outPixels) const override
+            {
+                const Transform2D &t = mDeviceToImage;
+                Float u = t.a * (x + 0.5) + t.c * (y + 0.5) + t.tx - 0.5;
+                Float v = t.b * (x + 0.5) + t.d * (y + 0.5) + t.ty - 0.5;
+                
+                //Untransformed images at whole pixel offsets are copied.
+                if(t.a == 1.0 && t.b == 0.0 && t.c == 0.0 && t.d == 1.0 && u == std::floor(u) && v == std::floor(v)) {
+                    for (long index = 0; index < count; index++)
+                        outPixels[index] = pixelAt(long(u) + index, long(v));
+                    
+                    return;
+                }
+                
+                for (long index = 0; index < count; index++, u += t.a, v += t.b) {
+                    Float floorU = std::floor(u), floorV = std::floor(v);
+                    long pixelX = long(floorU), pixelY = long(floorV);
+                    uint32_t weightX = uint32_t((u - floorU) * 256.0), weightY = uint32_t((v - floorV) * 256.0);
+                    
+                    uint32_t top = Lerp(pixelAt(pixelX, pixelY), pixelAt(pixelX + 1, pixelY), weightX);
+                    uint32_t bottom = Lerp(pixelAt(pixelX, pixelY + 1), pixelAt(pixelX + 1, pixelY + 1), weightX);
+                    outPixels[index] = Lerp(top, bottom, weightY);
+                }
+            }
+        };
+        
+        ///Samples the lookup table of a gradient at four locations at once.
+        ///
+        /// \param  lookupTable The lookup table of the gradient.
+        /// \param  location    The locations to sample.
+        /// \param  beforeColor The color of locations before 0.
+        /// \param  afterColor  The color of locations after 1.
+        ///
+        ///The locations are clamped and scaled into table indexes four lanes at a time.
+        ///Only the table lookups themselves are made one lane at a time. NaN locations
+        ///take the first color of the table. Every gradient shader samples through this
+        ///function, so all of them round locations to table indexes identically.
+        static inline U32x4 SampleGradient(const uint32_t *lookupTable, F32x4 location, uint32_t beforeColor, uint32_t afterColor)
+        {
+            const F32x4 kZero = { 0.0f, 0.0f, 0.0f, 0.0f };
+            const F32x4 kOne = { 1.0f, 1.0f, 1.0f, 1.0f };
+            
+            F32x4 clampedLocation = Select((I32x4)(location > kZero), location, kZero);
+            clampedLocation = Select((I32x4)(clampedLocation > kOne), kOne, clampedLocation);
+            I32x4 indexes = __builtin_convertvector(clampedLocation * float(Gradient::kLookupTableSize - 1) + 0.5f, I32x4);
+            
+            U32x4 colors = { lookupTable[indexes[0]], lookupTable[indexes[1]], lookupTable[indexes[2]], lookupTable[indexes[3]] };
+            U32x4 isBefore = (U32x4)(location < kZero), isAfter = (U32x4)(location > kOne);
+            return ((colors & ~(isBefore | isAfter)) |
+                    (U32x4{ beforeColor, beforeColor, beforeColor, beforeColor } & isBefore) |
+                    (U32x4{ afterColor, afterColor, afterColor, afterColor } & isAfter));
+        }
+        
+        ///Returns the color a gradient extends before its start with, given its drawing options.
+        static inline uint32_t GradientBeforeColor(const Gradient &gradient, int options)
+        {
+            return (options & DrawsBeforeStartLocation)? gradient.lookupTable()[0] : 0;
+        }
+        
+        ///Returns the color a gradient extends after its end with, given its drawing options.
+        static inline uint32_t GradientAfterColor(const Gradient &gradient, int options)
+        {
+            return (options & DrawsAfterEndLocation)? gradient.lookupTable()[Gradient::kLookupTableSize - 1] : 0;
+        }
+        
+        ///Shades a linear gradient between two points.
+        class LinearGradientShader : public Canvas::Shader
+        {
+            Gradient mGradient;
+            Transform2D mDeviceToUser;
+            Point mStart;
+            Float mDeltaX, mDeltaY;
+            uint32_t mBeforeColor, mAfterColor;
+            
+        public:
+            
+            LinearGradientShader(const Gradient &gradient, const Transform2D &deviceToUser, Point start, Point end, int options) :
+                mGradient(gradient),
+                mDeviceToUser(deviceToUser),
+                mStart(start),
+                mDeltaX(end.x - start.x),
+                mDeltaY(end.y - start.y),
+                mBeforeColor(GradientBeforeColor(gradient, options)),
+                mAfterColor(GradientAfterColor(gradient, options))
+            {
+                Float lengthSquared = mDeltaX * mDeltaX + mDeltaY * mDeltaY;
+                if(lengthSquared > 0.0) {
+                    mDeltaX /= lengthSquared;
+                    mDeltaY /= lengthSquared;
+                }
+            }
+            
+            void shadeRow(long x, long y, long count, uint32_t *outPixels) const override
+            {
+                //The location is an affine function of device space, so it changes
+                //by the same step from each pixel of a row to the next.
+                Point point = mDeviceToUser.transformPoint(Point{ x + 0.5, y + 0.5 });
+                Float location = (point.x - mStart.x) * mDeltaX + (point.y - mStart.y) * mDeltaY;
+                Float step = mDeviceToUser.a * mDeltaX + mDeviceToUser.b * mDeltaY;
+                
+                //Locations are computed in full precision once per four pixels, and
+                //stepped in single precision across the four, which is far finer
+                //than the spacing of the lookup table.
+                const F32x4 kLanes = { 0.0f, 1.0f, 2.0f, 3.0f };
+                const F32x4 laneSteps = kLanes * float(step);
+                const uint32_t *lookupTable = mGradient.lookupTable();
+                
+                long index = 0;
+                for (; index + 4 <= count; index += 4) {
+                    F32x4 locations = float(location + step * Float(index)) + laneSteps;
+                    Store(outPixels + index, SampleGradient(lookupTable, locations, mBeforeColor, mAfterColor));
+                }
+                
+                //The end of the row is shaded as a whole group of four so that
+                //every pixel is shaded identically regardless of the row's length.
+                if(index < count) {
+                    uint32_t pixels[4];
+                    F32x4 locations = float(location + step * Float(index)) + laneSteps;
+                    Store(pixels, SampleGradient(lookupTable, locations, mBeforeColor, mAfterColor));
+                    std::copy(pixels, pixels + (count - index), outPixels + index);
+                }
+            }
+        };
+        
+        ///Shades a radial gradient between two circles.
+        class RadialGradientShader : public Canvas::Shader
+        {
+            Gradient mGradient;
+            Transform2D mDeviceToUser;
+            Point mStartCenter;
+            Float mStartRadius;
+            Float mCenterDeltaX, mCenterDeltaY, mRadiusDelta;
+            Float mA, mInverseA;
+            uint32_t mBeforeColor, mAfterColor;
+            
+            ///Shades the four pixels of a row starting at a given index.
+            U32x4 shadeGroup(Point rowStart, long index, const uint32_t *lookupTable) const
+            {
+                const F32x4 kZero = { 0.0f, 0.0f, 0.0f, 0.0f };
+                const F32x4 kLanes = { 0.0f, 1.0f, 2.0f, 3.0f };
+                
+                //The offsets from the start center are found in full precision once per
+                //four pixels, which keeps the single precision lanes small in magnitude.
+                F32x4 deltaX = float(rowStart.x + mDeviceToUser.a * Float(index) - mStartCenter.x) + kLanes * float(mDeviceToUser.a);
+                F32x4 deltaY = float(rowStart.y + mDeviceToUser.b * Float(index) - mStartCenter.y) + kLanes * float(mDeviceToUser.b);
+                F32x4 b = deltaX * float(mCenterDeltaX) + deltaY * float(mCenterDeltaY) + float(mStartRadius * mRadiusDelta);
+                F32x4 c = deltaX * deltaX + deltaY * deltaY - float(mStartRadius * mStartRadius);
+                
+                F32x4 location;
+                I32x4 isTransparent;
+                if(std::abs(mA) < 1e-12) {
+                    isTransparent = (I32x4)(b == kZero);
+                    location = c / (2.0f * b);
+                } else {
+                    F32x4 discriminant = b * b - float(mA) * c;
+                    isTransparent = (I32x4)(discriminant < kZero);
+                    discriminant = Select(isTransparent, kZero, discriminant);
+                    
+                    F32x4 root = {
+                        std::sqrt(discriminant[0]), std::sqrt(discriminant[1]),
+                        std::sqrt(discriminant[2]), std::sqrt(discriminant[3]),
+                    };
+                    F32x4 larger = (b + root) * float(mInverseA), smaller = (b - root) * float(mInverseA);
+                    I32x4 takesSmaller = (I32x4)(float(mStartRadius) + larger * float(mRadiusDelta) < kZero);
+                    if(mA < 0.0)
+                        takesSmaller |= (I32x4)(larger < smaller);
+                    
+                    location = Select(takesSmaller, smaller, larger);
+                }
+                
+                isTransparent |= (I32x4)(float(mStartRadius) + location * float(mRadiusDelta) < kZero);
+                return SampleGradient(lookupTable, location, mBeforeColor, mAfterColor) & ~(U32x4)isTransparent;
+            }
+            
+        public:
+            
+            RadialGradientShader(const Gradient &gradient, const Transform2D &deviceToUser,
+                                 Point startCenter, Float startRadius, Point endCenter, Float endRadius, int options) :
+                mGradient(gradient),
+                mDeviceToUser(deviceToUser),
+                mStartCenter(startCenter),
+                mStartRadius(startRadius),
+                mCenterDeltaX(endCenter.x - startCenter.x),
+                mCenterDeltaY(endCenter.y - startCenter.y),
+                mRadiusDelta(endRadius - startRadius),
+                mA(mCenterDeltaX * mCenterDeltaX + mCenterDeltaY * mCenterDeltaY - mRadiusDelta * mRadiusDelta),
+                mInverseA(1.0 / mA),
+                mBeforeColor(GradientBeforeColor(gradient, options)),
+                mAfterColor(GradientAfterColor(gradient, options))
+            {
+            }
+            
+            void shadeRow(long x, long y, long count, uint32_t *outPixels) const override
+            {
+                //A point is on the circle for location t when |p - c(t)| = r(t).
+                //That expands to a quadratic in t, of which the largest root with
+                //a non-negative radius is the location of the point.
+                //
+                //The quadratic is solved and sampled for four pixels at a time.
+                Point rowStart = mDeviceToUser.transformPoint(Point{ x + 0.5, y + 0.5 });
+                const uint32_t *lookupTable = mGradient.lookupTable();
+                
+                long index = 0;
+                for (; index + 4 <= count; index += 4)
+                    Store(outPixels + index, shadeGroup(rowStart, index, lookupTable));
+                
+                //As with linear gradients, the end of the row is shaded as a whole group of four.
+                if(index < count) {
+                    uint32_t pixels[4];
+                    Store(pixels, shadeGroup(rowStart, index, lookupTable));
+                    std::copy(pixels, pixels + (count - index), outPixels + index);
+                }
+            }
+        };
+        
+#pragma mark - Shadows
+        
+        ///Blurs an 8-bit mask in place with three passes of a box blur, approximating a gaussian.
+        static void BlurMask(std::vector<uint8_t> &mask, long width, long height, long radius)
+        {
+            if(radius <= 0)
+                return;
+            
+            std::vector<uint8_t> line(std::max(width, height));
+            auto blurLine = [&line, radius](uint8_t *values, long count, long stride) {
+                for (long pass = 0; pass < 3; pass++) {
+                    for (long index = 0; index < count; index++)
+                        line[index] = values[index * stride];
+                    
+                    long window = 2 * radius + 1;
+                    long sum = 0;
+                    for (long index = -radius; index <= radius; index++)
+                        sum += (index >= 0 && index < count)? line[index] : 0;
+                    
+                    for (long index = 0; index < count; index++) {
+                        values[index * stride] = uint8_t((sum + window / 2) / window);
+                        
+                        long leaving = index - radius, entering = index + radius + 1;
+                        sum -= (leaving >= 0)? line[leaving] : 0;
+                        sum += (entering < count)? line[entering] : 0;
+                    }
+                }
+            };
+            
+            for (long y = 0; y < height; y++)
+                blurLine(mask.data() + y * width, width, 1);
+            
+            for (long x = 0; x < width; x++)
+                blurLine(mask.data() + x, height, width);
+        }
+        
+#pragma mark - Commands
+        
+        struct Canvas::Command
+        {
+            ///Whether the command clears the pixels it covers instead of painting them.
+            bool clears;
+            
+            ///The coverage of the command within the clip.
+            CoverageRasterizer rasterizer;
+            
+            ///The clip mask of the state the command was created in, if any.
+            std::shared_ptr<const ClipMask> clipMask;
+            
+            ///The premultiplied color to paint with, if there is no shader.
+            uint32_t color;
+            
+            ///The shader to paint with, if any.
+            std::shared_ptr<const Shader> shader;
+            
+            ///The premultiplied color of the shadow. Zero if there is no shadow.
+            uint32_t shadowColor;
+            
+            ///The coverage of the unblurred shadow. Released once the shadow is prepared.
+            std::unique_ptr<CoverageRasterizer> shadowRasterizer;
+            
+            ///The radius of the box blur applied to the shadow.
+            long shadowBlurRadius;
+            
+            ///The offset of the shadow in whole pixels.
+            long shadowOffsetX, shadowOffsetY;
+            
+            ///The pixels of the blurred shadow, before it is offset.
+            PixelRect shadowMaskBounds;
+            
+            ///The blurred coverage of the shadow within its mask bounds.
+            std::vector<uint8_t> shadowMask;
+            
+            ///The pixels the shadow is composited into.
+            PixelRect shadowBounds;
+            
+            ///The coverage of a glyph from the glyph atlas within the clip.
+            struct GlyphMask
+            {
+                ///The pixels the glyph is composited into.
+                PixelRect bounds;
+                
+                ///The page of the atlas the glyph is in.
+                std::shared_ptr<const GlyphAtlas::Page> page;
+                
+                ///The coverage of the top left pixel of the bounds within the page.
+                const uint8_t *coverage;
+            };
+            
+            ///The glyphs the command composites with its color, if any.
+            std::vector<GlyphMask> glyphMasks;
+            
+            ///The rows the glyphs are composited into.
+            PixelRect glyphBounds;
+            
+            Command(const std::vector<Contour> &polygons, FillRule rule, const State &state, bool clears,
+                    uint32_t color, std::shared_ptr<const Shader> shader) :
+                clears(clears),
+                rasterizer(polygons, rule, state.clipBounds),
+                clipMask(state.clipMask),
+                color(color),
+                shader(shader),
+                shadowColor(clears? 0 : state.shadowColor),
+                shadowRasterizer(),
+                shadowBlurRadius(0),
+                shadowOffsetX(0),
+                shadowOffsetY(0),
+                shadowMaskBounds(),
+                shadowMask(),
+                shadowBounds(),
+                glyphMasks(),
+                glyphBounds()
+            {
+                if(shadowColor == 0)
+                    return;
+                
+                shadowBlurRadius = long(std::lround((std::sqrt(state.shadowBlur * state.shadowBlur + 1.0) - 1.0) / 2.0));
+                shadowOffsetX = long(std::lround(state.shadowOffset.width));
+                shadowOffsetY = long(std::lround(state.shadowOffset.height));
+                
+                //Only the parts of the drawing whose blurred shadow can reach the clip are rasterized.
+                long extent = 3 * shadowBlurRadius + 1;
+                const PixelRect &destination = state.clipBounds;
+                PixelRect source{ destination.x - shadowOffsetX - extent, destination.y - shadowOffsetY - extent,
+                                  destination.width + 2 * extent, destination.height + 2 * extent };
+                shadowRasterizer.reset(new CoverageRasterizer(polygons, rule, source));
+                
+                const PixelRect &bounds = shadowRasterizer->bounds();
+                if(bounds.isEmpty()) {
+                    shadowRasterizer.reset();
+                    shadowColor = 0;
+                    return;
+                }
+                
+                shadowMaskBounds = PixelRect{ bounds.x - extent, bounds.y - extent, bounds.width + 2 * extent, bounds.height + 2 * extent };
+                shadowBounds = PixelRect{ shadowMaskBounds.x + shadowOffsetX, shadowMaskBounds.y + shadowOffsetY,
+                                          shadowMaskBounds.width, shadowMaskBounds.height }.intersection(destination);
+            }
+            
+            Command(std::vector<GlyphMask> &&glyphMasks, const State &state) :
+                clears(false),
+                rasterizer(std::vector<Contour>(), FillRule::NonZero, state.clipBounds),
+                clipMask(state.clipMask),
+                color(state.fillColor),
+                shader(),
+                shadowColor(0),
+                shadowRasterizer(),
+                shadowBlurRadius(0),
+                shadowOffsetX(0),
+                shadowOffsetY(0),
+                shadowMaskBounds(),
+                shadowMask(),
+                shadowBounds(),
+                glyphMasks(std::move(glyphMasks)),
+                glyphBounds()
+            {
+                long minY = std::numeric_limits<long>::max(), maxY = std::numeric_limits<long>::min();
+                for (const GlyphMask &glyphMask : this->glyphMasks) {
+                    minY = std::min(minY, glyphMask.bounds.y);
+                    maxY = std::max(maxY, glyphMask.bounds.y + glyphMask.bounds.height);
+                }
+                
+                if(minY < maxY)
+                    glyphBounds = PixelRect{ 0, minY, 0, maxY - minY };
+            }
+            
+            ///Returns the rows the command may change.
+            PixelRect bounds() const
+            {
+                if(!glyphMasks.empty())
+                    return glyphBounds;
+                
+                const PixelRect &bounds = rasterizer.bounds();
+                if(shadowColor == 0 || shadowBounds.isEmpty())
+                    return bounds;
+                else if(bounds.isEmpty())
+                    return shadowBounds;
+                
+                long minY = std::min(bounds.y, shadowBounds.y);
+                long maxY = std::max(bounds.y + bounds.height, shadowBounds.y + shadowBounds.height);
+                return PixelRect{ 0, minY, 0, maxY - minY };
+            }
+            
+            ///Returns whether or not the command must be prepared before it is rendered.
+            bool needsPreparation() const
+            {
+                return (shadowRasterizer != nullptr);
+            }
+            
+            ///Applies the clip mask to a run of coverage.
+            void applyClipMask(long y, long x, long count, uint8_t *coverage) const
+            {
+                if(const ClipMask *mask = clipMask.get())
+                    MultiplyCoverage(coverage, mask->coverage.data() + (y - mask->bounds.y) * mask->bounds.width + (x - mask->bounds.x), count);
+            }
+            
+            ///Computes the blurred shadow of the command. Commands may be prepared concurrently.
+            void prepare()
+            {
+                if(!shadowRasterizer)
+                    return;
+                
+                //The shadow is the coverage of the drawing, scaled by the alpha of its
+                //paint, blurred, offset, and composited in the shadow color beneath it.
+                const PixelRect &bounds = shadowMaskBounds;
+                shadowMask.assign(bounds.width * bounds.height, 0);
+                
+                std::vector<uint32_t> shaded;
+                shadowRasterizer->rasterize(bounds.y, bounds.y + bounds.height, [&](long y, long x, long count, uint8_t *coverage) {
+                    if(shader) {
+                        shaded.resize(count);
+                        shader->shadeRow(x, y, count, shaded.data());
+                        for (long index = 0; index < count; index++)
+                            coverage[index] = uint8_t(ScalePairs<uint32_t>(shaded[index] >> 24, coverage[index]));
+                    } else {
+                        for (long index = 0; index < count; index++)
+                            coverage[index] = uint8_t(ScalePairs<uint32_t>(color >> 24, coverage[index]));
+                    }
+                    
+                    memcpy(shadowMask.data() + (y - bounds.y) * bounds.width + (x - bounds.x), coverage, count);
+                });
+                
+                BlurMask(shadowMask, bounds.width, bounds.height, shadowBlurRadius);
+                shadowRasterizer.reset();
+            }
+            
+            ///Renders a range of rows of the command into a surface. Disjoint
+            ///ranges of rows of prepared commands may be rendered concurrently.
+            void render(Surface *surface, long firstRow, long endRow) const
+            {
+                if(shadowColor != 0) {
+                    long shadowFirstRow = std::max(firstRow, shadowBounds.y);
+                    long shadowEndRow = std::min(endRow, shadowBounds.y + shadowBounds.height);
+                    
+                    std::vector<uint8_t> coverage(shadowBounds.width);
+                    for (long y = shadowFirstRow; y < shadowEndRow; y++) {
+                        const uint8_t *maskRow = shadowMask.data() + (y - shadowOffsetY - shadowMaskBounds.y) * shadowMaskBounds.width + (shadowBounds.x - shadowOffsetX - shadowMaskBounds.x);
+                        memcpy(coverage.data(), maskRow, shadowBounds.width);
+                        applyClipMask(y, shadowBounds.x, shadowBounds.width, coverage.data());
+                        BlendSolidSpan(surface->row(y) + shadowBounds.x, shadowColor, coverage.data(), shadowBounds.width);
+                    }
+                }
+                
+                if(!glyphMasks.empty()) {
+                    std::vector<uint8_t> coverage;
+                    for (const GlyphMask &glyphMask : glyphMasks) {
+                        const PixelRect &bounds = glyphMask.bounds;
+                        long glyphFirstRow = std::max(firstRow, bounds.y), glyphEndRow = std::min(endRow, bounds.y + bounds.height);
+                        
+                        coverage.resize(bounds.width);
+                        for (long y = glyphFirstRow; y < glyphEndRow; y++) {
+                            memcpy(coverage.data(), glyphMask.coverage + (y - bounds.y) * GlyphAtlas::kPageSize, bounds.width);
+                            applyClipMask(y, bounds.x, bounds.width, coverage.data());
+                            BlendSolidSpan(surface->row(y) + bounds.x, color, coverage.data(), bounds.width);
+                        }
+                    }
+                }
+                
+                std::vector<uint32_t> shaded;
+                rasterizer.rasterize(firstRow, endRow, [&](long y, long x, long count, uint8_t *coverage) {
+                    applyClipMask(y, x, count, coverage);
+                    
+                    uint32_t *destination = surface->row(y) + x;
+                    if(clears) {
+                        ClearSpan(destination, coverage, count);
+                    } else if(shader) {
+                        shaded.resize(count);
+                        shader->shadeRow(x, y, count, shaded.data());
+                        BlendSpan(destination, shaded.data(), coverage, count);
+                    } else {
+                        BlendSolidSpan(destination, color, coverage, count);
+                    }
+                });
+            }
+        };
+        
+#pragma mark - Canvas
+        
+        ///The maximum distance between curves and the lines they are flattened into, in device pixels.
+        static const Float kFlatteningTolerance = 0.1;
+        
+        Canvas::Canvas(Surface *surface) :
+            mSurface(surface->retain()),
+            mStates(),
+            mDeferred(false),
+            mCommands()
+        {
+            mStates.push_back(State{
+                Transform2D::Identity,
+                PixelRect{ 0, 0, long(surface->width()), long(surface->height()) },
+                nullptr,
+                pixel(0, 0, 0, 255),
+                pixel(0, 0, 0, 255),
+                StrokeStyle{ 1.0, LineCap::Butt, LineJoin::Miter, 10.0 },
+                Size{},
+                0.0,
+                0,
+            });
+        }
+        
+        Canvas::~Canvas()
+        {
+            flush();
+            
+            mSurface->release();
+            mSurface = nullptr;
+        }
+        
+        Surface *Canvas::surface()
+        {
+            flush();
+            
+            return mSurface;
+        }
+        
+#pragma mark - Deferred Drawing
+        
+        void Canvas::setDeferred(bool deferred)
+        {
+            if(!deferred)
+                flush();
+            
+            mDeferred = deferred;
+        }
+        
+        void Canvas::flush()
+        {
+            if(mCommands.empty())
+                return;
+            
+            std::vector<std::unique_ptr<Command>> commands;
+            commands.swap(mCommands);
+            
+            //Shadows are blurred up front, as each band needs rows of the blur
+            //that are computed from rows of the drawing outside of the band.
+            std::vector<Command *> unprepared;
+            for (const auto &command : commands) {
+                if(command->needsPreparation())
+                    unprepared.push_back(command.get());
+            }
+            
+            threading::parallelFor(unprepared.size(), [&unprepared](size_t index, size_t) {
+                unprepared[index]->prepare();
+            });
+            
+            //Each command is binned into the bands its rows touch, in the order it was recorded.
+            long height = long(mSurface->height());
+            size_t numberOfBands = size_t((height + kBandHeight - 1) / kBandHeight);
+            std::vector<std::vector<const Command *>> bands(numberOfBands);
+            for (const auto &command : commands) {
+                PixelRect bounds = command->bounds();
+                if(bounds.height <= 0)
+                    continue;
+                
+                long firstBand = std::max(0L, bounds.y / kBandHeight);
+                long endBand = std::min(long(numberOfBands), (bounds.y + bounds.height + kBandHeight - 1) / kBandHeight);
+                for (long band = firstBand; band < endBand; band++)
+                    bands[band].push_back(command.get());
+            }
+            
+            Surface *surface = mSurface;
+            threading::parallelFor(numberOfBands, [&bands, surface](size_t band, size_t) {
+                long firstRow = long(band) * kBandHeight, endRow = firstRow + kBandHeight;
+                for (const Command *command : bands[band])
+                    command->render(surface, firstRow, endRow);
+            });
+        }
+        
+        void Canvas::perform(std::unique_ptr<Command> command)
+        {
+            if(mDeferred) {
+                mCommands.push_back(std::move(command));
+                if(mCommands.size() >= kMaximumDeferredCommands)
+                    flush();
+            } else {
+                command->prepare();
+                
+                PixelRect bounds = command->bounds();
+                command->render(mSurface, bounds.y, bounds.y + bounds.height);
+            }
+        }
+        
+#pragma mark - Graphics State
+        
+        void Canvas::save()
+        {
+            mStates.push_back(mStates.back());
+        }
+        
+        void Canvas::restore()
+        {
+            if(mStates.size() > 1)
+                mStates.pop_back();
+        }
+        
+        Transform2D Canvas::transform() const
+        {
+            return state().transform;
+        }
+        
+        void Canvas::concatTransform(const Transform2D &transform)
+        {
+            state().transform = transform.concat(state().transform);
+        }
+        
+        void Canvas::setFillColor(const Color &color)
+        {
+            state().fillColor = color.premultiplied();
+        }
+        
+        void Canvas::setStrokeColor(const Color &color)
+        {
+            state().strokeColor = color.premultiplied();
+        }
+        
+        void Canvas::setLineWidth(Float width)
+        {
+            state().strokeStyle.width = width;
+        }
+        
+        void Canvas::setLineCap(LineCap cap)
+        {
+            state().strokeStyle.cap = cap;
+        }
+        
+        void Canvas::setLineJoin(LineJoin join)
+        {
+            state().strokeStyle.join = join;
+        }
+        
+        void Canvas::setMiterLimit(Float limit)
+        {
+            state().strokeStyle.miterLimit = limit;
+        }
+        
+        void Canvas::setShadow(Size offset, Float blur, const Color &color)
+        {
+            //Shadow offsets are specified with y pointing upwards.
+            state().shadowOffset = Size{ offset.width, -offset.height };
+            state().shadowBlur = std::max(0.0, blur);
+            state().shadowColor = color.premultiplied();
+        }
+        
+        void Canvas::clearShadow()
+        {
+            state().shadowOffset = Size{};
+            state().shadowBlur = 0.0;
+            state().shadowColor = 0;
+        }
+        
+        Float Canvas::userSpaceTolerance() const
+        {
+            const Transform2D &transform = state().transform;
+            Float scale = std::sqrt(std::abs(transform.a * transform.d - transform.b * transform.c));
+            return (scale > 0.0)? kFlatteningTolerance / scale : kFlatteningTolerance;
+        }
+        
+        Float Canvas::instanceTolerance(const Transform2D *transforms, size_t count) const
+        {
+            Float largestScale = 0.0;
+            for (size_t index = 0; index < count; index++) {
+                const Transform2D &transform = transforms[index];
+                largestScale = std::max(largestScale, std::sqrt(std::abs(transform.a * transform.d - transform.b * transform.c)));
+            }
+            
+            Float tolerance = userSpaceTolerance();
+            return (largestScale > 0.0)? tolerance / largestScale : tolerance;
+        }
+        
+#pragma mark - Clipping
+        
+        void Canvas::clipToRect(Rect rect)
+        {
+            const Transform2D &transform = state().transform;
+            if(transform.b == 0.0 && transform.c == 0.0) {
+                Rect deviceRect = transform.transformRect(rect);
+                PixelRect pixels = PixelRect::enclosing(deviceRect);
+                if(deviceRect.getMinX() == pixels.x && deviceRect.getMinY() == pixels.y &&
+                   deviceRect.getWidth() == pixels.width && deviceRect.getHeight() == pixels.height) {
+                    state().clipBounds = state().clipBounds.intersection(pixels);
+                    return;
+                }
+            }
+            
+            Path path;
+            path.addRect(rect, Transform2D::Identity);
+            clipToPath(path, FillRule::NonZero);
+        }
+        
+        void Canvas::clipToPath(const Path &path, FillRule rule)
+        {
+            auto polygons = path.flattened(state().transform, kFlatteningTolerance);
+            
+            const PixelRect &clipBounds = state().clipBounds;
+            CoverageRasterizer rasterizer(*polygons, rule, clipBounds);
+            const PixelRect &bounds = rasterizer.bounds();
+            if(bounds.isEmpty()) {
+                state().clipBounds = PixelRect{};
+                state().clipMask = nullptr;
+                return;
+            }
+            
+            auto mask = std::make_shared<ClipMask>();
+            mask->bounds = bounds;
+            mask->coverage.resize(bounds.width * bounds.height, 0);
+            
+            auto previousMask = state().clipMask;
+            rasterizer.rasterize(bounds.y, bounds.y + bounds.height, [&](long y, long x, long count, uint8_t *coverage) {
+                if(previousMask) {
+                    const PixelRect &previousBounds = previousMask->bounds;
+                    MultiplyCoverage(coverage, previousMask->coverage.data() + (y - previousBounds.y) * previousBounds.width + (x - previousBounds.x), count);
+                }
+                
+                memcpy(mask->coverage.data() + (y - bounds.y) * bounds.width + (x - bounds.x), coverage, count);
+            });
+            
+            state().clipBounds = bounds;
+            state().clipMask = mask;
+        }
+        
+        Rect Canvas::clipBoundingBox() const
+        {
+            const PixelRect &bounds = state().clipBounds;
+            Rect deviceRect{ Point{ Float(bounds.x), Float(bounds.y) }, Size{ Float(bounds.width), Float(bounds.height) } };
+            return state().transform.invert().transformRect(deviceRect);
+        }
+        
+#pragma mark - Filling
+        
+        void Canvas::fillDevicePolygons(const std::vector<Contour> &polygons, FillRule rule, uint32_t color, std::shared_ptr<const Shader> shader)
+        {
+            const State &state = this->state();
+            if(state.clipBounds.isEmpty() || (!shader && color == 0))
+                return;
+            
+            perform(std::unique_ptr<Command>(new Command(polygons, rule, state, false, color, shader)));
+        }
+        
+        void Canvas::clearDevicePolygons(const std::vector<Contour> &polygons)
+        {
+            const State &state = this->state();
+            if(state.clipBounds.isEmpty())
+                return;
+            
+            perform(std::unique_ptr<Command>(new Command(polygons, FillRule::NonZero, state, true, 0, nullptr)));
+        }
+        
+        void Canvas::fillClipWithShader(std::shared_ptr<const Shader> shader)
+        {
+            const PixelRect &bounds = state().clipBounds;
+            if(bounds.isEmpty())
+                return;
+            
+            Float minX = bounds.x, minY = bounds.y, maxX = bounds.x + bounds.width, maxY = bounds.y + bounds.height;
+            std::vector<Contour> polygons{ Contour{ { Point{ minX, minY }, Point{ maxX, minY }, Point{ maxX, maxY }, Point{ minX, maxY } }, true } };
+            fillDevicePolygons(polygons, FillRule::NonZero, 0, shader);
+        }
+        
+        const Surface *Canvas::sampleableImage(const Surface *image)
+        {
+            if(image != mSurface)
+                return image->retain();
+            
+            flush();
+            return new Surface(mSurface);
+        }
+        
+#pragma mark - Drawing
+        
+        void Canvas::fillPath(const Path &path, FillRule rule)
+        {
+            auto polygons = path.flattened(state().transform, kFlatteningTolerance);
+            fillDevicePolygons(*polygons, rule, state().fillColor, nullptr);
+        }
+        
+        void Canvas::strokePath(const Path &path)
+        {
+            Float tolerance = userSpaceTolerance();
+            
+            std::vector<Contour> polygons = *path.stroked(state().strokeStyle, tolerance);
+            
+            const Transform2D &transform = state().transform;
+            for (Contour &polygon : polygons) {
+                for (Point &point : polygon.points)
+                    point = transform.transformPoint(point);
+            }
+            
+            fillDevicePolygons(polygons, FillRule::NonZero, state().strokeColor, nullptr);
+        }
+        
+        void Canvas::fillInstancePolygons(const std::vector<Contour> &polygons, FillRule rule, uint32_t color,
+                                          const Transform2D *transforms, size_t count)
+        {
+            std::vector<Contour> devicePolygons = polygons;
+            for (size_t index = 0; index < count; index++) {
+                Transform2D transform = transforms[index].concat(state().transform);
+                for (size_t polygon = 0; polygon < polygons.size(); polygon++) {
+                    const std::vector<Point> &points = polygons[polygon].points;
+                    std::vector<Point> &devicePoints = devicePolygons[polygon].points;
+                    for (size_t point = 0; point < points.size(); point++)
+                        devicePoints[point] = transform.transformPoint(points[point]);
+                }
+                
+                fillDevicePolygons(devicePolygons, rule, color, nullptr);
+            }
+        }
+        
+        void Canvas::fillPathInstances(const Path &path, FillRule rule, const Transform2D *transforms, size_t count)
+        {
+            auto contours = path.flattened(Transform2D::Identity, instanceTolerance(transforms, count));
+            fillInstancePolygons(*contours, rule, state().fillColor, transforms, count);
+        }
+        
+        void Canvas::strokePathInstances(const Path &path, const Transform2D *transforms, size_t count)
+        {
+            auto polygons = path.stroked(state().strokeStyle, instanceTolerance(transforms, count));
+            fillInstancePolygons(*polygons, FillRule::NonZero, state().strokeColor, transforms, count);
+        }
+        
+        void Canvas::fillRect(Rect rect)
+        {
+            Path path;
+            path.addRect(rect, Transform2D::Identity);
+            fillPath(path, FillRule::NonZero);
+        }
+        
+        void Canvas::strokeRect(Rect rect)
+        {
+            Path path;
+            path.addRect(rect, Transform2D::Identity);
+            strokePath(path);
+        }
+        
+        void Canvas::clearRect(Rect rect)
+        {
+            Path path;
+            path.addRect(rect, Transform2D::Identity);
+            
+            std::vector<Contour> polygons;
+            path.flatten(state().transform, kFlatteningTolerance, polygons);
+            clearDevicePolygons(polygons);
+        }
+        
+        void Canvas::strokeLineSegments(const Point *points, size_t count)
+        {
+            Path path;
+            for (size_t index = 0; index + 1 < count; index += 2) {
+                path.moveTo(points[index], Transform2D::Identity);
+                path.lineTo(points[index + 1], Transform2D::Identity);
+            }
+            
+            strokePath(path);
+        }
+        
+#pragma mark -
+        
+        ///Returns the transform from the font units of a glyph, with y increasing
+        ///upwards, to user space at a given size and origin.
+        static Transform2D GlyphToUserTransform(const Typeface &typeface, Float size, Point origin)
+        {
+            Float scale = size / typeface.unitsPerEm();
+            return Transform2D(NativeAffineTransform{ scale, 0.0, 0.0, -scale, origin.x, origin.y });
+        }
+        
+        void Canvas::fillGlyphs(const Typeface &typeface, Float size, const PositionedGlyph *glyphs, size_t count)
+        {
+            const State &state = this->state();
+            if(state.clipBounds.isEmpty() || state.fillColor == 0 || count == 0)
+                return;
+            
+            //The atlas holds glyphs rasterized upright at a size in device pixels, so glyphs
+            //that are rotated, skewed, stretched, or shadowed are filled as paths instead.
+            const Transform2D &transform = state.transform;
+            Float deviceSize = size * transform.a;
+            bool canUseAtlas = (transform.b == 0.0 && transform.c == 0.0 && transform.a == transform.d &&
+                                deviceSize > 0.0 && deviceSize <= GlyphAtlas::kMaximumFontSize && state.shadowColor == 0);
+            
+            Path uncachedGlyphs;
+            std::vector<Command::GlyphMask> glyphMasks;
+            GlyphAtlas &atlas = GlyphAtlas::shared();
+            for (size_t index = 0; index < count; index++) {
+                const PositionedGlyph &glyph = glyphs[index];
+                if(!canUseAtlas) {
+                    typeface.addGlyphOutline(glyph.glyph, GlyphToUserTransform(typeface, size, glyph.position), uncachedGlyphs);
+                    continue;
+                }
+                
+                Point origin = transform.transformPoint(glyph.position);
+                Float originX = std::floor(origin.x * GlyphAtlas::kSubpixelPositions + 0.5) / GlyphAtlas::kSubpixelPositions;
+                Float wholeOriginX = std::floor(originX);
+                int subpixelPosition = int((originX - wholeOriginX) * GlyphAtlas::kSubpixelPositions);
+                
+                GlyphAtlas::Entry entry = atlas.entryFor(typeface, deviceSize, subpixelPosition, glyph.glyph);
+                if(entry.rect.isEmpty())
+                    continue;
+                
+                if(!entry.page) {
+                    typeface.addGlyphOutline(glyph.glyph, GlyphToUserTransform(typeface, size, glyph.position), uncachedGlyphs);
+                    continue;
+                }
+                
+                PixelRect bounds{ long(wholeOriginX) + entry.left, long(std::floor(origin.y + 0.5)) + entry.top, entry.rect.width, entry.rect.height };
+                PixelRect visibleBounds = bounds.intersection(state.clipBounds);
+                if(visibleBounds.isEmpty())
+                    continue;
+                
+                const uint8_t *coverage = entry.page->coverage.data() + ((entry.rect.y + visibleBounds.y - bounds.y) * GlyphAtlas::kPageSize +
+                                                                         (entry.rect.x + visibleBounds.x - bounds.x));
+                glyphMasks.push_back(Command::GlyphMask{ visibleBounds, entry.page, coverage });
+            }
+            
+            if(!glyphMasks.empty())
+                perform(std::unique_ptr<Command>(new Command(std::move(glyphMasks), state)));
+            
+            if(!uncachedGlyphs.isEmpty())
+                fillPath(uncachedGlyphs, FillRule::NonZero);
+        }
+        
+#pragma mark -
+        
+        ///Returns the transform from the pixels of an image drawn in a rectangle to user space.
+        static Transform2D ImageToUserTransform(const Surface *image, Rect rect)
+        {
+            return Transform2D::makeScale(rect.size.width / image->width(), rect.size.height / image->height())
+                .concat(Transform2D::makeTranslation(rect.origin.x, rect.origin.y));
+        }
+        
+        void Canvas::drawImage(const Surface *image, Rect rect)
+        {
+            if(!image || image->width() == 0 || image->height() == 0 || rect.size.width == 0.0 || rect.size.height == 0.0)
+                return;
+            
+            Transform2D imageToDevice = ImageToUserTransform(image, rect).concat(state().transform);
+            const Surface *source = sampleableImage(image);
+            auto shader = std::make_shared<ImageShader>(source, imageToDevice.invert(), false);
+            source->release();
+            
+            fillRectWithShader(rect, shader);
+        }
+        
+        void Canvas::drawTiledImage(const Surface *image, Rect rect)
+        {
+            if(!image || image->width() == 0 || image->height() == 0 || rect.size.width == 0.0 || rect.size.height == 0.0)
+                return;
+            
+            Transform2D imageToDevice = ImageToUserTransform(image, rect).concat(state().transform);
+            const Surface *source = sampleableImage(image);
+            auto shader = std::make_shared<ImageShader>(source, imageToDevice.invert(), true);
+            source->release();
+            
+            fillClipWithShader(shader);
+        }
+        
+        void Canvas::fillRectWithShader(Rect rect, std::shared_ptr<const Shader> shader)
+        {
+            Path path;
+            path.addRect(rect, Transform2D::Identity);
+            
+            std::vector<Contour> polygons;
+            path.flatten(state().transform, kFlatteningTolerance, polygons);
+            fillDevicePolygons(polygons, FillRule::NonZero, 0, shader);
+        }
+        
+        void Canvas::drawLinearGradient(const Gradient &gradient, Point start, Point end, int options)
+        {
+            fillClipWithShader(std::make_shared<LinearGradientShader>(gradient, state().transform.invert(), start, end, options));
+        }
+        
+        void Canvas::drawRadialGradient(const Gradient &gradient, Point startCenter, Float startRadius,
+                                        Point endCenter, Float endRadius, int options)
+        {
+            fillClipWithShader(std::make_shared<RadialGradientShader>(gradient, state().transform.invert(), startCenter, startRadius,
+                                                                      endCenter, endRadius, options));
+        }
+        
+#pragma mark - Glyph Atlas
+        
+        size_t GlyphAtlas::KeyHash::operator()(const Key &key) const
+        {
+            size_t hash = std::hash<uint64_t>()(key.typeface);
+            hash = hash * 31 + std::hash<Float>()(key.size);
+            hash = hash * 31 + size_t(key.subpixelPosition);
+            hash = hash * 31 + size_t(key.glyph);
+            return hash;
+        }
+        
+        GlyphAtlas::GlyphAtlas() :
+            mMutex(),
+            mPages(),
+            mEntries(),
+            mShelfX(0),
+            mShelfY(0),
+            mShelfHeight(0)
+        {
+        }
+        
+        GlyphAtlas &GlyphAtlas::shared()
+        {
+            static GlyphAtlas *sharedAtlas = new GlyphAtlas();
+            return *sharedAtlas;
+        }
+        
+#pragma mark -
+        
+        std::shared_ptr<GlyphAtlas::Page> GlyphAtlas::allocate(long width, long height, PixelRect &outRect)
+        {
+            //Glyphs are placed left to right along shelves as tall as the tallest glyph
+            //placed on them. Glyphs of a font are of similar heights, so little is wasted.
+            if(!mPages.empty() && mShelfX + width > kPageSize) {
+                mShelfX = 0;
+                mShelfY += mShelfHeight;
+                mShelfHeight = 0;
+            }
+            
+            if(mPages.empty() || mShelfY + height > kPageSize) {
+                if(mPages.size() >= kMaximumPageCount) {
+                    mPages.clear();
+                    mEntries.clear();
+                }
+                
+                auto page = std::make_shared<Page>();
+                page->coverage.assign(size_t(kPageSize * kPageSize), 0);
+                mPages.push_back(page);
+                
+                mShelfX = 0;
+                mShelfY = 0;
+                mShelfHeight = 0;
+            }
+            
+            outRect = PixelRect{ mShelfX, mShelfY, width, height };
+            mShelfX += width;
+            mShelfHeight = std::max(mShelfHeight, height);
+            
+            return mPages.back();
+        }
+        
+        GlyphAtlas::Entry GlyphAtlas::entryFor(const Typeface &typeface, Float size, int subpixelPosition, uint16_t glyph)
+        {
+            Key key{ typeface.uniqueID(), size, subpixelPosition, glyph };
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                auto existingEntry = mEntries.find(key);
+                if(existingEntry != mEntries.end())
+                    return existingEntry->second;
+            }
+            
+            //Glyphs are rasterized outside of the lock so that bands and threads
+            //drawing different glyphs do not wait on each other.
+            Path outline;
+            Float scale = size / typeface.unitsPerEm();
+            Float offset = Float(subpixelPosition) / kSubpixelPositions;
+            typeface.addGlyphOutline(glyph, Transform2D(NativeAffineTransform{ scale, 0.0, 0.0, -scale, offset, 0.0 }), outline);
+            
+            std::vector<Contour> polygons;
+            outline.flatten(Transform2D::Identity, kFlatteningTolerance, polygons);
+            CoverageRasterizer rasterizer(polygons, FillRule::NonZero, PixelRect::enclosing(outline.boundingBox()));
+            
+            const PixelRect &bounds = rasterizer.bounds();
+            Entry entry{ nullptr, PixelRect{ 0, 0, bounds.width, bounds.height }, bounds.x, bounds.y };
+            if(bounds.width > kPageSize || bounds.height > kPageSize)
+                return entry;
+            
+            std::vector<uint8_t> coverage(size_t(bounds.width * bounds.height), 0);
+            rasterizer.rasterize(bounds.y, bounds.y + bounds.height, [&](long y, long x, long count, uint8_t *rowCoverage) {
+                memcpy(coverage.data() + (y - bounds.y) * bounds.width + (x - bounds.x), rowCoverage, count);
+            });
+            
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto existingEntry = mEntries.find(key);
+            if(existingEntry != mEntries.end())
+                return existingEntry->second;
+            
+            if(!entry.rect.isEmpty()) {
+                auto page = allocate(bounds.width, bounds.height, entry.rect);
+                for (long row = 0; row < bounds.height; row++)
+                    memcpy(page->coverage.data() + (entry.rect.y + row) * kPageSize + entry.rect.x, coverage.data() + row * bounds.width, bounds.width);
+                
+                entry.page = page;
+            }
+            
+            mEntries.emplace(key, entry);
+            return entry;
+        }
+        
+        void GlyphAtlas::removeAll()
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mPages.clear();
+            mEntries.clear();
+        }
+        
+        size_t GlyphAtlas::pageCount() const
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            return mPages.size();
+        }
+    }
+}
+
+#endif /* GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster */
@@ -0,0 +1,935 @@
+//
+//  rastercodec.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/6/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#if GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster
+
+#include "raster.h"
+#include "threading.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace gfx {
+    namespace raster {
+    
+#pragma mark - Constants
+        
+        ///The eight bytes every PNG begins with.
+        static const uint8_t kPNGSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        
+        ///The color types a PNG may use.
+        enum ColorType : uint8_t {
+            kColorTypeGray = 0,
+            kColorTypeRGB = 2,
+            kColorTypePalette = 3,
+            kColorTypeGrayAlpha = 4,
+            kColorTypeRGBA = 6,
+        };
+        
+        ///The filters a PNG scanline may be encoded with.
+        enum Filter : uint8_t {
+            kFilterNone = 0,
+            kFilterSub = 1,
+            kFilterUp = 2,
+            kFilterAverage = 3,
+            kFilterPaeth = 4,
+        };
+        
+#pragma mark - Byte Order
+        
+        static uint32_t ReadUInt32(const uint8_t *bytes)
+        {
+            return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]);
+        }
+        
+        static void AppendUInt32(std::vector<uint8_t> &data, uint32_t value)
+        {
+            data.push_back(uint8_t(value >> 24));
+            data.push_back(uint8_t(value >> 16));
+            data.push_back(uint8_t(value >> 8));
+            data.push_back(uint8_t(value));
+        }
+        
+#pragma mark - Filters
+        
+        ///The Paeth predictor, as defined by the PNG specification.
+        static inline uint8_t PaethPredictor(int a, int b, int c)
+        {
+            int p = a + b - c;
+            int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+            if(pa <= pb && pa <= pc)
+                return uint8_t(a);
+            else if(pb <= pc)
+                return uint8_t(b);
+            else
+                return uint8_t(c);
+        }
+        
+        ///Applies a filter to a scanline.
+        ///
+        /// \param  filter  The filter to apply.
+        /// \param  row     The unfiltered scanline.
+        /// \param  prior   The unfiltered scanline above, or a row of zeros.
+        /// \param  length  The number of bytes in a scanline.
+        /// \param  bpp     The number of bytes per complete pixel, rounded up to 1.
+        /// \param  out     On return, contains the filtered scanline.
+        ///
+        static void FilterRow(Filter filter, const uint8_t *row, const uint8_t *prior, size_t length, size_t bpp, uint8_t *out)
+        {
+            for (size_t i = 0; i < length; i++) {
+                int left = (i >= bpp)? row[i - bpp] : 0;
+                int above = prior[i];
+                int aboveLeft = (i >= bpp)? prior[i - bpp] : 0;
+                switch (filter) {
+                    case kFilterNone:
+                        out[i] = row[i];
+                        break;
+                    case kFilterSub:
+                        out[i] = uint8_t(row[i] - left);
+                        break;
+                    case kFilterUp:
+                        out[i] = uint8_t(row[i] - above);
+                        break;
+                    case kFilterAverage:
+                        out[i] = uint8_t(row[i] - ((left + above) >> 1));
+                        break;
+                    case kFilterPaeth:
+                        out[i] = uint8_t(row[i] - PaethPredictor(left, above, aboveLeft));
+                        break;
+                }
+            }
+        }
+        
+        ///Reverses the filter of a scanline in place.
+        ///
+        /// \result false if the filter type is unknown; true otherwise.
+        ///
+        static bool UnfilterRow(uint8_t filter, uint8_t *row, const uint8_t *prior, size_t length, size_t bpp)
+        {
+            switch (filter) {
+                case kFilterNone:
+                    break;
+                case kFilterSub:
+                    for (size_t i = bpp; i < length; i++)
+                        row[i] += row[i - bpp];
+                    break;
+                case kFilterUp:
+                    for (size_t i = 0; i < length; i++)
+                        row[i] += prior[i];
+                    break;
+                case kFilterAverage:
+                    for (size_t i = 0; i < length; i++) {
+                        int left = (i >= bpp)? row[i - bpp] : 0;
+                        row[i] += uint8_t((left + prior[i]) >> 1);
+                    }
+                    break;
+                case kFilterPaeth:
+                    for (size_t i = 0; i < length; i++) {
+                        int left = (i >= bpp)? row[i - bpp] : 0;
+                        int aboveLeft = (i >= bpp)? prior[i - bpp] : 0;
+                        row[i] += PaethPredictor(left, prior[i], aboveLeft);
+                    }
+                    break;
+                default:
+                    return false;
+            }
+            return true;
+        }
+        
+#pragma mark - Encoding
+        
+        ///The number of bytes of filtered scanlines in each band of a PNG that is compressed concurrently.
+        static const size_t kPNGBandLength = 256 * 1024;
+        
+        ///The size of the deflate window. Each band of a PNG is primed with this much of the data before it.
+        static const size_t kDeflateWindowSize = 32 * 1024;
+        
+        ///The number of bytes buffered by the encoders of uncompressed formats between writes.
+        static const size_t kEncodeBufferLength = 64 * 1024;
+        
+        ///Unpremultiplies a row of pixels into 8-bit RGBA samples.
+        static void UnpremultiplyRow(const uint32_t *source, size_t width, uint8_t *out)
+        {
+            for (size_t x = 0; x < width; x++, out += 4) {
+                uint32_t pixel = source[x];
+                uint32_t alpha = pixel >> 24;
+                if(alpha == 0) {
+                    out[0] = out[1] = out[2] = out[3] = 0;
+                } else if(alpha == 255) {
+                    out[0] = uint8_t(pixel);
+                    out[1] = uint8_t(pixel >> 8);
+                    out[2] = uint8_t(pixel >> 16);
+                    out[3] = 255;
+                } else {
+                    out[0] = uint8_t(std::min<uint32_t>(255, ((pixel & 0xFF) * 255 + alpha / 2) / alpha));
+                    out[1] = uint8_t(std::min<uint32_t>(255, (((pixel >> 8) & 0xFF) * 255 + alpha / 2) / alpha));
+                    out[2] = uint8_t(std::min<uint32_t>(255, (((pixel >> 16) & 0xFF) * 255 + alpha / 2) / alpha));
+                    out[3] = uint8_t(alpha);
+                }
+            }
+        }
+        
+        ///Returns the scanline filter type that corresponds to a fixed filter.
+        static Filter FilterForPNGFilter(PNGFilter filter)
+        {
+            switch (filter) {
+                case PNGFilter::Sub:
+                    return kFilterSub;
+                case PNGFilter::Up:
+                    return kFilterUp;
+                case PNGFilter::Average:
+                    return kFilterAverage;
+                case PNGFilter::Paeth:
+                    return kFilterPaeth;
+                default:
+                    return kFilterNone;
+            }
+        }
+        
+        ///Unpremultiplies and filters a range of rows of a surface.
+        ///
+        /// \param  surface     The surface whose rows to filter.
+        /// \param  firstRow    The first row to filter.
+        /// \param  endRow      The row after the last row to filter.
+        /// \param  filter      The filter to apply.
+        /// \param  out         On return, each filtered scanline preceded by its filter type has been appended.
+        ///
+        ///The filtered scanlines only depend on the rows of the surface, so any range
+        ///of rows is filtered exactly as it would be if the whole surface was filtered.
+        static void FilterRows(const Surface *surface, size_t firstRow, size_t endRow, PNGFilter filter, std::vector<uint8_t> &out)
+        {
+            const size_t width = surface->width();
+            const size_t stride = width * 4;
+            
+            std::vector<uint8_t> prior(stride, 0), current(stride), candidate(stride), best(stride);
+            if(firstRow > 0)
+                UnpremultiplyRow(surface->row(firstRow - 1), width, prior.data());
+            
+            for (size_t y = firstRow; y < endRow; y++) {
+                UnpremultiplyRow(surface->row(y), width, current.data());
+                
+                Filter bestFilter = FilterForPNGFilter(filter);
+                if(filter == PNGFilter::Adaptive) {
+                    //Choose the filter with the smallest sum of absolute
+                    //differences, as the PNG spec suggests.
+                    unsigned long bestScore = ~0UL;
+                    for (Filter candidateFilter : { kFilterNone, kFilterSub, kFilterUp, kFilterAverage, kFilterPaeth }) {
+                        FilterRow(candidateFilter, current.data(), prior.data(), stride, 4, candidate.data());
+                        
+                        unsigned long score = 0;
+                        for (uint8_t byte : candidate)
+                            score += (byte < 128)? byte : (256 - byte);
+                        
+                        if(score < bestScore) {
+                            bestScore = score;
+                            bestFilter = candidateFilter;
+                            best.swap(candidate);
+                        }
+                    }
+                } else {
+                    FilterRow(bestFilter, current.data(), prior.data(), stride, 4, best.data());
+                }
+                
+                out.push_back(bestFilter);
+                out.insert(out.end(), best.begin(), best.end());
+                prior.swap(current);
+            }
+        }
+        
+        ///Compresses a band of filtered scanlines into raw deflate data that may be
+        ///concatenated with the compressed bands around it.
+        ///
+        /// \param  data                The filtered scanlines of the band.
+        /// \param  length              The number of bytes in `data`.
+        /// \param  dictionary          The data immediately preceding the band, used to prime the compressor.
+        /// \param  dictionaryLength    The number of bytes in `dictionary`. May be 0.
+        /// \param  level               The zlib compression level.
+        /// \param  isLast              Whether or not the band ends the deflate stream.
+        /// \param  outData             On return, the compressed data has been appended.
+        ///
+        /// \result true if the band could be compressed; false otherwise.
+        ///
+        ///Bands other than the last are ended with a sync flush, which aligns them
+        ///to a byte boundary without ending the stream.
+        static bool DeflateBand(const uint8_t *data, size_t length, const uint8_t *dictionary, size_t dictionaryLength,
+                                int level, bool isLast, std::vector<uint8_t> &outData)
+        {
+            z_stream stream = {};
+            if(deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+                return false;
+            
+            if(dictionaryLength > 0 && deflateSetDictionary(&stream, dictionary, uInt(dictionaryLength)) != Z_OK) {
+                deflateEnd(&stream);
+                return false;
+            }
+            
+            size_t offset = outData.size();
+            outData.resize(offset + deflateBound(&stream, uLong(length)) + 16);
+            stream.next_in = const_cast<Bytef *>(data);
+            stream.avail_in = uInt(length);
+            stream.next_out = outData.data() + offset;
+            stream.avail_out = uInt(outData.size() - offset);
+            
+            bool succeeded = true;
+            for (;;) {
+                if(stream.avail_out == 0) {
+                    size_t used = outData.size();
+                    outData.resize(used * 2);
+                    stream.next_out = outData.data() + used;
+                    stream.avail_out = uInt(outData.size() - used);
+                }
+                
+                int status = deflate(&stream, isLast? Z_FINISH : Z_SYNC_FLUSH);
+                if(status == Z_STREAM_END)
+                    break;
+                
+                if((status != Z_OK && status != Z_BUF_ERROR) || (status == Z_BUF_ERROR && stream.avail_out != 0)) {
+                    succeeded = false;
+                    break;
+                }
+                
+                if(!isLast && stream.avail_in == 0 && stream.avail_out != 0)
+                    break;
+            }
+            
+            outData.resize(outData.size() - stream.avail_out);
+            deflateEnd(&stream);
+            return succeeded;
+        }
+        
+        ///Writes a chunk with a given four character type and payload to a PNG.
+        static bool WriteChunk(const EncodedBytesFunctor &write, const char type[4], const uint8_t *payload, size_t length)
+        {
+            std::vector<uint8_t> header;
+            AppendUInt32(header, uint32_t(length));
+            header.insert(header.end(), type, type + 4);
+            
+            uLong crc = crc32(0L, Z_NULL, 0);
+            crc = crc32(crc, header.data() + 4, 4);
+            if(length > 0)
+                crc = crc32(crc, payload, uInt(length));
+            
+            std::vector<uint8_t> trailer;
+            AppendUInt32(trailer, uint32_t(crc));
+            
+            return (write(header.data(), header.size()) &&
+                    (length == 0 || write(payload, length)) &&
+                    write(trailer.data(), trailer.size()));
+        }
+        
+        ///Writes the two byte zlib header that describes a stream compressed at a given level.
+        static void ZlibHeader(int level, uint8_t outHeader[2])
+        {
+            uint8_t compressionLevel;
+            if(level == Z_DEFAULT_COMPRESSION || level == 6)
+                compressionLevel = 2;
+            else if(level < 2)
+                compressionLevel = 0;
+            else if(level < 6)
+                compressionLevel = 1;
+            else
+                compressionLevel = 3;
+            
+            //A 32K window with the deflate method, and check bits that make the header a multiple of 31.
+            outHeader[0] = 0x78;
+            outHeader[1] = uint8_t(compressionLevel << 6);
+            outHeader[1] += uint8_t(31 - ((outHeader[0] * 256 + outHeader[1]) % 31));
+        }
+        
+        bool encodePNG(const Surface *surface, const PNGEncodingOptions &options, const EncodedBytesFunctor &write)
+        {
+            const size_t width = surface->width(), height = surface->height();
+            const size_t stride = width * 4;
+            const int level = (options.compressionLevel < 0)? Z_DEFAULT_COMPRESSION : std::min(options.compressionLevel, 9);
+            
+            uint8_t header[13];
+            header[0] = uint8_t(width >> 24); header[1] = uint8_t(width >> 16);
+            header[2] = uint8_t(width >> 8); header[3] = uint8_t(width);
+            header[4] = uint8_t(height >> 24); header[5] = uint8_t(height >> 16);
+            header[6] = uint8_t(height >> 8); header[7] = uint8_t(height);
+            header[8] = 8; //bit depth
+            header[9] = kColorTypeRGBA;
+            header[10] = 0; //compression method
+            header[11] = 0; //filter method
+            header[12] = 0; //interlace method
+            
+            if(!write(kPNGSignature, sizeof(kPNGSignature)) || !WriteChunk(write, "IHDR", header, sizeof(header)))
+                return false;
+            
+            const size_t rowsPerBand = std::max<size_t>(1, kPNGBandLength / (stride + 1));
+            const size_t rowsPerWindow = (kDeflateWindowSize + stride) / (stride + 1);
+            const size_t numberOfBands = std::max<size_t>(1, (height + rowsPerBand - 1) / rowsPerBand);
+            
+            //Each band becomes an IDAT chunk. The bands are written in order
+            //as they are completed, so the output is streamed while later
+            //bands are still being compressed.
+            struct Band
+            {
+                std::vector<uint8_t> compressed;
+                uLong checksum;
+                size_t length;
+                bool isComplete;
+            };
+            std::vector<Band> bands(numberOfBands);
+            
+            std::mutex writeMutex;
+            std::atomic<bool> failed(false);
+            size_t nextBandToWrite = 0;
+            uLong checksum = adler32(0L, Z_NULL, 0);
+            
+            threading::parallelFor(numberOfBands, [&](size_t index, size_t) {
+                if(failed.load(std::memory_order_relaxed))
+                    return;
+                
+                Band &band = bands[index];
+                size_t firstRow = std::min(height, index * rowsPerBand);
+                size_t endRow = std::min(height, firstRow + rowsPerBand);
+                size_t firstWindowRow = (firstRow > rowsPerWindow)? firstRow - rowsPerWindow : 0;
+                
+                //The rows before the band are filtered again to prime the compressor
+                //with the data the band would have followed in a serial stream.
+                std::vector<uint8_t> filtered;
+                filtered.reserve((endRow - firstWindowRow) * (stride + 1));
+                FilterRows(surface, firstWindowRow, endRow, options.filter, filtered);
+                
+                size_t windowLength = (firstRow - firstWindowRow) * (stride + 1);
+                size_t dictionaryLength = std::min(windowLength, kDeflateWindowSize);
+                const uint8_t *data = filtered.data() + windowLength;
+                band.length = filtered.size() - windowLength;
+                band.checksum = adler32(adler32(0L, Z_NULL, 0), data, uInt(band.length));
+                
+                if(index == 0) {
+                    uint8_t zlibHeader[2];
+                    ZlibHeader(level, zlibHeader);
+                    band.compressed.assign(zlibHeader, zlibHeader + 2);
+                }
+                
+                bool isLast = (index == numberOfBands - 1);
+                if(!DeflateBand(data, band.length, data - dictionaryLength, dictionaryLength, level, isLast, band.compressed)) {
+                    failed = true;
+                    return;
+                }
+                
+                std::lock_guard<std::mutex> lock(writeMutex);
+                band.isComplete = true;
+                while (nextBandToWrite < numberOfBands && bands[nextBandToWrite].isComplete) {
+                    Band &completedBand = bands[nextBandToWrite];
+                    checksum = adler32_combine(checksum, completedBand.checksum, z_off_t(completedBand.length));
+                    if(nextBandToWrite == numberOfBands - 1)
+                        AppendUInt32(completedBand.compressed, uint32_t(checksum));
+                    
+                    if(!failed && !WriteChunk(write, "IDAT", completedBand.compressed.data(), completedBand.compressed.size()))
+                        failed = true;
+                    
+                    std::vector<uint8_t>().swap(completedBand.compressed);
+                    nextBandToWrite++;
+                }
+            });
+            
+            if(failed || nextBandToWrite != numberOfBands)
+                return false;
+            
+            return WriteChunk(write, "IEND", nullptr, 0);
+        }
+        
+        bool encodePNG(const Surface *surface, std::vector<uint8_t> &outData)
+        {
+            outData.clear();
+            return encodePNG(surface, PNGEncodingOptions{ Z_DEFAULT_COMPRESSION, PNGFilter::Adaptive }, [&outData](const uint8_t *bytes, size_t length) {
+                outData.insert(outData.end(), bytes, bytes + length);
+                return true;
+            });
+        }
+        
+#pragma mark -
+        
+        ///The operations of the Quite OK Image format.
+        enum QOIOperation : uint8_t {
+            kQOIOperationIndex = 0x00,
+            kQOIOperationDiff = 0x40,
+            kQOIOperationLuma = 0x80,
+            kQOIOperationRun = 0xC0,
+            kQOIOperationRGB = 0xFE,
+            kQOIOperationRGBA = 0xFF,
+        };
+        
+        bool encodeQOI(const Surface *surface, const EncodedBytesFunctor &write)
+        {
+            const size_t width = surface->width(), height = surface->height();
+            
+            std::vector<uint8_t> buffer;
+            buffer.reserve(kEncodeBufferLength + 16);
+            buffer.insert(buffer.end(), { 'q', 'o', 'i', 'f' });
+            AppendUInt32(buffer, uint32_t(width));
+            AppendUInt32(buffer, uint32_t(height));
+            buffer.push_back(4); //channels
+            buffer.push_back(0); //sRGB with linear alpha
+            
+            uint8_t index[64][4] = {};
+            uint8_t previous[4] = { 0, 0, 0, 255 };
+            size_t run = 0;
+            
+            std::vector<uint8_t> row(width * 4);
+            for (size_t y = 0; y < height; y++) {
+                UnpremultiplyRow(surface->row(y), width, row.data());
+                
+                for (size_t x = 0; x < width; x++) {
+                    const uint8_t *pixel = &row[x * 4];
+                    bool isLastPixel = (y == height - 1 && x == width - 1);
+                    if(std::memcmp(pixel, previous, 4) == 0) {
+                        run++;
+                        if(run == 62 || isLastPixel) {
+                            buffer.push_back(uint8_t(kQOIOperationRun | (run - 1)));
+                            run = 0;
+                        }
+                    } else {
+                        if(run > 0) {
+                            buffer.push_back(uint8_t(kQOIOperationRun | (run - 1)));
+                            run = 0;
+                        }
+                        
+                        size_t position = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64;
+                        if(std::memcmp(index[position], pixel, 4) == 0) {
+                            buffer.push_back(uint8_t(kQOIOperationIndex | position));
+                        } else {
+                            std::memcpy(index[position], pixel, 4);
+                            
+                            if(pixel[3] == previous[3]) {
+                                int8_t red = int8_t(pixel[0] - previous[0]);
+                                int8_t green = int8_t(pixel[1] - previous[1]);
+                                int8_t blue = int8_t(pixel[2] - previous[2]);
+                                int8_t redGreen = int8_t(red - green);
+                                int8_t blueGreen = int8_t(blue - green);
+                                
+                                if(red >= -2 && red <= 1 && green >= -2 && green <= 1 && blue >= -2 && blue <= 1) {
+                                    buffer.push_back(uint8_t(kQOIOperationDiff | ((red + 2) << 4) | ((green + 2) << 2) | (blue + 2)));
+                                } else if(green >= -32 && green <= 31 && redGreen >= -8 && redGreen <= 7 && blueGreen >= -8 && blueGreen <= 7) {
+                                    buffer.push_back(uint8_t(kQOIOperationLuma | (green + 32)));
+                                    buffer.push_back(uint8_t(((redGreen + 8) << 4) | (blueGreen + 8)));
+                                } else {
+                                    buffer.insert(buffer.end(), { uint8_t(kQOIOperationRGB), pixel[0], pixel[1], pixel[2] });
+                                }
+                            } else {
+                                buffer.insert(buffer.end(), { uint8_t(kQOIOperationRGBA), pixel[0], pixel[1], pixel[2], pixel[3] });
+                            }
+                        }
+                    }
+                    
+                    std::memcpy(previous, pixel, 4);
+                }
+                
+                if(buffer.size() >= kEncodeBufferLength) {
+                    if(!write(buffer.data(), buffer.size()))
+                        return false;
+                    
+                    buffer.clear();
+                }
+            }
+            
+            buffer.insert(buffer.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+            return write(buffer.data(), buffer.size());
+        }
+        
+        bool encodePPM(const Surface *surface, const EncodedBytesFunctor &write)
+        {
+            const size_t width = surface->width(), height = surface->height();
+            
+            std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+            std::vector<uint8_t> buffer(header.begin(), header.end());
+            buffer.reserve(kEncodeBufferLength + width * 3);
+            
+            //Premultiplied samples are the samples composited over black.
+            for (size_t y = 0; y < height; y++) {
+                const uint32_t *source = surface->row(y);
+                for (size_t x = 0; x < width; x++) {
+                    uint32_t pixel = source[x];
+                    buffer.insert(buffer.end(), { uint8_t(pixel), uint8_t(pixel >> 8), uint8_t(pixel >> 16) });
+                }
+                
+                if(buffer.size() >= kEncodeBufferLength) {
+                    if(!write(buffer.data(), buffer.size()))
+                        return false;
+                    
+                    buffer.clear();
+                }
+            }
+            
+            return buffer.empty() || write(buffer.data(), buffer.size());
+        }
+        
+        bool encodeRGBA(const Surface *surface, const EncodedBytesFunctor &write)
+        {
+            const size_t width = surface->width(), height = surface->height();
+            const size_t stride = width * 4;
+            if(stride == 0)
+                return true;
+            
+            const size_t rowsPerWrite = std::max<size_t>(1, kEncodeBufferLength / stride);
+            std::vector<uint8_t> buffer(rowsPerWrite * stride);
+            for (size_t y = 0; y < height; y += rowsPerWrite) {
+                size_t numberOfRows = std::min(rowsPerWrite, height - y);
+                for (size_t row = 0; row < numberOfRows; row++)
+                    UnpremultiplyRow(surface->row(y + row), width, buffer.data() + row * stride);
+                
+                if(!write(buffer.data(), numberOfRows * stride))
+                    return false;
+            }
+            
+            return true;
+        }
+        
+#pragma mark - Decoding
+        
+        ///The contents of a PNG's header chunk.
+        struct ImageHeader
+        {
+            uint32_t width;
+            uint32_t height;
+            uint8_t bitDepth;
+            uint8_t colorType;
+            uint8_t interlaceMethod;
+            
+            ///Returns the number of samples in each pixel.
+            size_t channels() const
+            {
+                switch (colorType) {
+                    case kColorTypeGray:
+                    case kColorTypePalette:
+                        return 1;
+                    case kColorTypeGrayAlpha:
+                        return 2;
+                    case kColorTypeRGB:
+                        return 3;
+                    default:
+                        return 4;
+                }
+            }
+            
+            ///Returns whether or not the bit depth is permitted for the color type.
+            bool isValid() const
+            {
+                if(width == 0 || height == 0 || width > 0x7FFFFFFF || height > 0x7FFFFFFF)
+                    return false;
+                
+                switch (colorType) {
+                    case kColorTypeGray:
+                        return (bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16);
+                    case kColorTypePalette:
+                        return (bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8);
+                    case kColorTypeRGB:
+                    case kColorTypeGrayAlpha:
+                    case kColorTypeRGBA:
+                        return (bitDepth == 8 || bitDepth == 16);
+                    default:
+                        return false;
+                }
+            }
+        };
+        
+        ///The transparency and palette information used to expand samples into pixels.
+        struct ImagePalette
+        {
+            ///The palette entries as unpremultiplied RGBA quadruplets.
+            uint8_t entries[256][4];
+            
+            ///Whether or not a tRNS chunk specified a transparent color.
+            bool hasTransparentColor;
+            
+            ///The transparent color's samples, at the image's bit depth.
+            uint16_t transparentColor[3];
+        };
+        
+        ///Reads a sample of a given bit depth from a scanline.
+        static inline uint16_t ReadSample(const uint8_t *row, size_t index, uint8_t bitDepth)
+        {
+            switch (bitDepth) {
+                case 16:
+                    return uint16_t((row[index * 2] << 8) | row[index * 2 + 1]);
+                case 8:
+                    return row[index];
+                default: {
+                    size_t bit = index * bitDepth;
+                    unsigned shift = unsigned(8 - bitDepth - (bit & 7));
+                    return uint16_t((row[bit >> 3] >> shift) & ((1 << bitDepth) - 1));
+                }
+            }
+        }
+        
+        ///Scales a sample of a given bit depth to 8 bits.
+        static inline uint32_t ScaleSample(uint16_t sample, uint8_t bitDepth)
+        {
+            switch (bitDepth) {
+                case 16:
+                    return sample >> 8;
+                case 8:
+                    return sample;
+                default:
+                    return (uint32_t(sample) * 255) / ((1u << bitDepth) - 1);
+            }
+        }
+        
+        ///Expands an unfiltered scanline into premultiplied pixels.
+        ///
+        /// \param  header  The image header.
+        /// \param  palette The palette and transparency information.
+        /// \param  row     The unfiltered scanline.
+        /// \param  width   The number of pixels in the scanline.
+        /// \param  out     The first destination pixel.
+        /// \param  step    The distance between destination pixels.
+        ///
+        static void ExpandRow(const ImageHeader &header, const ImagePalette &palette, const uint8_t *row, size_t width, uint32_t *out, size_t step)
+        {
+            const uint8_t depth = header.bitDepth;
+            for (size_t x = 0; x < width; x++) {
+                uint32_t red, green, blue, alpha = 255;
+                switch (header.colorType) {
+                    case kColorTypeGray: {
+                        uint16_t gray = ReadSample(row, x, depth);
+                        red = green = blue = ScaleSample(gray, depth);
+                        if(palette.hasTransparentColor && gray == palette.transparentColor[0])
+                            alpha = 0;
+                        break;
+                    }
+                    case kColorTypeGrayAlpha: {
+                        red = green = blue = ScaleSample(ReadSample(row, x * 2, depth), depth);
+                        alpha = ScaleSample(ReadSample(row, x * 2 + 1, depth), depth);
+                        break;
+                    }
+                    case kColorTypeRGB: {
+                        uint16_t r = ReadSample(row, x * 3, depth);
+                        uint16_t g = ReadSample(row, x * 3 + 1, depth);
+                        uint16_t b = ReadSample(row, x * 3 + 2, depth);
+                        red = ScaleSample(r, depth);
+                        green = ScaleSample(g, depth);
+                        blue = ScaleSample(b, depth);
+                        if(palette.hasTransparentColor && r == palette.transparentColor[0] && g == palette.transparentColor[1] && b == palette.transparentColor[2])
+                            alpha = 0;
+                        break;
+                    }
+                    case kColorTypePalette: {
+                        const uint8_t *entry = palette.entries[ReadSample(row, x, depth)];
+                        red = entry[0];
+                        green = entry[1];
+                        blue = entry[2];
+                        alpha = entry[3];
+                        break;
+                    }
+                    default: {
+                        red = ScaleSample(ReadSample(row, x * 4, depth), depth);
+                        green = ScaleSample(ReadSample(row, x * 4 + 1, depth), depth);
+                        blue = ScaleSample(ReadSample(row, x * 4 + 2, depth), depth);
+                        alpha = ScaleSample(ReadSample(row, x * 4 + 3, depth), depth);
+                        break;
+                    }
+                }
+                
+                out[x * step] = pixel((red * alpha + 127) / 255, (green * alpha + 127) / 255, (blue * alpha + 127) / 255, alpha);
+            }
+        }
+        
+        ///The starting offsets and strides of the seven Adam7 passes.
+        static const struct { size_t x, y, dx, dy; } kAdam7Passes[7] = {
+            { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 },
+            { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 },
+        };
+        
+        ///Unfilters and expands a pass of image data into a surface.
+        ///
+        /// \result false if the image data is malformed; true otherwise.
+        ///
+        static bool DecodePass(const ImageHeader &header, const ImagePalette &palette,
+                               const uint8_t *&data, const uint8_t *end,
+                               size_t originX, size_t originY, size_t stepX, size_t stepY,
+                               Surface *surface)
+        {
+            if(originX >= header.width || originY >= header.height)
+                return true;
+            
+            const size_t bitsPerPixel = header.channels() * header.bitDepth;
+            const size_t bpp = std::max<size_t>(1, bitsPerPixel / 8);
+            const size_t passWidth = (header.width - originX + stepX - 1) / stepX;
+            const size_t passHeight = (header.height - originY + stepY - 1) / stepY;
+            const size_t length = (passWidth * bitsPerPixel + 7) / 8;
+            
+            std::vector<uint8_t> prior(length, 0), row(length);
+            for (size_t y = 0; y < passHeight; y++) {
+                if(size_t(end - data) < length + 1)
+                    return false;
+                
+                uint8_t filter = *data++;
+                std::memcpy(row.data(), data, length);
+                data += length;
+                
+                if(!UnfilterRow(filter, row.data(), prior.data(), length, bpp))
+                    return false;
+                
+                ExpandRow(header, palette, row.data(), passWidth, surface->row(originY + y * stepY) + originX, stepX);
+                prior.swap(row);
+            }
+            
+            return true;
+        }
+        
+        ///Inflates the concatenated contents of a PNG's IDAT chunks.
+        ///
+        /// \result false if the stream is malformed or shorter than expected; true otherwise.
+        ///
+        static bool Inflate(const std::vector<uint8_t> &compressed, std::vector<uint8_t> &outData, size_t expectedLength)
+        {
+            outData.resize(expectedLength);
+            
+            z_stream stream = {};
+            if(inflateInit(&stream) != Z_OK)
+                return false;
+            
+            stream.next_in = const_cast<Bytef *>(compressed.data());
+            stream.avail_in = uInt(compressed.size());
+            stream.next_out = outData.data();
+            stream.avail_out = uInt(outData.size());
+            
+            int status = inflate(&stream, Z_FINISH);
+            size_t produced = stream.total_out;
+            inflateEnd(&stream);
+            
+            return ((status == Z_STREAM_END || status == Z_BUF_ERROR) && produced == expectedLength);
+        }
+        
+        Surface *decodePNG(const uint8_t *bytes, size_t length)
+        {
+            if(!bytes || length < sizeof(kPNGSignature) || std::memcmp(bytes, kPNGSignature, sizeof(kPNGSignature)) != 0)
+                return nullptr;
+            
+            ImageHeader header = {};
+            bool hasHeader = false;
+            
+            ImagePalette palette = {};
+            for (size_t index = 0; index < 256; index++)
+                palette.entries[index][3] = 255;
+            
+            std::vector<uint8_t> compressed;
+            
+            const uint8_t *cursor = bytes + sizeof(kPNGSignature), *end = bytes + length;
+            while (size_t(end - cursor) >= 12) {
+                size_t chunkLength = ReadUInt32(cursor);
+                const uint8_t *type = cursor + 4;
+                const uint8_t *payload = cursor + 8;
+                if(chunkLength > size_t(end - payload) - 4)
+                    return nullptr;
+                
+                cursor = payload + chunkLength + 4;
+                
+                if(std::memcmp(type, "IHDR", 4) == 0) {
+                    if(chunkLength != 13)
+                        return nullptr;
+                    
+                    header.width = ReadUInt32(payload);
+                    header.height = ReadUInt32(payload + 4);
+                    header.bitDepth = payload[8];
+                    header.colorType = payload[9];
+                    header.interlaceMethod = payload[12];
+                    if(!header.isValid() || payload[10] != 0 || payload[11] != 0 || header.interlaceMethod > 1)
+                        return nullptr;
+                    
+                    hasHeader = true;
+                } else if(std::memcmp(type, "PLTE", 4) == 0) {
+                    for (size_t index = 0; index < std::min<size_t>(256, chunkLength / 3); index++)
+                        std::memcpy(palette.entries[index], payload + index * 3, 3);
+                } else if(std::memcmp(type, "tRNS", 4) == 0) {
+                    if(header.colorType == kColorTypePalette) {
+                        for (size_t index = 0; index < std::min<size_t>(256, chunkLength); index++)
+                            palette.entries[index][3] = payload[index];
+                    } else if(header.colorType == kColorTypeGray && chunkLength >= 2) {
+                        palette.hasTransparentColor = true;
+                        palette.transparentColor[0] = uint16_t((payload[0] << 8) | payload[1]);
+                    } else if(header.colorType == kColorTypeRGB && chunkLength >= 6) {
+                        palette.hasTransparentColor = true;
+                        for (size_t channel = 0; channel < 3; channel++)
+                            palette.transparentColor[channel] = uint16_t((payload[channel * 2] << 8) | payload[channel * 2 + 1]);
+                    }
+                } else if(std::memcmp(type, "IDAT", 4) == 0) {
+                    compressed.insert(compressed.end(), payload, payload + chunkLength);
+                } else if(std::memcmp(type, "IEND", 4) == 0) {
+                    break;
+                }
+            }
+            
+            if(!hasHeader || compressed.empty())
+                return nullptr;
+            
+            const size_t bitsPerPixel = header.channels() * header.bitDepth;
+            size_t expectedLength = 0;
+            if(header.interlaceMethod == 0) {
+                expectedLength = header.height * ((header.width * bitsPerPixel + 7) / 8 + 1);
+            } else {
+                for (const auto &pass : kAdam7Passes) {
+                    if(pass.x >= header.width || pass.y >= header.height)
+                        continue;
+                    
+                    size_t passWidth = (header.width - pass.x + pass.dx - 1) / pass.dx;
+                    size_t passHeight = (header.height - pass.y + pass.dy - 1) / pass.dy;
+                    expectedLength += passHeight * ((passWidth * bitsPerPixel + 7) / 8 + 1);
+                }
+            }
+            
+            std::vector<uint8_t> data;
+            if(!Inflate(compressed, data, expectedLength))
+                return nullptr;
+            
+            Surface *surface = new Surface(header.width, header.height);
+            const uint8_t *dataCursor = data.data(), *dataEnd = data.data() + data.size();
+            
+            bool succeeded = true;
+            if(header.interlaceMethod == 0) {
+                succeeded = DecodePass(header, palette, dataCursor, dataEnd, 0, 0, 1, 1, surface);
+            } else {
+                for (const auto &pass : kAdam7Passes) {
+                    if(!DecodePass(header, palette, dataCursor, dataEnd, pass.x, pass.y, pass.dx, pass.dy, surface)) {
+                        succeeded = false;
+                        break;
+                    }
+                }
+            }
+            
+            if(!succeeded) {
+                surface->release();
+                return nullptr;
+            }
+            
+            return surface;
+        }
+        
+        bool readPNGSize(const uint8_t *bytes, size_t length, size_t &outWidth, size_t &outHeight)
+        {
+            //The header chunk must immediately follow the signature.
+            const size_t headerEnd = sizeof(kPNGSignature) + 8 + 13;
+            if(!bytes || length < headerEnd || std::memcmp(bytes, kPNGSignature, sizeof(kPNGSignature)) != 0)
+                return false;
+            
+            const uint8_t *chunk = bytes + sizeof(kPNGSignature);
+            if(ReadUInt32(chunk) != 13 || std::memcmp(chunk + 4, "IHDR", 4) != 0)
+                return false;
+            
+            const uint8_t *payload = chunk + 8;
+            ImageHeader header = {};
+            header.width = ReadUInt32(payload);
+            header.height = ReadUInt32(payload + 4);
+            header.bitDepth = payload[8];
+            header.colorType = payload[9];
+            header.interlaceMethod = payload[12];
+            if(!header.isValid() || payload[10] != 0 || payload[11] != 0 || header.interlaceMethod > 1)
+                return false;
+            
+            outWidth = header.width;
+            outHeight = header.height;
+            return true;
+        }
+    }
+}
+
+#endif /* GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster */
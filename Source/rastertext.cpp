@@ -0,0 +1,831 @@
+//
+//  rastertext.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/6/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#if GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster
+
+#include "raster.h"
+#include <dirent.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace gfx {
+    namespace raster {
+    
+#pragma mark - Constants
+        
+        ///Returns the tag of a table from its four characters.
+        static constexpr uint32_t Tag(char a, char b, char c, char d)
+        {
+            return (uint32_t(uint8_t(a)) << 24) | (uint32_t(uint8_t(b)) << 16) | (uint32_t(uint8_t(c)) << 8) | uint32_t(uint8_t(d));
+        }
+        
+        ///The versions of fonts with TrueType outlines.
+        static const uint32_t kTrueTypeVersion = 0x00010000;
+        static const uint32_t kAppleTrueTypeVersion = Tag('t', 'r', 'u', 'e');
+        
+        ///The tag font collections begin with.
+        static const uint32_t kCollectionTag = Tag('t', 't', 'c', 'f');
+        
+        ///The flags of the points of a simple glyph.
+        enum PointFlag : uint8_t {
+            kPointFlagOnCurve = 0x01,
+            kPointFlagShortX = 0x02,
+            kPointFlagShortY = 0x04,
+            kPointFlagRepeat = 0x08,
+            kPointFlagSameOrPositiveX = 0x10,
+            kPointFlagSameOrPositiveY = 0x20,
+        };
+        
+        ///The flags of the components of a composite glyph.
+        enum ComponentFlag : uint16_t {
+            kComponentFlagArgumentsAreWords = 0x0001,
+            kComponentFlagArgumentsAreOffsets = 0x0002,
+            kComponentFlagHasScale = 0x0008,
+            kComponentFlagHasMoreComponents = 0x0020,
+            kComponentFlagHasXYScale = 0x0040,
+            kComponentFlagHasTwoByTwo = 0x0080,
+        };
+        
+        ///The deepest composite glyphs are followed.
+        static const int kMaximumComponentDepth = 8;
+        
+#pragma mark - Reading
+        
+        static inline uint16_t ReadUInt16(const uint8_t *bytes)
+        {
+            return uint16_t((bytes[0] << 8) | bytes[1]);
+        }
+        
+        static inline int16_t ReadInt16(const uint8_t *bytes)
+        {
+            return int16_t(ReadUInt16(bytes));
+        }
+        
+        static inline uint32_t ReadUInt32(const uint8_t *bytes)
+        {
+            return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]);
+        }
+        
+        ///Reads a signed 2.14 fixed point number.
+        static inline Float ReadF2Dot14(const uint8_t *bytes)
+        {
+            return Float(ReadInt16(bytes)) / 16384.0;
+        }
+        
+        ///The location of a table within a font file.
+        struct Table
+        {
+            size_t offset;
+            size_t length;
+        };
+        
+        ///Returns the offset of the table directory of the first font of a font file.
+        static size_t FontDirectoryOffset(const uint8_t *header, size_t length)
+        {
+            if(length >= 16 && ReadUInt32(header) == kCollectionTag)
+                return ReadUInt32(header + 12);
+            
+            return 0;
+        }
+        
+        ///Finds a table in the table directory of a font.
+        ///
+        /// \param  directory       The table directory.
+        /// \param  directoryLength The number of bytes available at `directory`.
+        /// \param  fileLength      The length of the font file, which tables must lie within.
+        /// \param  tag             The tag of the table to find.
+        /// \param  outTable        On return, contains the location of the table.
+        ///
+        /// \result true if the table was found; false otherwise.
+        ///
+        static bool FindTable(const uint8_t *directory, size_t directoryLength, size_t fileLength, uint32_t tag, Table &outTable)
+        {
+            if(directoryLength < 12)
+                return false;
+            
+            size_t numberOfTables = ReadUInt16(directory + 4);
+            if(12 + numberOfTables * 16 > directoryLength)
+                return false;
+            
+            for (size_t index = 0; index < numberOfTables; index++) {
+                const uint8_t *record = directory + 12 + index * 16;
+                if(ReadUInt32(record) != tag)
+                    continue;
+                
+                size_t offset = ReadUInt32(record + 8), length = ReadUInt32(record + 12);
+                if(offset > fileLength || length > fileLength - offset)
+                    return false;
+                
+                outTable = Table{ offset, length };
+                return true;
+            }
+            
+            return false;
+        }
+        
+        ///Appends a UTF-16 code unit sequence to a UTF-8 string.
+        static void AppendUTF16(std::string &string, const uint8_t *bytes, size_t length)
+        {
+            for (size_t offset = 0; offset + 1 < length; offset += 2) {
+                uint32_t character = ReadUInt16(bytes + offset);
+                if(character >= 0xD800 && character < 0xDC00 && offset + 3 < length) {
+                    uint32_t low = ReadUInt16(bytes + offset + 2);
+                    if(low >= 0xDC00 && low < 0xE000) {
+                        character = 0x10000 + ((character - 0xD800) << 10) + (low - 0xDC00);
+                        offset += 2;
+                    }
+                }
+                
+                if(character < 0x80) {
+                    string.push_back(char(character));
+                } else if(character < 0x800) {
+                    string.push_back(char(0xC0 | (character >> 6)));
+                    string.push_back(char(0x80 | (character & 0x3F)));
+                } else if(character < 0x10000) {
+                    string.push_back(char(0xE0 | (character >> 12)));
+                    string.push_back(char(0x80 | ((character >> 6) & 0x3F)));
+                    string.push_back(char(0x80 | (character & 0x3F)));
+                } else {
+                    string.push_back(char(0xF0 | (character >> 18)));
+                    string.push_back(char(0x80 | ((character >> 12) & 0x3F)));
+                    string.push_back(char(0x80 | ((character >> 6) & 0x3F)));
+                    string.push_back(char(0x80 | (character & 0x3F)));
+                }
+            }
+        }
+        
+        ///Reads the PostScript and full names of a font from its naming table.
+        ///
+        ///Windows names in US English are preferred, followed by any other Unicode
+        ///names, followed by Macintosh names, which are assumed to be ASCII.
+        static void ReadNames(const uint8_t *table, size_t length, std::string &outPostScriptName, std::string &outFullName)
+        {
+            if(length < 6)
+                return;
+            
+            size_t numberOfRecords = ReadUInt16(table + 2), storage = ReadUInt16(table + 4);
+            int postScriptNameScore = 0, fullNameScore = 0;
+            for (size_t index = 0; index < numberOfRecords && 6 + index * 12 + 12 <= length; index++) {
+                const uint8_t *record = table + 6 + index * 12;
+                uint16_t platform = ReadUInt16(record), language = ReadUInt16(record + 4), name = ReadUInt16(record + 6);
+                size_t stringLength = ReadUInt16(record + 8), stringOffset = storage + ReadUInt16(record + 10);
+                if((name != 4 && name != 6) || stringOffset + stringLength > length)
+                    continue;
+                
+                int score;
+                if(platform == 3)
+                    score = (language == 0x0409)? 3 : 2;
+                else if(platform == 0)
+                    score = 2;
+                else if(platform == 1)
+                    score = 1;
+                else
+                    continue;
+                
+                int &bestScore = (name == 6)? postScriptNameScore : fullNameScore;
+                std::string &string = (name == 6)? outPostScriptName : outFullName;
+                if(score <= bestScore)
+                    continue;
+                
+                bestScore = score;
+                string.clear();
+                if(platform == 1)
+                    string.assign((const char *)table + stringOffset, stringLength);
+                else
+                    AppendUTF16(string, table + stringOffset, stringLength);
+            }
+        }
+        
+#pragma mark - Outlines
+        
+        static inline Point Midpoint(Point a, Point b)
+        {
+            return Point{ (a.x + b.x) / 2.0, (a.y + b.y) / 2.0 };
+        }
+        
+        ///Adds a contour of TrueType points, in which two consecutive points that are
+        ///off the curve imply a point on the curve halfway between them.
+        static void AddContour(const Point *points, const uint8_t *flags, size_t count, const Transform2D &transform, Path &path)
+        {
+            if(count < 2)
+                return;
+            
+            //The contour starts at its first point on the curve, or halfway between
+            //its last and first points if every point is off the curve.
+            size_t firstOnCurve = 0;
+            while (firstOnCurve < count && !(flags[firstOnCurve] & kPointFlagOnCurve))
+                firstOnCurve++;
+            
+            Point start;
+            size_t first, end;
+            if(firstOnCurve < count) {
+                start = points[firstOnCurve];
+                first = firstOnCurve + 1;
+                end = firstOnCurve + count;
+            } else {
+                start = Midpoint(points[count - 1], points[0]);
+                first = 0;
+                end = count;
+            }
+            
+            path.moveTo(start, transform);
+            
+            bool hasControlPoint = false;
+            Point controlPoint;
+            for (size_t offset = first; offset < end; offset++) {
+                size_t index = offset % count;
+                const Point &point = points[index];
+                if(flags[index] & kPointFlagOnCurve) {
+                    if(hasControlPoint)
+                        path.quadTo(controlPoint, point, transform);
+                    else
+                        path.lineTo(point, transform);
+                    
+                    hasControlPoint = false;
+                } else {
+                    if(hasControlPoint)
+                        path.quadTo(controlPoint, Midpoint(controlPoint, point), transform);
+                    
+                    controlPoint = point;
+                    hasControlPoint = true;
+                }
+            }
+            
+            if(hasControlPoint)
+                path.quadTo(controlPoint, start, transform);
+            
+            path.close();
+        }
+        
+        ///Adds the contours of a simple glyph.
+        static void AddSimpleGlyphOutline(const uint8_t *outline, size_t length, size_t numberOfContours,
+                                          const Transform2D &transform, Path &path)
+        {
+            size_t cursor = 10;
+            if(numberOfContours == 0 || cursor + numberOfContours * 2 + 2 > length)
+                return;
+            
+            std::vector<size_t> endPoints(numberOfContours);
+            for (size_t &endPoint : endPoints) {
+                endPoint = ReadUInt16(outline + cursor);
+                cursor += 2;
+            }
+            
+            size_t instructionLength = ReadUInt16(outline + cursor);
+            cursor += 2 + instructionLength;
+            
+            size_t numberOfPoints = endPoints.back() + 1;
+            std::vector<uint8_t> flags(numberOfPoints);
+            for (size_t index = 0; index < numberOfPoints; ) {
+                if(cursor >= length)
+                    return;
+                
+                uint8_t flag = outline[cursor++];
+                size_t repeat = 1;
+                if(flag & kPointFlagRepeat) {
+                    if(cursor >= length)
+                        return;
+                    
+                    repeat += outline[cursor++];
+                }
+                
+                for (; repeat > 0 && index < numberOfPoints; repeat--)
+                    flags[index++] = flag;
+            }
+            
+            //Each coordinate is a delta from the coordinate of the previous point.
+            std::vector<Point> points(numberOfPoints);
+            auto readCoordinates = [&](uint8_t shortFlag, uint8_t sameOrPositiveFlag, Float Point::*coordinate) {
+                int value = 0;
+                for (size_t index = 0; index < numberOfPoints; index++) {
+                    uint8_t flag = flags[index];
+                    if(flag & shortFlag) {
+                        if(cursor >= length)
+                            return false;
+                        
+                        int delta = outline[cursor++];
+                        value += (flag & sameOrPositiveFlag)? delta : -delta;
+                    } else if(!(flag & sameOrPositiveFlag)) {
+                        if(cursor + 2 > length)
+                            return false;
+                        
+                        value += ReadInt16(outline + cursor);
+                        cursor += 2;
+                    }
+                    
+                    points[index].*coordinate = value;
+                }
+                
+                return true;
+            };
+            
+            if(!readCoordinates(kPointFlagShortX, kPointFlagSameOrPositiveX, &Point::x) ||
+               !readCoordinates(kPointFlagShortY, kPointFlagSameOrPositiveY, &Point::y))
+                return;
+            
+            size_t first = 0;
+            for (size_t endPoint : endPoints) {
+                if(endPoint < first || endPoint >= numberOfPoints)
+                    return;
+                
+                AddContour(points.data() + first, flags.data() + first, endPoint - first + 1, transform, path);
+                first = endPoint + 1;
+            }
+        }
+        
+#pragma mark - Typefaces
+        
+        Typeface::Typeface(std::vector<uint8_t> &&data) :
+            mData(std::move(data)),
+            mUniqueID(0),
+            mGlyphOffsets(0),
+            mGlyphs(0),
+            mHorizontalMetrics(0),
+            mCharacterMap(0),
+            mGlyphOffsetsLength(0),
+            mGlyphsLength(0),
+            mHorizontalMetricsLength(0),
+            mCharacterMapLength(0),
+            mHasLongGlyphOffsets(false),
+            mNumberOfGlyphs(0),
+            mNumberOfHorizontalMetrics(0),
+            mUnitsPerEm(0.0),
+            mAscender(0.0),
+            mDescender(0.0),
+            mLineGap(0.0),
+            mPostScriptName(),
+            mFullName()
+        {
+            static std::atomic<uint64_t> nextUniqueID(1);
+            mUniqueID = nextUniqueID++;
+        }
+        
+        std::shared_ptr<const Typeface> Typeface::withData(std::vector<uint8_t> data)
+        {
+            std::shared_ptr<Typeface> typeface(new Typeface(std::move(data)));
+            if(!typeface->load())
+                return nullptr;
+            
+            return typeface;
+        }
+        
+        bool Typeface::load()
+        {
+            const uint8_t *data = mData.data();
+            size_t length = mData.size();
+            
+            size_t directory = FontDirectoryOffset(data, length);
+            if(directory + 12 > length)
+                return false;
+            
+            uint32_t version = ReadUInt32(data + directory);
+            if(version != kTrueTypeVersion && version != kAppleTrueTypeVersion)
+                return false;
+            
+            Table header, horizontalHeader, maximumProfile, horizontalMetrics, characterMap, glyphOffsets, glyphs, names;
+            const uint8_t *tables = data + directory;
+            size_t tablesLength = length - directory;
+            if(!FindTable(tables, tablesLength, length, Tag('h', 'e', 'a', 'd'), header) || header.length < 54 ||
+               !FindTable(tables, tablesLength, length, Tag('h', 'h', 'e', 'a'), horizontalHeader) || horizontalHeader.length < 36 ||
+               !FindTable(tables, tablesLength, length, Tag('m', 'a', 'x', 'p'), maximumProfile) || maximumProfile.length < 6 ||
+               !FindTable(tables, tablesLength, length, Tag('h', 'm', 't', 'x'), horizontalMetrics) ||
+               !FindTable(tables, tablesLength, length, Tag('c', 'm', 'a', 'p'), characterMap) || characterMap.length < 4 ||
+               !FindTable(tables, tablesLength, length, Tag('l', 'o', 'c', 'a'), glyphOffsets) ||
+               !FindTable(tables, tablesLength, length, Tag('g', 'l', 'y', 'f'), glyphs))
+                return false;
+            
+            mUnitsPerEm = ReadUInt16(data + header.offset + 18);
+            mHasLongGlyphOffsets = (ReadInt16(data + header.offset + 50) != 0);
+            mAscender = ReadInt16(data + horizontalHeader.offset + 4);
+            mDescender = ReadInt16(data + horizontalHeader.offset + 6);
+            mLineGap = ReadInt16(data + horizontalHeader.offset + 8);
+            mNumberOfHorizontalMetrics = ReadUInt16(data + horizontalHeader.offset + 34);
+            mNumberOfGlyphs = ReadUInt16(data + maximumProfile.offset + 4);
+            if(mUnitsPerEm == 0.0 || mNumberOfHorizontalMetrics == 0 ||
+               horizontalMetrics.length < size_t(mNumberOfHorizontalMetrics) * 4 ||
+               glyphOffsets.length < (size_t(mNumberOfGlyphs) + 1) * (mHasLongGlyphOffsets? 4 : 2))
+                return false;
+            
+            mGlyphOffsets = glyphOffsets.offset;
+            mGlyphOffsetsLength = glyphOffsets.length;
+            mGlyphs = glyphs.offset;
+            mGlyphsLength = glyphs.length;
+            mHorizontalMetrics = horizontalMetrics.offset;
+            mHorizontalMetricsLength = horizontalMetrics.length;
+            
+            //Full Unicode maps are preferred over maps of the basic multilingual plane.
+            int bestScore = 0;
+            size_t characterMapEnd = characterMap.offset + characterMap.length;
+            size_t numberOfSubtables = ReadUInt16(data + characterMap.offset + 2);
+            for (size_t index = 0; index < numberOfSubtables; index++) {
+                size_t record = characterMap.offset + 4 + index * 8;
+                if(record + 8 > characterMapEnd)
+                    break;
+                
+                uint16_t platform = ReadUInt16(data + record), encoding = ReadUInt16(data + record + 2);
+                size_t subtable = characterMap.offset + ReadUInt32(data + record + 4);
+                if(subtable + 4 > characterMapEnd)
+                    continue;
+                
+                bool isUnicode = (platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10)));
+                uint16_t format = ReadUInt16(data + subtable);
+                int score = 0;
+                if(format == 12 && isUnicode)
+                    score = 3;
+                else if(format == 4 && isUnicode)
+                    score = 2;
+                else if(format == 4 && platform == 3)
+                    score = 1;
+                
+                if(score > bestScore) {
+                    bestScore = score;
+                    mCharacterMap = subtable;
+                    mCharacterMapLength = characterMapEnd - subtable;
+                }
+            }
+            
+            if(bestScore == 0)
+                return false;
+            
+            if(FindTable(tables, tablesLength, length, Tag('n', 'a', 'm', 'e'), names))
+                ReadNames(data + names.offset, names.length, mPostScriptName, mFullName);
+            
+            return true;
+        }
+        
+#pragma mark -
+        
+        uint16_t Typeface::glyphForCharacter(uint32_t character) const
+        {
+            const uint8_t *table = mData.data() + mCharacterMap;
+            size_t length = mCharacterMapLength;
+            
+            uint32_t glyph = 0;
+            uint16_t format = ReadUInt16(table);
+            if(format == 4) {
+                if(character > 0xFFFF || length < 14)
+                    return 0;
+                
+                size_t numberOfSegments = ReadUInt16(table + 6) / 2;
+                if(16 + numberOfSegments * 8 > length)
+                    return 0;
+                
+                const uint8_t *endCodes = table + 14;
+                const uint8_t *startCodes = endCodes + numberOfSegments * 2 + 2;
+                const uint8_t *deltas = startCodes + numberOfSegments * 2;
+                const uint8_t *rangeOffsets = deltas + numberOfSegments * 2;
+                
+                //Segments are ordered by their last character.
+                size_t low = 0, high = numberOfSegments;
+                while (low < high) {
+                    size_t middle = (low + high) / 2;
+                    if(ReadUInt16(endCodes + middle * 2) < character)
+                        low = middle + 1;
+                    else
+                        high = middle;
+                }
+                
+                if(low == numberOfSegments)
+                    return 0;
+                
+                uint32_t startCode = ReadUInt16(startCodes + low * 2);
+                if(character < startCode)
+                    return 0;
+                
+                uint16_t delta = ReadUInt16(deltas + low * 2), rangeOffset = ReadUInt16(rangeOffsets + low * 2);
+                if(rangeOffset == 0) {
+                    glyph = uint16_t(character + delta);
+                } else {
+                    size_t glyphOffset = size_t(rangeOffsets + low * 2 - table) + rangeOffset + (character - startCode) * 2;
+                    if(glyphOffset + 2 > length)
+                        return 0;
+                    
+                    glyph = ReadUInt16(table + glyphOffset);
+                    if(glyph != 0)
+                        glyph = uint16_t(glyph + delta);
+                }
+            } else if(format == 12) {
+                if(length < 16)
+                    return 0;
+                
+                size_t numberOfGroups = ReadUInt32(table + 12);
+                if(numberOfGroups > (length - 16) / 12)
+                    return 0;
+                
+                //Groups are ordered by their first character.
+                size_t low = 0, high = numberOfGroups;
+                while (low < high) {
+                    size_t middle = (low + high) / 2;
+                    if(ReadUInt32(table + 16 + middle * 12 + 4) < character)
+                        low = middle + 1;
+                    else
+                        high = middle;
+                }
+                
+                if(low == numberOfGroups)
+                    return 0;
+                
+                const uint8_t *group = table + 16 + low * 12;
+                uint32_t startCode = ReadUInt32(group);
+                if(character < startCode)
+                    return 0;
+                
+                glyph = ReadUInt32(group + 8) + (character - startCode);
+            }
+            
+            return (glyph < mNumberOfGlyphs)? uint16_t(glyph) : 0;
+        }
+        
+        Float Typeface::advance(uint16_t glyph) const
+        {
+            size_t index = std::min<size_t>(glyph, mNumberOfHorizontalMetrics - 1);
+            return ReadUInt16(mData.data() + mHorizontalMetrics + index * 4);
+        }
+        
+        void Typeface::addGlyphOutline(uint16_t glyph, const Transform2D &transform, Path &path) const
+        {
+            addGlyphOutline(glyph, transform, path, 0);
+        }
+        
+        void Typeface::addGlyphOutline(uint16_t glyph, const Transform2D &transform, Path &path, int depth) const
+        {
+            if(glyph >= mNumberOfGlyphs || depth > kMaximumComponentDepth)
+                return;
+            
+            const uint8_t *glyphOffsets = mData.data() + mGlyphOffsets;
+            size_t start, end;
+            if(mHasLongGlyphOffsets) {
+                start = ReadUInt32(glyphOffsets + glyph * 4);
+                end = ReadUInt32(glyphOffsets + glyph * 4 + 4);
+            } else {
+                start = size_t(ReadUInt16(glyphOffsets + glyph * 2)) * 2;
+                end = size_t(ReadUInt16(glyphOffsets + glyph * 2 + 2)) * 2;
+            }
+            
+            //Glyphs without outlines, such as spaces, have no data.
+            if(end <= start || end > mGlyphsLength || end - start < 10)
+                return;
+            
+            const uint8_t *outline = mData.data() + mGlyphs + start;
+            size_t length = end - start;
+            
+            int16_t numberOfContours = ReadInt16(outline);
+            if(numberOfContours >= 0) {
+                AddSimpleGlyphOutline(outline, length, size_t(numberOfContours), transform, path);
+                return;
+            }
+            
+            //Composite glyphs are made of other glyphs, each with its own transform.
+            size_t cursor = 10;
+            for (;;) {
+                if(cursor + 4 > length)
+                    return;
+                
+                uint16_t flags = ReadUInt16(outline + cursor), component = ReadUInt16(outline + cursor + 2);
+                cursor += 4;
+                
+                Float offsetX, offsetY;
+                if(flags & kComponentFlagArgumentsAreWords) {
+                    if(cursor + 4 > length)
+                        return;
+                    
+                    offsetX = ReadInt16(outline + cursor);
+                    offsetY = ReadInt16(outline + cursor + 2);
+                    cursor += 4;
+                } else {
+                    if(cursor + 2 > length)
+                        return;
+                    
+                    offsetX = int8_t(outline[cursor]);
+                    offsetY = int8_t(outline[cursor + 1]);
+                    cursor += 2;
+                }
+                
+                //Components positioned by matching points are placed at the origin.
+                if(!(flags & kComponentFlagArgumentsAreOffsets))
+                    offsetX = offsetY = 0.0;
+                
+                Float a = 1.0, b = 0.0, c = 0.0, d = 1.0;
+                if(flags & kComponentFlagHasScale) {
+                    if(cursor + 2 > length)
+                        return;
+                    
+                    a = d = ReadF2Dot14(outline + cursor);
+                    cursor += 2;
+                } else if(flags & kComponentFlagHasXYScale) {
+                    if(cursor + 4 > length)
+                        return;
+                    
+                    a = ReadF2Dot14(outline + cursor);
+                    d = ReadF2Dot14(outline + cursor + 2);
+                    cursor += 4;
+                } else if(flags & kComponentFlagHasTwoByTwo) {
+                    if(cursor + 8 > length)
+                        return;
+                    
+                    a = ReadF2Dot14(outline + cursor);
+                    b = ReadF2Dot14(outline + cursor + 2);
+                    c = ReadF2Dot14(outline + cursor + 4);
+                    d = ReadF2Dot14(outline + cursor + 6);
+                    cursor += 8;
+                }
+                
+                Transform2D componentTransform = Transform2D(NativeAffineTransform{ a, b, c, d, offsetX, offsetY });
+                addGlyphOutline(component, componentTransform.concat(transform), path, depth + 1);
+                
+                if(!(flags & kComponentFlagHasMoreComponents))
+                    return;
+            }
+        }
+        
+#pragma mark - Installed Typefaces
+        
+        ///Reads a range of bytes of a file.
+        static bool ReadRange(FILE *file, size_t offset, size_t length, std::vector<uint8_t> &outBytes)
+        {
+            outBytes.resize(length);
+            return (fseek(file, long(offset), SEEK_SET) == 0 &&
+                    fread(outBytes.data(), 1, length, file) == length);
+        }
+        
+        ///Returns the length of a file.
+        static size_t FileLength(FILE *file)
+        {
+            if(fseek(file, 0, SEEK_END) != 0)
+                return 0;
+            
+            long length = ftell(file);
+            return (length > 0)? size_t(length) : 0;
+        }
+        
+        ///The InstalledTypefaces class indexes the font files of the system
+        ///by the names of their typefaces, and loads them on demand.
+        class InstalledTypefaces
+        {
+            ///Guards the members of the index.
+            std::mutex mMutex;
+            
+            ///Whether or not the font directories have been searched.
+            bool mHasSearched;
+            
+            ///The paths of font files by the PostScript names, full names, and file names of their typefaces.
+            std::unordered_map<std::string, std::string> mPathsByName;
+            
+            ///The typefaces that have been loaded, by the paths of their font files.
+            std::unordered_map<std::string, std::shared_ptr<const Typeface>> mTypefacesByPath;
+            
+            ///Adds the names of the typeface of a font file to the index.
+            void addFile(const std::string &path)
+            {
+                FILE *file = fopen(path.c_str(), "rb");
+                if(!file)
+                    return;
+                
+                //Only the table directory and the naming table are read, rather than the whole file.
+                std::vector<uint8_t> header, tables, names;
+                size_t fileLength = FileLength(file);
+                if(ReadRange(file, 0, std::min<size_t>(16, fileLength), header)) {
+                    size_t directory = FontDirectoryOffset(header.data(), header.size());
+                    Table nameTable;
+                    if(directory + 12 <= fileLength && ReadRange(file, directory, 12, tables) &&
+                       ReadRange(file, directory, std::min<size_t>(12 + ReadUInt16(tables.data() + 4) * 16, fileLength - directory), tables) &&
+                       FindTable(tables.data(), tables.size(), fileLength, Tag('n', 'a', 'm', 'e'), nameTable) &&
+                       ReadRange(file, nameTable.offset, nameTable.length, names)) {
+                        std::string postScriptName, fullName;
+                        ReadNames(names.data(), names.size(), postScriptName, fullName);
+                        
+                        //Files found earlier take precedence over files with the same names.
+                        size_t nameStart = path.find_last_of('/') + 1, nameEnd = path.find_last_of('.');
+                        for (const std::string &name : { postScriptName, fullName, path.substr(nameStart, nameEnd - nameStart) }) {
+                            if(!name.empty())
+                                mPathsByName.emplace(name, path);
+                        }
+                    }
+                }
+                
+                fclose(file);
+            }
+            
+            ///Adds the font files of a directory and its subdirectories to the index.
+            void addDirectory(const std::string &path, int depth)
+            {
+                DIR *directory = opendir(path.c_str());
+                if(!directory)
+                    return;
+                
+                std::vector<std::pair<std::string, bool>> entries;
+                while (struct dirent *entry = readdir(directory)) {
+                    if(entry->d_name[0] != '.')
+                        entries.emplace_back(entry->d_name, (entry->d_type == DT_DIR));
+                }
+                closedir(directory);
+                
+                //Entries are visited in a stable order so that the same file wins every time.
+                std::sort(entries.begin(), entries.end());
+                for (const auto &entry : entries) {
+                    std::string entryPath = path + "/" + entry.first;
+                    if(entry.second) {
+                        if(depth < 4)
+                            addDirectory(entryPath, depth + 1);
+                        
+                        continue;
+                    }
+                    
+                    size_t extension = entry.first.find_last_of('.');
+                    if(extension == std::string::npos)
+                        continue;
+                    
+                    std::string suffix = entry.first.substr(extension);
+                    std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::tolower);
+                    if(suffix == ".ttf" || suffix == ".ttc")
+                        addFile(entryPath);
+                }
+            }
+        
+        public:
+            
+            InstalledTypefaces() :
+                mMutex(),
+                mHasSearched(false),
+                mPathsByName(),
+                mTypefacesByPath()
+            {
+            }
+            
+            ///Returns the shared index.
+            static InstalledTypefaces &shared()
+            {
+                static InstalledTypefaces *sharedTypefaces = new InstalledTypefaces();
+                return *sharedTypefaces;
+            }
+            
+            ///Returns the typeface with a given name or file path, loading it if needed.
+            std::shared_ptr<const Typeface> typefaceNamed(const std::string &name)
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                
+                std::string path = name;
+                if(name.find('/') == std::string::npos) {
+                    if(!mHasSearched) {
+                        std::vector<std::string> directories;
+                        if(const char *home = getenv("HOME")) {
+                            directories.push_back(std::string(home) + "/.fonts");
+                            directories.push_back(std::string(home) + "/.local/share/fonts");
+                            directories.push_back(std::string(home) + "/Library/Fonts");
+                        }
+                        
+                        directories.push_back("/usr/local/share/fonts");
+                        directories.push_back("/usr/share/fonts");
+                        directories.push_back("/Library/Fonts");
+                        directories.push_back("/System/Library/Fonts");
+                        
+                        for (const std::string &directory : directories)
+                            addDirectory(directory, 0);
+                        
+                        mHasSearched = true;
+                    }
+                    
+                    auto existingPath = mPathsByName.find(name);
+                    if(existingPath == mPathsByName.end())
+                        return nullptr;
+                    
+                    path = existingPath->second;
+                }
+                
+                auto existingTypeface = mTypefacesByPath.find(path);
+                if(existingTypeface != mTypefacesByPath.end())
+                    return existingTypeface->second;
+                
+                FILE *file = fopen(path.c_str(), "rb");
+                if(!file)
+                    return nullptr;
+                
+                std::vector<uint8_t> data;
+                bool wasRead = ReadRange(file, 0, FileLength(file), data);
+                fclose(file);
+                if(!wasRead)
+                    return nullptr;
+                
+                auto typeface = Typeface::withData(std::move(data));
+                if(typeface)
+                    mTypefacesByPath.emplace(path, typeface);
+                
+                return typeface;
+            }
+        };
+        
+        std::shared_ptr<const Typeface> Typeface::named(const std::string &name)
+        {
+            return InstalledTypefaces::shared().typefaceNamed(name);
+        }
+    }
+}
+
+#endif /* GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster */
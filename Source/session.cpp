@@ -92,8 +92,8 @@ namespace gfx {
     
     void Session::parseArguments()
     {
-        static const String *const FlagPrefix = str("-");
-        static const String *const ParameterPrefix = str("--");
+        static const String *const FlagPrefix = gfx_str("-");
+        static const String *const ParameterPrefix = gfx_str("--");
         
         AutoreleasePool pool;
         
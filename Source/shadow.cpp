@@ -71,12 +71,33 @@ namespace gfx {
     
     void Shadow::set()
     {
+        Scoped<Shadow> shadow = this;
+        Context::currentContext()->recordOperation([shadow](Context *context) {
+            shadow->set();
+        });
+
+        Context::currentContext()->mHasShadow = true;
+        
+#if GFX_Graphics_Use_Raster
+        Context::currentContext()->get()->setShadow(offset(), blurRadius(), *color()->get());
+#else
         CGContextSetShadowWithColor(Context::currentContext()->get(), offset(), blurRadius(), color()->get());
+#endif /* GFX_Graphics_Use_Raster */
     }
     
     void Shadow::unset()
     {
+        Context::currentContext()->recordOperation([](Context *context) {
+            Shadow::unset();
+        });
+
+        Context::currentContext()->mHasShadow = false;
+        
+#if GFX_Graphics_Use_Raster
+        Context::currentContext()->get()->clearShadow();
+#else
         CGContextSetShadowWithColor(Context::currentContext()->get(), CGSizeZero, 0.0, NULL);
+#endif /* GFX_Graphics_Use_Raster */
     }
     
 #pragma mark - Functions
@@ -113,9 +134,9 @@ namespace gfx {
     {
         gfx_assert_param(frame);
         
-        frame->createFunctionBinding(str("shadow"), &shadow_make);
+        frame->createFunctionBinding(gfx_str("shadow"), &shadow_make);
         
-        frame->createFunctionBinding(str("shadow/set"), &shadow_set);
-        frame->createFunctionBinding(str("shadow/unset"), &shadow_unset);
+        frame->createFunctionBinding(gfx_str("shadow/set"), &shadow_set);
+        frame->createFunctionBinding(gfx_str("shadow/unset"), &shadow_unset);
     }
 }
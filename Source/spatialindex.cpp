@@ -0,0 +1,392 @@
+//
+//  spatialindex.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/10/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#if GFX_Include_GraphicsStack
+
+#include "spatialindex.h"
+#include "path.h"
+#include "context.h"
+#include "str.h"
+#include "array.h"
+#include "number.h"
+
+#include "stackframe.h"
+#include "graphics.h"
+#include "interpreter.h"
+#include <algorithm>
+#include <limits>
+
+namespace gfx {
+
+#pragma mark - Geometry
+    
+    ///Returns whether or not two rectangles overlap. Touching edges count as overlapping,
+    ///so that paths with no width or height, such as straight lines, may still be found.
+    static bool RectsOverlap(const Rect &a, const Rect &b)
+    {
+        return (a.getMinX() <= b.getMaxX() && b.getMinX() <= a.getMaxX() &&
+                a.getMinY() <= b.getMaxY() && b.getMinY() <= a.getMaxY());
+    }
+    
+    ///Returns the square of the distance from a point to the nearest point within a rectangle.
+    static Float DistanceSquaredToRect(const Rect &rect, Point point)
+    {
+        Float dx = std::max(std::max(rect.getMinX() - point.x, point.x - rect.getMaxX()), 0.0);
+        Float dy = std::max(std::max(rect.getMinY() - point.y, point.y - rect.getMaxY()), 0.0);
+        return dx * dx + dy * dy;
+    }
+    
+    ///Returns the smallest rectangle containing two rectangles.
+    static Rect UnionOfRects(const Rect &a, const Rect &b)
+    {
+        Float minX = std::min(a.getMinX(), b.getMinX()), minY = std::min(a.getMinY(), b.getMinY());
+        Float maxX = std::max(a.getMaxX(), b.getMaxX()), maxY = std::max(a.getMaxY(), b.getMaxY());
+        return Rect{Point{minX, minY}, Size{maxX - minX, maxY - minY}};
+    }
+    
+#pragma mark - Lifecycle
+    
+    SpatialIndex::SpatialIndex() :
+        Base(),
+        mEntries(),
+        mOrder(),
+        mNodes(),
+        mNeedsRebuild(false),
+        mRebuildMutex()
+    {
+    }
+    
+    SpatialIndex::~SpatialIndex()
+    {
+        removeAll();
+    }
+    
+#pragma mark - Identity
+    
+    const String *SpatialIndex::description() const
+    {
+        String::Builder description;
+        description << "<" << this->className() << ":" << (void *)this << " " << count() << " paths>";
+        return description;
+    }
+    
+#pragma mark - Populating
+    
+    void SpatialIndex::add(Path *path)
+    {
+        gfx_assert_param(path);
+        
+        if(path->isEmpty())
+            return;
+        
+        mEntries.push_back(Entry{path->boundingBox(), retained(path)});
+        mNeedsRebuild = true;
+    }
+    
+    void SpatialIndex::remove(const Path *path)
+    {
+        gfx_assert_param(path);
+        
+        auto removed = std::remove_if(mEntries.begin(), mEntries.end(), [path](const Entry &entry) {
+            if(entry.path != path)
+                return false;
+            
+            released(entry.path);
+            return true;
+        });
+        if(removed == mEntries.end())
+            return;
+        
+        mEntries.erase(removed, mEntries.end());
+        mNeedsRebuild = true;
+    }
+    
+    void SpatialIndex::removeAll()
+    {
+        for (const Entry &entry : mEntries)
+            released(entry.path);
+        
+        mEntries.clear();
+        mOrder.clear();
+        mNodes.clear();
+        mNeedsRebuild = false;
+    }
+    
+    Index SpatialIndex::count() const
+    {
+        return Index(mEntries.size());
+    }
+    
+#pragma mark - Building
+    
+    void SpatialIndex::rebuildIfNeeded() const
+    {
+        std::lock_guard<std::mutex> lock(mRebuildMutex);
+        if(!mNeedsRebuild)
+            return;
+        
+        mOrder.resize(mEntries.size());
+        for (uint32_t offset = 0; offset < mOrder.size(); offset++)
+            mOrder[offset] = offset;
+        
+        mNodes.clear();
+        mNodes.reserve(mEntries.size() * 2 / kMaximumLeafCount + 1);
+        if(!mOrder.empty())
+            buildNode(0, uint32_t(mOrder.size()));
+        
+        mNeedsRebuild = false;
+    }
+    
+    uint32_t SpatialIndex::buildNode(uint32_t first, uint32_t end) const
+    {
+        Rect bounds = mEntries[mOrder[first]].bounds;
+        Float minCenterX = bounds.getMidX(), maxCenterX = minCenterX;
+        Float minCenterY = bounds.getMidY(), maxCenterY = minCenterY;
+        for (uint32_t offset = first + 1; offset < end; offset++) {
+            const Rect &entryBounds = mEntries[mOrder[offset]].bounds;
+            bounds = UnionOfRects(bounds, entryBounds);
+            
+            minCenterX = std::min(minCenterX, entryBounds.getMidX());
+            maxCenterX = std::max(maxCenterX, entryBounds.getMidX());
+            minCenterY = std::min(minCenterY, entryBounds.getMidY());
+            maxCenterY = std::max(maxCenterY, entryBounds.getMidY());
+        }
+        
+        uint32_t nodeOffset = uint32_t(mNodes.size());
+        mNodes.push_back(Node{bounds, first, end - first, 0});
+        if(end - first <= kMaximumLeafCount)
+            return nodeOffset;
+        
+        //Interior nodes split their entries in half along the axis their centers are most spread out on.
+        bool splitAlongX = (maxCenterX - minCenterX >= maxCenterY - minCenterY);
+        uint32_t middle = first + (end - first) / 2;
+        std::nth_element(mOrder.begin() + first, mOrder.begin() + middle, mOrder.begin() + end, [this, splitAlongX](uint32_t a, uint32_t b) {
+            const Rect &aBounds = mEntries[a].bounds, &bBounds = mEntries[b].bounds;
+            if(splitAlongX)
+                return aBounds.getMidX() < bBounds.getMidX();
+            else
+                return aBounds.getMidY() < bBounds.getMidY();
+        });
+        
+        mNodes[nodeOffset].count = 0;
+        buildNode(first, middle);
+        uint32_t right = buildNode(middle, end);
+        mNodes[nodeOffset].right = right;
+        
+        return nodeOffset;
+    }
+    
+#pragma mark - Querying
+    
+    void SpatialIndex::queryPoint(Point point, const QueryFunctor &function) const
+    {
+        rebuildIfNeeded();
+        if(mNodes.empty())
+            return;
+        
+        Rect pointRect{point, Size{0.0, 0.0}};
+        std::vector<uint32_t> matches;
+        std::vector<uint32_t> pendingNodes{0};
+        while (!pendingNodes.empty()) {
+            uint32_t nodeOffset = pendingNodes.back();
+            pendingNodes.pop_back();
+            
+            const Node &node = mNodes[nodeOffset];
+            if(!RectsOverlap(node.bounds, pointRect))
+                continue;
+            
+            if(node.count == 0) {
+                pendingNodes.push_back(node.right);
+                pendingNodes.push_back(nodeOffset + 1);
+                continue;
+            }
+            
+            for (uint32_t offset = node.first; offset < node.first + node.count; offset++) {
+                const Entry &entry = mEntries[mOrder[offset]];
+                if(RectsOverlap(entry.bounds, pointRect) && entry.path->containsPoint(point))
+                    matches.push_back(mOrder[offset]);
+            }
+        }
+        
+        std::sort(matches.begin(), matches.end());
+        for (uint32_t match : matches)
+            function(mEntries[match].path);
+    }
+    
+    void SpatialIndex::queryRect(Rect rect, const QueryFunctor &function) const
+    {
+        rebuildIfNeeded();
+        if(mNodes.empty())
+            return;
+        
+        std::vector<uint32_t> matches;
+        std::vector<uint32_t> pendingNodes{0};
+        while (!pendingNodes.empty()) {
+            uint32_t nodeOffset = pendingNodes.back();
+            pendingNodes.pop_back();
+            
+            const Node &node = mNodes[nodeOffset];
+            if(!RectsOverlap(node.bounds, rect))
+                continue;
+            
+            if(node.count == 0) {
+                pendingNodes.push_back(node.right);
+                pendingNodes.push_back(nodeOffset + 1);
+                continue;
+            }
+            
+            for (uint32_t offset = node.first; offset < node.first + node.count; offset++) {
+                if(RectsOverlap(mEntries[mOrder[offset]].bounds, rect))
+                    matches.push_back(mOrder[offset]);
+            }
+        }
+        
+        std::sort(matches.begin(), matches.end());
+        for (uint32_t match : matches)
+            function(mEntries[match].path);
+    }
+    
+    Path *SpatialIndex::nearest(Point point) const
+    {
+        rebuildIfNeeded();
+        if(mNodes.empty())
+            return nullptr;
+        
+        Float bestDistance = std::numeric_limits<Float>::infinity();
+        uint32_t bestEntry = 0;
+        
+        std::function<void(uint32_t nodeOffset)> visit = [&](uint32_t nodeOffset) {
+            const Node &node = mNodes[nodeOffset];
+            if(DistanceSquaredToRect(node.bounds, point) > bestDistance)
+                return;
+            
+            if(node.count == 0) {
+                //Visiting the nearer child first lets the farther one be pruned more often.
+                uint32_t left = nodeOffset + 1, right = node.right;
+                if(DistanceSquaredToRect(mNodes[right].bounds, point) < DistanceSquaredToRect(mNodes[left].bounds, point))
+                    std::swap(left, right);
+                
+                visit(left);
+                visit(right);
+                return;
+            }
+            
+            for (uint32_t offset = node.first; offset < node.first + node.count; offset++) {
+                uint32_t entry = mOrder[offset];
+                Float distance = DistanceSquaredToRect(mEntries[entry].bounds, point);
+                if(distance < bestDistance || (distance == bestDistance && entry < bestEntry)) {
+                    bestDistance = distance;
+                    bestEntry = entry;
+                }
+            }
+        };
+        visit(0);
+        
+        return mEntries[bestEntry].path;
+    }
+    
+#pragma mark - Index Functions
+    
+    static void index_make(StackFrame *stack)
+    {
+        /* -- index */
+        stack->push(make<SpatialIndex>());
+    }
+    
+    static void index_add(StackFrame *stack)
+    {
+        /* index path|vec -- */
+        auto value = stack->pop();
+        auto index = stack->popType<SpatialIndex>();
+        if(auto paths = dynamic_cast<Array<Base> *>(value)) {
+            paths->iterate(paths->all(), [index](Base *path, Index offset, bool *stop) {
+                index->add(dynamic_cast_or_throw<Path *>(path));
+            });
+        } else {
+            index->add(dynamic_cast_or_throw<Path *>(value));
+        }
+    }
+    
+    static void index_remove(StackFrame *stack)
+    {
+        /* index path -- */
+        auto path = stack->popType<Path>();
+        auto index = stack->popType<SpatialIndex>();
+        index->remove(path);
+    }
+    
+    static void index_count(StackFrame *stack)
+    {
+        /* index -- num */
+        auto index = stack->popType<SpatialIndex>();
+        stack->push(make<Number>(index->count()));
+    }
+    
+    static void index_queryPoint(StackFrame *stack)
+    {
+        /* index vec -- vec */
+        auto point = VectorToPoint(stack->popType<Array<Base>>());
+        auto index = stack->popType<SpatialIndex>();
+        
+        Array<Base> *paths = make<Array<Base>>();
+        index->queryPoint(point, [paths](Path *path) {
+            paths->append(path);
+        });
+        stack->push(paths);
+    }
+    
+    static void index_queryRect(StackFrame *stack)
+    {
+        /* index vec -- vec */
+        auto rect = VectorToRect(stack->popType<Array<Base>>());
+        auto index = stack->popType<SpatialIndex>();
+        
+        Array<Base> *paths = make<Array<Base>>();
+        index->queryRect(rect, [paths](Path *path) {
+            paths->append(path);
+        });
+        stack->push(paths);
+    }
+    
+    static void index_nearest(StackFrame *stack)
+    {
+        /* index vec -- path */
+        auto point = VectorToPoint(stack->popType<Array<Base>>());
+        auto index = stack->popType<SpatialIndex>();
+        stack->push(index->nearest(point));
+    }
+    
+    static void index_visible(StackFrame *stack)
+    {
+        /* index -- vec */
+        auto index = stack->popType<SpatialIndex>();
+        
+        Array<Base> *paths = make<Array<Base>>();
+        index->queryRect(Context::currentContext()->boundingRect(), [paths](Path *path) {
+            paths->append(path);
+        });
+        stack->push(paths);
+    }
+    
+#pragma mark -
+    
+    void SpatialIndex::addTo(StackFrame *frame)
+    {
+        frame->createFunctionBinding(gfx_str("index/make"), &index_make);
+        frame->createFunctionBinding(gfx_str("index/add"), &index_add);
+        frame->createFunctionBinding(gfx_str("index/remove"), &index_remove);
+        frame->createFunctionBinding(gfx_str("index/count"), &index_count);
+        
+        frame->createFunctionBinding(gfx_str("index/query-point"), &index_queryPoint);
+        frame->createFunctionBinding(gfx_str("index/query-rect"), &index_queryRect);
+        frame->createFunctionBinding(gfx_str("index/nearest"), &index_nearest);
+        frame->createFunctionBinding(gfx_str("index/visible"), &index_visible);
+    }
+}
+
+#endif /* GFX_Include_GraphicsStack */
@@ -0,0 +1,167 @@
+//
+//  spatialindex.h
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/10/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef __gfx__spatialindex__
+#define __gfx__spatialindex__
+
+#if GFX_Include_GraphicsStack
+
+#include "base.h"
+#include "types.h"
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace gfx {
+    class Path;
+    class StackFrame;
+    
+    ///The SpatialIndex class organizes paths by their bounding boxes so that the paths
+    ///under a point, or within a rectangle, may be found without testing every path.
+    ///
+    ///The index is a bounding volume hierarchy. Paths may be added one at a time or
+    ///in bulk, and the hierarchy is rebuilt lazily by the first query after the index
+    ///changes, so adding many paths before querying only builds the hierarchy once.
+    ///
+    ///The bounding box of a path is captured when it is added to the index. Paths
+    ///mutated after being added should be removed and added again. Queries may be
+    ///made from multiple threads at once, but not while the index is being changed.
+    class SpatialIndex : public Base
+    {
+    public:
+        
+        ///A function invoked with each path found by a query.
+        typedef std::function<void(Path *path)> QueryFunctor;
+        
+    protected:
+        
+        ///A path and the bounding box it had when it was added to the index.
+        struct Entry
+        {
+            ///The bounding box of the path.
+            Rect bounds;
+            
+            ///The path. Retained by the index.
+            Path *path;
+        };
+        
+        ///A node of the bounding volume hierarchy.
+        ///
+        ///Leaf nodes refer to a run of `mOrder`. The left child of an
+        ///interior node immediately follows it in `mNodes`.
+        struct Node
+        {
+            ///The bounds of every entry beneath the node.
+            Rect bounds;
+            
+            ///The offset of the first entry of a leaf node within `mOrder`.
+            uint32_t first;
+            
+            ///The number of entries of a leaf node, or 0 for interior nodes.
+            uint32_t count;
+            
+            ///The offset of the right child of an interior node within `mNodes`.
+            uint32_t right;
+        };
+        
+        ///The entries of the index, in the order they were added.
+        std::vector<Entry> mEntries;
+        
+        ///The offsets of the entries of the index, ordered by the hierarchy.
+        mutable std::vector<uint32_t> mOrder;
+        
+        ///The nodes of the hierarchy. The first node is the root.
+        mutable std::vector<Node> mNodes;
+        
+        ///Whether or not the hierarchy must be rebuilt before the next query.
+        mutable bool mNeedsRebuild;
+        
+        ///Serializes lazy rebuilds of the hierarchy between querying threads.
+        mutable std::mutex mRebuildMutex;
+        
+        ///Rebuilds the hierarchy if the index has changed since it was last built.
+        void rebuildIfNeeded() const;
+        
+        ///Builds the node for a range of `mOrder`, returning its offset within `mNodes`.
+        uint32_t buildNode(uint32_t first, uint32_t end) const;
+        
+    public:
+        
+        ///The largest number of entries kept in a leaf node of the hierarchy.
+        static const uint32_t kMaximumLeafCount = 4;
+        
+#pragma mark - Lifecycle
+        
+        ///Constructs an empty index.
+        SpatialIndex();
+        
+        ///The destructor.
+        ~SpatialIndex();
+        
+#pragma mark - Identity
+        
+        virtual const String *description() const override;
+        
+#pragma mark - Populating
+        
+        ///Adds a path to the receiver.
+        ///
+        /// \param  path    The path to add. Required. Empty paths are ignored.
+        ///
+        void add(Path *path);
+        
+        ///Removes a path from the receiver.
+        ///
+        /// \param  path    The path to remove. Required. Paths not in the receiver are ignored.
+        ///
+        ///The path is found by identity, so paths mutated since being added may still be removed.
+        void remove(const Path *path);
+        
+        ///Removes every path from the receiver.
+        void removeAll();
+        
+        ///Returns the number of paths in the receiver.
+        Index count() const;
+        
+#pragma mark - Querying
+        
+        ///Finds every path of the receiver that contains a given point.
+        ///
+        /// \param  point       The point to test.
+        /// \param  function    Invoked with each path containing the point, in the order the paths were added.
+        ///
+        ///Paths whose bounding boxes contain the point are tested with `gfx::Path::containsPoint`.
+        void queryPoint(Point point, const QueryFunctor &function) const;
+        
+        ///Finds every path of the receiver whose bounding box intersects a given rectangle.
+        ///
+        /// \param  rect        The rectangle to test.
+        /// \param  function    Invoked with each path found, in the order the paths were added.
+        ///
+        ///This is suitable for culling paths that fall outside of a visible area, such as
+        ///the bounding box of the clip of the current `gfx::Context`.
+        void queryRect(Rect rect, const QueryFunctor &function) const;
+        
+        ///Returns the path of the receiver whose bounding box is nearest a given point.
+        ///
+        ///Paths whose bounding boxes contain the point have a distance of 0. Paths at
+        ///equal distances are resolved in favor of the path that was added first.
+        ///
+        /// \result The nearest path, or null if the receiver is empty.
+        Path *nearest(Point point) const;
+        
+#pragma mark - Functions
+        
+        ///Adds the spatial index function suite to a given stack frame.
+        static void addTo(StackFrame *frame);
+    };
+}
+
+#endif /* GFX_Include_GraphicsStack */
+
+#endif /* defined(__gfx__spatialindex__) */
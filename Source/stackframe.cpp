@@ -35,7 +35,7 @@ namespace gfx {
         mInterpreter(interpreter),
         mIsFrozen(false),
         mDestroySignalReference(),
-        DestroySignal(str("gfx::StackFrame::DestroySignal"))
+        DestroySignal(gfx_str("gfx::StackFrame::DestroySignal"))
     {
         if(mParent)
             mDestroySignalReference = mParent->DestroySignal.add([this](Nothing) {
@@ -188,26 +188,30 @@ namespace gfx {
         
         assertMutationPossible(String::Builder() << "Cannot change value of binding '" << key << "'.");
         
-        auto bindings = mBindings;
+        StackFrame *owner = this;
         if(searchParentScopes && parent()) {
             auto parentScope = parent();
             
+            //Frames beneath a frozen frame may be used from several threads at once,
+            //so bindings at or above the first frozen frame may not be changed.
+            const StackFrame *frozenScope = nullptr;
             do {
                 if(parentScope->bindingValue(key, false)) {
-                    parentScope->assertMutationPossible(String::Builder() << "Cannot change value of binding '" << key << "'.");
+                    (frozenScope ?: parentScope)->assertMutationPossible(String::Builder() << "Cannot change value of binding '" << key << "'.", key);
                     
-                    bindings = parentScope->mBindings;
+                    owner = parentScope;
                     break;
                 }
                 
+                if(!frozenScope && parentScope->isFrozen())
+                    frozenScope = parentScope;
+                
                 parentScope = parentScope->parent();
             } while (parentScope != nullptr);
-            
-            if(!bindings)
-                bindings = mBindings;
         }
         
-        bindings->set(key, value);
+        std::lock_guard<std::recursive_mutex> ownerLock(owner->mReadWriteMutex);
+        owner->mBindings->set(key, value);
     }
     
     Base *StackFrame::bindingValue(const String *key, bool searchParentScopes) const
@@ -245,7 +249,7 @@ namespace gfx {
             Dictionary<const String, Base> *userInfo = nullptr;
             if(affectedBindingKey) {
                 userInfo = autoreleased(new Dictionary<const String, Base>{
-                    {str("AffectedBindingKey"), (Base *)affectedBindingKey},
+                    {gfx_str("AffectedBindingKey"), (Base *)affectedBindingKey},
                 });
             }
             throw StackFrame::AccessViolationException(message, userInfo);
@@ -213,6 +213,10 @@ namespace gfx {
         ///                             to find any existing binding with the name `key`, and
         ///                             to replace the binding's value if found. Default is `true`.
         ///
+        ///Bindings found in or above a frozen parent scope cannot be changed, and
+        ///raise `gfx::StackFrame::AccessViolationException`. This keeps frames that
+        ///share a frozen parent, such as those of parallel applications, from
+        ///changing the same bindings concurrently.
         void setBindingToValue(const String *key, Base *value, bool searchParentScopes = true);
         
         ///Returns the value, if any, for for the binding by the name `key`.
@@ -263,7 +267,7 @@ namespace gfx {
         ///
         /// \param  message The message to associate with the exception. Required.
         ///
-        void assertMutationPossible(const String *message = str("Attempting to mutate a frame that has been frozen."), const String *affectedBindingKey = nullptr) const;
+        void assertMutationPossible(const String *message = gfx_str("Attempting to mutate a frame that has been frozen."), const String *affectedBindingKey = nullptr) const;
     };
 }
 
@@ -8,47 +8,186 @@
 
 #include "str.h"
 #include "exception.h"
+#include <mutex>
 
 namespace gfx {
     const String *const String::Empty = new String();
     
     String::String() :
-        mStorage(CFStringCreateMutable(kCFAllocatorDefault, 0))
+        mStorage(CFStringCreateMutable(kCFAllocatorDefault, 0)),
+        mHash(0),
+        mLength(0),
+        mFlags(kFlagASCII),
+        mInlineCString(),
+        mCStringBuffer(nullptr)
     {
+        this->cacheASCII("", 0);
     }
     
     String::String(const char *string, CFStringEncoding encoding) :
-        mStorage(CFStringCreateMutable(kCFAllocatorDefault, strlen(string)))
-    {
+        mStorage(nullptr),
+        mHash(0),
+        mLength(-1),
+        mFlags(0),
+        mInlineCString(),
+        mCStringBuffer(nullptr)
+    {
+        size_t byteLength = strlen(string);
+        mStorage = CFStringCreateMutable(kCFAllocatorDefault, byteLength);
         CFStringAppendCString(mStorage, string, encoding);
+        
+        bool isASCII = true;
+        for (size_t index = 0; index < byteLength; index++) {
+            if((unsigned char)string[index] >= 0x80) {
+                isASCII = false;
+                break;
+            }
+        }
+        
+        if(isASCII)
+            this->cacheASCII(string, byteLength);
     }
     
     String::String(const UniChar *buffer, Index length, CFStringEncoding encoding) :
-        mStorage(CFStringCreateMutable(kCFAllocatorDefault, length))
+        mStorage(CFStringCreateMutable(kCFAllocatorDefault, length)),
+        mHash(0),
+        mLength(length),
+        mFlags(0),
+        mInlineCString(),
+        mCStringBuffer(nullptr)
     {
         CFStringAppendCharacters(mStorage, buffer, length);
     }
     
     String::String(CFStringRef string) :
-        mStorage(CFStringCreateMutableCopy(kCFAllocatorDefault, 0, string))
+        mStorage(CFStringCreateMutableCopy(kCFAllocatorDefault, 0, string)),
+        mHash(0),
+        mLength(-1),
+        mFlags(0),
+        mInlineCString(),
+        mCStringBuffer(nullptr)
     {
     }
     
     String::String(const String *string) :
-        mStorage(CFStringCreateMutableCopy(kCFAllocatorDefault, 0, string->mStorage))
+        mStorage(CFStringCreateMutableCopy(kCFAllocatorDefault, 0, string->mStorage)),
+        mHash(string->mHash.load()),
+        mLength(string->mLength.load()),
+        mFlags(string->mFlags & ~kFlagCStringValid),
+        mInlineCString(),
+        mCStringBuffer(nullptr)
     {
+        if((string->mFlags & kFlagASCII) && (string->mFlags & kFlagCStringValid))
+            this->cacheASCII(string->cachedCString(), string->mLength);
     }
     
     String::~String()
     {
+        if(mCStringBuffer)
+            free(mCStringBuffer);
+        
         CFRelease(mStorage);
     }
     
+    const String *String::Literal(const char *literal, HashCode asciiHash)
+    {
+        String *string = new String(literal);
+        if(string->mFlags & kFlagASCII) {
+            string->mHash = asciiHash;
+            string->mFlags |= kFlagHashValid;
+        }
+        
+        return string;
+    }
+    
+#pragma mark - Caches
+    
+    void String::cacheASCII(const char *string, Index length) const
+    {
+        mLength = length;
+        mFlags |= kFlagASCII;
+        
+        if(mCStringBuffer) {
+            free(mCStringBuffer);
+            mCStringBuffer = nullptr;
+        }
+        
+        if(length < kInlineCStringCapacity) {
+            memcpy(mInlineCString, string, length + 1);
+        } else {
+            mCStringBuffer = (char *)malloc(length + 1);
+            memcpy(mCStringBuffer, string, length + 1);
+        }
+        
+        mFlags |= kFlagCStringValid;
+    }
+    
+    ///Returns the lock that serializes filling the utf8 cache of a given string.
+    ///
+    ///Locks are striped by address so that strings do not need to carry
+    ///a mutex of their own; the lock is only taken on a cache miss.
+    static std::mutex &CStringCacheLock(const String *string)
+    {
+        static std::mutex locks[16];
+        return locks[(reinterpret_cast<uintptr_t>(string) >> 4) % 16];
+    }
+    
+    const char *String::cachedCString() const
+    {
+        if(!(mFlags & kFlagCStringValid)) {
+            std::lock_guard<std::mutex> guard(CStringCacheLock(this));
+            if(mFlags & kFlagCStringValid)
+                return mCStringBuffer? mCStringBuffer : mInlineCString;
+            
+            if(mCStringBuffer) {
+                free(mCStringBuffer);
+                mCStringBuffer = nullptr;
+            }
+            
+            Index length = this->length();
+            Index bufferSize = CFStringGetMaximumSizeForEncoding(length, kCFStringEncodingUTF8) + 1;
+            if(bufferSize <= kInlineCStringCapacity) {
+                CFStringGetCString(mStorage, mInlineCString, kInlineCStringCapacity, kCFStringEncodingUTF8);
+            } else {
+                mCStringBuffer = (char *)malloc(bufferSize);
+                CFStringGetCString(mStorage, mCStringBuffer, bufferSize, kCFStringEncodingUTF8);
+            }
+            
+            mFlags |= kFlagCStringValid;
+        }
+        
+        return mCStringBuffer? mCStringBuffer : mInlineCString;
+    }
+    
+    void String::invalidateCaches()
+    {
+        mFlags = 0;
+        mLength = -1;
+    }
+    
 #pragma mark - Identity
     
     HashCode String::hash() const
     {
-        return CFHash(mStorage);
+        if(!(mFlags & kFlagHashValid)) {
+            HashCode hash = StringHashASCII("");
+            if(mFlags & kFlagASCII) {
+                const char *characters = this->cachedCString();
+                for (Index index = 0, length = this->length(); index < length; index++)
+                    hash = StringHashStep(hash, UniChar(characters[index]));
+            } else {
+                CFStringInlineBuffer buffer;
+                Index length = this->length();
+                CFStringInitInlineBuffer(mStorage, &buffer, CFRangeMake(0, length));
+                for (Index index = 0; index < length; index++)
+                    hash = StringHashStep(hash, CFStringGetCharacterFromInlineBuffer(&buffer, index));
+            }
+            
+            mHash = hash;
+            mFlags |= kFlagHashValid;
+        }
+        
+        return mHash;
     }
     
     bool String::isEqual(const String *other) const
@@ -56,6 +195,15 @@ namespace gfx {
         if(!other)
             return false;
         
+        if(other == this)
+            return true;
+        
+        if((mFlags & kFlagHashValid) && (other->mFlags & kFlagHashValid) && (mHash != other->mHash))
+            return false;
+        
+        if(mLength != -1 && other->mLength != -1 && mLength != other->mLength)
+            return false;
+        
         return CFEqual(this->getStorage(), other->getStorage());
     }
     
@@ -64,7 +212,7 @@ namespace gfx {
         if(!other)
             return false;
         
-        if(this->isKindOfClass<String>()) {
+        if(other->isKindOfClass<String>()) {
             return this->isEqual((const String *)other);
         }
         
@@ -101,6 +249,7 @@ namespace gfx {
     
     CFMutableStringRef String::getStorage()
     {
+        this->invalidateCaches();
         return mStorage;
     }
     
@@ -113,7 +262,10 @@ namespace gfx {
     
     Index String::length() const
     {
-        return CFStringGetLength(mStorage);
+        if(mLength == -1)
+            mLength = CFStringGetLength(mStorage);
+        
+        return mLength;
     }
     
     CFStringEncoding String::encoding() const
@@ -125,6 +277,9 @@ namespace gfx {
     {
         gfx_assert((offset < this->length()), str("out of bounds"));
         
+        if((mFlags & kFlagASCII) && (mFlags & kFlagCStringValid))
+            return UniChar(this->cachedCString()[offset]);
+        
         return CFStringGetCharacterAtIndex(mStorage, offset);
     }
     
@@ -135,6 +290,9 @@ namespace gfx {
     
     const char *String::getCString(CFStringEncoding encoding) const
     {
+        if(encoding == kCFStringEncodingUTF8 || ((mFlags & kFlagASCII) && encoding == kCFStringEncodingASCII))
+            return this->cachedCString();
+        
         return CFStringGetCStringPtr(mStorage, encoding);
     }
     
@@ -199,7 +357,11 @@ namespace gfx {
         gfx_assert_param(stringToFind);
         gfx_assert_param(stringToReplace);
         
-        return CFStringFindAndReplace(mStorage, stringToFind->getStorage(), stringToReplace->getStorage(), searchRange, options);
+        Index numberOfReplacements = CFStringFindAndReplace(mStorage, stringToFind->getStorage(), stringToReplace->getStorage(), searchRange, options);
+        if(numberOfReplacements > 0)
+            this->invalidateCaches();
+        
+        return numberOfReplacements;
     }
     
 #pragma mark - Mutation
@@ -209,6 +371,7 @@ namespace gfx {
         gfx_assert_param(replacementString);
         
         CFStringReplace(mStorage, rangeToReplace, replacementString->getStorage());
+        this->invalidateCaches();
     }
     
     void String::replaceAll(const String *replacementString)
@@ -216,6 +379,7 @@ namespace gfx {
         gfx_assert_param(replacementString);
         
         CFStringReplaceAll(mStorage, replacementString->getStorage());
+        this->invalidateCaches();
     }
     
 #pragma mark -
@@ -225,17 +389,27 @@ namespace gfx {
         gfx_assert_param(stringToInsert);
         
         CFStringInsert(mStorage, insertionPoint, stringToInsert->getStorage());
+        this->invalidateCaches();
     }
     
     void String::append(const String *stringToAppend)
     {
         gfx_assert_param(stringToAppend);
         
+        bool bothASCII = ((mFlags & kFlagASCII) && (stringToAppend->mFlags & kFlagASCII));
+        Index newLength = this->length() + stringToAppend->length();
+        
         CFStringAppend(mStorage, stringToAppend->getStorage());
+        this->invalidateCaches();
+        
+        mLength = newLength;
+        if(bothASCII)
+            mFlags |= kFlagASCII;
     }
     
     void String::deleteRange(Range rangeToDelete)
     {
         CFStringDelete(mStorage, rangeToDelete);
+        this->invalidateCaches();
     }
 }
\ No newline at end of file
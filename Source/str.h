@@ -11,17 +11,86 @@
 
 #include "base.h"
 #include <stdarg.h>
+#include <type_traits>
+#include <atomic>
 
 namespace gfx {
+    ///Computes the hash of a sequence of utf16 code units using the FNV-1a algorithm.
+    ///
+    ///This is the hashing function used by `gfx::String`. It is exposed so
+    ///that the hash of a string literal may be computed at compile time.
+    constexpr HashCode StringHashStep(HashCode hash, UniChar character)
+    {
+        return (hash ^ character) * HashCode(16777619);
+    }
+    
+    ///Computes the hash of an ASCII c string at compile time.
+    ///
+    ///The result is only meaningful for pure ASCII strings.
+    constexpr HashCode StringHashASCII(const char *string, HashCode hash = HashCode(2166136261u))
+    {
+        return (*string == '\0')? hash : StringHashASCII(string + 1, StringHashStep(hash, UniChar(*string)));
+    }
+    
     ///The String class is a simple wrapper around the CFString type.
     ///
     ///All instances of `String` have mutable storage, to represent an
     ///immutable string, qualify the instance with the const modifier.
+    ///
+    ///Strings lazily cache their hash, their length, and their utf8
+    ///representation. Short strings keep their utf8 representation in
+    ///an inline buffer. Pure ASCII strings answer `length` and `at`
+    ///without consulting the CFString storage. The caches may be filled
+    ///concurrently by any number of readers of an immutable string.
     class String : public Base
     {
         ///The storage of the string.
         CFMutableStringRef mStorage;
         
+#pragma mark - Caches
+        
+        enum {
+            ///The number of bytes, including the terminator, that fit in the inline utf8 buffer.
+            kInlineCStringCapacity = 24,
+        };
+        
+        enum Flags : uint8_t {
+            ///Set when `mHash` is valid.
+            kFlagHashValid = (1 << 0),
+            
+            ///Set when the string is known to only contain ASCII characters.
+            kFlagASCII = (1 << 1),
+            
+            ///Set when the utf8 representation is cached.
+            kFlagCStringValid = (1 << 2),
+        };
+        
+        ///The cached hash of the string.
+        mutable std::atomic<HashCode> mHash;
+        
+        ///The cached length of the string, or -1 if it is not known.
+        mutable std::atomic<Index> mLength;
+        
+        ///The state of the caches.
+        mutable std::atomic<uint8_t> mFlags;
+        
+        ///The utf8 representation of short strings.
+        mutable char mInlineCString[kInlineCStringCapacity];
+        
+        ///The utf8 representation of long strings. Null for short strings.
+        mutable char *mCStringBuffer;
+        
+        ///Returns the cached utf8 representation of the string, creating it if needed.
+        const char *cachedCString() const;
+        
+        ///Caches a known ASCII representation of the string.
+        void cacheASCII(const char *string, Index length) const;
+        
+        ///Discards all cached information about the string's contents.
+        ///
+        ///Called by every mutator, and whenever the mutable storage is vended.
+        void invalidateCaches();
+        
     public:
         
         static const String *const Empty;
@@ -44,6 +113,14 @@ namespace gfx {
         ///The destructor.
         ~String();
         
+        ///Returns a new immortal string for a given string literal.
+        ///
+        /// \param  literal     The contents of the string. Required.
+        /// \param  asciiHash   The precomputed hash of the literal. Only used when the literal is pure ASCII.
+        ///
+        ///This method is an implementation detail of `gfx_str`, and should not be called directly.
+        static const String *Literal(const char *literal, HashCode asciiHash);
+        
 #pragma mark - Identity
         
         HashCode hash() const override;
@@ -80,13 +157,17 @@ namespace gfx {
         ///Returns the underlying storage of the string.
         ///
         ///This should be considered an implementation detail,
-        ///but is exposed for platform compatibility.
+        ///but is exposed for platform compatibility. Vending the
+        ///mutable storage discards the string's cached information.
         CFMutableStringRef getStorage();
         CFStringRef getStorage() const;
         
 #pragma mark -
         
         ///Returns the length of the string.
+        ///
+        ///The length is cached, and is known without scanning
+        ///the string for strings created from ASCII c strings.
         Index length() const;
         
         ///Returns the encoding of the string.
@@ -103,6 +184,9 @@ namespace gfx {
         
         ///Returns a C string representation of the receiver with
         ///a given encoding, defaulting to the kCFStringEncodingUTF8.
+        ///
+        ///The utf8 representation is cached by the receiver, and is
+        ///valid until the receiver is mutated or deallocated.
         const char *getCString(CFStringEncoding encoding = kCFStringEncodingUTF8) const;
         
         ///Places the characters in a given range into a given utf16 data buffer.
@@ -313,6 +397,17 @@ namespace gfx {
     {
         return autoreleased(new String(rawString));
     }
+    
+    ///Returns an immortal `const String *` for a given string literal.
+    ///
+    ///The string is created once per call site, the first time the call
+    ///site is reached, and its hash is computed at compile time. Unlike
+    ///`str`, repeated evaluation performs no allocations, making this the
+    ///preferred way to spell constant strings such as dictionary keys.
+#define gfx_str(literal) ([]() -> const gfx::String * { \
+        static const gfx::String *const interned = gfx::String::Literal(literal, std::integral_constant<gfx::HashCode, gfx::StringHashASCII(literal)>::value); \
+        return interned; \
+    }())
 }
 
 #endif /* defined(__gfx__string__) */
@@ -9,6 +9,12 @@
 #include "threading.h"
 #include <pthread.h>
 #include <CoreFoundation/CoreFoundation.h>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <algorithm>
 
 namespace gfx {
     namespace threading {
@@ -57,5 +63,268 @@ namespace gfx {
                 task();
             });
         }
+        
+#pragma mark - Worker Pool
+        
+        ///The stack size of pool threads. Matches the main thread so
+        ///that deeply recursive functions behave the same in workers.
+        static const size_t kWorkerStackSize = 8 * 1024 * 1024;
+        
+        ///A contiguous range of indexes owned by a single worker.
+        struct WorkRange
+        {
+            std::mutex lock;
+            size_t begin;
+            size_t end;
+        };
+        
+        ///The state of a single `parallelFor` invocation.
+        struct WorkJob
+        {
+            ///The function being applied.
+            const std::function<void(size_t, size_t)> *function;
+            
+            ///The ranges of the workers, one per worker number.
+            std::unique_ptr<WorkRange[]> ranges;
+            
+            ///The number of ranges.
+            size_t numberOfRanges;
+            
+            ///The next unclaimed worker number. Guarded by the pool lock.
+            size_t nextWorker;
+            
+            ///The number of workers currently running. Guarded by the pool lock.
+            size_t activeWorkers;
+            
+            ///Set when a worker raises, stops all workers from starting new indexes.
+            std::atomic<bool> cancelled;
+            
+            ///The first exception raised by a worker, if any.
+            std::exception_ptr error;
+            std::mutex errorLock;
+            
+            WorkJob(size_t count, size_t numberOfWorkers, const std::function<void(size_t, size_t)> &function) :
+                function(&function),
+                ranges(new WorkRange[numberOfWorkers]),
+                numberOfRanges(numberOfWorkers),
+                nextWorker(0),
+                activeWorkers(0),
+                cancelled(false),
+                error(),
+                errorLock()
+            {
+                for (size_t worker = 0; worker < numberOfWorkers; worker++) {
+                    ranges[worker].begin = (count * worker) / numberOfWorkers;
+                    ranges[worker].end = (count * (worker + 1)) / numberOfWorkers;
+                }
+            }
+            
+            ///Takes the next index from the front of a worker's own range.
+            bool take(size_t worker, size_t &outIndex)
+            {
+                WorkRange &range = ranges[worker];
+                std::lock_guard<std::mutex> guard(range.lock);
+                if(range.begin == range.end)
+                    return false;
+                
+                outIndex = range.begin++;
+                return true;
+            }
+            
+            ///Moves the back half of another worker's range into a worker's
+            ///own range, and takes the first index of the stolen half.
+            bool steal(size_t worker, size_t &outIndex)
+            {
+                for (size_t offset = 1; offset < numberOfRanges; offset++) {
+                    WorkRange &victim = ranges[(worker + offset) % numberOfRanges];
+                    size_t begin, end;
+                    {
+                        std::lock_guard<std::mutex> guard(victim.lock);
+                        size_t remaining = victim.end - victim.begin;
+                        if(remaining == 0)
+                            continue;
+                        
+                        begin = victim.begin + remaining / 2;
+                        end = victim.end;
+                        victim.end = begin;
+                    }
+                    
+                    WorkRange &range = ranges[worker];
+                    std::lock_guard<std::mutex> guard(range.lock);
+                    range.begin = begin + 1;
+                    range.end = end;
+                    outIndex = begin;
+                    return true;
+                }
+                
+                return false;
+            }
+            
+            ///Applies the function until there are no indexes left to take or steal.
+            void run(size_t worker)
+            {
+                size_t index;
+                while (!cancelled && (take(worker, index) || steal(worker, index))) {
+                    try {
+                        (*function)(index, worker);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> guard(errorLock);
+                        if(!error)
+                            error = std::current_exception();
+                        
+                        cancelled = true;
+                    }
+                }
+            }
+        };
+        
+        ///The WorkerPool class manages the threads used by `parallelFor`.
+        ///
+        ///The pool is created on first use and lives for the rest of the process.
+        class WorkerPool
+        {
+            std::mutex mLock;
+            std::condition_variable mJobAvailable;
+            std::condition_variable mJobFinished;
+            
+            ///The job currently being run, if any. Guarded by `mLock`.
+            WorkJob *mJob;
+            
+            ///Whether or not a job is currently being run.
+            std::atomic<bool> mBusy;
+            
+            ///The number of threads owned by the pool.
+            size_t mNumberOfThreads;
+            
+            static pthread_key_t WorkerThreadKey()
+            {
+                static pthread_key_t workerThreadKey;
+                static pthread_once_t guard = PTHREAD_ONCE_INIT;
+                pthread_once(&guard, []{
+                    gfx_assert((pthread_key_create(&workerThreadKey, nullptr) == 0),
+                               gfx_str("Could not create worker thread key"));
+                });
+                
+                return workerThreadKey;
+            }
+            
+            void workerMain()
+            {
+                pthread_setspecific(WorkerThreadKey(), this);
+                
+                std::unique_lock<std::mutex> lock(mLock);
+                for (;;) {
+                    mJobAvailable.wait(lock, [this] { return (mJob && mJob->nextWorker < mJob->numberOfRanges); });
+                    
+                    WorkJob *job = mJob;
+                    size_t worker = job->nextWorker++;
+                    job->activeWorkers++;
+                    
+                    lock.unlock();
+                    job->run(worker);
+                    lock.lock();
+                    
+                    if(--job->activeWorkers == 0)
+                        mJobFinished.notify_all();
+                }
+            }
+            
+        public:
+            
+            WorkerPool() :
+                mLock(),
+                mJobAvailable(),
+                mJobFinished(),
+                mJob(nullptr),
+                mBusy(false),
+                mNumberOfThreads(0)
+            {
+                size_t hardwareConcurrency = std::thread::hardware_concurrency();
+                size_t numberOfThreads = (hardwareConcurrency > 1)? hardwareConcurrency - 1 : 0;
+                
+                pthread_attr_t attributes;
+                pthread_attr_init(&attributes);
+                pthread_attr_setstacksize(&attributes, kWorkerStackSize);
+                pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+                for (size_t index = 0; index < numberOfThreads; index++) {
+                    pthread_t thread;
+                    auto entryPoint = [](void *pool) -> void * {
+                        static_cast<WorkerPool *>(pool)->workerMain();
+                        return nullptr;
+                    };
+                    if(pthread_create(&thread, &attributes, entryPoint, this) == 0)
+                        mNumberOfThreads++;
+                }
+                pthread_attr_destroy(&attributes);
+            }
+            
+            ///Returns the shared pool, creating it if needed.
+            static WorkerPool *SharedPool()
+            {
+                static WorkerPool *sharedPool = new WorkerPool();
+                return sharedPool;
+            }
+            
+            ///Returns whether or not the calling thread belongs to a pool.
+            static bool IsWorkerThread()
+            {
+                return (pthread_getspecific(WorkerThreadKey()) != nullptr);
+            }
+            
+            size_t concurrency() const
+            {
+                return mNumberOfThreads + 1;
+            }
+            
+            ///Runs a job on the pool, returning false without doing
+            ///anything if the pool is already running another job.
+            bool tryRun(size_t count, const std::function<void(size_t, size_t)> &function)
+            {
+                bool expected = false;
+                if(!mBusy.compare_exchange_strong(expected, true))
+                    return false;
+                
+                WorkJob job(count, std::min(count, concurrency()), function);
+                job.nextWorker = 1;
+                job.activeWorkers = 1;
+                {
+                    std::lock_guard<std::mutex> guard(mLock);
+                    mJob = &job;
+                }
+                mJobAvailable.notify_all();
+                
+                job.run(0);
+                {
+                    std::unique_lock<std::mutex> lock(mLock);
+                    job.activeWorkers--;
+                    mJobFinished.wait(lock, [&job] { return (job.activeWorkers == 0); });
+                    mJob = nullptr;
+                }
+                mBusy = false;
+                
+                if(job.error)
+                    std::rethrow_exception(job.error);
+                
+                return true;
+            }
+        };
+        
+        size_t concurrency()
+        {
+            return WorkerPool::SharedPool()->concurrency();
+        }
+        
+        void parallelFor(size_t count, const std::function<void(size_t index, size_t worker)> &function)
+        {
+            if(count == 0 || !function)
+                return;
+            
+            WorkerPool *pool = WorkerPool::SharedPool();
+            if(count > 1 && pool->concurrency() > 1 && !WorkerPool::IsWorkerThread() && pool->tryRun(count, function))
+                return;
+            
+            for (size_t index = 0; index < count; index++)
+                function(index, 0);
+        }
     }
 }
@@ -11,6 +11,8 @@
 
 #include "dictionary.h"
 #include <functional>
+#include <algorithm>
+#include <vector>
 
 namespace gfx {
     
@@ -42,6 +44,87 @@ namespace gfx {
         ///This function assumes that a run loop is in operation. The task
         ///function will not be executed if there is no active run loop.
         extern void performOnMainThread(std::function<void()> task);
+        
+#pragma mark - Worker Pool
+        
+        ///Returns the maximum number of workers that will participate in
+        ///a single `gfx::threading::parallelFor` call, including the caller.
+        extern size_t concurrency();
+        
+        ///Applies a function to every index in `[0, count)` using the shared worker pool.
+        ///
+        /// \param  count       The number of indexes to visit.
+        /// \param  function    The function to apply. Invoked with an index and the number
+        ///                     of the worker applying it. Worker numbers are in the range
+        ///                     `[0, concurrency())` and a given worker number is never used
+        ///                     by two threads at once, so callers may keep per-worker state.
+        ///
+        ///The index range is split evenly between workers up front. A worker that
+        ///runs out of indexes steals half of the remaining indexes of another worker.
+        ///The calling thread participates as worker 0 and this function does not
+        ///return until every index has been visited.
+        ///
+        ///If the function raises, no further indexes are started and the first
+        ///exception is rethrown on the calling thread once all workers have stopped.
+        ///Calls made while the pool is busy, including nested calls from inside
+        ///of a worker, are run serially on the calling thread.
+        extern void parallelFor(size_t count, const std::function<void(size_t index, size_t worker)> &function);
+        
+        ///The smallest number of values each worker must have before
+        ///`gfx::threading::parallelStableSort` splits its input.
+        static const size_t kParallelSortMinimumRun = 4096;
+        
+        ///Stably sorts a vector, splitting large inputs across the shared worker pool.
+        ///
+        /// \param values  The values to sort in place.
+        /// \param less    A strict weak ordering of the values. Must not raise.
+        ///
+        ///Large inputs are split into one run per worker, the runs are sorted in
+        ///parallel, and then adjacent runs are merged in parallel rounds until one
+        ///run remains. Small inputs are sorted serially with `std::stable_sort`.
+        template<typename T, typename Less>
+        void parallelStableSort(std::vector<T> &values, Less less)
+        {
+            size_t count = values.size();
+            size_t numberOfRuns = std::min(concurrency(), count / kParallelSortMinimumRun);
+            if(numberOfRuns < 2) {
+                std::stable_sort(values.begin(), values.end(), less);
+                return;
+            }
+            
+            std::vector<size_t> bounds;
+            for (size_t run = 0; run <= numberOfRuns; run++)
+                bounds.push_back((count * run) / numberOfRuns);
+            
+            parallelFor(numberOfRuns, [&values, &bounds, &less](size_t run, size_t) {
+                std::stable_sort(values.begin() + bounds[run], values.begin() + bounds[run + 1], less);
+            });
+            
+            std::vector<T> scratch(count);
+            std::vector<T> *source = &values, *destination = &scratch;
+            while (bounds.size() > 2) {
+                size_t lastRun = bounds.size() - 1;
+                parallelFor((lastRun + 1) / 2, [source, destination, &bounds, &less, lastRun](size_t merge, size_t) {
+                    size_t begin = bounds[merge * 2];
+                    size_t middle = bounds[std::min(merge * 2 + 1, lastRun)];
+                    size_t end = bounds[std::min(merge * 2 + 2, lastRun)];
+                    std::merge(source->begin() + begin, source->begin() + middle,
+                               source->begin() + middle, source->begin() + end,
+                               destination->begin() + begin, less);
+                });
+                
+                std::vector<size_t> mergedBounds;
+                for (size_t run = 0; run < lastRun; run += 2)
+                    mergedBounds.push_back(bounds[run]);
+                mergedBounds.push_back(bounds[lastRun]);
+                
+                bounds.swap(mergedBounds);
+                std::swap(source, destination);
+            }
+            
+            if(source != &values)
+                values.swap(scratch);
+        }
     }
 }
 
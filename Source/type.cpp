@@ -13,6 +13,7 @@
 #include "array.h"
 #include "dictionary.h"
 #include "blob.h"
+#include "typedarray.h"
 #include "file.h"
 #include "function.h"
 
@@ -88,13 +89,13 @@ namespace gfx {
     
     Type *Type::BaseType()
     {
-        static Type *baseType = new Type(nullptr, str("<val>"));
+        static Type *baseType = new Type(nullptr, gfx_str("<val>"));
         return baseType;
     }
     
     Type *Type::TypeType()
     {
-        static Type *typeType = new Type(nullptr, str("<type>"));
+        static Type *typeType = new Type(nullptr, gfx_str("<type>"));
         return typeType;
     }
     
@@ -150,12 +151,14 @@ namespace gfx {
         map->registerType(typeid(Base), baseType);
         map->registerType(typeid(Type), Type::TypeType());
         
-        map->registerType(typeid(String), make<Type>(baseType, str("<str>")));
-        map->registerType(typeid(Number), make<Type>(baseType, str("<num>")));
-        map->registerType(typeid(Array<Base>), make<Type>(baseType, str("<vec>")));
-        map->registerType(typeid(Dictionary<Base, Base>), make<Type>(baseType, str("<hash>")));
-        map->registerType(typeid(Blob), make<Type>(baseType, str("<blob>")));
-        map->registerType(typeid(Function), make<Type>(baseType, str("<func>")));
+        map->registerType(typeid(String), make<Type>(baseType, gfx_str("<str>")));
+        map->registerType(typeid(Number), make<Type>(baseType, gfx_str("<num>")));
+        map->registerType(typeid(Array<Base>), make<Type>(baseType, gfx_str("<vec>")));
+        map->registerType(typeid(Dictionary<Base, Base>), make<Type>(baseType, gfx_str("<hash>")));
+        map->registerType(typeid(Blob), make<Type>(baseType, gfx_str("<blob>")));
+        map->registerType(typeid(Float64Array), make<Type>(baseType, gfx_str("<f64vec>")));
+        map->registerType(typeid(Float32Array), make<Type>(baseType, gfx_str("<f32vec>")));
+        map->registerType(typeid(Function), make<Type>(baseType, gfx_str("<func>")));
         
         return map;
     }
@@ -0,0 +1,629 @@
+//
+//  typedarray.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/4/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#include "typedarray.h"
+#include "blob.h"
+#include "number.h"
+#include "stackframe.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <functional>
+
+namespace gfx {
+    
+#pragma mark - Kernels
+    
+    ///The kernels namespace contains the vectorized loops behind typed arrays.
+    ///
+    ///Kernels are written against the GCC/clang vector extensions using
+    ///128-bit vectors, so that they lower to SSE on Intel and NEON on ARM
+    ///without intrinsics or instruction set specific build settings.
+    ///Every kernel handles unaligned buffers and any count of values.
+    namespace kernels {
+        typedef double VectorDouble __attribute__((vector_size(16)));
+        typedef float VectorFloat __attribute__((vector_size(16)));
+        
+        ///The operations of every typed array share a representation,
+        ///so the kernels take the operations of `TypedArray<double>`.
+        typedef TypedArray<double>::Operation Operation;
+        
+        template<typename T> struct Lanes;
+        
+        template<> struct Lanes<double>
+        {
+            typedef VectorDouble Vector;
+            static const size_t count = 2;
+        };
+        
+        template<> struct Lanes<float>
+        {
+            typedef VectorFloat Vector;
+            static const size_t count = 4;
+        };
+        
+        template<typename T>
+        static inline typename Lanes<T>::Vector load(const T *values)
+        {
+            typename Lanes<T>::Vector vector;
+            memcpy(&vector, values, sizeof(vector));
+            return vector;
+        }
+        
+        template<typename T>
+        static inline void store(T *values, typename Lanes<T>::Vector vector)
+        {
+            memcpy(values, &vector, sizeof(vector));
+        }
+        
+        template<typename T>
+        static inline typename Lanes<T>::Vector broadcast(T value)
+        {
+            typename Lanes<T>::Vector vector;
+            for (size_t lane = 0; lane < Lanes<T>::count; lane++)
+                vector[lane] = value;
+            
+            return vector;
+        }
+        
+        ///Selects the lanes of `left` where mask is set, and the lanes of `right` elsewhere.
+        ///
+        ///The mask is the result of comparing two vectors, which
+        ///has all bits of a lane set when the comparison holds.
+        template<typename Mask, typename Vector>
+        static inline Vector select(Mask mask, Vector left, Vector right)
+        {
+            return (Vector)((mask & (Mask)left) | (~mask & (Mask)right));
+        }
+        
+        template<typename Vector>
+        static inline Vector perform(Operation operation, Vector left, Vector right)
+        {
+            switch (operation) {
+                case Operation::Add:
+                    return left + right;
+                
+                case Operation::Subtract:
+                    return left - right;
+                
+                case Operation::Multiply:
+                    return left * right;
+                
+                case Operation::Divide:
+                    return left / right;
+            }
+            
+            return left;
+        }
+        
+        template<typename T>
+        static void binary(Operation operation, const T *left, const T *right, T *result, size_t count)
+        {
+            const size_t lanes = Lanes<T>::count;
+            size_t index = 0;
+            for (; index + lanes <= count; index += lanes)
+                store(result + index, perform(operation, load(left + index), load(right + index)));
+            
+            for (; index < count; index++)
+                result[index] = perform(operation, left[index], right[index]);
+        }
+        
+        template<typename T>
+        static void binaryScalar(Operation operation, const T *values, T scalar, bool scalarOnLeft, T *result, size_t count)
+        {
+            const size_t lanes = Lanes<T>::count;
+            const typename Lanes<T>::Vector scalarVector = broadcast(scalar);
+            size_t index = 0;
+            if(scalarOnLeft) {
+                for (; index + lanes <= count; index += lanes)
+                    store(result + index, perform(operation, scalarVector, load(values + index)));
+                
+                for (; index < count; index++)
+                    result[index] = perform(operation, scalar, values[index]);
+            } else {
+                for (; index + lanes <= count; index += lanes)
+                    store(result + index, perform(operation, load(values + index), scalarVector));
+                
+                for (; index < count; index++)
+                    result[index] = perform(operation, values[index], scalar);
+            }
+        }
+        
+        template<typename T>
+        static T sum(const T *values, size_t count)
+        {
+            const size_t lanes = Lanes<T>::count;
+            typename Lanes<T>::Vector partialSums = broadcast(T(0));
+            size_t index = 0;
+            for (; index + lanes <= count; index += lanes)
+                partialSums += load(values + index);
+            
+            T sum = 0;
+            for (size_t lane = 0; lane < lanes; lane++)
+                sum += partialSums[lane];
+            
+            for (; index < count; index++)
+                sum += values[index];
+            
+            return sum;
+        }
+        
+        ///Finds the minimum or maximum of a sequence of values, ignoring NaN.
+        ///
+        ///Comparisons against NaN are always false, so a NaN
+        ///never replaces the running extreme of its lane. Lanes
+        ///that have seen a number are tracked alongside, so that
+        ///a sequence of only NaN yields NaN rather than infinity.
+        template<typename T, bool FindMaximum>
+        static T extreme(const T *values, size_t count)
+        {
+            const size_t lanes = Lanes<T>::count;
+            const T initial = FindMaximum? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+            typename Lanes<T>::Vector extremes = broadcast(initial);
+            auto seen = (extremes != extremes);
+            size_t index = 0;
+            for (; index + lanes <= count; index += lanes) {
+                typename Lanes<T>::Vector vector = load(values + index);
+                if(FindMaximum)
+                    extremes = select(vector > extremes, vector, extremes);
+                else
+                    extremes = select(vector < extremes, vector, extremes);
+                
+                seen |= (vector == vector);
+            }
+            
+            T extreme = initial;
+            bool found = false;
+            for (size_t lane = 0; lane < lanes; lane++) {
+                if(FindMaximum? (extremes[lane] > extreme) : (extremes[lane] < extreme))
+                    extreme = extremes[lane];
+                
+                found = found || seen[lane];
+            }
+            
+            for (; index < count; index++) {
+                if(FindMaximum? (values[index] > extreme) : (values[index] < extreme))
+                    extreme = values[index];
+                
+                found = found || (values[index] == values[index]);
+            }
+            
+            if(!found)
+                return std::numeric_limits<T>::quiet_NaN();
+            
+            return extreme;
+        }
+    }
+    
+#pragma mark - Lifecycle
+    
+    template<typename T>
+    TypedArray<T>::TypedArray(Index count) :
+        Base(),
+        mStorage(count, T(0))
+    {
+    }
+    
+    template<typename T>
+    TypedArray<T>::TypedArray(const T *values, Index count) :
+        Base(),
+        mStorage(values, values + count)
+    {
+    }
+    
+    template<typename T>
+    TypedArray<T>::TypedArray(const TypedArray<T> *other) :
+        Base(),
+        mStorage(other->mStorage)
+    {
+    }
+    
+    template<typename T>
+    TypedArray<T>::TypedArray(const Array<Base> *array) :
+        Base(),
+        mStorage()
+    {
+        gfx_assert_param(array);
+        
+        mStorage.reserve(array->count());
+        array->iterate(array->all(), [this](Base *value, Index index, bool *stop) {
+            gfx_assert(value->isKindOfClass<Number>(), gfx_str("typed arrays can only contain numbers"));
+            mStorage.push_back(T(static_cast<Number *>(value)->value()));
+        });
+    }
+    
+    template<typename T>
+    TypedArray<T>::TypedArray(const Blob *blob) :
+        Base(),
+        mStorage()
+    {
+        gfx_assert_param(blob);
+        gfx_assert((blob->length() % sizeof(T)) == 0, gfx_str("blob length is not a multiple of the typed array's element size"));
+        
+        mStorage.resize(blob->length() / sizeof(T));
+        if(!mStorage.empty())
+            memcpy(mStorage.data(), blob->bytes(), blob->length());
+    }
+    
+#pragma mark - Identity
+    
+    template<typename T>
+    HashCode TypedArray<T>::hash() const
+    {
+        HashCode hash = mStorage.size();
+        for (T value : mStorage)
+            hash = (hash * 31) + std::hash<T>()(value);
+        
+        return hash;
+    }
+    
+    template<typename T>
+    bool TypedArray<T>::isEqual(const TypedArray<T> *other) const
+    {
+        if(!other)
+            return false;
+        
+        return (mStorage == other->mStorage);
+    }
+    
+    template<typename T>
+    bool TypedArray<T>::isEqual(const Base *other) const
+    {
+        if(other && other->isKindOfClass<TypedArray<T>>())
+            return this->isEqual((const TypedArray<T> *)other);
+        
+        return false;
+    }
+    
+    template<typename T>
+    const String *TypedArray<T>::description() const
+    {
+        String::Builder description;
+        
+        description << "<" << this->className() << ":" << (void *)this << " ";
+        description << count() << " values>";
+        
+        return description;
+    }
+    
+#pragma mark - Introspection
+    
+    template<typename T>
+    Index TypedArray<T>::count() const
+    {
+        return mStorage.size();
+    }
+    
+    template<typename T>
+    T TypedArray<T>::at(Index index) const
+    {
+        gfx_assert((index >= 0 && index < count()), gfx_str("out of bounds"));
+        
+        return mStorage[index];
+    }
+    
+    template<typename T>
+    const T *TypedArray<T>::values() const
+    {
+        return mStorage.data();
+    }
+    
+    template<typename T>
+    T *TypedArray<T>::values()
+    {
+        return mStorage.data();
+    }
+    
+#pragma mark - Conversion
+    
+    template<typename T>
+    Array<Base> *TypedArray<T>::toArray() const
+    {
+        std::vector<Base *> numbers;
+        numbers.reserve(mStorage.size());
+        for (T value : mStorage)
+            numbers.push_back(make<Number>(value));
+        
+        return make<Array<Base>>(numbers);
+    }
+    
+    template<typename T>
+    Blob *TypedArray<T>::toBlob() const
+    {
+        return make<Blob>((const UInt8 *)mStorage.data(), Index(mStorage.size() * sizeof(T)));
+    }
+    
+#pragma mark - Element-wise Operations
+    
+    template<typename T>
+    TypedArray<T> *TypedArray<T>::apply(Operation operation, const TypedArray<T> *other) const
+    {
+        gfx_assert_param(other);
+        gfx_assert(other->count() == this->count(), gfx_str("typed arrays must have the same count"));
+        
+        auto result = make<TypedArray<T>>(count());
+        kernels::binary<T>(kernels::Operation(operation), values(), other->values(), result->values(), mStorage.size());
+        return result;
+    }
+    
+    template<typename T>
+    TypedArray<T> *TypedArray<T>::apply(Operation operation, T scalar, bool scalarOnLeft) const
+    {
+        auto result = make<TypedArray<T>>(count());
+        kernels::binaryScalar<T>(kernels::Operation(operation), values(), scalar, scalarOnLeft, result->values(), mStorage.size());
+        return result;
+    }
+    
+    template<typename T>
+    TypedArray<T> *TypedArray<T>::scaled(T factor) const
+    {
+        return apply(Operation::Multiply, factor);
+    }
+    
+    template<typename T>
+    TypedArray<T> *TypedArray<T>::normalized() const
+    {
+        if(mStorage.empty())
+            return make<TypedArray<T>>();
+        
+        T minimum = this->minimum(), maximum = this->maximum();
+        if(!(maximum > minimum))
+            return make<TypedArray<T>>(count());
+        
+        return apply(Operation::Subtract, minimum)->scaled(T(1) / (maximum - minimum));
+    }
+    
+#pragma mark - Reductions
+    
+    template<typename T>
+    T TypedArray<T>::sum() const
+    {
+        return kernels::sum(mStorage.data(), mStorage.size());
+    }
+    
+    template<typename T>
+    T TypedArray<T>::minimum() const
+    {
+        gfx_assert(!mStorage.empty(), gfx_str("cannot find the minimum of an empty typed array"));
+        
+        return kernels::extreme<T, false>(mStorage.data(), mStorage.size());
+    }
+    
+    template<typename T>
+    T TypedArray<T>::maximum() const
+    {
+        gfx_assert(!mStorage.empty(), gfx_str("cannot find the maximum of an empty typed array"));
+        
+        return kernels::extreme<T, true>(mStorage.data(), mStorage.size());
+    }
+    
+    template<typename T>
+    T TypedArray<T>::mean() const
+    {
+        gfx_assert(!mStorage.empty(), gfx_str("cannot find the mean of an empty typed array"));
+        
+        return sum() / T(mStorage.size());
+    }
+    
+    template class TypedArray<double>;
+    template class TypedArray<float>;
+    
+#pragma mark - Functions
+    
+    template<typename T>
+    static void typedarray_make(StackFrame *frame)
+    {
+        /* vec -- typedvec */
+        Array<Base> *vector = frame->popType<Array<Base>>();
+        frame->push(make<TypedArray<T>>(vector));
+    }
+    
+    template<typename T>
+    static void typedarray_zeros(StackFrame *frame)
+    {
+        /* num -- typedvec */
+        Number *count = frame->popNumber();
+        gfx_assert(count->value() >= 0, gfx_str("count must be positive"));
+        
+        frame->push(make<TypedArray<T>>(Index(count->value())));
+    }
+    
+    template<typename T>
+    static void typedarray_count(StackFrame *frame)
+    {
+        /* typedvec -- num */
+        TypedArray<T> *array = frame->popType<TypedArray<T>>();
+        frame->push(make<Number>(array->count()));
+    }
+    
+    template<typename T>
+    static void typedarray_at(StackFrame *frame)
+    {
+        /* typedvec num -- num */
+        Number *index = frame->popNumber();
+        TypedArray<T> *array = frame->popType<TypedArray<T>>();
+        frame->push(make<Number>(array->at(index->value())));
+    }
+    
+    template<typename T>
+    static void typedarray_toVector(StackFrame *frame)
+    {
+        /* typedvec -- vec */
+        TypedArray<T> *array = frame->popType<TypedArray<T>>();
+        frame->push(array->toArray());
+    }
+    
+    template<typename T>
+    static void typedarray_toBlob(StackFrame *frame)
+    {
+        /* typedvec -- blob */
+        TypedArray<T> *array = frame->popType<TypedArray<T>>();
+        frame->push(array->toBlob());
+    }
+    
+    template<typename T>
+    static void typedarray_fromBlob(StackFrame *frame)
+    {
+        /* blob -- typedvec */
+        Blob *blob = frame->popType<Blob>();
+        frame->push(make<TypedArray<T>>(blob));
+    }
+    
+    template<typename From, typename To>
+    static void typedarray_convert(StackFrame *frame)
+    {
+        /* typedvec -- typedvec */
+        TypedArray<From> *array = frame->popType<TypedArray<From>>();
+        auto result = make<TypedArray<To>>(array->count());
+        std::copy(array->values(), array->values() + array->count(), result->values());
+        frame->push(result);
+    }
+    
+#pragma mark -
+    
+    ///Applies an element-wise operation to the top two values of a frame.
+    ///
+    ///Either operand may be a number, in which case it is broadcast
+    ///against every value of the other operand.
+    template<typename T>
+    static void TypedArrayApply(StackFrame *frame, typename TypedArray<T>::Operation operation)
+    {
+        /* typedvec|num typedvec|num -- typedvec */
+        Base *right = frame->pop();
+        Base *left = frame->pop();
+        if(left->isKindOfClass<TypedArray<T>>() && right->isKindOfClass<TypedArray<T>>()) {
+            frame->push(static_cast<TypedArray<T> *>(left)->apply(operation, static_cast<TypedArray<T> *>(right)));
+        } else if(left->isKindOfClass<TypedArray<T>>() && right->isKindOfClass<Number>()) {
+            frame->push(static_cast<TypedArray<T> *>(left)->apply(operation, T(static_cast<Number *>(right)->value()), false));
+        } else if(left->isKindOfClass<Number>() && right->isKindOfClass<TypedArray<T>>()) {
+            frame->push(static_cast<TypedArray<T> *>(right)->apply(operation, T(static_cast<Number *>(left)->value()), true));
+        } else {
+            throw Exception((String::Builder() << "wrong types on stack. got '" << left->className() << "' and '" << right->className() << "'."), nullptr);
+        }
+    }
+    
+    template<typename T>
+    static void typedarray_add(StackFrame *frame)
+    {
+        TypedArrayApply<T>(frame, TypedArray<T>::Operation::Add);
+    }
+    
+    template<typename T>
+    static void typedarray_subtract(StackFrame *frame)
+    {
+        TypedArrayApply<T>(frame, TypedArray<T>::Operation::Subtract);
+    }
+    
+    template<typename T>
+    static void typedarray_multiply(StackFrame *frame)
+    {
+        TypedArrayApply<T>(frame, TypedArray<T>::Operation::Multiply);
+    }
+    
+    template<typename T>
+    static void typedarray_divide(StackFrame *frame)
+    {
+        TypedArrayApply<T>(frame, TypedArray<T>::Operation::Divide);
+    }
+    
+    template<typename T>
+    static void typedarray_scale(StackFrame *frame)
+    {
+        /* typedvec num -- typedvec */
+        Number *factor = frame->popNumber();
+        TypedArray<T> *array = frame->popType<TypedArray<T>>();
+        frame->push(array->scaled(factor->value()));
+    }
+    
+    template<typename T>
+    static void typedarray_normalize(StackFrame *frame)
+    {
+        /* typedvec -- typedvec */
+        TypedArray<T> *array = frame->popType<TypedArray<T>>();
+        frame->push(array->normalized());
+    }
+    
+#pragma mark -
+    
+    template<typename T>
+    static void typedarray_sum(StackFrame *frame)
+    {
+        /* typedvec -- num */
+        TypedArray<T> *array = frame->popType<TypedArray<T>>();
+        frame->push(make<Number>(array->sum()));
+    }
+    
+    template<typename T>
+    static void typedarray_min(StackFrame *frame)
+    {
+        /* typedvec -- num */
+        TypedArray<T> *array = frame->popType<TypedArray<T>>();
+        frame->push(make<Number>(array->minimum()));
+    }
+    
+    template<typename T>
+    static void typedarray_max(StackFrame *frame)
+    {
+        /* typedvec -- num */
+        TypedArray<T> *array = frame->popType<TypedArray<T>>();
+        frame->push(make<Number>(array->maximum()));
+    }
+    
+    template<typename T>
+    static void typedarray_mean(StackFrame *frame)
+    {
+        /* typedvec -- num */
+        TypedArray<T> *array = frame->popType<TypedArray<T>>();
+        frame->push(make<Number>(array->mean()));
+    }
+    
+#pragma mark -
+    
+    void TypedArrayFunctions::addTo(StackFrame *frame)
+    {
+        gfx_assert_param(frame);
+        
+        frame->createFunctionBinding(gfx_str("f64vec"), &typedarray_make<double>);
+        frame->createFunctionBinding(gfx_str("f64vec/zeros"), &typedarray_zeros<double>);
+        frame->createFunctionBinding(gfx_str("f64vec/count"), &typedarray_count<double>);
+        frame->createFunctionBinding(gfx_str("f64vec/at"), &typedarray_at<double>);
+        frame->createFunctionBinding(gfx_str("f64vec/vec"), &typedarray_toVector<double>);
+        frame->createFunctionBinding(gfx_str("f64vec/blob"), &typedarray_toBlob<double>);
+        frame->createFunctionBinding(gfx_str("f64vec/from-blob"), &typedarray_fromBlob<double>);
+        frame->createFunctionBinding(gfx_str("f64vec/f32vec"), &typedarray_convert<double, float>);
+        frame->createFunctionBinding(gfx_str("f64vec/+"), &typedarray_add<double>);
+        frame->createFunctionBinding(gfx_str("f64vec/-"), &typedarray_subtract<double>);
+        frame->createFunctionBinding(gfx_str("f64vec/*"), &typedarray_multiply<double>);
+        frame->createFunctionBinding(gfx_str("f64vec//"), &typedarray_divide<double>);
+        frame->createFunctionBinding(gfx_str("f64vec/scale"), &typedarray_scale<double>);
+        frame->createFunctionBinding(gfx_str("f64vec/normalize"), &typedarray_normalize<double>);
+        frame->createFunctionBinding(gfx_str("f64vec/sum"), &typedarray_sum<double>);
+        frame->createFunctionBinding(gfx_str("f64vec/min"), &typedarray_min<double>);
+        frame->createFunctionBinding(gfx_str("f64vec/max"), &typedarray_max<double>);
+        frame->createFunctionBinding(gfx_str("f64vec/mean"), &typedarray_mean<double>);
+        
+        frame->createFunctionBinding(gfx_str("f32vec"), &typedarray_make<float>);
+        frame->createFunctionBinding(gfx_str("f32vec/zeros"), &typedarray_zeros<float>);
+        frame->createFunctionBinding(gfx_str("f32vec/count"), &typedarray_count<float>);
+        frame->createFunctionBinding(gfx_str("f32vec/at"), &typedarray_at<float>);
+        frame->createFunctionBinding(gfx_str("f32vec/vec"), &typedarray_toVector<float>);
+        frame->createFunctionBinding(gfx_str("f32vec/blob"), &typedarray_toBlob<float>);
+        frame->createFunctionBinding(gfx_str("f32vec/from-blob"), &typedarray_fromBlob<float>);
+        frame->createFunctionBinding(gfx_str("f32vec/f64vec"), &typedarray_convert<float, double>);
+        frame->createFunctionBinding(gfx_str("f32vec/+"), &typedarray_add<float>);
+        frame->createFunctionBinding(gfx_str("f32vec/-"), &typedarray_subtract<float>);
+        frame->createFunctionBinding(gfx_str("f32vec/*"), &typedarray_multiply<float>);
+        frame->createFunctionBinding(gfx_str("f32vec//"), &typedarray_divide<float>);
+        frame->createFunctionBinding(gfx_str("f32vec/scale"), &typedarray_scale<float>);
+        frame->createFunctionBinding(gfx_str("f32vec/normalize"), &typedarray_normalize<float>);
+        frame->createFunctionBinding(gfx_str("f32vec/sum"), &typedarray_sum<float>);
+        frame->createFunctionBinding(gfx_str("f32vec/min"), &typedarray_min<float>);
+        frame->createFunctionBinding(gfx_str("f32vec/max"), &typedarray_max<float>);
+        frame->createFunctionBinding(gfx_str("f32vec/mean"), &typedarray_mean<float>);
+    }
+}
@@ -0,0 +1,183 @@
+//
+//  typedarray.h
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/4/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef __gfx__typedarray__
+#define __gfx__typedarray__
+
+#include "base.h"
+#include "array.h"
+#include <vector>
+#include <type_traits>
+
+namespace gfx {
+    class Blob;
+    class StackFrame;
+    
+    ///The TypedArray class encapsulates a contiguous sequence of unboxed numbers.
+    ///
+    /// \tparam T   The element type. Either `double` or `float`.
+    ///
+    ///Typed arrays exist for numeric work at scale. Where an `Array` of
+    ///`Number`s pays a pointer chase and a virtual call per element, the
+    ///operations of a typed array run as vectorized loops over raw storage.
+    ///
+    ///Like `Blob`, the operations of a typed array never modify the receiver,
+    ///they always yield a new typed array.
+    template<typename T>
+    class TypedArray final : public Base
+    {
+        static_assert(std::is_floating_point<T>::value, "TypedArray requires a floating point type");
+        
+        ///The storage of the typed array.
+        std::vector<T> mStorage;
+        
+    public:
+        
+        ///The element-wise operations supported by typed arrays.
+        enum class Operation {
+            Add,
+            Subtract,
+            Multiply,
+            Divide,
+        };
+        
+#pragma mark - Lifecycle
+        
+        ///Constructs a typed array of a given count with every element set to zero.
+        explicit TypedArray(Index count = 0);
+        
+        ///Constructs a typed array by copying a given buffer of values.
+        ///
+        /// \param  values  The values to copy. Required if count is greater than zero.
+        /// \param  count   The number of values in the buffer.
+        ///
+        TypedArray(const T *values, Index count);
+        
+        ///Constructs a typed array by copying the contents of another typed array.
+        TypedArray(const TypedArray<T> *other);
+        
+        ///Constructs a typed array from a vector of numbers.
+        ///
+        /// \throws `gfx::Exception` if the vector contains a value that is not a number.
+        explicit TypedArray(const Array<Base> *array);
+        
+        ///Constructs a typed array from the bytes of a blob.
+        ///
+        ///The bytes are interpreted as values of type T in native byte order.
+        ///
+        /// \throws `gfx::Exception` if the blob's length is not a multiple of the size of T.
+        explicit TypedArray(const Blob *blob);
+        
+#pragma mark - Identity
+        
+        HashCode hash() const override;
+        
+        ///Returns a bool indicating whether or not the receiver contains the same values as another typed array.
+        bool isEqual(const TypedArray<T> *other) const;
+        bool isEqual(const Base *other) const override;
+        const String *description() const override;
+        
+#pragma mark - Introspection
+        
+        ///Returns the number of values in the typed array.
+        Index count() const;
+        
+        ///Returns the value at a given index.
+        ///
+        /// \throws `gfx::Exception` if index is out of bounds.
+        T at(Index index) const;
+        
+        ///Returns the values of the typed array.
+        ///
+        ///__Important:__ the returned pointer is invalidated when the typed array is destroyed.
+        const T *values() const;
+        
+        ///Returns the values of the typed array as a mutable pointer.
+        T *values();
+        
+#pragma mark - Conversion
+        
+        ///Returns a vector of numbers containing the values of the receiver.
+        Array<Base> *toArray() const;
+        
+        ///Returns a blob containing the values of the receiver in native byte order.
+        Blob *toBlob() const;
+        
+#pragma mark - Element-wise Operations
+        
+        ///Returns the result of applying an operation between each pair of values of the receiver and another typed array.
+        ///
+        /// \throws `gfx::Exception` if the typed arrays do not have the same count.
+        TypedArray<T> *apply(Operation operation, const TypedArray<T> *other) const;
+        
+        ///Returns the result of applying an operation between each value of the receiver and a scalar.
+        ///
+        /// \param  operation       The operation to apply.
+        /// \param  scalar          The scalar to broadcast.
+        /// \param  scalarOnLeft    Whether or not the scalar is the left operand, e.g. `scalar - value`.
+        ///
+        TypedArray<T> *apply(Operation operation, T scalar, bool scalarOnLeft = false) const;
+        
+        ///Returns the result of multiplying each value of the receiver by a factor.
+        TypedArray<T> *scaled(T factor) const;
+        
+        ///Returns the receiver with its values mapped linearly into the range [0, 1].
+        ///
+        ///The minimum value maps to 0, and the maximum value to 1. If all of
+        ///the values are the same, every value of the result is 0.
+        TypedArray<T> *normalized() const;
+        
+#pragma mark - Reductions
+        
+        ///Returns the sum of the values of the receiver.
+        ///
+        ///The values are summed in several interleaved partial sums,
+        ///so the result may differ in the last bits from a serial sum.
+        T sum() const;
+        
+        ///Returns the smallest value of the receiver, ignoring NaN.
+        ///
+        ///If every value of the receiver is NaN, the result is NaN.
+        ///
+        /// \throws `gfx::Exception` if the receiver is empty.
+        T minimum() const;
+        
+        ///Returns the largest value of the receiver, ignoring NaN.
+        ///
+        ///If every value of the receiver is NaN, the result is NaN.
+        ///
+        /// \throws `gfx::Exception` if the receiver is empty.
+        T maximum() const;
+        
+        ///Returns the arithmetic mean of the values of the receiver.
+        ///
+        /// \throws `gfx::Exception` if the receiver is empty.
+        T mean() const;
+    };
+    
+    ///A typed array of 64-bit floating point numbers.
+    typedef TypedArray<double> Float64Array;
+    
+    ///A typed array of 32-bit floating point numbers.
+    typedef TypedArray<float> Float32Array;
+    
+    extern template class TypedArray<double>;
+    extern template class TypedArray<float>;
+    
+    ///The TypedArrayFunctions class contains the functions
+    ///for working with typed arrays from gfx.
+    class TypedArrayFunctions
+    {
+    public:
+        
+        ///Adds the functions in the typed array suite to a given stack frame.
+        static void addTo(StackFrame *frame);
+    };
+}
+
+#endif /* defined(__gfx__typedarray__) */
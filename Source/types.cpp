@@ -12,14 +12,95 @@ namespace gfx {
     
 #pragma mark - • Transform2D
     
+#if GFX_Graphics_Use_Raster
+    Transform2D const Transform2D::Identity = NativeAffineTransform{ 1.0, 0.0, 0.0, 1.0, 0.0, 0.0 };
+#else
     Transform2D const Transform2D::Identity = CGAffineTransformIdentity;
+#endif /* GFX_Graphics_Use_Raster */
     
 #pragma mark - Lifecycle
     
-    Transform2D::Transform2D(const CGAffineTransform &other) :
-        CGAffineTransform(other)
+    Transform2D::Transform2D(const NativeAffineTransform &other) :
+        NativeAffineTransform(other)
     {
     }
+
+#if GFX_Graphics_Use_Raster
+
+#pragma mark - Creating New Transformations
+    
+    Transform2D Transform2D::rotate(Float angleInRadians) const
+    {
+        Float sine = std::sin(angleInRadians), cosine = std::cos(angleInRadians);
+        return Transform2D(NativeAffineTransform{ cosine, sine, -sine, cosine, 0.0, 0.0 }).concat(*this);
+    }
+    
+    Transform2D Transform2D::scale(Float scaleX, Float scaleY) const
+    {
+        return Transform2D(NativeAffineTransform{ scaleX, 0.0, 0.0, scaleY, 0.0, 0.0 }).concat(*this);
+    }
+    
+    Transform2D Transform2D::translate(Float translateX, Float translateY) const
+    {
+        return Transform2D(NativeAffineTransform{ 1.0, 0.0, 0.0, 1.0, translateX, translateY }).concat(*this);
+    }
+    
+    Transform2D Transform2D::invert() const
+    {
+        Float determinant = a * d - b * c;
+        if(determinant == 0.0)
+            return *this;
+        
+        return NativeAffineTransform{
+            d / determinant,
+            -b / determinant,
+            -c / determinant,
+            a / determinant,
+            (c * ty - d * tx) / determinant,
+            (b * tx - a * ty) / determinant,
+        };
+    }
+    
+    Transform2D Transform2D::concat(const Transform2D &other) const
+    {
+        return NativeAffineTransform{
+            a * other.a + b * other.c,
+            a * other.b + b * other.d,
+            c * other.a + d * other.c,
+            c * other.b + d * other.d,
+            tx * other.a + ty * other.c + other.tx,
+            tx * other.b + ty * other.d + other.ty,
+        };
+    }
+    
+#pragma mark - Applying the Transformation
+    
+    Point Transform2D::transformPoint(Point point) const
+    {
+        return Point{ a * point.x + c * point.y + tx, b * point.x + d * point.y + ty };
+    }
+    
+    Rect Transform2D::transformRect(Rect rect) const
+    {
+        Point corners[4] = {
+            transformPoint(Point{ rect.getMinX(), rect.getMinY() }),
+            transformPoint(Point{ rect.getMaxX(), rect.getMinY() }),
+            transformPoint(Point{ rect.getMinX(), rect.getMaxY() }),
+            transformPoint(Point{ rect.getMaxX(), rect.getMaxY() }),
+        };
+        
+        Float minX = corners[0].x, maxX = corners[0].x, minY = corners[0].y, maxY = corners[0].y;
+        for (const Point &corner : corners) {
+            minX = std::min(minX, corner.x);
+            maxX = std::max(maxX, corner.x);
+            minY = std::min(minY, corner.y);
+            maxY = std::max(maxY, corner.y);
+        }
+        
+        return Rect{ Point{ minX, minY }, Size{ maxX - minX, maxY - minY } };
+    }
+
+#else
     
 #pragma mark - Creating New Transformations
     
@@ -47,4 +128,18 @@ namespace gfx {
     {
         return CGAffineTransformConcat(*this, other);
     }
+    
+#pragma mark - Applying the Transformation
+    
+    Point Transform2D::transformPoint(Point point) const
+    {
+        return CGPointApplyAffineTransform(point, *this);
+    }
+    
+    Rect Transform2D::transformRect(Rect rect) const
+    {
+        return CGRectApplyAffineTransform(rect, *this);
+    }
+
+#endif /* GFX_Graphics_Use_Raster */
 }
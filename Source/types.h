@@ -9,12 +9,20 @@
 #ifndef gfx_types_h
 #define gfx_types_h
 
-#include <CoreGraphics/CoreGraphics.h>
+#if GFX_Graphics_Use_Raster
+#   include <CoreFoundation/CoreFoundation.h>
+#   include <algorithm>
+#   include <cfloat>
+#   include <cmath>
+#else
+#   include <CoreGraphics/CoreGraphics.h>
+#endif /* GFX_Graphics_Use_Raster */
 
 /*!
- Gfx currently only targets Apple platforms that include the CoreGraphics stack,
- however, to aid in the possibility of Gfx becoming cross platform in the future,
- this file contains generic, namespaced types for various basic things.
+ Gfx targets Apple platforms that include the CoreGraphics stack, and any
+ platform with CoreFoundation through the portable software rasterizer. This
+ file contains generic, namespaced types for various basic things, which are
+ layout compatible with their CoreGraphics counterparts on Apple platforms.
  */
 
 namespace gfx {
@@ -23,9 +31,15 @@ namespace gfx {
     
     ///Platform and architecture independent type The basic type
     ///for all floating point values used in the graphics stack.
+#if GFX_Graphics_Use_Raster
+    typedef double      Float;
+#define GFX_FLOAT_MIN   DBL_MIN
+#define GFX_FLOAT_MAX   DBL_MAX
+#else
     typedef CGFloat     Float;
 #define GFX_FLOAT_MIN   CGFLOAT_MIN
 #define GFX_FLOAT_MAX   CGFLOAT_MAX
+#endif /* GFX_Graphics_Use_Raster */
     
     ///A type for hashes returned by the `Base::hash() const` method.
     typedef CFHashCode  HashCode;
@@ -81,16 +95,39 @@ namespace gfx {
     
     /*! \section    Graphics Types */
     
+#if GFX_Graphics_Use_Raster
+    
+    ///The portable equivalent of `CGPoint`.
+    struct NativePoint { Float x; Float y; };
+    
+    ///The portable equivalent of `CGSize`.
+    struct NativeSize { Float width; Float height; };
+    
+    ///The portable equivalent of `CGRect`.
+    struct NativeRect { NativePoint origin; NativeSize size; };
+    
+    ///The portable equivalent of `CGAffineTransform`.
+    struct NativeAffineTransform { Float a, b, c, d, tx, ty; };
+
+#else
+    
+    typedef CGPoint NativePoint;
+    typedef CGSize NativeSize;
+    typedef CGRect NativeRect;
+    typedef CGAffineTransform NativeAffineTransform;
+
+#endif /* GFX_Graphics_Use_Raster */
+    
     ///A structure that contains a point in a 2 dimensional coordinate system.
     ///
     /// \field  x   The x offset.
     /// \field  y   The y offset.
     ///
-    struct Point : CGPoint
+    struct Point : NativePoint
     {
         ///Constructs an empty point.
         Point() :
-            CGPoint{}
+            NativePoint{}
         {
         }
         
@@ -100,13 +137,13 @@ namespace gfx {
         /// \param  y   The y coordinate.
         ///
         Point(Float x, Float y) :
-            CGPoint{x, y}
+            NativePoint{x, y}
         {
         }
         
         ///Constructs a point with an instance of its superclass.
-        Point(const CGPoint &p) :
-            CGPoint(p)
+        Point(const NativePoint &p) :
+            NativePoint(p)
         {
         }
     };
@@ -116,11 +153,11 @@ namespace gfx {
     /// \field  width   The width of the size.
     /// \field  height  The height of the size.
     ///
-    struct Size : CGSize
+    struct Size : NativeSize
     {
         ///Constructs an empty size.
         Size() :
-            CGSize{}
+            NativeSize{}
         {
         }
         
@@ -128,14 +165,14 @@ namespace gfx {
         ///
         /// \param  width   The width.
         /// \param  height  The height.
-        Size(Float width, float height) :
-            CGSize{width, height}
+        Size(Float width, Float height) :
+            NativeSize{width, height}
         {
         }
         
         ///Constructs a size with an instance of its superclass.
-        Size(const CGSize &s) :
-            CGSize(s)
+        Size(const NativeSize &s) :
+            NativeSize(s)
         {
         }
     };
@@ -145,11 +182,11 @@ namespace gfx {
     /// \field  origin  The coordinates of the shape.
     /// \field  size    The size of the shape.
     ///
-    struct Rect : CGRect
+    struct Rect : NativeRect
     {
         ///Constructs an empty rectangle.
         Rect() :
-            CGRect{}
+            NativeRect{}
         {
         }
         
@@ -159,17 +196,81 @@ namespace gfx {
         /// \param  size    The size.
         ///
         Rect(Point origin, Size size) :
-            CGRect{origin, size}
+            NativeRect{origin, size}
         {
         }
         
         ///Constructs a rectangle with an instance of its superclass.
-        Rect(const CGRect &r) :
-            CGRect(r)
+        Rect(const NativeRect &r) :
+            NativeRect(r)
         {
         }
         
 #pragma mark -
+
+#if GFX_Graphics_Use_Raster
+        
+        ///Returns the width of the rectangle.
+        Float getWidth() const { return std::abs(size.width); }
+        
+        ///Returns the height of the rectangle.
+        Float getHeight() const { return std::abs(size.height); }
+        
+#pragma mark -
+        
+        ///Returns the smallest value for the x coordinate of the rectangle.
+        Float getMinX() const { return std::min(origin.x, origin.x + size.width); }
+        
+        ///Returns the middle value for the x coordinate of the rectangle.
+        Float getMidX() const { return origin.x + size.width / 2.0; }
+        
+        ///Returns the largest value for the x coordinate of the rectangle.
+        Float getMaxX() const { return std::max(origin.x, origin.x + size.width); }
+        
+#pragma mark -
+        
+        ///Returns the smallest value for the y coordinate of the rectangle.
+        Float getMinY() const { return std::min(origin.y, origin.y + size.height); }
+        
+        ///Returns the middle value for the y coordinate of the rectangle.
+        Float getMidY() const { return origin.y + size.height / 2.0; }
+        
+        ///Returns the largest value for the y coordinate of the rectangle.
+        Float getMaxY() const { return std::max(origin.y, origin.y + size.height); }
+        
+#pragma mark -
+        
+        ///Returns whether or not the rectangle has no area.
+        bool isEmpty() const { return size.width == 0.0 || size.height == 0.0; }
+        
+        ///Returns the smallest rectangle containing the receiver and another rectangle.
+        ///
+        ///Empty rectangles are ignored.
+        Rect getUnion(const Rect &other) const
+        {
+            if(other.isEmpty())
+                return *this;
+            else if(isEmpty())
+                return other;
+            
+            Float minX = std::min(getMinX(), other.getMinX()), minY = std::min(getMinY(), other.getMinY());
+            Float maxX = std::max(getMaxX(), other.getMaxX()), maxY = std::max(getMaxY(), other.getMaxY());
+            return Rect{Point{minX, minY}, Size{maxX - minX, maxY - minY}};
+        }
+        
+        ///Returns the area shared by the receiver and another rectangle,
+        ///or an empty rectangle if they do not overlap.
+        Rect getIntersection(const Rect &other) const
+        {
+            Float minX = std::max(getMinX(), other.getMinX()), minY = std::max(getMinY(), other.getMinY());
+            Float maxX = std::min(getMaxX(), other.getMaxX()), maxY = std::min(getMaxY(), other.getMaxY());
+            if(maxX <= minX || maxY <= minY)
+                return Rect{};
+            
+            return Rect{Point{minX, minY}, Size{maxX - minX, maxY - minY}};
+        }
+
+#else
         
         ///Returns the width of the rectangle.
         Float getWidth() const { return CGRectGetWidth(*this); }
@@ -198,10 +299,41 @@ namespace gfx {
         
         ///Returns the largest value for the y coordinate of the rectangle.
         Float getMaxY() const { return CGRectGetMaxY(*this); }
+        
+#pragma mark -
+        
+        ///Returns whether or not the rectangle has no area.
+        bool isEmpty() const { return CGRectIsEmpty(*this); }
+        
+        ///Returns the smallest rectangle containing the receiver and another rectangle.
+        ///
+        ///Empty rectangles are ignored.
+        Rect getUnion(const Rect &other) const
+        {
+            if(other.isEmpty())
+                return *this;
+            else if(isEmpty())
+                return other;
+            
+            return CGRectUnion(*this, other);
+        }
+        
+        ///Returns the area shared by the receiver and another rectangle,
+        ///or an empty rectangle if they do not overlap.
+        Rect getIntersection(const Rect &other) const
+        {
+            CGRect intersection = CGRectIntersection(*this, other);
+            if(CGRectIsEmpty(intersection))
+                return Rect{};
+            
+            return intersection;
+        }
+
+#endif /* GFX_Graphics_Use_Raster */
     };
     
     ///An opaque structure for holding an affine transformation matrix.
-    struct Transform2D : CGAffineTransform
+    struct Transform2D : NativeAffineTransform
     {
         /*! \section    Lifecycle */
         
@@ -227,7 +359,7 @@ namespace gfx {
         static Transform2D const Identity;
         
         ///Constructs a Transform2D from a native affine transform.
-        Transform2D(const CGAffineTransform &other);
+        Transform2D(const NativeAffineTransform &other);
         
         
         /*! \section    Creating New Transformation */
@@ -246,6 +378,27 @@ namespace gfx {
         
         ///Returns a new 2D transform constructed by concating the receiver with another given 2D transform.
         Transform2D concat(const Transform2D &other) const;
+        
+        
+        /*! \section    Applying the Transformation */
+        
+        ///Returns a given point transformed by the receiver.
+        Point transformPoint(Point point) const;
+        
+        ///Returns the smallest rectangle containing a given rectangle transformed by the receiver.
+        Rect transformRect(Rect rect) const;
+        
+        
+        /*! \section    Comparing Transformations */
+        
+        ///Returns whether or not the receiver and another transform have identical components.
+        bool operator==(const Transform2D &other) const
+        {
+            return (a == other.a && b == other.b && c == other.c &&
+                    d == other.d && tx == other.tx && ty == other.ty);
+        }
+        
+        bool operator!=(const Transform2D &other) const { return !(*this == other); }
     };
     
 #endif /* GFX_Include_GraphicsStack */
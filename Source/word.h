@@ -12,6 +12,7 @@
 #include "base.h"
 #include "str.h"
 #include "offset.h"
+#include <atomic>
 
 namespace gfx {
     ///The Word class encapsulates words as they are defined by the Gfx Forth-derived language.
@@ -23,12 +24,16 @@ namespace gfx {
         ///Where the word originated.
         Offset mOffset;
         
+        ///The value a word handler resolved the word to, or null.
+        mutable std::atomic<Base *> mResolvedValue;
+        
     public:
         
         ///Constructs the receiver with a given string, and offset origin.
         Word(String *inString, Offset offset) :
             mString(retained(inString)),
-            mOffset(offset)
+            mOffset(offset),
+            mResolvedValue(nullptr)
         {
         }
         
@@ -36,6 +41,7 @@ namespace gfx {
         virtual ~Word()
         {
             released(mString);
+            released(mResolvedValue.load());
         }
         
         ///Returns the string of the receiver.
@@ -50,6 +56,34 @@ namespace gfx {
             return mOffset;
         }
         
+#pragma mark - Resolved Values
+        
+        ///Returns the value a word handler resolved the receiver to, or null.
+        ///
+        ///Word handlers that always turn a word into the same value, such as the
+        ///color literals of the graphics stack, keep the value on the word so that
+        ///each word in a script is only resolved once.
+        Base *resolvedValue() const
+        {
+            return mResolvedValue.load();
+        }
+        
+        ///Sets the value the receiver resolves to, if it does not have one yet.
+        ///
+        /// \param  value   The value. Required.
+        ///
+        /// \result The value the receiver resolves to, which is not `value`
+        ///         if another thread resolved the receiver first.
+        Base *setResolvedValue(Base *value) const
+        {
+            Base *existingValue = nullptr;
+            if(mResolvedValue.compare_exchange_strong(existingValue, retained(value)))
+                return value;
+            
+            released(value);
+            return existingValue;
+        }
+        
 #pragma mark - Identity
         
         virtual HashCode hash() const override
@@ -0,0 +1,293 @@
+//
+//  cache_tests.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/14/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#include "t11.h"
+#include <gfx/gfx.h>
+#include <gfx/lrucache.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#if GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster
+#   include <gfx/raster.h>
+#   include <gfx/path.h>
+#   include <gfx/font.h>
+#   include <gfx/attributedstr.h>
+#   include <gfx/file.h>
+#endif /* GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster */
+
+namespace {
+    using namespace gfx;
+    
+    ///Returns whether or not a cache holds a value for a given key, without creating one.
+    static bool Contains(LRUCache<int, std::string> &cache, int key)
+    {
+        std::string value;
+        return cache.find(key, value);
+    }
+    
+    T11Suite(lrucache, [](T11::Suite &s) {
+        s.test("evicts the least recently used value", [](T11::Test &t) {
+            LRUCache<int, std::string> cache(3);
+            cache.insert(1, "one");
+            cache.insert(2, "two");
+            cache.insert(3, "three");
+            
+            std::string value;
+            t.is_true(cache.find(1, value));
+            t.equal(value, std::string("one"));
+            
+            cache.insert(4, "four");
+            t.equal(cache.count(), size_t(3));
+            t.is_true(Contains(cache, 1));
+            t.is_false(Contains(cache, 2));
+            t.is_true(Contains(cache, 3));
+            t.is_true(Contains(cache, 4));
+        });
+        
+        s.test("evicts values to fit their cost", [](T11::Test &t) {
+            LRUCache<int, std::string> cache(100, 10);
+            cache.insert(1, "one", 4);
+            cache.insert(2, "two", 4);
+            cache.insert(3, "three", 4);
+            t.equal(cache.count(), size_t(2));
+            t.is_false(Contains(cache, 1));
+            
+            cache.insert(4, "four", 11);
+            t.is_false(Contains(cache, 4));
+            t.equal(cache.count(), size_t(2));
+            
+            cache.setMaximumCost(5);
+            t.equal(cache.maximumCost(), size_t(5));
+            t.equal(cache.count(), size_t(1));
+            t.is_true(Contains(cache, 3));
+            
+            cache.setMaximumCost(0);
+            t.equal(cache.count(), size_t(0));
+        });
+        
+        s.test("keeps the first value for a key", [](T11::Test &t) {
+            LRUCache<int, std::string> cache(3);
+            cache.insert(1, "one");
+            cache.insert(1, "uno");
+            
+            std::string value;
+            t.is_true(cache.find(1, value));
+            t.equal(value, std::string("one"));
+            t.equal(cache.count(), size_t(1));
+        });
+        
+        s.test("creates values once", [](T11::Test &t) {
+            LRUCache<int, std::string> cache(3);
+            int creations = 0;
+            auto create = [&creations] {
+                creations++;
+                return std::string("created");
+            };
+            
+            t.equal(cache.valueFor(1, create), std::string("created"));
+            t.equal(cache.valueFor(1, create), std::string("created"));
+            t.equal(creations, 1);
+            
+            cache.insert(2, "two");
+            cache.insert(3, "three");
+            cache.valueFor(1, create);
+            cache.insert(4, "four");
+            t.is_true(Contains(cache, 1));
+            t.is_false(Contains(cache, 2));
+            t.equal(creations, 1);
+        });
+    });
+    
+#if GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster
+    
+    ///Returns the pixels of a drawing made in a new bitmap context.
+    ///
+    /// \result A new surface with a retain count of 1.
+    static raster::Surface *Draw(const std::function<void()> &functor)
+    {
+        Context *context = Context::bitmapContextWith(Size(64.0, 64.0), 1.0);
+        Context::pushContext(context);
+        functor();
+        Context::popContext();
+        
+        return context->get()->surface()->retain();
+    }
+    
+    ///Returns whether or not two drawings produce the same pixels.
+    static bool DrawsEqually(const std::function<void()> &functor, const std::function<void()> &otherFunctor)
+    {
+        raster::Surface *surface = Draw(functor);
+        raster::Surface *otherSurface = Draw(otherFunctor);
+        bool isEqual = surface->isEqual(otherSurface);
+        surface->release();
+        otherSurface->release();
+        return isEqual;
+    }
+    
+    ///Returns whether or not a drawing leaves every pixel transparent.
+    static bool DrawsNothing(const std::function<void()> &functor)
+    {
+        return DrawsEqually(functor, [] {});
+    }
+    
+    ///Writes a PNG of a square surface of a given size and color to a path.
+    static void WriteImage(const String *path, size_t size, uint32_t color)
+    {
+        raster::Surface *surface = new raster::Surface(size, size);
+        for (size_t index = 0; index < size * size; index++)
+            surface->pixels()[index] = color;
+        
+        File *file = make<File>(path, File::Mode::Write);
+        make<Image>(surface)->writeRepresentation(Image::RepresentationType::PNG, file);
+        file->close();
+    }
+    
+    ///Returns the path of a scratch image file.
+    static const String *ScratchImagePath()
+    {
+        const char *directory = getenv("TMPDIR");
+        String::Builder path;
+        path << (directory? directory : "/tmp") << "/gfx-cache-tests.png";
+        return path;
+    }
+    
+    T11Suite(caches, [](T11::Suite &s) {
+        s.setup([] {
+            Session::init(0, nullptr);
+        });
+        
+        s.test("constructed paths are independent copies", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            Rect rect = { {8.0, 8.0}, {40.0, 30.0} };
+            Path *path = Path::withOval(rect);
+            Path *otherPath = Path::withOval(rect);
+            t.is_true(path != otherPath);
+            t.is_true(path->isEqual(otherPath));
+            
+            path->lineToPoint(Point(60.0, 60.0));
+            t.is_false(path->isEqual(otherPath));
+            t.is_true(Path::withOval(rect)->isEqual(otherPath));
+            
+            t.is_true(DrawsEqually([rect] { Path::withRoundedRect(rect, 5.0, 5.0)->fill(); },
+                                   [rect] { Path::withRoundedRect(rect, 5.0, 5.0)->fill(); }));
+        });
+        
+        s.test("constructed paths with non-finite parameters", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            Rect rect = { {NAN, 0.0}, {10.0, 10.0} };
+            Path *path = Path::withRect(rect);
+            Path *otherPath = Path::withRect(rect);
+            t.is_true(path != otherPath);
+            t.is_true(DrawsNothing([rect] { Path::withOval(rect)->fill(); }));
+        });
+        
+        s.test("colors with the same values are shared", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            Color *color = Color::withRGBA(0.2, 0.4, 0.6, 1.0);
+            t.is_true(color == Color::withRGBA(0.2, 0.4, 0.6, 1.0));
+            t.is_true(color != Color::withRGBA(0.2, 0.4, 0.6, 0.5));
+            t.is_true(Color::withHTMLString(str("#ff0000")) == Color::withRGBA(1.0, 0.0, 0.0, 1.0));
+            
+            Color *nanColor = Color::withRGBA(NAN, 0.0, 0.0, 1.0);
+            t.is_true(nanColor != Color::withRGBA(NAN, 0.0, 0.0, 1.0));
+        });
+        
+        s.test("gradients with the same stops draw equally", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            auto drawGradient = [] {
+                Array<Color> *colors = make<Array<Color>>(std::vector<Color *>{ Color::red(), Color::blue() });
+                Gradient *gradient = make<Gradient>(colors, std::vector<Float>{ 0.0, 1.0 }, Gradient::DrawingInformation(Float(90.0)));
+                gradient->drawInRect(Rect{ {}, {64.0, 64.0} });
+            };
+            t.is_false(DrawsNothing(drawGradient));
+            t.is_true(DrawsEqually(drawGradient, drawGradient));
+            
+            Array<Color> *colors = make<Array<Color>>(std::vector<Color *>{ Color::red(), Color::blue() });
+            Gradient *gradient = make<Gradient>(colors, std::vector<Float>{ 0.0, 1.0 }, Gradient::DrawingInformation(Float(90.0)));
+            Gradient *otherGradient = make<Gradient>(colors, std::vector<Float>{ 0.0, 1.0 }, Gradient::DrawingInformation(Float(90.0)));
+            t.is_true(gradient->isEqual(otherGradient));
+        });
+        
+        s.test("text sizes are stable", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            TextAttributes *attributes = make<TextAttributes>();
+            attributes->setFont(Font::regular(14.0));
+            attributes->setForegroundColor(Color::black());
+            AttributedString *string = make<AttributedString>(str("The quick brown fox jumps over the lazy dog"), attributes);
+            
+            Size size = string->size(LineBreakMode::WordWrap);
+            t.is_true(size.width > 0.0 && size.height > 0.0);
+            
+            Size otherSize = make<AttributedString>(string)->size(LineBreakMode::WordWrap);
+            t.is_true(size.width == otherSize.width && size.height == otherSize.height);
+            
+            Size wrappedSize = string->size(LineBreakMode::WordWrap, Size(100.0, GFX_FLOAT_MAX));
+            t.is_true(wrappedSize.height > size.height);
+            
+            Size nanSize = string->size(LineBreakMode::WordWrap, Size(NAN, NAN));
+            Size otherNaNSize = string->size(LineBreakMode::WordWrap, Size(NAN, NAN));
+            t.is_true(nanSize.width == otherNaNSize.width && nanSize.height == otherNaNSize.height);
+        });
+        
+        s.test("decoded images are shared", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            const String *path = ScratchImagePath();
+            WriteImage(path, 32, raster::pixel(200, 40, 90, 255));
+            
+            auto drawImage = [path] {
+                Image *image = Image::withFile(make<File>(path, File::Mode::Read));
+                image->drawInRect(Rect{ {}, {64.0, 64.0} });
+            };
+            t.is_false(DrawsNothing(drawImage));
+            t.is_true(DrawsEqually(drawImage, drawImage));
+            
+            size_t budget = Image::decodeCacheBudget();
+            Image::setDecodeCacheBudget(0);
+            t.equal(Image::decodeCacheBudget(), size_t(0));
+            t.is_true(DrawsEqually(drawImage, [path] {
+                Image *image = Image::withFile(make<File>(path, File::Mode::Read));
+                image->drawInRect(Rect{ {}, {64.0, 64.0} });
+            }));
+            Image::setDecodeCacheBudget(budget);
+            
+            std::remove(path->getCString());
+        });
+        
+        s.test("rewritten images are decoded again", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            const String *path = ScratchImagePath();
+            auto drawImage = [path] {
+                Image *image = Image::withFile(make<File>(path, File::Mode::Read));
+                image->drawInRect(Rect{ {}, {64.0, 64.0} });
+            };
+            
+            WriteImage(path, 32, raster::pixel(200, 40, 90, 255));
+            raster::Surface *surface = Draw(drawImage);
+            
+            WriteImage(path, 48, raster::pixel(0, 0, 255, 255));
+            raster::Surface *rewrittenSurface = Draw(drawImage);
+            t.is_false(surface->isEqual(rewrittenSurface));
+            t.equal(rewrittenSurface->row(32)[32], raster::pixel(0, 0, 255, 255));
+            
+            surface->release();
+            rewrittenSurface->release();
+            std::remove(path->getCString());
+        });
+    });
+    
+#endif /* GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster */
+}
@@ -0,0 +1,242 @@
+//
+//  codec_tests.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/14/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#include "t11.h"
+#include <gfx/gfx_defines.h>
+
+#if GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster
+
+#include <gfx/raster.h>
+#include <cstring>
+#include <vector>
+
+namespace {
+    using namespace gfx;
+    using namespace gfx::raster;
+    
+    ///Creates a surface with gradients, noise, runs of equal pixels, and translucent regions.
+    ///
+    /// \result A new surface with a retain count of 1.
+    ///
+    ///Samples are premultiplied with the same rounding the PNG decoder uses,
+    ///so that decoding an encoded copy of the surface reproduces it exactly.
+    static Surface *MakeTestSurface(size_t width, size_t height)
+    {
+        Surface *surface = new Surface(width, height);
+        uint32_t state = 0x2545F491;
+        for (size_t y = 0; y < height; y++) {
+            uint32_t *row = surface->row(y);
+            for (size_t x = 0; x < width; x++) {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                
+                uint32_t red, green, blue, alpha;
+                switch ((y / 16) % 4) {
+                    case 0: //Smooth gradients, which suit the diff operations of QOI.
+                        red = x & 0xFF;
+                        green = y & 0xFF;
+                        blue = (x + y) & 0xFF;
+                        alpha = 255;
+                        break;
+                    
+                    case 1: //Runs of a single color.
+                        red = 200;
+                        green = 40;
+                        blue = 90;
+                        alpha = (x < width / 2)? 255 : 0;
+                        break;
+                    
+                    case 2: //Noise, which exercises the literal operations.
+                        red = state & 0xFF;
+                        green = (state >> 8) & 0xFF;
+                        blue = (state >> 16) & 0xFF;
+                        alpha = 255;
+                        break;
+                    
+                    default: //Translucent noise.
+                        red = state & 0xFF;
+                        green = (state >> 8) & 0xFF;
+                        blue = (state >> 16) & 0xFF;
+                        alpha = (state >> 24) & 0xFF;
+                        break;
+                }
+                
+                row[x] = pixel((red * alpha + 127) / 255, (green * alpha + 127) / 255, (blue * alpha + 127) / 255, alpha);
+            }
+        }
+        
+        return surface;
+    }
+    
+    ///Returns the bytes of a given encoder.
+    static std::vector<uint8_t> Encode(bool (*encoder)(const Surface *, const EncodedBytesFunctor &), const Surface *surface)
+    {
+        std::vector<uint8_t> data;
+        encoder(surface, [&data](const uint8_t *bytes, size_t length) {
+            data.insert(data.end(), bytes, bytes + length);
+            return true;
+        });
+        return data;
+    }
+    
+    ///Returns the bytes of a PNG encoded with a given set of options.
+    static std::vector<uint8_t> EncodePNG(const Surface *surface, const PNGEncodingOptions &options)
+    {
+        std::vector<uint8_t> data;
+        encodePNG(surface, options, [&data](const uint8_t *bytes, size_t length) {
+            data.insert(data.end(), bytes, bytes + length);
+            return true;
+        });
+        return data;
+    }
+    
+    ///Returns whether or not a PNG decodes into pixels equal to those of a surface.
+    static bool DecodesInto(const std::vector<uint8_t> &data, const Surface *surface)
+    {
+        Surface *decoded = decodePNG(data.data(), data.size());
+        if(!decoded)
+            return false;
+        
+        bool isEqual = decoded->isEqual(surface);
+        decoded->release();
+        return isEqual;
+    }
+    
+    ///Decodes a Quite OK Image into unpremultiplied RGBA bytes, following the reference decoder.
+    ///
+    /// \result true if the image was well formed and of the expected size; false otherwise.
+    static bool DecodeQOI(const std::vector<uint8_t> &data, size_t width, size_t height, std::vector<uint8_t> &outPixels)
+    {
+        static const uint8_t kEndMarker[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+        if(data.size() < 14 + sizeof(kEndMarker) || memcmp(data.data(), "qoif", 4) != 0)
+            return false;
+        
+        auto readUInt32 = [&data](size_t offset) {
+            return (uint32_t(data[offset]) << 24) | (uint32_t(data[offset + 1]) << 16) | (uint32_t(data[offset + 2]) << 8) | uint32_t(data[offset + 3]);
+        };
+        if(readUInt32(4) != width || readUInt32(8) != height || data[12] != 4)
+            return false;
+        
+        uint8_t index[64][4] = {};
+        uint8_t pixel[4] = { 0, 0, 0, 255 };
+        size_t position = 14, end = data.size() - sizeof(kEndMarker), run = 0;
+        outPixels.clear();
+        for (size_t count = 0; count < width * height; count++) {
+            if(run > 0) {
+                run--;
+            } else {
+                if(position >= end)
+                    return false;
+                
+                uint8_t operation = data[position++];
+                if(operation == 0xFE) {
+                    pixel[0] = data[position++];
+                    pixel[1] = data[position++];
+                    pixel[2] = data[position++];
+                } else if(operation == 0xFF) {
+                    memcpy(pixel, &data[position], 4);
+                    position += 4;
+                } else if((operation & 0xC0) == 0x00) {
+                    memcpy(pixel, index[operation], 4);
+                } else if((operation & 0xC0) == 0x40) {
+                    pixel[0] += ((operation >> 4) & 0x03) - 2;
+                    pixel[1] += ((operation >> 2) & 0x03) - 2;
+                    pixel[2] += (operation & 0x03) - 2;
+                } else if((operation & 0xC0) == 0x80) {
+                    uint8_t next = data[position++];
+                    int green = (operation & 0x3F) - 32;
+                    pixel[0] += green - 8 + ((next >> 4) & 0x0F);
+                    pixel[1] += green;
+                    pixel[2] += green - 8 + (next & 0x0F);
+                } else {
+                    run = (operation & 0x3F);
+                }
+                
+                memcpy(index[(pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64], pixel, 4);
+            }
+            
+            outPixels.insert(outPixels.end(), pixel, pixel + 4);
+        }
+        
+        return (run == 0 && position == end && memcmp(&data[end], kEndMarker, sizeof(kEndMarker)) == 0);
+    }
+    
+    T11Suite(codecs, [](T11::Suite &s) {
+        s.test("png round trip", [](T11::Test &t) {
+            //The tall surface is split into several bands which are compressed concurrently.
+            const size_t sizes[][2] = { { 1, 1 }, { 3, 2 }, { 64, 64 }, { 320, 700 } };
+            for (const auto &size : sizes) {
+                Surface *surface = MakeTestSurface(size[0], size[1]);
+                
+                std::vector<uint8_t> data;
+                t.is_true(encodePNG(surface, data));
+                t.is_true(DecodesInto(data, surface));
+                
+                surface->release();
+            }
+        });
+        
+        s.test("png round trip with every option", [](T11::Test &t) {
+            const PNGFilter filters[] = {
+                PNGFilter::Adaptive, PNGFilter::None, PNGFilter::Sub,
+                PNGFilter::Up, PNGFilter::Average, PNGFilter::Paeth,
+            };
+            const int levels[] = { -1, 0, 1, 9 };
+            
+            Surface *surface = MakeTestSurface(320, 700);
+            for (PNGFilter filter : filters) {
+                for (int level : levels)
+                    t.is_true(DecodesInto(EncodePNG(surface, PNGEncodingOptions{ level, filter }), surface));
+            }
+            surface->release();
+        });
+        
+        s.test("png encoding is deterministic", [](T11::Test &t) {
+            Surface *surface = MakeTestSurface(320, 700);
+            std::vector<uint8_t> first = EncodePNG(surface, PNGEncodingOptions{ -1, PNGFilter::Adaptive });
+            for (int run = 0; run < 4; run++)
+                t.is_true(EncodePNG(surface, PNGEncodingOptions{ -1, PNGFilter::Adaptive }) == first);
+            
+            std::vector<uint8_t> data;
+            encodePNG(surface, data);
+            t.is_true(data == first);
+            
+            surface->release();
+        });
+        
+        s.test("qoi round trip", [](T11::Test &t) {
+            const size_t sizes[][2] = { { 1, 1 }, { 3, 2 }, { 64, 64 }, { 320, 700 } };
+            for (const auto &size : sizes) {
+                Surface *surface = MakeTestSurface(size[0], size[1]);
+                
+                std::vector<uint8_t> decoded;
+                t.is_true(DecodeQOI(Encode(&encodeQOI, surface), size[0], size[1], decoded));
+                t.is_true(decoded == Encode(&encodeRGBA, surface));
+                
+                surface->release();
+            }
+        });
+        
+        s.test("qoi runs longer than an operation", [](T11::Test &t) {
+            //Every pixel matches the initial previous pixel of the format, so
+            //the image is made up entirely of runs, including a partial one.
+            Surface *surface = new Surface(100, 3);
+            for (size_t index = 0; index < 300; index++)
+                surface->pixels()[index] = pixel(0, 0, 0, 255);
+            
+            std::vector<uint8_t> decoded;
+            t.is_true(DecodeQOI(Encode(&encodeQOI, surface), 100, 3, decoded));
+            t.is_true(decoded == Encode(&encodeRGBA, surface));
+            
+            surface->release();
+        });
+    });
+}
+
+#endif /* GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster */
@@ -0,0 +1,109 @@
+//
+//  noise_tests.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/14/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#include "t11.h"
+#include <gfx/noise.h>
+#include <cmath>
+#include <vector>
+
+namespace {
+    using namespace gfx;
+    
+    static const noise::Basis kBases[] = { noise::Basis::Value, noise::Basis::Perlin, noise::Basis::Simplex };
+    
+    T11Suite(noise, [](T11::Suite &s) {
+        s.test("random sequences are reproducible", [](T11::Test &t) {
+            noise::Random first(1234), second(1234), other(4321);
+            bool sameSequence = true, otherDiffers = false;
+            for (int index = 0; index < 1000; index++) {
+                uint32_t value = first.next();
+                sameSequence = sameSequence && (value == second.next());
+                otherDiffers = otherDiffers || (value != other.next());
+            }
+            t.is_true(sameSequence);
+            t.is_true(otherDiffers);
+        });
+        
+        s.test("random sequences may be started anywhere", [](T11::Test &t) {
+            std::vector<uint32_t> sequence(1000);
+            noise::Random(99).fill(sequence.data(), sequence.size());
+            
+            noise::Random middle(99, 500);
+            bool matches = true;
+            for (size_t index = 500; index < sequence.size(); index++)
+                matches = matches && (middle.next() == sequence[index]);
+            t.is_true(matches);
+        });
+        
+        s.test("random ranges are inclusive", [](T11::Test &t) {
+            noise::Random random(7);
+            bool inRange = true, sawMaximum = false;
+            for (int index = 0; index < 10000; index++) {
+                uint32_t value = random.nextInRange(9);
+                inRange = inRange && (value <= 9);
+                sawMaximum = sawMaximum || (value == 9);
+            }
+            t.is_true(inRange);
+            t.is_true(sawMaximum);
+            t.equal(noise::Random(7).nextInRange(0), uint32_t(0));
+        });
+        
+        s.test("samples are deterministic and bounded", [](T11::Test &t) {
+            for (noise::Basis basis : kBases) {
+                bool deterministic = true, bounded = true, seedsDiffer = false;
+                for (int index = 0; index < 2000; index++) {
+                    double x = index * 0.173, y = index * 0.291 - 40.0;
+                    double value = noise::fractal(basis, x, y, 4, 42);
+                    deterministic = deterministic && (value == noise::fractal(basis, x, y, 4, 42));
+                    bounded = bounded && (value >= -1.0 && value <= 1.0);
+                    seedsDiffer = seedsDiffer || (value != noise::fractal(basis, x, y, 4, 43));
+                }
+                t.is_true(deterministic);
+                t.is_true(bounded);
+                t.is_true(seedsDiffer);
+            }
+        });
+        
+        s.test("parallel white noise matches a serial fill", [](T11::Test &t) {
+            const size_t width = 317, height = 211;
+            std::vector<uint8_t> pixels(width * height * 4, 0);
+            noise::fillWhite(pixels.data(), width, height, width * 4, 4, 3, 200, 2014);
+            
+            //Every row continues the sequence where the row above it ended.
+            noise::Random random(2014);
+            bool matches = true, othersUntouched = true;
+            for (size_t index = 0; index < width * height; index++) {
+                matches = matches && (pixels[index * 4 + 3] == random.nextInRange(200));
+                othersUntouched = othersUntouched && (pixels[index * 4] == 0 && pixels[index * 4 + 1] == 0 && pixels[index * 4 + 2] == 0);
+            }
+            t.is_true(matches);
+            t.is_true(othersUntouched);
+        });
+        
+        s.test("parallel coherent noise matches a serial fill", [](T11::Test &t) {
+            const size_t width = 129, height = 97;
+            for (noise::Basis basis : kBases) {
+                std::vector<uint8_t> pixels(width * height, 0);
+                noise::fillCoherent(pixels.data(), width, height, width, basis, 16.0, 3, 77);
+                
+                std::vector<uint8_t> again(width * height, 0);
+                noise::fillCoherent(again.data(), width, height, width, basis, 16.0, 3, 77);
+                t.is_true(pixels == again);
+                
+                bool matches = true;
+                for (size_t row = 0; row < height; row++) {
+                    for (size_t column = 0; column < width; column++) {
+                        double value = noise::fractal(basis, (column + 0.5) / 16.0, (row + 0.5) / 16.0, 3, 77);
+                        matches = matches && (pixels[row * width + column] == uint8_t(std::lround((value + 1.0) * 127.5)));
+                    }
+                }
+                t.is_true(matches);
+            }
+        });
+    });
+}
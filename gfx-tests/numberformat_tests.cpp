@@ -0,0 +1,119 @@
+//
+//  numberformat_tests.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/14/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#include "t11.h"
+#include <gfx/numberformat.h>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+    using namespace gfx;
+    
+    ///Returns whether or not two doubles have the same bits.
+    static bool SameDouble(double left, double right)
+    {
+        return memcmp(&left, &right, sizeof(double)) == 0;
+    }
+    
+    ///Formats a value, and parses it back.
+    static double RoundTrip(double value)
+    {
+        char buffer[numberformat::kFormatBufferSize];
+        size_t length = numberformat::formatDouble(value, buffer);
+        return numberformat::parseDouble(buffer, length);
+    }
+    
+    ///Returns a formatted value as a string.
+    static std::string Format(double value)
+    {
+        char buffer[numberformat::kFormatBufferSize];
+        size_t length = numberformat::formatDouble(value, buffer);
+        return std::string(buffer, length);
+    }
+    
+    T11Suite(numberformat, [](T11::Suite &s) {
+        s.test("shortest formatting", [](T11::Test &t) {
+            t.equal(Format(42.0), std::string("42"));
+            t.equal(Format(-7.0), std::string("-7"));
+            t.equal(Format(0.0), std::string("0"));
+            t.equal(Format(-0.0), std::string("-0"));
+            t.equal(Format(0.1), std::string("0.1"));
+            t.equal(Format(1.5), std::string("1.5"));
+            t.equal(Format(1e21), std::string("1e+21"));
+            t.equal(Format(0.1 + 0.2), std::string("0.30000000000000004"));
+        });
+        
+        s.test("round trip of edge values", [](T11::Test &t) {
+            const double values[] = {
+                0.0, -0.0, 1.0, -1.0, 0.1, 1.0 / 3.0, 2.0 / 3.0, M_PI, M_E,
+                123456789012345.0, 1e15, 1e16, 9007199254740993.0, 1e22, 1e23,
+                DBL_MAX, -DBL_MAX, DBL_MIN, DBL_EPSILON, 4.9e-324, 2.2250738585072009e-308,
+            };
+            for (double value : values)
+                t.is_true(SameDouble(RoundTrip(value), value));
+        });
+        
+        s.test("round trip of random values", [](T11::Test &t) {
+            //The bit patterns are generated with a fixed seed so failures are reproducible.
+            uint64_t state = 0x9E3779B97F4A7C15ULL;
+            size_t failures = 0;
+            for (int index = 0; index < 100000; index++) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                
+                double value;
+                memcpy(&value, &state, sizeof(value));
+                if(!std::isfinite(value))
+                    continue;
+                
+                if(!SameDouble(RoundTrip(value), value))
+                    failures++;
+            }
+            t.equal(failures, size_t(0));
+        });
+        
+        s.test("formatting of non-finite values", [](T11::Test &t) {
+            t.equal(Format(INFINITY), std::string("inf"));
+            t.equal(Format(-INFINITY), std::string("-inf"));
+            t.equal(Format(NAN), std::string("nan"));
+        });
+        
+        s.test("parsing", [](T11::Test &t) {
+            size_t consumed = 0;
+            t.equal(numberformat::parseDouble("1_000_000", 9, &consumed), 1000000.0);
+            t.equal(consumed, size_t(9));
+            
+            t.equal(numberformat::parseDouble("-2.5e3 rest", 11, &consumed), -2500.0);
+            t.equal(consumed, size_t(6));
+            
+            t.equal(numberformat::parseDouble("+0.125", 6, &consumed), 0.125);
+            t.equal(consumed, size_t(6));
+            
+            t.equal(numberformat::parseDouble("word", 4, &consumed), 0.0);
+            t.equal(consumed, size_t(0));
+        });
+        
+        s.test("parsing code units", [](T11::Test &t) {
+            const char *sources[] = { "42", "-0.5", "6.02214076e23", "1_024.75", "3.14159 pi" };
+            for (const char *source : sources) {
+                size_t length = strlen(source);
+                std::vector<uint16_t> codeUnits(source, source + length);
+                
+                size_t consumed = 0, codeUnitsConsumed = 0;
+                double value = numberformat::parseDouble(source, length, &consumed);
+                double codeUnitsValue = numberformat::parseDouble(codeUnits.data(), codeUnits.data() + codeUnits.size(), &codeUnitsConsumed);
+                t.is_true(SameDouble(value, codeUnitsValue));
+                t.equal(consumed, codeUnitsConsumed);
+            }
+        });
+    });
+}
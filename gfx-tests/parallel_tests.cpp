@@ -0,0 +1,143 @@
+//
+//  parallel_tests.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/14/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#include "t11.h"
+#include <gfx/gfx.h>
+#include <gfx/threading.h>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+    using namespace gfx;
+    
+    ///Returns a vector of the numbers in `[0, count)`.
+    static Array<Base> *Numbers(Index count)
+    {
+        Array<Base> *numbers = make<Array<Base>>();
+        for (Index index = 0; index < count; index++)
+            numbers->append(make<Number>(index));
+        
+        return numbers;
+    }
+    
+    ///Applies a vector word to a vector with a given function, yielding its result.
+    static Base *Apply(Interpreter *interpreter, Array<Base> *vector, const char *function, const char *word)
+    {
+        StackFrame *frame = make<StackFrame>(interpreter->rootFrame(), interpreter);
+        frame->push(vector);
+        
+        String::Builder source;
+        source << function << " " << word;
+        interpreter->eval(frame, Parser(source).parse());
+        
+        return frame->pop();
+    }
+    
+    T11Suite(parallel, [](T11::Suite &s) {
+        s.setup([] {
+            Session::init(0, nullptr);
+        });
+        
+        s.test("parallelFor visits every index once", [](T11::Test &t) {
+            const size_t count = 100000;
+            std::unique_ptr<std::atomic<int>[]> visits(new std::atomic<int>[count]);
+            for (size_t index = 0; index < count; index++)
+                visits[index] = 0;
+            
+            std::atomic<bool> workersInRange(true);
+            threading::parallelFor(count, [&](size_t index, size_t worker) {
+                visits[index]++;
+                if(worker >= threading::concurrency())
+                    workersInRange = false;
+            });
+            
+            bool visitedOnce = true;
+            for (size_t index = 0; index < count; index++)
+                visitedOnce = visitedOnce && (visits[index] == 1);
+            t.is_true(visitedOnce);
+            t.is_true(workersInRange.load());
+        });
+        
+        s.test("parallelFor rethrows", [](T11::Test &t) {
+            t.throws([] {
+                threading::parallelFor(1000, [](size_t index, size_t) {
+                    if(index == 500)
+                        throw std::runtime_error("expected");
+                });
+            });
+        });
+        
+        s.test("pmap is deterministic", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            Interpreter *interpreter = make<Interpreter>();
+            Array<Base> *numbers = Numbers(10000);
+            Base *expected = Apply(interpreter, numbers, "{ 3 * 1 + }", "vec/map");
+            for (int run = 0; run < 8; run++) {
+                AutoreleasePool runPool;
+                
+                Base *result = Apply(interpreter, numbers, "{ 3 * 1 + }", "vec/pmap");
+                t.is_true(result->isEqual(expected));
+            }
+        });
+        
+        s.test("pfilter is deterministic", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            Interpreter *interpreter = make<Interpreter>();
+            Array<Base> *numbers = Numbers(10000);
+            Base *expected = Apply(interpreter, numbers, "{ 0.5 * math/sin 0 > }", "vec/filter");
+            for (int run = 0; run < 8; run++) {
+                AutoreleasePool runPool;
+                
+                Base *result = Apply(interpreter, numbers, "{ 0.5 * math/sin 0 > }", "vec/pfilter");
+                t.is_true(result->isEqual(expected));
+            }
+        });
+        
+        s.test("parallel applications only see their item", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            Interpreter *interpreter = make<Interpreter>();
+            Array<Base> *numbers = Numbers(1000);
+            t.throws([interpreter, numbers] {
+                Apply(interpreter, numbers, "{ + }", "vec/pmap");
+            });
+        });
+        
+        s.test("parallel applications cannot change enclosing bindings", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            Interpreter *interpreter = make<Interpreter>();
+            Array<Base> *numbers = Numbers(1000);
+            t.throws([interpreter, numbers] {
+                Apply(interpreter, numbers, "0 =>total { =>item item total + =>total item }", "vec/pmap");
+            });
+            
+            StackFrame *frame = make<StackFrame>(interpreter->rootFrame(), interpreter);
+            frame->push(numbers);
+            try {
+                interpreter->eval(frame, Parser(str("0 =>total { =>item item total + =>total item } vec/peach")).parse());
+            } catch (Exception &e) {
+                //Expected, the body assigns to an enclosing binding.
+            }
+            t.is_true(frame->bindingValue(str("total"))->isEqual(make<Number>(0)));
+        });
+        
+        s.test("parallel applications may bind their own variables", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            Interpreter *interpreter = make<Interpreter>();
+            Array<Base> *numbers = Numbers(1000);
+            Base *expected = Apply(interpreter, numbers, "{ 2 * }", "vec/map");
+            Base *result = Apply(interpreter, numbers, "{ =>item item item + }", "vec/pmap");
+            t.is_true(result->isEqual(expected));
+        });
+    });
+}
@@ -0,0 +1,268 @@
+//
+//  persistent_tests.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/14/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#include "t11.h"
+#include <gfx/persistent.h>
+#include <memory>
+#include <set>
+#include <vector>
+
+namespace {
+    using namespace gfx;
+    
+    ///A reference counted integer which satisfies the requirements of the persistent containers.
+    struct Counted
+    {
+        int value;
+        int retainCount;
+        
+        explicit Counted(int inValue) :
+            value(inValue),
+            retainCount(1)
+        {
+        }
+        
+        void retain() { retainCount++; }
+        void release() { retainCount--; }
+        bool isEqual(const Counted *other) const { return value == other->value; }
+    };
+    
+    ///A pool of `Counted` values which are only destroyed with the pool.
+    ///Values are never freed by their containers, so a leak or an over
+    ///release shows up as a retain count other than 1 once containers
+    ///are destroyed.
+    class Pool
+    {
+        std::vector<std::unique_ptr<Counted>> mValues;
+    
+    public:
+        
+        Counted *make(int value)
+        {
+            mValues.emplace_back(new Counted(value));
+            return mValues.back().get();
+        }
+        
+        bool isBalanced() const
+        {
+            for (const auto &value : mValues) {
+                if(value->retainCount != 1)
+                    return false;
+            }
+            
+            return true;
+        }
+    };
+    
+    typedef persistent::Vector<Counted> Vector;
+    typedef persistent::Hash<Counted, Counted> Hash;
+    
+    ///Returns the values of a vector in order.
+    static std::vector<int> Contents(const Vector &vector)
+    {
+        std::vector<int> contents;
+        vector.forEach(0, vector.count(), [&contents](Counted *value, size_t index) {
+            contents.push_back(value->value);
+            return true;
+        });
+        return contents;
+    }
+    
+    T11Suite(persistent, [](T11::Suite &s) {
+        s.test("vector push and pop round trip", [](T11::Test &t) {
+            Pool pool;
+            {
+                //Enough values to grow the trie past two levels.
+                const int count = 40000;
+                Vector vector;
+                for (int index = 0; index < count; index++)
+                    vector.push(pool.make(index));
+                
+                t.equal(vector.count(), size_t(count));
+                
+                bool allInPlace = true;
+                for (int index = 0; index < count; index++)
+                    allInPlace = allInPlace && (vector.at(index)->value == index);
+                t.is_true(allInPlace);
+                
+                std::vector<int> expected;
+                for (int index = 0; index < count; index++)
+                    expected.push_back(index);
+                t.is_true(Contents(vector) == expected);
+                
+                bool poppedInOrder = true;
+                for (int index = count - 1; index >= 0; index--) {
+                    poppedInOrder = poppedInOrder && (vector.at(index)->value == index);
+                    vector.pop();
+                }
+                t.is_true(poppedInOrder);
+                t.equal(vector.count(), size_t(0));
+            }
+            t.is_true(pool.isBalanced());
+        });
+        
+        s.test("vector copies are isolated", [](T11::Test &t) {
+            Pool pool;
+            {
+                Vector original;
+                for (int index = 0; index < 2000; index++)
+                    original.push(pool.make(index));
+                
+                std::vector<int> originalContents = Contents(original);
+                
+                Vector copy(original);
+                copy.set(0, pool.make(-1));
+                copy.set(1500, pool.make(-2));
+                copy.set(1999, pool.make(-3));
+                copy.push(pool.make(2000));
+                
+                t.is_true(Contents(original) == originalContents);
+                t.equal(copy.count(), size_t(2001));
+                t.equal(copy.at(0)->value, -1);
+                t.equal(copy.at(1500)->value, -2);
+                t.equal(copy.at(1999)->value, -3);
+                
+                Vector shrunk(original);
+                for (int index = 0; index < 1000; index++)
+                    shrunk.pop();
+                original.set(10, pool.make(-4));
+                
+                t.equal(shrunk.count(), size_t(1000));
+                t.equal(shrunk.at(10)->value, 10);
+                t.equal(original.count(), size_t(2000));
+                t.equal(original.at(10)->value, -4);
+                t.equal(copy.at(10)->value, 10);
+            }
+            t.is_true(pool.isBalanced());
+        });
+        
+        s.test("vector append and assign", [](T11::Test &t) {
+            Pool pool;
+            {
+                std::vector<Counted *> values;
+                for (int index = 0; index < 100; index++)
+                    values.push_back(pool.make(index));
+                
+                Vector first, second;
+                first.assign(values.data(), 60);
+                second.assign(values.data() + 60, 40);
+                
+                Vector joined(first);
+                joined.append(second);
+                t.equal(joined.count(), size_t(100));
+                t.equal(first.count(), size_t(60));
+                
+                std::vector<Counted *> copied;
+                joined.copyInto(copied);
+                t.is_true(copied == values);
+                
+                Vector empty;
+                empty.append(joined);
+                t.is_true(Contents(empty) == Contents(joined));
+                
+                joined.clear();
+                t.equal(joined.count(), size_t(0));
+                t.equal(empty.count(), size_t(100));
+            }
+            t.is_true(pool.isBalanced());
+        });
+        
+        s.test("hash set and remove round trip", [](T11::Test &t) {
+            Pool pool;
+            {
+                const int count = 5000;
+                std::vector<Counted *> keys;
+                Hash hash;
+                for (int index = 0; index < count; index++) {
+                    keys.push_back(pool.make(index));
+                    hash.set(keys.back(), pool.make(index * 2), size_t(index) * 2654435761u);
+                }
+                t.equal(hash.count(), size_t(count));
+                
+                bool allFound = true;
+                for (int index = 0; index < count; index++) {
+                    Counted *value = hash.get(keys[index], size_t(index) * 2654435761u);
+                    allFound = allFound && value && (value->value == index * 2);
+                }
+                t.is_true(allFound);
+                
+                std::set<int> visited;
+                hash.forEach([&visited](Counted *key, Counted *value) {
+                    visited.insert(key->value);
+                    return true;
+                });
+                t.equal(visited.size(), size_t(count));
+                
+                for (int index = 0; index < count; index += 2)
+                    hash.remove(keys[index], size_t(index) * 2654435761u);
+                t.equal(hash.count(), size_t(count / 2));
+                
+                bool removedEvens = true;
+                for (int index = 0; index < count; index++)
+                    removedEvens = removedEvens && (hash.contains(keys[index], size_t(index) * 2654435761u) == (index % 2 == 1));
+                t.is_true(removedEvens);
+            }
+            t.is_true(pool.isBalanced());
+        });
+        
+        s.test("hash copies are isolated", [](T11::Test &t) {
+            Pool pool;
+            {
+                std::vector<Counted *> keys;
+                Hash original;
+                for (int index = 0; index < 500; index++) {
+                    keys.push_back(pool.make(index));
+                    original.set(keys.back(), pool.make(index), size_t(index));
+                }
+                
+                Hash copy(original);
+                copy.set(keys[7], pool.make(-7), 7);
+                copy.remove(keys[8], 8);
+                
+                t.equal(original.get(keys[7], 7)->value, 7);
+                t.is_true(original.contains(keys[8], 8));
+                t.equal(copy.get(keys[7], 7)->value, -7);
+                t.is_false(copy.contains(keys[8], 8));
+                t.equal(original.count(), size_t(500));
+                t.equal(copy.count(), size_t(499));
+            }
+            t.is_true(pool.isBalanced());
+        });
+        
+        s.test("hash collisions", [](T11::Test &t) {
+            Pool pool;
+            {
+                //Every key shares one of four hash codes, so most
+                //keys end up in the collision nodes of the tree.
+                std::vector<Counted *> keys;
+                Hash hash;
+                for (int index = 0; index < 200; index++) {
+                    keys.push_back(pool.make(index));
+                    hash.set(keys.back(), pool.make(index), size_t(index % 4));
+                }
+                t.equal(hash.count(), size_t(200));
+                
+                Counted *equalKey = pool.make(42);
+                t.equal(hash.get(equalKey, 42 % 4)->value, 42);
+                
+                Hash copy(hash);
+                for (int index = 0; index < 200; index += 3)
+                    copy.remove(keys[index], size_t(index % 4));
+                
+                bool allFound = true, removedThirds = true;
+                for (int index = 0; index < 200; index++) {
+                    allFound = allFound && (hash.get(keys[index], size_t(index % 4))->value == index);
+                    removedThirds = removedThirds && (copy.contains(keys[index], size_t(index % 4)) == (index % 3 != 0));
+                }
+                t.is_true(allFound);
+                t.is_true(removedThirds);
+            }
+            t.is_true(pool.isBalanced());
+        });
+    });
+}
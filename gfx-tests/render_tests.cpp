@@ -0,0 +1,436 @@
+//
+//  render_tests.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/14/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#include "t11.h"
+#include <gfx/gfx_defines.h>
+
+#if GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster
+
+#include <gfx/gfx.h>
+#include <gfx/raster.h>
+#include <gfx/path.h>
+#include <gfx/font.h>
+#include <gfx/attributedstr.h>
+#include <functional>
+#include <vector>
+
+namespace {
+    using namespace gfx;
+    
+    ///The size of the scene drawn by the tests, in points.
+    static const Size kSceneSize = { 240.0, 400.0 };
+    
+    ///The scale the scene is drawn at. Each band of a deferred canvas is 32 points tall.
+    static const Float kSceneScale = 2.0;
+    
+    ///Creates an opaque checkerboard surface.
+    ///
+    /// \result A new surface with a retain count of 1.
+    static raster::Surface *MakeCheckerboard(size_t width, size_t height)
+    {
+        raster::Surface *surface = new raster::Surface(width, height);
+        for (size_t y = 0; y < height; y++) {
+            uint32_t *row = surface->row(y);
+            for (size_t x = 0; x < width; x++)
+                row[x] = ((x / 4 + y / 4) % 2)? raster::pixel(255, 255, 255, 255) : raster::pixel(30, 60, 90, 255);
+        }
+        
+        return surface;
+    }
+    
+    ///Draws a scene that touches every band of a context with fills, strokes,
+    ///gradients, shadows, clips, transforms, text, and images.
+    static void DrawScene()
+    {
+        Context *context = Context::currentContext();
+        
+        Color::withRGBA(0.95, 0.92, 0.85, 1.0)->set();
+        Path::fillRect(Rect{ {}, kSceneSize });
+        
+        for (int index = 0; index < 12; index++) {
+            Float y = 10.0 + index * 31.0;
+            Color::withRGBA(index / 12.0, 0.3, 1.0 - index / 12.0, 0.8)->set();
+            Path::withOval(Rect{ {10.0 + index * 3.0, y}, {80.0, 40.0} })->fill();
+            
+            Path *roundedRect = Path::withRoundedRect(Rect{ {110.0, y}, {60.0, 24.0} }, 6.0, 6.0);
+            roundedRect->setLineWidth(3.0);
+            roundedRect->stroke();
+            
+            Path::withTriangle(Rect{ {180.0, y}, {30.0, 30.0} }, Path::TriangleDirection::Up)->fill();
+        }
+        
+        Array<Color> *colors = make<Array<Color>>(std::vector<Color *>{ Color::red(), Color::yellow(), Color::blue() });
+        Gradient *gradient = make<Gradient>(colors, std::vector<Float>{ 0.0, 0.5, 1.0 }, Gradient::DrawingInformation(Float(45.0)));
+        gradient->drawLinearInRect(Rect{ {20.0, 50.0}, {100.0, 60.0} }, 45.0);
+        gradient->drawRadialInPath(Path::withOval(Rect{ {130.0, 120.0}, {90.0, 90.0} }), Point(0.3, 0.3));
+        
+        context->transaction([](Context *context) {
+            make<Shadow>(Size(4.0, 4.0), 3.0, Color::black())->set();
+            Color::orange()->set();
+            Path::fillRect(Rect{ {30.0, 220.0}, {60.0, 40.0} });
+        });
+        
+        context->transaction([](Context *context) {
+            context->concatTransformationMatrix(Transform2D::makeTranslation(160.0, 300.0).rotate(0.3));
+            Path::withOval(Rect{ {-40.0, -30.0}, {80.0, 60.0} })->set();
+            Color::green()->set();
+            Path::fillRect(Rect{ {-50.0, -50.0}, {100.0, 100.0} });
+            Color::purple()->set();
+            Path::strokeLine(Point(-50.0, 0.0), Point(50.0, 0.0));
+        });
+        
+        TextAttributes *attributes = make<TextAttributes>();
+        attributes->setFont(Font::regular(14.0));
+        attributes->setForegroundColor(Color::black());
+        make<AttributedString>(str("Bands meet here"), attributes)->drawAtPoint(Point(12.0, 24.0));
+        
+        make<Image>(MakeCheckerboard(16, 16))->drawInRect(Rect{ {190.0, 340.0}, {40.0, 40.0} });
+    }
+    
+    ///Returns a new bitmap context the size of the scene, after drawing into it.
+    static Context *Render(bool deferred, const std::function<void(Context *context)> &functor)
+    {
+        Context *context = Context::bitmapContextWith(kSceneSize, kSceneScale);
+        context->get()->setDeferred(deferred);
+        
+        Context::pushContext(context);
+        functor(context);
+        Context::popContext();
+        
+        return context;
+    }
+    
+    ///Returns whether or not two contexts contain the same pixels.
+    static bool RendersEqually(Context *context, Context *otherContext)
+    {
+        return context->get()->surface()->isEqual(otherContext->get()->surface());
+    }
+    
+    ///Returns whether or not every pixel of a context is transparent.
+    static bool IsBlank(Context *context)
+    {
+        raster::Surface *surface = context->get()->surface();
+        const uint32_t *pixels = surface->pixels();
+        for (size_t index = 0, count = surface->width() * surface->height(); index < count; index++) {
+            if(pixels[index] != 0)
+                return false;
+        }
+        
+        return true;
+    }
+    
+    T11Suite(render, [](T11::Suite &s) {
+        s.setup([] {
+            Session::init(0, nullptr);
+        });
+        
+        s.test("deferred drawing matches immediate drawing", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            Context *immediate = Render(false, [](Context *) { DrawScene(); });
+            Context *deferred = Render(true, [](Context *) { DrawScene(); });
+            t.is_false(IsBlank(immediate));
+            t.is_true(RendersEqually(deferred, immediate));
+        });
+        
+        s.test("deferred drawing that flushes itself matches immediate drawing", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            auto drawRects = [](Context *) {
+                for (size_t index = 0; index < raster::Canvas::kMaximumDeferredCommands + 500; index++) {
+                    Color::withRGBA((index % 7) / 7.0, (index % 11) / 11.0, (index % 13) / 13.0, 0.5)->set();
+                    Path::fillRect(Rect{ {Float(index % 200), Float(index % 360)}, {20.0, 20.0} });
+                }
+            };
+            
+            Context *immediate = Render(false, drawRects);
+            Context *deferred = Render(true, drawRects);
+            t.is_true(RendersEqually(deferred, immediate));
+        });
+        
+        s.test("replayed display lists match direct drawing", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            Context *direct = Render(true, [](Context *) { DrawScene(); });
+            
+            DisplayList *displayList = make<DisplayList>(Rect{ {}, kSceneSize });
+            Context *replayed = Render(true, [displayList](Context *context) {
+                context->record(displayList, [](Context *) { DrawScene(); });
+                displayList->replay(context);
+            });
+            t.is_false(displayList->isEmpty());
+            t.is_true(RendersEqually(replayed, direct));
+        });
+        
+        s.test("recording does not draw", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            DisplayList *displayList = make<DisplayList>(Rect{ {}, kSceneSize });
+            Context *recorded = Render(true, [displayList](Context *context) {
+                context->record(displayList, [](Context *) { DrawScene(); });
+            });
+            t.is_true(IsBlank(recorded));
+        });
+        
+        s.test("transformed display lists match transformed drawing", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            //Ovals are left out, as `Path::withOval` bakes in the transform they are built under.
+            auto drawShapes = [] {
+                Color::purple()->set();
+                Path::withRoundedRect(Rect{ {10.0, 10.0}, {120.0, 80.0} }, 12.0, 12.0)->fill();
+                Path::withTriangle(Rect{ {140.0, 100.0}, {80.0, 120.0} }, Path::TriangleDirection::Left)->stroke();
+                
+                Array<Color> *colors = make<Array<Color>>(std::vector<Color *>{ Color::red(), Color::blue() });
+                Gradient *gradient = make<Gradient>(colors, std::vector<Float>{ 0.0, 1.0 }, Gradient::DrawingInformation(Float(30.0)));
+                gradient->drawLinearInRect(Rect{ {20.0, 240.0}, {200.0, 100.0} }, 30.0);
+                
+                TextAttributes *attributes = make<TextAttributes>();
+                attributes->setFont(Font::regular(20.0));
+                attributes->setForegroundColor(Color::black());
+                make<AttributedString>(str("Replayed"), attributes)->drawAtPoint(Point(20.0, 360.0));
+            };
+            
+            Transform2D transform = Transform2D::makeTranslation(40.0, 60.0).scale(0.5, 0.5);
+            Context *direct = Render(true, [transform, &drawShapes](Context *context) {
+                context->transaction([transform, &drawShapes](Context *context) {
+                    context->concatTransformationMatrix(transform);
+                    drawShapes();
+                });
+            });
+            
+            DisplayList *displayList = make<DisplayList>(Rect{ {}, kSceneSize });
+            Context *replayed = Render(true, [displayList, transform, &drawShapes](Context *context) {
+                context->record(displayList, [&drawShapes](Context *) { drawShapes(); });
+                displayList->replay(context, transform);
+            });
+            t.is_false(IsBlank(direct));
+            t.is_true(RendersEqually(replayed, direct));
+        });
+        
+        s.test("instanced fills match individual fills", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            std::vector<Transform2D> transforms;
+            for (int index = 0; index < 40; index++)
+                transforms.push_back(Transform2D::makeTranslation(10.0 + (index % 8) * 28.0, 10.0 + (index / 8) * 75.0).rotate(index * 0.1));
+            
+            Context *individual = Render(true, [&transforms](Context *) {
+                Color::blue()->set();
+                for (const Transform2D &transform : transforms) {
+                    Context::currentContext()->transaction([&transform](Context *context) {
+                        context->concatTransformationMatrix(transform);
+                        Path::withTriangle(Rect{ {}, {20.0, 20.0} }, Path::TriangleDirection::Right)->fill();
+                    });
+                }
+            });
+            
+            Context *instanced = Render(true, [&transforms](Context *) {
+                Color::blue()->set();
+                Path::withTriangle(Rect{ {}, {20.0, 20.0} }, Path::TriangleDirection::Right)->fillInstances(transforms);
+            });
+            t.is_true(RendersEqually(instanced, individual));
+        });
+        
+        s.test("quick rejection counts culled drawing", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            Context *context = Render(true, [&t](Context *context) {
+                context->resetStatistics();
+                Color::red()->set();
+                Path::withOval(Rect{ {300.0, 500.0}, {20.0, 20.0} })->fill();
+                t.equal(context->culledOperationCount(), size_t(1));
+                t.equal(context->drawnOperationCount(), size_t(0));
+                
+                context->transaction([](Context *) {
+                    make<Shadow>(Size(4.0, 4.0), 3.0, Color::black())->set();
+                    Path::withOval(Rect{ {300.0, 500.0}, {20.0, 20.0} })->fill();
+                });
+                t.equal(context->culledOperationCount(), size_t(1));
+                t.equal(context->drawnOperationCount(), size_t(1));
+                
+                context->resetStatistics();
+                t.equal(context->culledOperationCount(), size_t(0));
+                t.equal(context->drawnOperationCount(), size_t(0));
+            });
+            t.is_true(IsBlank(context));
+        });
+        
+        s.test("drawn text is stable", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            //The second rendering composites glyphs cached by the first.
+            auto drawText = [](Context *) {
+                TextAttributes *attributes = make<TextAttributes>();
+                attributes->setFont(Font::regular(18.0));
+                attributes->setForegroundColor(Color::black());
+                make<AttributedString>(str("The quick brown fox jumps over the lazy dog"), attributes)->drawInRect(Rect{ {10.0, 10.0}, {220.0, 380.0} });
+            };
+            Context *first = Render(true, drawText);
+            Context *second = Render(false, drawText);
+            t.is_false(IsBlank(first));
+            t.is_true(RendersEqually(second, first));
+        });
+        
+        s.test("surfaces reusing pooled pixels are transparent", [](T11::Test &t) {
+            raster::Surface *surface = MakeCheckerboard(256, 256);
+            surface->release();
+            
+            raster::Surface *reused = new raster::Surface(256, 256);
+            bool isTransparent = true;
+            for (size_t index = 0; index < 256 * 256; index++)
+                isTransparent = isTransparent && (reused->pixels()[index] == 0);
+            t.is_true(isTransparent);
+            reused->release();
+        });
+        
+        s.test("surface pool buckets", [](T11::Test &t) {
+            bool bucketsFit = true;
+            for (size_t count = 1; count < 4096 * 4096; count = count * 9 / 8 + 1) {
+                size_t capacity = raster::SurfacePool::bucketCapacity(count);
+                bucketsFit = bucketsFit && (capacity >= count);
+                if(count > raster::SurfacePool::kMinimumPooledPixels)
+                    bucketsFit = bucketsFit && (capacity - count < count / 4);
+                else if(count < raster::SurfacePool::kMinimumPooledPixels)
+                    bucketsFit = bucketsFit && (capacity == count);
+            }
+            t.is_true(bucketsFit);
+            
+            size_t capacity = raster::SurfacePool::bucketCapacity(300 * 300);
+            raster::SurfacePool surfacePool(capacity * sizeof(uint32_t));
+            std::vector<uint32_t> pixels = surfacePool.acquire(300 * 300);
+            const uint32_t *storage = pixels.data();
+            surfacePool.recycle(pixels);
+            t.equal(surfacePool.pooledBytes(), capacity * sizeof(uint32_t));
+            
+            std::vector<uint32_t> reused = surfacePool.acquire(300 * 299);
+            t.is_true(reused.data() == storage);
+            t.equal(surfacePool.pooledBytes(), size_t(0));
+            
+            std::vector<uint32_t> larger = surfacePool.acquire(300 * 400);
+            surfacePool.recycle(reused);
+            surfacePool.recycle(larger);
+            t.equal(surfacePool.pooledBytes(), capacity * sizeof(uint32_t));
+            
+            surfacePool.purge();
+            t.equal(surfacePool.pooledBytes(), size_t(0));
+        });
+    });
+    
+    T11Suite(layers, [](T11::Suite &s) {
+        s.setup([] {
+            Session::init(0, nullptr);
+        });
+        
+        s.test("concurrent layers match serial layers", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            auto makeTree = [](bool drawsConcurrently) {
+                Layer *root = make<Layer>(Rect{ {}, kSceneSize }, [](Layer *, Rect) {
+                    Color::withRGBA(0.95, 0.92, 0.85, 1.0)->set();
+                    Path::fillRect(Rect{ {}, kSceneSize });
+                }, kSceneScale);
+                root->setDrawsConcurrently(drawsConcurrently);
+                
+                for (int index = 0; index < 8; index++) {
+                    Layer *sublayer = make<Layer>(Rect{ {Float(index * 25.0), Float(index * 45.0)}, {100.0, 60.0} }, [index](Layer *, Rect) {
+                        Color::withRGBA(index / 8.0, 0.5, 0.2, 0.7)->set();
+                        Path::withOval(Rect{ {5.0, 5.0}, {90.0, 50.0} })->fill();
+                        Color::black()->set();
+                        Path::withRoundedRect(Rect{ {2.0, 2.0}, {96.0, 56.0} }, 8.0, 8.0)->stroke();
+                    }, kSceneScale);
+                    sublayer->setDrawsConcurrently(drawsConcurrently);
+                    root->addSublayer(sublayer);
+                }
+                
+                return root;
+            };
+            
+            Context *concurrent = Render(true, [&makeTree](Context *context) { makeTree(true)->render(context); });
+            Context *serial = Render(true, [&makeTree](Context *context) { makeTree(false)->render(context); });
+            t.is_false(IsBlank(serial));
+            t.is_true(RendersEqually(concurrent, serial));
+        });
+        
+        s.test("concurrent script layers match serial script layers", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            Interpreter *interpreter = make<Interpreter>();
+            Graphics::AttachTo(interpreter);
+            
+            Context *concurrent = nullptr, *serial = nullptr;
+            Render(true, [interpreter, &concurrent, &serial](Context *) {
+                StackFrame *frame = make<StackFrame>(interpreter->rootFrame(), interpreter);
+                interpreter->eval(frame, Parser(str("#336699 =>tint "
+                                                    "{ =>rect tint set-fill [10 10 80 40] path/oval path/fill } =>draw "
+                                                    "[0 0 100 60] &draw layer "
+                                                    "[0 0 100 60] &draw layer")).parse());
+                Layer *serialLayer = frame->popType<Layer>();
+                Layer *concurrentLayer = frame->popType<Layer>();
+                serialLayer->setDrawsConcurrently(false);
+                
+                concurrent = Render(true, [concurrentLayer](Context *context) { concurrentLayer->render(context); });
+                serial = Render(true, [serialLayer](Context *context) { serialLayer->render(context); });
+            });
+            t.is_false(IsBlank(serial));
+            t.is_true(RendersEqually(concurrent, serial));
+        });
+        
+        s.test("partial redraws match full redraws", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            std::vector<Rect> drawnRects;
+            Layer *layer = nullptr;
+            Render(true, [&drawnRects, &layer](Context *) {
+                layer = make<Layer>(Rect{ {}, kSceneSize }, [&drawnRects](Layer *, Rect rect) {
+                    drawnRects.push_back(rect);
+                    DrawScene();
+                }, kSceneScale);
+            });
+            
+            Context *full = Render(true, [layer](Context *context) { layer->render(context); });
+            
+            Rect dirtyRect = { {50.0, 70.0}, {100.0, 120.0} };
+            layer->setNeedsDisplayInRect(dirtyRect);
+            Context *partial = Render(true, [layer](Context *context) { layer->render(context); });
+            
+            t.equal(drawnRects.size(), size_t(2));
+            t.is_true(drawnRects.back().origin.x == dirtyRect.origin.x && drawnRects.back().origin.y == dirtyRect.origin.y &&
+                      drawnRects.back().size.width == dirtyRect.size.width && drawnRects.back().size.height == dirtyRect.size.height);
+            t.is_false(IsBlank(full));
+            t.is_true(RendersEqually(partial, full));
+        });
+        
+        s.test("partial redraws only change the dirty rect", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            Color *color = Color::red();
+            Layer *layer = nullptr;
+            Render(true, [&color, &layer](Context *) {
+                layer = make<Layer>(Rect{ {}, {64.0, 64.0} }, [&color](Layer *, Rect) {
+                    color->set();
+                    Path::fillRect(Rect{ {}, {64.0, 64.0} });
+                }, 1.0);
+            });
+            
+            Context *context = Context::bitmapContextWith(Size(64.0, 64.0), 1.0);
+            layer->render(context);
+            
+            color = Color::blue();
+            layer->setNeedsDisplayInRect(Rect{ {16.0, 16.0}, {16.0, 16.0} });
+            layer->render(context);
+            
+            raster::Surface *surface = context->get()->surface();
+            t.equal(surface->row(8)[8], raster::pixel(255, 0, 0, 255));
+            t.equal(surface->row(20)[20], raster::pixel(0, 0, 255, 255));
+            t.equal(surface->row(40)[20], raster::pixel(255, 0, 0, 255));
+        });
+    });
+}
+
+#endif /* GFX_Include_GraphicsStack && GFX_Graphics_Use_Raster */
@@ -0,0 +1,215 @@
+//
+//  spatialindex_tests.cpp
+//  gfx
+//
+//  Created by Kevin MacWhinnie on 2/14/14.
+//  Copyright (c) 2014 Roundabout Software, LLC. All rights reserved.
+//
+
+#include "t11.h"
+#include <gfx/gfx_defines.h>
+
+#if GFX_Include_GraphicsStack
+
+#include <gfx/gfx.h>
+#include <gfx/path.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace {
+    using namespace gfx;
+    
+    ///A deterministic source of coordinates.
+    class Coordinates
+    {
+        uint32_t mState;
+    
+    public:
+        Coordinates() :
+            mState(0x2545F491)
+        {
+        }
+        
+        ///Returns the next coordinate, in `[0, range)`.
+        Float next(Float range)
+        {
+            mState ^= mState << 13;
+            mState ^= mState >> 17;
+            mState ^= mState << 5;
+            return (mState % 1000000) / 1000000.0 * range;
+        }
+    };
+    
+    ///Returns an assortment of ovals, rectangles, and triangles scattered over a 1000 by 1000 area.
+    static std::vector<Path *> MakePaths(size_t count)
+    {
+        Coordinates coordinates;
+        std::vector<Path *> paths;
+        for (size_t index = 0; index < count; index++) {
+            Rect rect = { {coordinates.next(1000.0), coordinates.next(1000.0)}, {1.0 + coordinates.next(60.0), 1.0 + coordinates.next(60.0)} };
+            switch (index % 3) {
+                case 0:
+                    paths.push_back(Path::withOval(rect));
+                    break;
+                
+                case 1:
+                    paths.push_back(Path::withRect(rect));
+                    break;
+                
+                default:
+                    paths.push_back(Path::withTriangle(rect, Path::TriangleDirection::Down));
+                    break;
+            }
+        }
+        
+        return paths;
+    }
+    
+    ///Returns whether or not two rectangles overlap, including their edges.
+    static bool RectsOverlap(const Rect &a, const Rect &b)
+    {
+        return !(a.getMaxX() < b.getMinX() || a.getMinX() > b.getMaxX() ||
+                 a.getMaxY() < b.getMinY() || a.getMinY() > b.getMaxY());
+    }
+    
+    ///Returns the squared distance from a point to the nearest point of a rectangle.
+    static Float DistanceSquaredToRect(const Rect &rect, Point point)
+    {
+        Float dx = std::max(std::max(rect.getMinX() - point.x, point.x - rect.getMaxX()), 0.0);
+        Float dy = std::max(std::max(rect.getMinY() - point.y, point.y - rect.getMaxY()), 0.0);
+        return dx * dx + dy * dy;
+    }
+    
+    T11Suite(spatialindex, [](T11::Suite &s) {
+        s.setup([] {
+            Session::init(0, nullptr);
+        });
+        
+        s.test("point queries match testing every path", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            std::vector<Path *> paths = MakePaths(2000);
+            SpatialIndex *index = make<SpatialIndex>();
+            for (Path *path : paths)
+                index->add(path);
+            t.equal(index->count(), Index(paths.size()));
+            
+            Coordinates coordinates;
+            bool matches = true;
+            for (int query = 0; query < 500; query++) {
+                Point point(coordinates.next(1000.0), coordinates.next(1000.0));
+                
+                std::vector<Path *> expected;
+                for (Path *path : paths) {
+                    if(path->containsPoint(point))
+                        expected.push_back(path);
+                }
+                
+                std::vector<Path *> found;
+                index->queryPoint(point, [&found](Path *path) { found.push_back(path); });
+                matches = matches && (found == expected);
+            }
+            t.is_true(matches);
+        });
+        
+        s.test("rect queries match testing every path", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            std::vector<Path *> paths = MakePaths(2000);
+            SpatialIndex *index = make<SpatialIndex>();
+            for (Path *path : paths)
+                index->add(path);
+            
+            Coordinates coordinates;
+            bool matches = true;
+            for (int query = 0; query < 200; query++) {
+                Rect rect = { {coordinates.next(1000.0), coordinates.next(1000.0)}, {coordinates.next(200.0), coordinates.next(200.0)} };
+                
+                std::vector<Path *> expected;
+                for (Path *path : paths) {
+                    if(RectsOverlap(path->boundingBox(), rect))
+                        expected.push_back(path);
+                }
+                
+                std::vector<Path *> found;
+                index->queryRect(rect, [&found](Path *path) { found.push_back(path); });
+                matches = matches && (found == expected);
+            }
+            t.is_true(matches);
+        });
+        
+        s.test("nearest matches testing every path", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            std::vector<Path *> paths = MakePaths(2000);
+            SpatialIndex *index = make<SpatialIndex>();
+            t.is_true(index->nearest(Point(0.0, 0.0)) == nullptr);
+            
+            for (Path *path : paths)
+                index->add(path);
+            
+            Coordinates coordinates;
+            bool matches = true;
+            for (int query = 0; query < 500; query++) {
+                Point point(coordinates.next(1200.0) - 100.0, coordinates.next(1200.0) - 100.0);
+                
+                Path *expected = nullptr;
+                Float bestDistance = std::numeric_limits<Float>::infinity();
+                for (Path *path : paths) {
+                    Float distance = DistanceSquaredToRect(path->boundingBox(), point);
+                    if(distance < bestDistance) {
+                        bestDistance = distance;
+                        expected = path;
+                    }
+                }
+                
+                matches = matches && (index->nearest(point) == expected);
+            }
+            t.is_true(matches);
+        });
+        
+        s.test("removed paths are not found", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            std::vector<Path *> paths = MakePaths(300);
+            SpatialIndex *index = make<SpatialIndex>();
+            for (Path *path : paths)
+                index->add(path);
+            
+            //Query once so that removal has to invalidate a built hierarchy.
+            index->queryRect(Rect{ {}, {1000.0, 1000.0} }, [](Path *) {});
+            for (size_t offset = 0; offset < paths.size(); offset += 2)
+                index->remove(paths[offset]);
+            t.equal(index->count(), Index(paths.size() / 2));
+            
+            bool foundRemoved = false;
+            size_t foundCount = 0;
+            index->queryRect(Rect{ {}, {1100.0, 1100.0} }, [&paths, &foundRemoved, &foundCount](Path *path) {
+                size_t offset = std::find(paths.begin(), paths.end(), path) - paths.begin();
+                foundRemoved = foundRemoved || (offset % 2 == 0);
+                foundCount++;
+            });
+            t.is_false(foundRemoved);
+            t.equal(foundCount, paths.size() / 2);
+            
+            index->remove(make<Path>());
+            t.equal(index->count(), Index(paths.size() / 2));
+            
+            index->removeAll();
+            t.equal(index->count(), Index(0));
+            t.is_true(index->nearest(Point(500.0, 500.0)) == nullptr);
+        });
+        
+        s.test("empty paths are ignored", [](T11::Test &t) {
+            AutoreleasePool pool;
+            
+            SpatialIndex *index = make<SpatialIndex>();
+            index->add(make<Path>());
+            t.equal(index->count(), Index(0));
+            t.throws([index] { index->add(nullptr); });
+        });
+    });
+}
+
+#endif /* GFX_Include_GraphicsStack */